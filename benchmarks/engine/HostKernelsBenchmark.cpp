@@ -0,0 +1,544 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+/**
+ * Measures the host (CPU) kernels of the engine (hostkernels.h) on random data.
+ * The sparsez method times hCalculateSparseZ over a grid of nonzeros per example
+ * and layer widths, for every instruction set the CPU supports, with and without
+ * weight row prefetch, and reports the time per batch and GFLOP/s.  The sparsegradient method times the
+ * sparse input weight gradient, hCalculateSparseTransposedMatrix followed by
+ * hCalculateSparseTransposedWeightGradient, over the same grid.  The activation method
+ * times every activation function and its derivative (hCalculateHadamardProduct) on
+ * batch x width units.  The sparseloss method times the sparse output deltas and errors
+ * (hostloss.cpp) of Sigmoid outputs over the nonzeros and widths grid.  The optimizer method
+ * times every weight update (hostoptimizer.cpp) on a features x width weight matrix.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <omp.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+namespace
+{
+std::vector<uint32_t> parseList(const char *values)
+{
+    std::vector<uint32_t> list;
+    std::stringstream stream(values);
+    std::string value;
+    while (std::getline(stream, value, ','))
+    {
+        list.push_back(strtoul(value.c_str(), NULL, 10));
+    }
+    return list;
+}
+
+std::vector<HostSimd> getSupportedSimd()
+{
+    std::vector<HostSimd> simds;
+    for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+    {
+        if (simd <= hGetSimd())
+        {
+            simds.push_back(simd);
+        }
+    }
+    return simds;
+}
+
+template<typename Function>
+double timeIterations(int iterations, Function function)
+{
+    function();  // warm up
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        function();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+void benchmarkSparseZ(uint32_t features, uint32_t batch, const std::vector<uint32_t> &nonzeros,
+                      const std::vector<uint32_t> &widths, uint32_t prefetch, int iterations)
+{
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<uint32_t> feature(0, features - 1);
+    std::uniform_real_distribution<NNFloat> uniform(-1.0f, 1.0f);
+    std::vector<HostSimd> simds = getSupportedSimd();
+    HostSimd best = hGetSimd();
+
+    printf("%8s %8s %8s %8s %12s %10s\n", "simd", "prefetch", "nonzeros", "width", "ms/batch", "GFLOP/s");
+    for (uint32_t width : widths)
+    {
+        std::vector<NNFloat> weights((size_t) features * width);
+        for (auto &w : weights)
+        {
+            w = uniform(generator);
+        }
+        std::vector<NNFloat> units((size_t) batch * width);
+
+        for (uint32_t count : nonzeros)
+        {
+            std::vector<uint64_t> sparseStart(batch);
+            std::vector<uint64_t> sparseEnd(batch);
+            std::vector<uint32_t> sparseIndex((size_t) batch * count);
+            for (uint32_t i = 0; i < batch; ++i)
+            {
+                sparseStart[i] = (uint64_t) i * count;
+                sparseEnd[i] = sparseStart[i] + count;
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    sparseIndex[sparseStart[i] + j] = feature(generator);
+                }
+            }
+
+            for (HostSimd simd : simds)
+            {
+                hSetSimd(simd);
+                for (uint32_t distance : { 0u, prefetch })
+                {
+                    hSetWeightPrefetch(distance);
+                    double seconds = timeIterations(iterations, [&]()
+                    {
+                        hCalculateSparseZ(0, batch, width, weights.data(), sparseStart.data(), sparseEnd.data(),
+                                          sparseIndex.data(), NULL, units.data(), (NNFloat) 1.0);
+                    });
+                    double flops = 2.0 * batch * count * width;
+                    printf("%8s %8u %8u %8u %12.3f %10.2f\n", hGetSimdName(simd), distance, count, width,
+                           seconds * 1000.0, flops / seconds / 1.0e9);
+                    if (prefetch == 0)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    hSetWeightPrefetch(0);
+    hSetSimd(best);
+}
+
+void benchmarkSparseGradient(uint32_t features, uint32_t batch, const std::vector<uint32_t> &nonzeros,
+                             const std::vector<uint32_t> &widths, int iterations)
+{
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<uint32_t> feature(0, features - 1);
+    std::uniform_real_distribution<NNFloat> uniform(-1.0f, 1.0f);
+    std::vector<HostSimd> simds = getSupportedSimd();
+    HostSimd best = hGetSimd();
+
+    printf("%8s %8s %8s %12s %12s %10s\n", "simd", "nonzeros", "width", "transpose ms", "gradient ms", "GFLOP/s");
+    for (uint32_t width : widths)
+    {
+        std::vector<NNFloat> gradient((size_t) features * width);
+        std::vector<NNFloat> delta((size_t) batch * width);
+        for (auto &d : delta)
+        {
+            d = uniform(generator);
+        }
+
+        for (uint32_t count : nonzeros)
+        {
+            std::vector<uint64_t> sparseStart(batch);
+            std::vector<uint64_t> sparseEnd(batch);
+            std::vector<uint32_t> sparseIndex((size_t) batch * count);
+            std::vector<uint32_t> featureCount(features);
+            for (uint32_t i = 0; i < batch; ++i)
+            {
+                sparseStart[i] = (uint64_t) i * count;
+                sparseEnd[i] = sparseStart[i] + count;
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    sparseIndex[sparseStart[i] + j] = feature(generator);
+                    featureCount[sparseIndex[sparseStart[i] + j]]++;
+                }
+            }
+            std::vector<uint32_t> transposedStart(features);
+            for (uint32_t f = 1; f < features; ++f)
+            {
+                transposedStart[f] = transposedStart[f - 1] + featureCount[f - 1];
+            }
+            std::vector<uint32_t> transposedEnd(features);
+            std::vector<uint32_t> transposedIndex(sparseIndex.size());
+
+            double transposeSeconds = timeIterations(iterations, [&]()
+            {
+                transposedEnd = transposedStart;
+                hCalculateSparseTransposedMatrix(0, batch, sparseStart.data(), sparseEnd.data(), sparseIndex.data(), NULL,
+                                                 transposedEnd.data(), transposedIndex.data(), NULL);
+            });
+            for (HostSimd simd : simds)
+            {
+                hSetSimd(simd);
+                double seconds = timeIterations(iterations, [&]()
+                {
+                    hCalculateSparseTransposedWeightGradient((NNFloat) 1.0, (NNFloat) 1.0, features, width, transposedStart.data(),
+                                                             transposedEnd.data(), transposedIndex.data(), delta.data(), gradient.data());
+                });
+                double flops = 2.0 * batch * count * width;
+                printf("%8s %8u %8u %12.3f %12.3f %10.2f\n", hGetSimdName(simd), count, width, transposeSeconds * 1000.0,
+                       seconds * 1000.0, flops / seconds / 1.0e9);
+            }
+        }
+    }
+    hSetSimd(best);
+}
+
+// Floating point operations per unit of the host activations and derivatives (hostactivation.cpp), counting an
+// FMA as two: exp is 24, expm1 27 and log 30
+struct ActivationCost
+{
+    Activation activation;
+    const char *name;
+    double forward;
+    double derivative;
+};
+
+const ActivationCost activationCosts[] = {
+    { Sigmoid, "Sigmoid", 27, 3 },
+    { Tanh, "Tanh", 44, 5 },
+    { RectifiedLinear, "RELU", 1, 2 },
+    { LeakyRectifiedLinear, "LRELU", 2, 2 },
+    { ExponentialLinear, "ELU", 30, 4 },
+    { ScaledExponentialLinear, "SELU", 31, 5 },
+    { SoftPlus, "SoftPlus", 65, 30 },
+    { SoftSign, "SoftSign", 3, 4 },
+    { SoftMax, "SoftMax", 28, 0 },
+};
+
+void benchmarkActivation(uint32_t batch, const std::vector<uint32_t> &widths, int iterations)
+{
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<NNFloat> uniform(-4.0f, 4.0f);
+    std::vector<HostSimd> simds = getSupportedSimd();
+    HostSimd best = hGetSimd();
+
+    printf("%8s %9s %8s %12s %10s %12s %10s\n", "simd", "function", "width", "forward ms", "GFLOP/s", "deriv ms", "GFLOP/s");
+    for (uint32_t width : widths)
+    {
+        size_t size = (size_t) batch * width;
+        std::vector<NNFloat> input(size);
+        for (auto &x : input)
+        {
+            x = uniform(generator);
+        }
+        std::vector<NNFloat> units(size);
+        std::vector<NNFloat> initialDelta(input.rbegin(), input.rend());
+        std::vector<NNFloat> delta(size);
+
+        for (HostSimd simd : simds)
+        {
+            hSetSimd(simd);
+            for (const ActivationCost &cost : activationCosts)
+            {
+                // Each call starts from the same inputs, the copy is timed separately and subtracted
+                double copySeconds = timeIterations(iterations, [&]()
+                {
+                    units = input;
+                });
+                double seconds = timeIterations(iterations, [&]()
+                {
+                    units = input;
+                    hCalculateActivation(cost.activation, units.data(), batch, width, (NNFloat) 0.1, (NNFloat) 1.0, (NNFloat) 1.0);
+                }) - copySeconds;
+                double derivativeSeconds = timeIterations(iterations, [&]()
+                {
+                    delta = initialDelta;
+                    hCalculateHadamardProduct(cost.activation, size, (NNFloat) 1.0, units.data(), delta.data(), (NNFloat) 0.1,
+                                              (NNFloat) 1.0, (NNFloat) 1.0);
+                }) - copySeconds;
+                printf("%8s %9s %8u %12.3f %10.2f", hGetSimdName(simd), cost.name, width, seconds * 1000.0,
+                       cost.forward * size / seconds / 1.0e9);
+                if (cost.derivative > 0)
+                {
+                    printf(" %12.3f %10.2f\n", derivativeSeconds * 1000.0, cost.derivative * size / derivativeSeconds / 1.0e9);
+                } else
+                {
+                    printf(" %12s %10s\n", "-", "-");
+                }
+            }
+        }
+    }
+    hSetSimd(best);
+}
+
+void printLossTime(HostSimd simd, uint32_t count, uint32_t width, const char *function, const char *suffix, double seconds,
+                   double bytes)
+{
+    printf("%8s %8u %8u %16s %12.3f", hGetSimdName(simd), count, width, (std::string(function) + suffix).c_str(),
+           seconds * 1000.0);
+    if (bytes > 0.0)
+    {
+        printf(" %10.2f\n", bytes / seconds / 1.0e9);
+    } else
+    {
+        printf(" %10s\n", "-");
+    }
+}
+
+// Sparse output delta and error of a Sigmoid output layer with count nonzero targets per example.  GB/s counts the
+// bytes of the zero target sweep: units read and deltas written
+void benchmarkSparseLoss(uint32_t batch, const std::vector<uint32_t> &nonzeros, const std::vector<uint32_t> &widths,
+                         int iterations)
+{
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<NNFloat> uniform(0.0f, 1.0f);
+    std::vector<HostSimd> simds = getSupportedSimd();
+    HostSimd best = hGetSimd();
+
+    printf("%8s %8s %8s %16s %12s %10s\n", "simd", "nonzeros", "width", "function", "ms/batch", "GB/s");
+    for (uint32_t width : widths)
+    {
+        std::uniform_int_distribution<uint32_t> output(0, width - 1);
+        std::vector<NNFloat> units((size_t) batch * width);
+        for (auto &u : units)
+        {
+            u = uniform(generator);
+        }
+        std::vector<NNFloat> delta(units.size());
+
+        for (uint32_t count : nonzeros)
+        {
+            std::vector<uint64_t> sparseStart(batch);
+            std::vector<uint64_t> sparseEnd(batch);
+            std::vector<uint32_t> sparseIndex((size_t) batch * count);
+            for (uint32_t i = 0; i < batch; ++i)
+            {
+                sparseStart[i] = (uint64_t) i * count;
+                sparseEnd[i] = sparseStart[i] + count;
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    sparseIndex[sparseStart[i] + j] = output(generator);
+                }
+            }
+
+            for (HostSimd simd : simds)
+            {
+                hSetSimd(simd);
+                for (bool bSparseIgnoreZero : { false, true })
+                {
+                    const char *suffix = bSparseIgnoreZero ? " ignore0" : "";
+                    double l2Seconds = timeIterations(iterations, [&]()
+                    {
+                        hCalculateSparseOutputDelta(Sigmoid, 0, batch, width, units.data(), delta.data(), sparseStart.data(),
+                                                    sparseEnd.data(), sparseIndex.data(), NULL, bSparseIgnoreZero,
+                                                    (NNFloat) 0.1, (NNFloat) 1.0, (NNFloat) 1.0);
+                    });
+                    double crossEntropySeconds = timeIterations(iterations, [&]()
+                    {
+                        hCalculateSparseCrossEntropyOutputDelta(Sigmoid, 0, batch, width, units.data(), delta.data(),
+                                                                sparseStart.data(), sparseEnd.data(), sparseIndex.data(), NULL,
+                                                                bSparseIgnoreZero);
+                    });
+                    double errorSeconds = timeIterations(iterations, [&]()
+                    {
+                        hCalculateSparseCrossEntropyError(0, batch, width, units.data(), sparseStart.data(), sparseEnd.data(),
+                                                          sparseIndex.data(), NULL, bSparseIgnoreZero);
+                    });
+                    // With bSparseIgnoreZero the deltas are only cleared and the error reads the nonzero targets alone
+                    double units = (double) batch * width;
+                    printLossTime(simd, count, width, "L2 delta", suffix, l2Seconds, (bSparseIgnoreZero ? 4.0 : 8.0) * units);
+                    printLossTime(simd, count, width, "CE delta", suffix, crossEntropySeconds, (bSparseIgnoreZero ? 4.0 : 8.0) * units);
+                    printLossTime(simd, count, width, "CE error", suffix, errorSeconds, bSparseIgnoreZero ? 0.0 : 4.0 * units);
+                }
+            }
+        }
+    }
+    hSetSimd(best);
+}
+
+// Weight updates with the bytes each one reads and writes per weight: the weight and gradient, plus one or two
+// velocities, all read and all but the gradient written
+struct OptimizerCost
+{
+    TrainingMode mode;
+    const char *name;
+    double bytes;
+};
+
+const OptimizerCost optimizerCosts[] = {
+    { SGD, "SGD", 12 },
+    { Momentum, "Momentum", 20 },
+    { AdaGrad, "AdaGrad", 20 },
+    { Nesterov, "Nesterov", 20 },
+    { RMSProp, "RMSProp", 20 },
+    { AdaDelta, "AdaDelta", 28 },
+    { Adam, "Adam", 28 },
+};
+
+void benchmarkOptimizer(uint32_t features, const std::vector<uint32_t> &widths, int iterations)
+{
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<NNFloat> uniform(-0.01f, 0.01f);
+    std::vector<HostSimd> simds = getSupportedSimd();
+    HostSimd best = hGetSimd();
+    const NNFloat alpha = 0.001f;
+    const NNFloat lambda = 0.0001f;
+    const NNFloat lambda1 = 0.00001f;
+    const NNFloat mu = 0.9f;
+    const NNFloat mu1 = 0.999f;
+
+    printf("%8s %9s %8s %12s %10s\n", "simd", "optimizer", "width", "ms/update", "GB/s");
+    for (uint32_t width : widths)
+    {
+        size_t size = (size_t) features * width;
+        std::vector<NNFloat> weights(size);
+        std::vector<NNFloat> gradient(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            weights[i] = uniform(generator);
+            gradient[i] = uniform(generator);
+        }
+        std::vector<NNFloat> velocity(size, (NNFloat) 0.0);
+        std::vector<NNFloat> gradientVelocity(size, (NNFloat) 0.0);
+
+        for (HostSimd simd : simds)
+        {
+            hSetSimd(simd);
+            for (const OptimizerCost &cost : optimizerCosts)
+            {
+                NNFloat t = (NNFloat) 0.0;
+                double seconds = timeIterations(iterations, [&]()
+                {
+                    switch (cost.mode)
+                    {
+                        case SGD:
+                            hSGDUpdateWeights(alpha, lambda, lambda1, size, gradient.data(), weights.data());
+                            break;
+                        case Momentum:
+                            hMomentumUpdateWeights(alpha, lambda, lambda1, mu, size, velocity.data(), gradient.data(), weights.data());
+                            break;
+                        case AdaGrad:
+                            hAdaGradUpdateWeights(alpha, lambda, lambda1, size, velocity.data(), gradient.data(), weights.data());
+                            break;
+                        case Nesterov:
+                            hNesterovUpdateWeights(alpha, lambda, lambda1, mu, size, velocity.data(), gradient.data(), weights.data());
+                            break;
+                        case RMSProp:
+                            hRMSPropUpdateWeights(alpha, lambda, lambda1, mu, size, velocity.data(), gradient.data(), weights.data());
+                            break;
+                        case AdaDelta:
+                            hAdaDeltaUpdateWeights(lambda, lambda1, mu, size, velocity.data(), gradient.data(), gradientVelocity.data(),
+                                                   weights.data());
+                            break;
+                        case Adam:
+                            hAdamUpdateWeights(alpha, lambda, lambda1, mu, mu1, t, size, velocity.data(), gradient.data(),
+                                               gradientVelocity.data(), weights.data());
+                            break;
+                    }
+                    t += (NNFloat) 1.0;
+                });
+                printf("%8s %9s %8u %12.3f %10.2f\n", hGetSimdName(simd), cost.name, width, seconds * 1000.0,
+                       cost.bytes * size / seconds / 1.0e9);
+            }
+        }
+    }
+    hSetSimd(best);
+}
+
+void printUsage()
+{
+    fprintf(stderr, "Usage: hostKernelsBenchmark [-m method] [-f features] [-b batch_size] [-n nonzeros] [-w widths] [-p prefetch] [-i iterations]\n");
+    fprintf(stderr, "    -m method: (default = sparsez) sparsez, sparsegradient, activation, sparseloss or optimizer\n");
+    fprintf(stderr, "    -f features: (default = 100000) input features (rows of the weight matrix)\n");
+    fprintf(stderr, "    -b batch_size: (default = 1024) examples per call\n");
+    fprintf(stderr, "    -n nonzeros: (default = 1,8,32,128) comma separated nonzeros per example\n");
+    fprintf(stderr, "    -w widths: (default = 128,512,2048) comma separated layer widths\n");
+    fprintf(stderr, "    -p prefetch: (default = 4) sparsez weight row prefetch distance timed next to no prefetch, 0 to skip\n");
+    fprintf(stderr, "    -i iterations: (default = 20) number of timed calls\n");
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::string method = "sparsez";
+    uint32_t features = 100000;
+    uint32_t batch = 1024;
+    std::vector<uint32_t> nonzeros = { 1, 8, 32, 128 };
+    std::vector<uint32_t> widths = { 128, 512, 2048 };
+    uint32_t prefetch = 4;
+    int iterations = 20;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:f:b:n:w:p:i:h")) != -1)
+    {
+        switch (opt) {
+            case 'm':
+                method = optarg;
+                break;
+            case 'f':
+                features = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                batch = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                nonzeros = parseList(optarg);
+                break;
+            case 'w':
+                widths = parseList(optarg);
+                break;
+            case 'p':
+                prefetch = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            default:
+                printUsage();
+                return 1;
+        }
+    }
+
+    printf("method=%s threads=%d best simd=%s\n", method.c_str(), omp_get_max_threads(), hGetSimdName(hGetSimd()));
+    if (method == "sparsez")
+    {
+        printf("features=%u batch=%u\n", features, batch);
+        benchmarkSparseZ(features, batch, nonzeros, widths, prefetch, iterations);
+    } else if (method == "sparsegradient")
+    {
+        printf("features=%u batch=%u\n", features, batch);
+        benchmarkSparseGradient(features, batch, nonzeros, widths, iterations);
+    } else if (method == "activation")
+    {
+        printf("batch=%u\n", batch);
+        benchmarkActivation(batch, widths, iterations);
+    } else if (method == "sparseloss")
+    {
+        printf("batch=%u\n", batch);
+        benchmarkSparseLoss(batch, nonzeros, widths, iterations);
+    } else if (method == "optimizer")
+    {
+        printf("features=%u\n", features);
+        benchmarkOptimizer(features, widths, iterations);
+    } else
+    {
+        fprintf(stderr, "ERROR: unknown method %s\n", method.c_str());
+        printUsage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,662 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+/**
+ * Measures search throughput (queries/s) of the astdl::knn implementations
+ * on random data. For approximate methods also reports recall@k against the
+ * exact CPU search on the same data for each requested nprobe, and for
+ * quantized data types (int8, pq) recall@k and memory against fp32.
+ * The merge method times the merge of per partition top k results alone.
+ * The serve method is a load generator: single query requests arrive at a
+ * target rate (poisson) and are batched by a BatchScheduler in front of the
+ * exact search; it reports the latency percentiles.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <omp.h>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "amazon/dsstne/knn/DataReader.h"
+#include "amazon/dsstne/knn/ExclusionSet.h"
+#include "amazon/dsstne/knn/KnnData.h"
+#include "amazon/dsstne/knn/KnnExactCpu.h"
+#include "amazon/dsstne/knn/KnnExactGpu.h"
+#include "amazon/dsstne/knn/KnnIvfCpu.h"
+#include "amazon/dsstne/knn/KnnMerge.h"
+#include "amazon/dsstne/runtime/BatchScheduler.h"
+
+using namespace astdl::knn;
+
+namespace
+{
+const float CLUSTER_STDDEV = 0.1f;
+
+void generateVector(std::mt19937 &generator, std::uniform_real_distribution<float> &distribution,
+                    std::normal_distribution<float> &noise, const std::vector<float> &centers, int columns,
+                    float *vector)
+{
+    if (centers.empty())
+    {
+        for (int j = 0; j < columns; ++j)
+        {
+            vector[j] = distribution(generator);
+        }
+    } else
+    {
+        size_t center = generator() % (centers.size() / columns);
+        for (int j = 0; j < columns; ++j)
+        {
+            vector[j] = centers[center * columns + j] + noise(generator);
+        }
+    }
+}
+
+/**
+ * Generates rows of uniform random values in [-1, 1), or, when centers are
+ * given, rows drawn from gaussians around a randomly picked center (uniform
+ * data has no structure for an approximate index to exploit).
+ */
+class RandomDataReader: public DataReader
+{
+  public:
+    RandomDataReader(uint32_t rows, int columns, int partition, const std::vector<float> &centers) :
+        generator(partition),
+        distribution(-1.0f, 1.0f),
+        noise(0.0f, CLUSTER_STDDEV),
+        centers(centers),
+        position(0),
+        partition(partition)
+    {
+        this->rows = rows;
+        this->columns = columns;
+    }
+
+    bool readRow(std::string *key, float *vector)
+    {
+        if (position >= rows)
+        {
+            return false;
+        }
+        *key = std::to_string(partition) + "_" + std::to_string(position);
+        generateVector(generator, distribution, noise, centers, columns, vector);
+        ++position;
+        return true;
+    }
+
+  private:
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> distribution;
+    std::normal_distribution<float> noise;
+    const std::vector<float> &centers;
+    uint32_t position;
+    int partition;
+};
+
+/**
+ * Loads partitions x rows random rows into data and returns the seconds it took.
+ */
+double loadData(KnnData &data, int partitions, uint32_t rows, int columns, const std::vector<float> &centers)
+{
+    std::map<int, DataReader*> readers;
+    for (int p = 0; p < partitions; ++p)
+    {
+        readers[p] = new RandomDataReader(rows, columns, p, centers);
+    }
+    auto start = std::chrono::steady_clock::now();
+    data.load(readers);
+    auto end = std::chrono::steady_clock::now();
+    for (auto &entry : readers)
+    {
+        delete entry.second;
+    }
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * Returns the seconds per search call, averaged over iterations (after one warm up call).
+ */
+double timeSearch(Knn &knn, int k, const std::vector<float> &queries, std::vector<std::string> &keys,
+                  std::vector<float> &scores, int iterations)
+{
+    knn.search(k, queries.data(), keys.data(), scores.data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        knn.search(k, queries.data(), keys.data(), scores.data());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+/**
+ * Average seconds per search of the batch with every query filtered by exclusions.
+ */
+double timeFilteredSearch(Knn &knn, int k, int batchSize, const std::vector<float> &queries,
+                          const ExclusionSet &exclusions, std::vector<std::string> &keys, std::vector<float> &scores,
+                          int iterations)
+{
+    knn.search(k, queries.data(), batchSize, { &exclusions }, keys.data(), scores.data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        knn.search(k, queries.data(), batchSize, { &exclusions }, keys.data(), scores.data());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+/**
+ * Fraction of the exact top k keys of each query that are in the approximate top k.
+ */
+double recall(const std::vector<std::string> &exactKeys, const std::vector<std::string> &keys, int batchSize, int k)
+{
+    size_t hits = 0;
+    for (int q = 0; q < batchSize; ++q)
+    {
+        std::set<std::string> expected(exactKeys.begin() + q * k, exactKeys.begin() + (q + 1) * k);
+        for (int i = 0; i < k; ++i)
+        {
+            hits += expected.count(keys[q * k + i]);
+        }
+    }
+    return (double) hits / ((size_t) batchSize * k);
+}
+
+/**
+ * The merge mergeKnn replaced: a linear scan over the partition heads for every
+ * output slot, copying the key of every slot. Kept as the baseline.
+ */
+void linearMergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+                    const std::vector<uint32_t*> &allIndexes, const std::vector<std::vector<std::string>> &allKeys,
+                    float *scores, std::string *keys)
+{
+    std::vector<int> positions(numPartitions);
+    for (int i = 0; i < batchSize; ++i)
+    {
+        for (int n = 0; n < numPartitions; ++n)
+        {
+            positions[n] = i * width;
+        }
+        for (int col = 0; col < k; ++col)
+        {
+            int maxPartition = 0;
+            float maxVal = allScores[0][positions[0]];
+            for (int n = 1; n < numPartitions; ++n)
+            {
+                if (maxVal < allScores[n][positions[n]])
+                {
+                    maxVal = allScores[n][positions[n]];
+                    maxPartition = n;
+                }
+            }
+            uint32_t maxIdx = allIndexes[maxPartition][positions[maxPartition]++];
+            scores[i * k + col] = maxVal;
+            keys[i * k + col] = allKeys[maxPartition][maxIdx];
+        }
+    }
+}
+
+template<typename Merge>
+double timeMerge(Merge merge, int iterations)
+{
+    merge();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        merge();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count() / iterations;
+}
+
+/**
+ * Times merging the sorted top k of 1 to 8 partitions for k = 10, 100 and 1000 with
+ * the linear merge, the heap merge returning keys and the heap merge returning indexes.
+ */
+void benchmarkMerge(int batchSize, uint32_t rows, int iterations)
+{
+    const int maxPartitions = 8;
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    // the linear merge is timed with its original key storage
+    std::vector<std::vector<std::string>> stringKeys(maxPartitions);
+    std::vector<KeyArena> allKeys(maxPartitions);
+    for (int p = 0; p < maxPartitions; ++p)
+    {
+        for (uint32_t row = 0; row < rows; ++row)
+        {
+            stringKeys[p].push_back("item_key_" + std::to_string(p) + "_" + std::to_string(row));
+            allKeys[p].append(stringKeys[p].back());
+        }
+    }
+
+    printf("%10s %6s %14s %14s %14s\n", "partitions", "k", "linear ms", "heap keys ms", "heap index ms");
+    for (int k : { 10, 100, 1000 })
+    {
+        std::vector<std::vector<float>> partitionScores(maxPartitions, std::vector<float>((size_t) batchSize * k));
+        std::vector<std::vector<uint32_t>> partitionIndexes(maxPartitions, std::vector<uint32_t>((size_t) batchSize * k));
+        for (int p = 0; p < maxPartitions; ++p)
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                float *row = partitionScores[p].data() + (size_t) i * k;
+                std::generate(row, row + k, [&]() { return distribution(generator); });
+                std::sort(row, row + k, std::greater<float>());
+            }
+            std::generate(partitionIndexes[p].begin(), partitionIndexes[p].end(), [&]() { return generator() % rows; });
+        }
+
+        std::vector<float> scores((size_t) batchSize * k);
+        std::vector<std::string> keys((size_t) batchSize * k);
+        std::vector<uint32_t> resultPartitions((size_t) batchSize * k);
+        std::vector<uint32_t> resultRows((size_t) batchSize * k);
+        for (int numPartitions = 1; numPartitions <= maxPartitions; ++numPartitions)
+        {
+            std::vector<float*> allScores;
+            std::vector<uint32_t*> allIndexes;
+            for (int p = 0; p < numPartitions; ++p)
+            {
+                allScores.push_back(partitionScores[p].data());
+                allIndexes.push_back(partitionIndexes[p].data());
+            }
+
+            double linearSeconds = timeMerge([&]() {
+                linearMergeKnn(k, batchSize, k, numPartitions, allScores, allIndexes, stringKeys, scores.data(),
+                               keys.data());
+            }, iterations);
+            double keysSeconds = timeMerge([&]() {
+                mergeKnn(k, batchSize, k, numPartitions, allScores, allIndexes, allKeys, scores.data(), keys.data());
+            }, iterations);
+            double indexSeconds = timeMerge([&]() {
+                mergeKnn(k, batchSize, k, numPartitions, allScores, allIndexes, scores.data(), resultPartitions.data(),
+                         resultRows.data());
+            }, iterations);
+            printf("%10d %6d %14.3f %14.3f %14.3f\n", numPartitions, k, linearSeconds * 1000, keysSeconds * 1000,
+                   indexSeconds * 1000);
+        }
+    }
+}
+
+struct KnnResponse
+{
+    std::vector<std::string> keys;
+    std::vector<float> scores;
+    std::chrono::steady_clock::time_point done;
+};
+
+/**
+ * Submits single query requests with exponential inter-arrival times (mean 1 / qps) for the given
+ * seconds and prints the achieved rate, the latency (submit to response) percentiles and the mean batch size.
+ */
+void benchmarkServing(Knn &knn, int k, int columns, const std::vector<float> &queries, int maxBatchSize, int workers,
+                      int maxLatencyMicros, double qps, double seconds)
+{
+    typedef BatchScheduler<const float*, KnnResponse> Scheduler;
+    Scheduler scheduler([&](int worker, std::vector<const float*> &requests, std::vector<KnnResponse> &responses)
+    {
+        int size = requests.size();
+        std::vector<float> batch((size_t) size * columns);
+        for (int i = 0; i < size; ++i)
+        {
+            std::copy_n(requests[i], columns, batch.data() + (size_t) i * columns);
+        }
+        std::vector<std::string> keys((size_t) size * k);
+        std::vector<float> scores((size_t) size * k);
+        knn.search(k, batch.data(), size, keys.data(), scores.data());
+
+        auto done = std::chrono::steady_clock::now();
+        for (int i = 0; i < size; ++i)
+        {
+            responses[i].keys.assign(keys.begin() + (size_t) i * k, keys.begin() + (size_t) (i + 1) * k);
+            responses[i].scores.assign(scores.begin() + (size_t) i * k, scores.begin() + (size_t) (i + 1) * k);
+            responses[i].done = done;
+        }
+    }, maxBatchSize, std::chrono::microseconds(maxLatencyMicros), workers);
+
+    std::mt19937 generator(4321);
+    std::exponential_distribution<double> interArrival(qps);
+    size_t numQueries = queries.size() / columns;
+
+    std::vector<std::chrono::steady_clock::time_point> submitted;
+    std::vector<std::future<KnnResponse>> futures;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+    auto next = start;
+    while (next < end)
+    {
+        std::this_thread::sleep_until(next);
+        submitted.push_back(std::chrono::steady_clock::now());
+        futures.push_back(scheduler.submit(queries.data() + (futures.size() % numQueries) * columns));
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interArrival(generator)));
+    }
+
+    std::vector<double> latencies;
+    auto last = start;
+    for (size_t i = 0; i < futures.size(); ++i)
+    {
+        KnnResponse response = futures[i].get();
+        latencies.push_back(std::chrono::duration<double>(response.done - submitted[i]).count() * 1000);
+        last = std::max(last, response.done);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p)
+    {
+        return latencies[std::min(latencies.size() - 1, (size_t) (p * latencies.size()))];
+    };
+
+    double elapsed = std::chrono::duration<double>(last - start).count();
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "target/s", "queries/s", "p50 ms", "p90 ms", "p99 ms", "max ms",
+           "avg batch");
+    printf("%10.1f %10.1f %10.3f %10.3f %10.3f %10.3f %10.2f\n", qps, latencies.size() / elapsed, percentile(0.5),
+           percentile(0.9), percentile(0.99), latencies.back(),
+           (double) scheduler.getNumRequests() / scheduler.getNumBatches());
+}
+
+void printUsage()
+{
+    fprintf(stderr, "Usage: knnBenchmark [-m method] [-e backend] [-p partitions] [-n rows] [-d columns] [-c clusters] [-b batch_size] [-k k] [-i iterations] [-t data_type] [-M metric] [-x exclude_fraction] [-s pq_subspace_columns] [-l lists] [-r nprobes] [-q qps] [-w workers] [-u max_latency_us] [-o seconds]\n");
+    fprintf(stderr, "    -m method: (default = exact) exact, ivf (cpu backend only), merge (merge of partition results only) or serve (batched single query requests)\n");
+    fprintf(stderr, "    -e backend: (default = cpu) cpu or gpu\n");
+    fprintf(stderr, "    -p partitions: (default = 1) number of data partitions (GPUs for the gpu backend)\n");
+    fprintf(stderr, "    -n rows: (default = 1000000) rows per partition\n");
+    fprintf(stderr, "    -d columns: (default = 128) vector dimension\n");
+    fprintf(stderr, "    -c clusters: (default = 0) draw rows and queries around this many random centers, 0 for uniform data\n");
+    fprintf(stderr, "    -b batch_size: (default = 128) queries per search call\n");
+    fprintf(stderr, "    -k k: (default = 100) results per query\n");
+    fprintf(stderr, "    -i iterations: (default = 20) number of timed search calls\n");
+    fprintf(stderr, "    -t data_type: (default = fp32) fp32, fp16, int8 (cpu only) or pq (cpu only)\n");
+    fprintf(stderr, "    -M metric: (default = ip) ip (inner product), cosine or l2\n");
+    fprintf(stderr, "    -x exclude_fraction: (default = 0) exact: also time a search that excludes this random fraction of rows\n");
+    fprintf(stderr, "    -s pq_subspace_columns: (default = %d) dimensions per pq subspace (one byte each)\n",
+            KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS);
+    fprintf(stderr, "    -l lists: (default = 1024) ivf lists\n");
+    fprintf(stderr, "    -r nprobes: (default = 1,2,4,8,16,32,64) comma separated ivf nprobe values to measure\n");
+    fprintf(stderr, "    -q qps: (default = 1000) serve: target requests per second\n");
+    fprintf(stderr, "    -w workers: (default = 1) serve: batch scheduler workers (1 for the gpu backend)\n");
+    fprintf(stderr, "    -u max_latency_us: (default = 2000) serve: longest a request waits for its batch to fill up\n");
+    fprintf(stderr, "    -o seconds: (default = 10) serve: duration of the load\n");
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::string method = "exact";
+    Backend backend = Backend::CPU;
+    int partitions = 1;
+    uint32_t rows = 1000000;
+    int columns = 128;
+    int batchSize = 128;
+    int k = 100;
+    int iterations = 20;
+    DataType dataType = DataType::FP32;
+    Metric metric = Metric::INNER_PRODUCT;
+    double excludeFraction = 0;
+    int pqSubspaceColumns = KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS;
+    int clusters = 0;
+    int lists = 1024;
+    std::vector<int> nprobes = { 1, 2, 4, 8, 16, 32, 64 };
+    double qps = 1000;
+    int workers = 1;
+    int maxLatencyMicros = 2000;
+    double seconds = 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:e:p:n:d:c:b:k:i:t:M:x:s:l:r:q:w:u:o:h")) != -1)
+    {
+        switch (opt) {
+            case 'm':
+                method = optarg;
+                break;
+            case 'e':
+                backend = getBackendFromString(optarg);
+                break;
+            case 'p':
+                partitions = atoi(optarg);
+                break;
+            case 'n':
+                rows = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                columns = atoi(optarg);
+                break;
+            case 'c':
+                clusters = atoi(optarg);
+                break;
+            case 'b':
+                batchSize = atoi(optarg);
+                break;
+            case 'k':
+                k = atoi(optarg);
+                break;
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            case 't':
+                dataType = getDataTypeFromString(optarg);
+                break;
+            case 'M':
+                metric = getMetricFromString(optarg);
+                break;
+            case 'x':
+                excludeFraction = atof(optarg);
+                break;
+            case 's':
+                pqSubspaceColumns = atoi(optarg);
+                break;
+            case 'l':
+                lists = atoi(optarg);
+                break;
+            case 'r': {
+                nprobes.clear();
+                std::stringstream values(optarg);
+                std::string value;
+                while (std::getline(values, value, ','))
+                {
+                    nprobes.push_back(atoi(value.c_str()));
+                }
+                break;
+            }
+            case 'q':
+                qps = atof(optarg);
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 'u':
+                maxLatencyMicros = atoi(optarg);
+                break;
+            case 'o':
+                seconds = atof(optarg);
+                break;
+            default:
+                printUsage();
+                return 1;
+        }
+    }
+
+    if (method == "merge")
+    {
+        // rows is the number of keys per partition
+        printf("method=merge batch=%d rows=%u threads=%d\n", batchSize, rows, omp_get_max_threads());
+        benchmarkMerge(batchSize, rows, iterations);
+        return 0;
+    }
+
+    if (method != "exact" && method != "ivf" && method != "serve")
+    {
+        fprintf(stderr, "ERROR: unknown method %s\n", method.c_str());
+        printUsage();
+        return 1;
+    }
+    if (method == "ivf" && backend != Backend::CPU)
+    {
+        fprintf(stderr, "ERROR: method ivf requires the cpu backend\n");
+        return 1;
+    }
+    if (method == "serve" && backend == Backend::GPU && workers != 1)
+    {
+        // KnnExactGpu reuses the device buffers of its KnnData, one search at a time
+        fprintf(stderr, "ERROR: method serve with the gpu backend requires 1 worker\n");
+        return 1;
+    }
+
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, CLUSTER_STDDEV);
+    std::vector<float> centers((size_t) clusters * columns);
+    std::generate(centers.begin(), centers.end(), [&]() { return distribution(generator); });
+
+    KnnData data(partitions, batchSize, k, dataType, backend, pqSubspaceColumns, metric);
+    double loadSeconds = loadData(data, partitions, rows, columns, centers);
+
+    std::vector<float> queries((size_t) batchSize * columns);
+    for (int q = 0; q < batchSize; ++q)
+    {
+        generateVector(generator, distribution, noise, centers, columns, queries.data() + (size_t) q * columns);
+    }
+    std::vector<std::string> keys((size_t) batchSize * k);
+    std::vector<float> scores((size_t) batchSize * k);
+
+    printf("method=%s backend=%s dataType=%s metric=%s partitions=%d rows=%u columns=%d clusters=%d batch=%d k=%d\n",
+           method.c_str(), getBackendString(backend).c_str(), getDataTypeString(dataType).c_str(),
+           getMetricString(metric).c_str(), partitions, rows, columns, clusters, batchSize, k);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("load: %.3f s, peak RSS: %.1f MB\n", loadSeconds, usage.ru_maxrss / 1024.0);
+
+    if (method == "serve")
+    {
+        std::unique_ptr<Knn> knn;
+        if (backend == Backend::CPU)
+        {
+            knn.reset(new KnnExactCpu(&data));
+        } else
+        {
+            knn.reset(new KnnExactGpu(&data));
+        }
+        printf("serve: workers=%d max latency=%d us max batch=%d\n", workers, maxLatencyMicros, batchSize);
+        benchmarkServing(*knn, k, columns, queries, batchSize, workers, maxLatencyMicros, qps, seconds);
+        return 0;
+    }
+
+    if (method == "exact")
+    {
+        std::unique_ptr<Knn> knn;
+        if (backend == Backend::CPU)
+        {
+            knn.reset(new KnnExactCpu(&data));
+        } else
+        {
+            knn.reset(new KnnExactGpu(&data));
+        }
+
+        double seconds = timeSearch(*knn, k, queries, keys, scores, iterations);
+        if (excludeFraction > 0)
+        {
+            // one global bitmask excluding a random subset of the rows of every partition
+            std::bernoulli_distribution excluded(excludeFraction);
+            std::vector<std::vector<uint64_t>> bitmasks(partitions, std::vector<uint64_t>((rows + 63) / 64));
+            for (auto &bitmask : bitmasks)
+            {
+                for (uint32_t row = 0; row < rows; ++row)
+                {
+                    if (excluded(generator))
+                    {
+                        bitmask[row / 64] |= 1ull << (row % 64);
+                    }
+                }
+            }
+            ExclusionSet exclusions = ExclusionSet::fromBitmasks(bitmasks);
+            double filteredSeconds = timeFilteredSearch(*knn, k, batchSize, queries, exclusions, keys, scores,
+                                                        iterations);
+            printf("search: %.3f ms/batch, %.1f queries/s\n", seconds * 1000, batchSize / seconds);
+            printf("filtered search (%.0f%% of rows excluded): %.3f ms/batch, %.1f queries/s\n", excludeFraction * 100,
+                   filteredSeconds * 1000, batchSize / filteredSeconds);
+            return 0;
+        }
+        if (backend == Backend::GPU || dataType == DataType::FP32 || dataType == DataType::FP16)
+        {
+            printf("search: %.3f ms/batch, %.1f queries/s\n", seconds * 1000, batchSize / seconds);
+            return 0;
+        }
+
+        // quantized data: compare with the same search over fp32 data
+        KnnData exactData(partitions, batchSize, k, DataType::FP32, backend, pqSubspaceColumns, metric);
+        loadData(exactData, partitions, rows, columns, centers);
+        KnnExactCpu exact(&exactData);
+        std::vector<std::string> exactKeys((size_t) batchSize * k);
+        double exactSeconds = timeSearch(exact, k, queries, exactKeys, scores, iterations);
+
+        printf("%8s %12s %12s %10s %12s\n", "type", "ms/batch", "queries/s", "recall@k", "data MB");
+        printf("%8s %12.3f %12.1f %10.4f %12.1f\n", "fp32", exactSeconds * 1000, batchSize / exactSeconds, 1.0,
+               exactData.getHostDataSizeInBytes() / (1024.0 * 1024.0));
+        printf("%8s %12.3f %12.1f %10.4f %12.1f\n", getDataTypeString(dataType).c_str(), seconds * 1000,
+               batchSize / seconds, recall(exactKeys, keys, batchSize, k),
+               data.getHostDataSizeInBytes() / (1024.0 * 1024.0));
+        return 0;
+    }
+
+    if (dataType != DataType::FP32 && dataType != DataType::FP16)
+    {
+        fprintf(stderr, "ERROR: method ivf requires fp32 data\n");
+        return 1;
+    }
+
+    // exact search on the same data is both the latency baseline and the recall reference
+    KnnExactCpu exact(&data);
+    std::vector<std::string> exactKeys((size_t) batchSize * k);
+    double exactSeconds = timeSearch(exact, k, queries, exactKeys, scores, iterations);
+
+    auto buildStart = std::chrono::steady_clock::now();
+    KnnIvfCpu ivf(&data, lists);
+    auto buildEnd = std::chrono::steady_clock::now();
+    printf("ivf build: %.3f s (%d lists)\n", std::chrono::duration<double>(buildEnd - buildStart).count(), lists);
+
+    printf("%8s %12s %12s %10s\n", "nprobe", "ms/batch", "queries/s", "recall@k");
+    printf("%8s %12.3f %12.1f %10.4f\n", "exact", exactSeconds * 1000, batchSize / exactSeconds, 1.0);
+    for (int nprobe : nprobes)
+    {
+        if (nprobe > lists)
+        {
+            continue;
+        }
+        ivf.setNprobe(nprobe);
+        double seconds = timeSearch(ivf, k, queries, keys, scores, iterations);
+        printf("%8d %12.3f %12.1f %10.4f\n", nprobe, seconds * 1000, batchSize / seconds,
+               recall(exactKeys, keys, batchSize, k));
+    }
+    return 0;
+}
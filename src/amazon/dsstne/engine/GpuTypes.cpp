@@ -492,6 +492,8 @@ void GpuContext::SetNeuralNetwork(NNNetwork* pNetwork)
     _data._SMCE_zeroTarget                          = pNetwork->_SMCE_zeroTarget;
     _data._SMCE_oneScale                            = pNetwork->_SMCE_oneScale;
     _data._SMCE_zeroScale                           = pNetwork->_SMCE_zeroScale;
+    hSetDeltaBoost(pNetwork->_deltaBoost_one, pNetwork->_deltaBoost_zero);
+    hSetSMCE(pNetwork->_SMCE_oneTarget, pNetwork->_SMCE_zeroTarget, pNetwork->_SMCE_oneScale, pNetwork->_SMCE_zeroScale);
     _data._bShuffleIndices                          = pNetwork->_bShuffleIndices && (pNetwork->_mode == Mode::Training);
     _data._pShuffleIndex                            = pNetwork->_pShuffleIndex;
     CopyConstants();
@@ -397,10 +397,18 @@ struct GpuBuffer
     bool                    _bManaged;
     T*                      _pSysData;
     T*                      _pDevData;
+    bool                    _bView;
     GpuBuffer(int length, bool bSysMem = false, bool bManaged = false);
     GpuBuffer(unsigned int length, bool bSysMem = false, bool bManaged = false);
     GpuBuffer(unsigned long long int length, bool bSysMem = false, bool bManaged = false);
     GpuBuffer(size_t length, bool bSysMem = false, bool bManaged = false);
+
+    /**
+     * Creates a view of length elements of device memory owned by another
+     * buffer.  A view never allocates or frees device memory, so the owner
+     * must outlive it.
+     */
+    GpuBuffer(T* pDevData, size_t length);
     virtual ~GpuBuffer();
 
     /**
@@ -454,29 +462,34 @@ struct GpuBuffer
 };
 
 template <typename T>
-GpuBuffer<T>::GpuBuffer(int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL)
+GpuBuffer<T>::GpuBuffer(int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL), _bView(false)
 {
     Allocate();
 }
 
 template <typename T>
-GpuBuffer<T>::GpuBuffer(unsigned int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL)
+GpuBuffer<T>::GpuBuffer(unsigned int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL), _bView(false)
 {
     Allocate();
 }
 
 template <typename T>
-GpuBuffer<T>::GpuBuffer(unsigned long long int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL)
+GpuBuffer<T>::GpuBuffer(unsigned long long int length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL), _bView(false)
 {
     Allocate();
 }
 
 template <typename T>
-GpuBuffer<T>::GpuBuffer(size_t length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL)
+GpuBuffer<T>::GpuBuffer(size_t length, bool bSysMem, bool bManaged) : _length(length), _bSysMem(bSysMem), _bManaged(bManaged), _pSysData(NULL), _pDevData(NULL), _bView(false)
 {
     Allocate();
 }
 
+template <typename T>
+GpuBuffer<T>::GpuBuffer(T* pDevData, size_t length) : _length(length), _bSysMem(false), _bManaged(false), _pSysData(NULL), _pDevData(pDevData), _bView(true)
+{
+}
+
 template <typename T>
 GpuBuffer<T>::~GpuBuffer()
 {
@@ -539,6 +552,12 @@ void GpuBuffer<T>::Allocate()
 
 template<typename T> void GpuBuffer<T>::Resize(size_t length)
 {
+    if (_bView)
+    {
+        printf("GpuBuffer::Resize: Views of another buffer cannot be resized\n");
+        return;
+    }
+
     if(length > _length)
     {
         Deallocate();
@@ -550,6 +569,14 @@ template<typename T> void GpuBuffer<T>::Resize(size_t length)
 template <typename T>
 void GpuBuffer<T>::Deallocate()
 {
+    // Views only drop their reference to the owner's memory
+    if (_bView)
+    {
+        _pDevData = NULL;
+        _length = 0;
+        return;
+    }
+
     cudaError_t status;
 
     // Deallocate GPU memory
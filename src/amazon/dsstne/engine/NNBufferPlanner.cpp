@@ -0,0 +1,69 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+
+// Greedy interval coloring: buffers are placed in the order they become live, each into the free arena
+// that fits it most tightly, growing the largest free arena only if none fits and opening a new arena only
+// if every arena is still in use.  For the chains of fully connected layers that make up most networks this
+// needs two arenas no matter how many layers there are.
+uint64_t PlanBufferArenas(const vector<NNBufferLifetime>& vLifetime, vector<uint32_t>& vArena, vector<uint64_t>& vArenaSize)
+{
+    vector<uint32_t> vOrder(vLifetime.size());
+    iota(vOrder.begin(), vOrder.end(), 0);
+    sort(vOrder.begin(), vOrder.end(), [&vLifetime](uint32_t a, uint32_t b)
+    {
+        if (vLifetime[a]._first != vLifetime[b]._first)
+            return vLifetime[a]._first < vLifetime[b]._first;
+        if (vLifetime[a]._size != vLifetime[b]._size)
+            return vLifetime[a]._size > vLifetime[b]._size;
+        return a < b;
+    });
+
+    vArena.assign(vLifetime.size(), 0);
+    vArenaSize.resize(0);
+    vector<uint32_t> vArenaLast;                                // Last step of the latest buffer in each arena
+    for (auto i : vOrder)
+    {
+        const NNBufferLifetime& l           = vLifetime[i];
+        int64_t fit                         = -1;
+        int64_t largest                     = -1;
+        for (size_t a = 0; a < vArenaSize.size(); a++)
+        {
+            if (vArenaLast[a] >= l._first)
+                continue;
+            if ((vArenaSize[a] >= l._size) && ((fit < 0) || (vArenaSize[a] < vArenaSize[fit])))
+                fit                         = a;
+            if ((largest < 0) || (vArenaSize[a] > vArenaSize[largest]))
+                largest                     = a;
+        }
+
+        if (fit < 0)
+            fit                             = largest;
+        if (fit < 0)
+        {
+            fit                             = vArenaSize.size();
+            vArenaSize.push_back(0);
+            vArenaLast.push_back(0);
+        }
+        vArena[i]                           = fit;
+        vArenaSize[fit]                     = max(vArenaSize[fit], l._size);
+        vArenaLast[fit]                     = l._last;
+    }
+
+    return accumulate(vArenaSize.begin(), vArenaSize.end(), (uint64_t)0);
+}
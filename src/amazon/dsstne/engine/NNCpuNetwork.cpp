@@ -0,0 +1,1113 @@
+/*
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <cfloat>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+// Epsilon cuDNN applies in cudnnBatchNormalizationForwardInference (CUDNN_BN_MIN_EPSILON)
+static const NNFloat CPU_BN_EPSILON         = (NNFloat)1.0e-5;
+static const uint32_t CPU_QUANTIZED_INPUTS  = 133144;               // Most inputs whose int8 dot products fit in 32 bits
+
+NNCpuNetwork::NNCpuNetwork(const NNNetworkDescriptor& d, uint32_t batch) :
+_name(d._name),
+_batch(batch),
+_position(0),
+_examples(0),
+_bExamplesFound(false),
+_bQuantized(false),
+_errorFunction(d._errorFunction),
+_trainingMode(SGD),
+_bShuffleIndices(d._bShuffleIndices),
+_bSparsenessPenalty(d._bSparsenessPenalty),
+_decay(d._decay),
+_deltaBoost_one(d._deltaBoost_one),
+_deltaBoost_zero(d._deltaBoost_zero),
+_SMCE_oneTarget(d._SMCE_oneTarget),
+_SMCE_zeroTarget(d._SMCE_zeroTarget),
+_SMCE_oneScale(d._SMCE_oneScale),
+_SMCE_zeroScale(d._SMCE_zeroScale),
+_epochs(0),
+_batches(0),
+_threads(0),
+_rng(FIXED_SEED)
+{
+    // Create layers
+    for (const NNLayerDescriptor& ld : d._vLayerDescriptor)
+    {
+        if (ld._type != NNLayer::Type::FullyConnected)
+            throw std::runtime_error("NNCpuNetwork: layer " + ld._name + " is not fully connected, only fully connected networks are supported");
+        if (_mLayer.find(ld._name) != _mLayer.end())
+            throw std::runtime_error("NNCpuNetwork: duplicate layer " + ld._name);
+
+        NNCpuLayer* pLayer                  = new NNCpuLayer();
+        pLayer->_name                       = ld._name;
+        pLayer->_index                      = _vLayer.size();
+        pLayer->_kind                       = ld._kind;
+        pLayer->_dataSet                    = ld._dataSet;
+        pLayer->_Nx                         = ld._Nx;
+        pLayer->_Ny                         = ld._Ny;
+        pLayer->_Nz                         = ld._Nz;
+        pLayer->_Nw                         = ld._Nw;
+        pLayer->_stride                     = ld._Nx * ld._Ny * ld._Nz * ld._Nw;
+        pLayer->_activation                 = ld._activation;
+        pLayer->_RELUSlope                  = ld._RELUSlope;
+        pLayer->_ELUAlpha                   = ld._ELUAlpha;
+        pLayer->_SELULambda                 = ld._SELULambda;
+        pLayer->_biasInit                   = ld._biasInit;
+        pLayer->_pDropout                   = ld._pDropout;
+        pLayer->_deltaNorm                  = ld._deltaNorm;
+        pLayer->_bSparse                    = (ld._attributes & NNLayer::Attributes::Sparse) != 0;
+        pLayer->_bFastSparse                = false;
+        pLayer->_bDenoising                 = (ld._attributes & NNLayer::Attributes::Denoising) != 0;
+        pLayer->_bBatchNormalization        = (ld._attributes & NNLayer::Attributes::BatchNormalization) != 0;
+        pLayer->_pDataSet                   = NULL;
+        pLayer->_sparseTransposedIndices    = 0;
+        pLayer->_quantizedUnitScale         = (NNFloat)0.0;
+        if (pLayer->_bBatchNormalization)
+        {
+            // Layers saved before training start with identity statistics
+            pLayer->_vScaleBN               = ld._vScaleBN.size() ? ld._vScaleBN : vector<NNFloat>(pLayer->_stride, (NNFloat)1.0);
+            pLayer->_vBiasBN                = ld._vBiasBN.size() ? ld._vBiasBN : vector<NNFloat>(pLayer->_stride, (NNFloat)0.0);
+            pLayer->_vRunningMeanBN         = ld._vRunningMeanBN.size() ? ld._vRunningMeanBN : vector<NNFloat>(pLayer->_stride, (NNFloat)0.0);
+            pLayer->_vRunningVarianceBN     = ld._vRunningVarianceBN.size() ? ld._vRunningVarianceBN : vector<NNFloat>(pLayer->_stride, (NNFloat)1.0);
+        }
+        _vLayer.push_back(pLayer);
+        _mLayer[pLayer->_name]              = pLayer;
+    }
+
+    // Create weights and connect layers like NNWeight::NNWeight does
+    for (const NNWeightDescriptor& wd : d._vWeightDescriptor)
+    {
+        NNCpuLayer* pInputLayer             = GetLayer(wd._inputLayer);
+        NNCpuLayer* pOutputLayer            = GetLayer(wd._outputLayer);
+        if ((pInputLayer == NULL) || (pOutputLayer == NULL))
+            throw std::runtime_error("NNCpuNetwork: weights from " + wd._inputLayer + " to " + wd._outputLayer + " reference an unknown layer");
+
+        NNCpuWeight* pWeight                = new NNCpuWeight();
+        pWeight->_index                     = _vWeight.size();
+        pWeight->_pInputLayer               = pInputLayer;
+        pWeight->_pOutputLayer              = pOutputLayer;
+        pWeight->_bShared                   = wd._bShared;
+        pWeight->_bTransposed               = wd._bTransposed;
+        pWeight->_bLocked                   = wd._bLocked;
+        pWeight->_norm                      = wd._norm;
+        pWeight->_sharingCount              = 1;
+        pWeight->_pSharedWeight             = NULL;
+        _vWeight.push_back(pWeight);
+
+        if (!wd._bShared)
+        {
+            if (wd._vWeight.size() != (uint64_t)pInputLayer->_stride * pOutputLayer->_stride)
+                throw std::runtime_error("NNCpuNetwork: weights from " + wd._inputLayer + " to " + wd._outputLayer + " are missing or have the wrong size");
+            pWeight->_vWeight               = wd._vWeight;
+        }
+
+        // NNWeight::Randomize sets missing biases to -_biasInit of the output layer
+        if (wd._vBias.size() == pOutputLayer->_stride)
+            pWeight->_vBias                 = wd._vBias;
+        else
+            pWeight->_vBias.assign(pOutputLayer->_stride, -pOutputLayer->_biasInit);
+
+        pOutputLayer->_vIncomingLayer.push_back(pInputLayer);
+        pOutputLayer->_vIncomingWeight.push_back(pWeight);
+    }
+
+    // Resolve shared weights
+    for (size_t i = 0; i < _vWeight.size(); i++)
+    {
+        const NNWeightDescriptor& wd        = d._vWeightDescriptor[i];
+        if (!wd._bShared)
+            continue;
+        for (size_t j = 0; j < _vWeight.size(); j++)
+        {
+            const NNWeightDescriptor& swd   = d._vWeightDescriptor[j];
+            if (!swd._bShared && (swd._inputLayer == wd._sourceInputLayer) && (swd._outputLayer == wd._sourceOutputLayer))
+            {
+                _vWeight[i]->_pSharedWeight = _vWeight[j];
+                _vWeight[j]->_sharingCount++;
+                break;
+            }
+        }
+        if (_vWeight[i]->_pSharedWeight == NULL)
+            throw std::runtime_error("NNCpuNetwork: unable to locate shared weights " + wd._sourceInputLayer + " to " + wd._sourceOutputLayer + " for weights " + wd._inputLayer + " to " + wd._outputLayer);
+
+        uint64_t size                       = (uint64_t)_vWeight[i]->_pInputLayer->_stride * _vWeight[i]->_pOutputLayer->_stride;
+        if (_vWeight[i]->_pSharedWeight->_vWeight.size() != size)
+            throw std::runtime_error("NNCpuNetwork: shared weights for " + wd._inputLayer + " to " + wd._outputLayer + " do not match the size of their source");
+    }
+
+    // Connect skip layers
+    for (const NNLayerDescriptor& ld : d._vLayerDescriptor)
+    {
+        NNCpuLayer* pLayer                  = GetLayer(ld._name);
+        for (const string& skip : ld._vSkip)
+        {
+            NNCpuLayer* pSkipLayer          = GetLayer(skip);
+            if (pSkipLayer == NULL)
+                throw std::runtime_error("NNCpuNetwork: unknown skip layer " + skip + " for layer " + ld._name);
+            if (pSkipLayer->_stride != pLayer->_stride)
+                throw std::runtime_error("NNCpuNetwork: skip layer " + skip + " does not match the size of layer " + ld._name);
+            pLayer->_vIncomingSkip.push_back(pSkipLayer);
+        }
+    }
+
+    CalculateFPOrder();
+    AllocateWorkspace(_workspace, false);
+}
+
+NNCpuNetwork::~NNCpuNetwork()
+{
+    for (NNCpuWeight* pWeight : _vWeight)
+        delete pWeight;
+    for (NNCpuLayer* pLayer : _vLayer)
+        delete pLayer;
+}
+
+NNCpuNetwork::NNCpuLayer* NNCpuNetwork::GetLayer(const string& layer) const
+{
+    map<string, NNCpuLayer*>::const_iterator it = _mLayer.find(layer);
+    return (it != _mLayer.end()) ? it->second : NULL;
+}
+
+// Orders the non-target layers so that every layer follows its source and skip layers
+void NNCpuNetwork::CalculateFPOrder()
+{
+    set<NNCpuLayer*> sDone;
+    while (_vFPOrder.size() < _vLayer.size())
+    {
+        size_t ordered                      = _vFPOrder.size();
+        for (NNCpuLayer* pLayer : _vLayer)
+        {
+            if (sDone.count(pLayer))
+                continue;
+
+            bool bReady                     = true;
+            for (NNCpuLayer* pSource : pLayer->_vIncomingLayer)
+                bReady                     &= (sDone.count(pSource) != 0);
+            for (NNCpuLayer* pSource : pLayer->_vIncomingSkip)
+                bReady                     &= (sDone.count(pSource) != 0);
+            if (bReady)
+            {
+                sDone.insert(pLayer);
+                _vFPOrder.push_back(pLayer);
+            }
+        }
+        if (_vFPOrder.size() == ordered)
+            throw std::runtime_error("NNCpuNetwork: network " + _name + " contains a cycle");
+    }
+
+    // Target layers only carry training data
+    _vFPOrder.erase(remove_if(_vFPOrder.begin(), _vFPOrder.end(), [](NNCpuLayer* pLayer) { return pLayer->_kind == NNLayer::Kind::Target; }), _vFPOrder.end());
+}
+
+// Sizes the buffers of a workspace for the current batch size.  Weight gradients are allocated by BackPropagate
+// on first use since the direct sparse updates do not need them.
+void NNCpuNetwork::AllocateWorkspace(NNCpuWorkspace& w, bool bTraining)
+{
+    w._vUnit.resize(_vLayer.size());
+    for (NNCpuLayer* pLayer : _vFPOrder)
+        w._vUnit[pLayer->_index].resize((uint64_t)_batch * pLayer->_stride);
+    w._vQuantizedUnit.resize(_vLayer.size());
+    for (NNCpuLayer* pLayer : _vFPOrder)
+    {
+        if (pLayer->_quantizedUnitScale > (NNFloat)0.0)
+            w._vQuantizedUnit[pLayer->_index].resize((uint64_t)_batch * hQuantizedStride(pLayer->_stride));
+    }
+    if (!bTraining)
+        return;
+
+    w._vDelta.resize(_vLayer.size());
+    w._vRandom.resize(_vLayer.size());
+    w._vSparseTransposedEnd.resize(_vLayer.size());
+    w._vSparseTransposedIndex.resize(_vLayer.size());
+    w._vSparseTransposedData.resize(_vLayer.size());
+    for (NNCpuLayer* pLayer : _vFPOrder)
+    {
+        uint32_t i                          = pLayer->_index;
+        if (pLayer->_kind != NNLayer::Kind::Input)
+        {
+            w._vDelta[i].resize((uint64_t)_batch * pLayer->_stride);
+            if (pLayer->_pDropout > (NNFloat)0.0)
+                w._vRandom[i].resize((uint64_t)_batch * pLayer->_stride);
+        }
+        else if (pLayer->_bFastSparse)
+        {
+            w._vSparseTransposedEnd[i].resize(pLayer->_vSparseTransposedStart.size());
+            w._vSparseTransposedIndex[i].resize(pLayer->_sparseTransposedIndices);
+            uint32_t attributes             = pLayer->_pDataSet->_attributes;
+            if ((attributes & NNDataSetEnums::Weighted) || !(attributes & NNDataSetEnums::Boolean))
+                w._vSparseTransposedData[i].resize(pLayer->_sparseTransposedIndices);
+        }
+    }
+    w._vWeightGradient.resize(_vWeight.size());
+    w._vUpdateCount.assign(_vWeight.size(), 0);
+}
+
+bool NNCpuNetwork::LoadDataSets(vector<NNDataSetBase*>& vData)
+{
+    ClearQuantization();
+    for (NNCpuLayer* pLayer : _vLayer)
+    {
+        if ((pLayer->_kind != NNLayer::Kind::Input) && (pLayer->_kind != NNLayer::Kind::Output))
+            continue;
+
+        for (NNDataSetBase* pDataSet : vData)
+        {
+            if (pDataSet->_name != pLayer->_dataSet)
+                continue;
+
+            if (pDataSet->_width * pDataSet->_height * pDataSet->_length != pLayer->_stride)
+            {
+                printf("NNCpuNetwork::LoadDataSets: Data set %s does not match the dimensions of layer %s\n", pDataSet->_name.c_str(), pLayer->_name.c_str());
+                return false;
+            }
+            if (pDataSet->_sharding != NNDataSetEnums::Sharding::None)
+            {
+                printf("NNCpuNetwork::LoadDataSets: Data set %s is sharded\n", pDataSet->_name.c_str());
+                return false;
+            }
+
+            if (!_bExamplesFound)
+            {
+                _examples                   = pDataSet->_examples;
+                _bExamplesFound             = true;
+            }
+            else if (pDataSet->_examples != _examples)
+            {
+                printf("NNCpuNetwork::LoadDataSets: Mismatched examples count (%u vs %u) in data set %s\n", _examples, pDataSet->_examples, pDataSet->_name.c_str());
+                return false;
+            }
+
+            pLayer->_pDataSet               = pDataSet;
+            if (pLayer->_kind == NNLayer::Kind::Input)
+            {
+                // Same fast sparse test as NNLayer::RefreshState
+                pLayer->_bSparse            = (pDataSet->_attributes & NNDataSetEnums::Sparse) != 0;
+                pLayer->_bFastSparse        = pLayer->_bSparse && (pDataSet->_sparseDensity <= (NNFloat)0.1);
+            }
+        }
+
+        if ((pLayer->_kind == NNLayer::Kind::Input) && (pLayer->_pDataSet == NULL))
+        {
+            printf("NNCpuNetwork::LoadDataSets: No data set %s for input layer %s\n", pLayer->_dataSet.c_str(), pLayer->_name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NNCpuNetwork::SetPosition(uint32_t position)
+{
+    if (position >= _examples)
+    {
+        printf("NNCpuNetwork::SetPosition: Invalid position %u for %u examples\n", position, _examples);
+        return false;
+    }
+    _position                               = position;
+    return true;
+}
+
+bool NNCpuNetwork::SetBatch(uint32_t batch)
+{
+    if (batch == 0)
+    {
+        printf("NNCpuNetwork::SetBatch: Batch size must be nonzero\n");
+        return false;
+    }
+    _batch                                  = batch;
+    AllocateWorkspace(_workspace, false);
+    _vWorkspace.clear();
+    return true;
+}
+
+uint32_t NNCpuNetwork::GetBatch() const
+{
+    return _batch;
+}
+
+uint32_t NNCpuNetwork::GetExamples() const
+{
+    return _examples;
+}
+
+uint32_t NNCpuNetwork::GetPosition() const
+{
+    return _position;
+}
+
+string NNCpuNetwork::GetName() const
+{
+    return _name;
+}
+
+bool NNCpuNetwork::PredictBatch()
+{
+    if (!_bExamplesFound)
+    {
+        printf("NNCpuNetwork::PredictBatch: No data sets loaded for network %s\n", _name.c_str());
+        return false;
+    }
+
+    uint32_t batch                          = _batch;
+    if (_position + batch > _examples)
+        batch                               = _examples - _position;
+
+    for (NNCpuLayer* pLayer : _vFPOrder)
+        ForwardPropagate(_workspace, pLayer, _position, batch, NULL, false);
+    return true;
+}
+
+void NNCpuNetwork::ForwardPropagate(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t position, uint32_t batch, uint32_t* pShuffleIndex, bool bTraining)
+{
+    NNFloat* pUnit                          = w._vUnit[pLayer->_index].data();
+    uint32_t stride                         = pLayer->_stride;
+
+    // Input layers only load their batch, as in NNLayer::LoadPredictionBatch, and fast sparse ones also build
+    // the transposed matrix of their weight gradient when training, as in NNLayer::LoadTrainingBatch
+    if (pLayer->_kind == NNLayer::Kind::Input)
+    {
+        if (!pLayer->_bSparse)
+            pLayer->_pDataSet->LoadInputUnitOnHost(position, batch, stride, pUnit, pShuffleIndex);
+        else if (!pLayer->_bFastSparse)
+            pLayer->_pDataSet->LoadSparseInputUnitOnHost(position, batch, stride, pUnit, pShuffleIndex);
+        else if (bTraining)
+        {
+            uint32_t i                      = pLayer->_index;
+            NNFloat* pSparseTransposedData  = w._vSparseTransposedData[i].empty() ? NULL : w._vSparseTransposedData[i].data();
+            pLayer->_pDataSet->CalculateSparseTransposedMatrixOnHost(position, batch, pLayer->_vSparseTransposedStart.data(), w._vSparseTransposedEnd[i].data(),
+                                                                     w._vSparseTransposedIndex[i].data(), pSparseTransposedData, pShuffleIndex);
+        }
+        if (!bTraining && _bQuantized && (pLayer->_quantizedUnitScale > (NNFloat)0.0))
+            hQuantizeUnits(pUnit, batch, stride, pLayer->_quantizedUnitScale, w._vQuantizedUnit[pLayer->_index].data());
+        return;
+    }
+
+    // Initialize units to the sum of the incoming biases
+    if (pLayer->_vIncomingWeight.size() == 0)
+        memset(pUnit, 0, (uint64_t)batch * stride * sizeof(NNFloat));
+    else
+    {
+        hClearUnit(pUnit, pLayer->_vIncomingWeight[0]->_vBias.data(), stride, batch);
+        for (size_t i = 1; i < pLayer->_vIncomingWeight.size(); i++)
+            hAddBias(pUnit, pLayer->_vIncomingWeight[i]->_vBias.data(), stride, batch);
+    }
+
+    bool bQuantized                         = !bTraining && _bQuantized;
+    for (size_t i = 0; i < pLayer->_vIncomingLayer.size(); i++)
+    {
+        NNCpuLayer* pInputLayer             = pLayer->_vIncomingLayer[i];
+        NNCpuWeight* pWeight                = pLayer->_vIncomingWeight[i];
+        if (pInputLayer->_bFastSparse)
+        {
+            if (bQuantized)
+                pInputLayer->_pDataSet->CalculateQuantizedSparseZOnHost(position, batch, stride, pWeight->_vQuantizedWeight.data(), pWeight->_vQuantizedScale.data(), pUnit, (NNFloat)1.0, pShuffleIndex);
+            else
+                pInputLayer->_pDataSet->CalculateSparseZOnHost(position, batch, stride, pWeight->GetWeightBuffer(), pUnit, (NNFloat)1.0, pShuffleIndex);
+        }
+        else if (bQuantized)
+        {
+            hCalculateQuantizedZ(batch, pInputLayer->_stride, stride, w._vQuantizedUnit[pInputLayer->_index].data(), pInputLayer->_quantizedUnitScale,
+                                 pWeight->_vQuantizedWeight.data(), pWeight->_vQuantizedScale.data(), pWeight->_vQuantizedSum.data(), pUnit, (NNFloat)1.0);
+        }
+        else
+        {
+            // C[batch][stride] += A[batch][k] * W, where W is [k][stride], or [stride][k] if transposed
+            int m                           = batch;
+            int n                           = stride;
+            int k                           = pInputLayer->_stride;
+            cblas_sgemm(CblasRowMajor, CblasNoTrans, pWeight->_bTransposed ? CblasTrans : CblasNoTrans,
+                        m, n, k,
+                        (NNFloat)1.0,
+                        w._vUnit[pInputLayer->_index].data(), k,
+                        pWeight->GetWeightBuffer(), pWeight->_bTransposed ? k : n,
+                        (NNFloat)1.0,
+                        pUnit, n);
+        }
+    }
+
+    for (NNCpuLayer* pSkipLayer : pLayer->_vIncomingSkip)
+        hAddBuffers(pUnit, w._vUnit[pSkipLayer->_index].data(), (uint64_t)batch * stride);
+
+    if (pLayer->_bBatchNormalization)
+        hCalculateBatchNormalization(pUnit, pLayer->_vScaleBN.data(), pLayer->_vBiasBN.data(), pLayer->_vRunningMeanBN.data(), pLayer->_vRunningVarianceBN.data(), CPU_BN_EPSILON, stride, batch);
+
+    CalculateActivation(pLayer, pUnit, batch);
+    if (bTraining && (pLayer->_pDropout > (NNFloat)0.0))
+        CalculateDropout(w, pLayer, batch);
+    if (bQuantized && (pLayer->_quantizedUnitScale > (NNFloat)0.0))
+        hQuantizeUnits(pUnit, batch, stride, pLayer->_quantizedUnitScale, w._vQuantizedUnit[pLayer->_index].data());
+}
+
+// Same activations as NNLayer::CalculateActivation, the others are left linear there as well
+void NNCpuNetwork::CalculateActivation(NNCpuLayer* pLayer, NNFloat* pUnit, uint32_t batch)
+{
+    uint64_t size                           = (uint64_t)batch * pLayer->_stride;
+    switch (pLayer->_activation)
+    {
+        case Sigmoid:
+            hCalculateSigmoidActivation(pUnit, size);
+            break;
+
+        case Tanh:
+            hCalculateTanhActivation(pUnit, size);
+            break;
+
+        case RectifiedLinear:
+            hCalculateRELUActivation(pUnit, size);
+            break;
+
+        case LeakyRectifiedLinear:
+            hCalculateLRELUActivation(pUnit, size, pLayer->_RELUSlope);
+            break;
+
+        case ExponentialLinear:
+            hCalculateELUActivation(pUnit, size, pLayer->_ELUAlpha);
+            break;
+
+        case ScaledExponentialLinear:
+            hCalculateSELUActivation(pUnit, size, pLayer->_ELUAlpha, pLayer->_SELULambda);
+            break;
+
+        case SoftMax:
+            hCalculateSoftMaxActivation(pUnit, batch, pLayer->_stride);
+            break;
+
+        case Linear:
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Same dropout as NNLayer::CalculateDropout with randoms from the workspace's generator
+void NNCpuNetwork::CalculateDropout(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t batch)
+{
+    NNFloat* pUnit                          = w._vUnit[pLayer->_index].data();
+    NNFloat* pRandom                        = w._vRandom[pLayer->_index].data();
+    uint64_t size                           = (uint64_t)batch * pLayer->_stride;
+    std::uniform_real_distribution<NNFloat> uniform((NNFloat)0.0, (NNFloat)1.0);
+    for (uint64_t pos = 0; pos < size; pos++)
+        pRandom[pos]                        = uniform(w._rng);
+
+    NNFloat lambda                          = (pLayer->_activation == ScaledExponentialLinear) ? pLayer->_SELULambda : (NNFloat)1.0;
+    NNFloat alpha                           = -lambda * pLayer->_ELUAlpha;
+    NNFloat q                               = (NNFloat)1.0 - pLayer->_pDropout;
+    NNFloat a                               = (NNFloat)1.0 / sqrt(q + alpha * alpha * pLayer->_pDropout * q);
+    NNFloat b                               = -a * pLayer->_pDropout * alpha;
+    NNFloat target                          = (pLayer->_activation == Sigmoid) ? (NNFloat)0.5 : (NNFloat)0.0;
+    switch (pLayer->_activation)
+    {
+        case ExponentialLinear:
+        case ScaledExponentialLinear:
+            hCalculateScaledBiasedDropout(pUnit, pRandom, batch, pLayer->_stride, pLayer->_pDropout, alpha, a, b);
+            break;
+
+        default:
+            hCalculateDropout(pUnit, pRandom, batch, pLayer->_stride, pLayer->_pDropout, target);
+            break;
+    }
+}
+
+NNFloat* NNCpuNetwork::GetUnitBuffer(const string& layer)
+{
+    NNCpuLayer* pLayer                      = GetLayer(layer);
+    if ((pLayer == NULL) || _workspace._vUnit[pLayer->_index].empty())
+        return NULL;
+    return _workspace._vUnit[pLayer->_index].data();
+}
+
+bool NNCpuNetwork::GetUnits(const string& layer, vector<NNFloat>& vUnit)
+{
+    NNCpuLayer* pLayer                      = GetLayer(layer);
+    if ((pLayer == NULL) || _workspace._vUnit[pLayer->_index].empty())
+    {
+        printf("NNCpuNetwork::GetUnits: Unknown layer %s\n", layer.c_str());
+        return false;
+    }
+    vUnit                                   = _workspace._vUnit[pLayer->_index];
+    return true;
+}
+
+bool NNCpuNetwork::CalculateTopK(const string& layer, uint32_t k, vector<NNFloat>& vKey, vector<uint32_t>& vValue)
+{
+    NNCpuLayer* pLayer                      = GetLayer(layer);
+    if ((pLayer == NULL) || _workspace._vUnit[pLayer->_index].empty())
+    {
+        printf("NNCpuNetwork::CalculateTopK: Unknown layer %s\n", layer.c_str());
+        return false;
+    }
+
+    vKey.resize((uint64_t)_batch * k);
+    vValue.resize((uint64_t)_batch * k);
+    hCalculateTopK(_workspace._vUnit[pLayer->_index].data(), vKey.data(), vValue.data(), _batch, pLayer->_stride, k);
+    return true;
+}
+
+// Writes the units of the output layers in the format of NNNetwork::DumpBatch
+bool NNCpuNetwork::DumpBatch(FILE* fp)
+{
+    uint32_t batch                          = _batch;
+    if (_position + batch > _examples)
+        batch                               = _examples - _position;
+
+    for (NNCpuLayer* pLayer : _vFPOrder)
+    {
+        if (pLayer->_kind != NNLayer::Kind::Output)
+            continue;
+
+        uint32_t stride                     = pLayer->_stride;
+        vector<NNFloat>& vUnit              = _workspace._vUnit[pLayer->_index];
+        for (uint32_t j = 0; j < batch; j++)
+        {
+            for (uint32_t k = 0; k < stride; k++)
+            {
+                fprintf(fp, "%f", vUnit[(uint64_t)j * stride + k]);
+                if (k < (stride -1))
+                    fprintf(fp, ",");
+                else
+                    fprintf(fp, "\n");
+            }
+        }
+    }
+    return true;
+}
+
+bool NNCpuNetwork::Quantize(uint32_t examples)
+{
+    if (!_bExamplesFound)
+    {
+        printf("NNCpuNetwork::Quantize: No data sets loaded for network %s\n", _name.c_str());
+        return false;
+    }
+    examples                                = min(examples, _examples);
+    if (examples == 0)
+    {
+        printf("NNCpuNetwork::Quantize: No calibration examples\n");
+        return false;
+    }
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if (!pWeight->_pInputLayer->_bFastSparse && (pWeight->_pInputLayer->_stride > CPU_QUANTIZED_INPUTS))
+        {
+            printf("NNCpuNetwork::Quantize: Layer %s has more than %u units\n", pWeight->_pInputLayer->_name.c_str(), CPU_QUANTIZED_INPUTS);
+            return false;
+        }
+    }
+
+    // Largest unit magnitude of every layer feeding dense weights over the calibration examples
+    ClearQuantization();
+    vector<bool> vDense(_vLayer.size(), false);
+    vector<NNFloat> vMax(_vLayer.size(), (NNFloat)0.0);
+    for (NNCpuWeight* pWeight : _vWeight)
+        vDense[pWeight->_pInputLayer->_index] = !pWeight->_pInputLayer->_bFastSparse;
+    for (uint32_t position = 0; position < examples; position += _batch)
+    {
+        uint32_t batch                      = min(_batch, examples - position);
+        for (NNCpuLayer* pLayer : _vFPOrder)
+        {
+            ForwardPropagate(_workspace, pLayer, position, batch, NULL, false);
+            if (!vDense[pLayer->_index])
+                continue;
+            const NNFloat* pUnit            = _workspace._vUnit[pLayer->_index].data();
+            for (uint64_t i = 0; i < (uint64_t)batch * pLayer->_stride; i++)
+                vMax[pLayer->_index]        = max(vMax[pLayer->_index], fabsf(pUnit[i]));
+        }
+    }
+    for (NNCpuLayer* pLayer : _vLayer)
+    {
+        if (vDense[pLayer->_index])
+            pLayer->_quantizedUnitScale     = (vMax[pLayer->_index] > (NNFloat)0.0) ? vMax[pLayer->_index] / (NNFloat)127.0 : (NNFloat)1.0;
+    }
+
+    // Weights from fast sparse layers are read [input][output] like the single precision sparse Z kernels do
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        uint32_t k                          = pWeight->_pInputLayer->_stride;
+        uint32_t n                          = pWeight->_pOutputLayer->_stride;
+        pWeight->_vQuantizedScale.resize(n);
+        if (pWeight->_pInputLayer->_bFastSparse)
+        {
+            pWeight->_vQuantizedWeight.resize((uint64_t)k * n);
+            hQuantizeWeightsByInput(k, n, pWeight->GetWeightBuffer(), false, pWeight->_vQuantizedScale.data(), pWeight->_vQuantizedWeight.data());
+        }
+        else
+        {
+            pWeight->_vQuantizedWeight.resize((uint64_t)n * hQuantizedStride(k));
+            pWeight->_vQuantizedSum.resize(n);
+            hQuantizeWeightsByOutput(k, n, pWeight->GetWeightBuffer(), pWeight->_bTransposed, pWeight->_vQuantizedScale.data(), pWeight->_vQuantizedWeight.data(), pWeight->_vQuantizedSum.data());
+        }
+    }
+
+    _bQuantized                             = true;
+    AllocateWorkspace(_workspace, false);
+    return true;
+}
+
+bool NNCpuNetwork::SetQuantized(bool bQuantized)
+{
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if (bQuantized && pWeight->_vQuantizedScale.empty())
+        {
+            printf("NNCpuNetwork::SetQuantized: Network %s has not been quantized\n", _name.c_str());
+            return false;
+        }
+    }
+    _bQuantized                             = bQuantized;
+    return true;
+}
+
+bool NNCpuNetwork::IsQuantized() const
+{
+    return _bQuantized;
+}
+
+uint64_t NNCpuNetwork::GetWeightBytes(bool bQuantized) const
+{
+    uint64_t bytes                          = 0;
+    for (const NNCpuWeight* pWeight : _vWeight)
+    {
+        bytes                              += pWeight->_vBias.size() * sizeof(NNFloat);
+        if (bQuantized)
+            bytes                          += pWeight->_vQuantizedWeight.size() + pWeight->_vQuantizedScale.size() * sizeof(NNFloat) + pWeight->_vQuantizedSum.size() * sizeof(int32_t);
+        else
+            bytes                          += pWeight->_vWeight.size() * sizeof(NNFloat);
+    }
+    return bytes;
+}
+
+// Drops the int8 weights and units, which go stale once the weights are trained or input layers change
+void NNCpuNetwork::ClearQuantization()
+{
+    _bQuantized                             = false;
+    for (NNCpuLayer* pLayer : _vLayer)
+        pLayer->_quantizedUnitScale         = (NNFloat)0.0;
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        vector<int8_t>().swap(pWeight->_vQuantizedWeight);
+        vector<NNFloat>().swap(pWeight->_vQuantizedScale);
+        vector<int32_t>().swap(pWeight->_vQuantizedSum);
+    }
+    _workspace._vQuantizedUnit.clear();
+}
+
+void NNCpuNetwork::SetTrainingMode(TrainingMode mode)
+{
+    _trainingMode                           = mode;
+}
+
+void NNCpuNetwork::SetThreads(uint32_t threads)
+{
+    _threads                                = threads;
+}
+
+void NNCpuNetwork::SetRandomSeed(unsigned long seed)
+{
+    _rng.seed(seed);
+    _vWorkspace.clear();
+}
+
+// Checks that every output layer has a data set with host errors and deltas and rejects the training features
+// NNNetwork::Train supports that are not implemented here, then lays out the fast sparse transposed matrices
+bool NNCpuNetwork::CheckTraining()
+{
+    if (!_bExamplesFound)
+    {
+        printf("NNCpuNetwork::Train: No data sets loaded for network %s\n", _name.c_str());
+        return false;
+    }
+    if (_bSparsenessPenalty)
+    {
+        printf("NNCpuNetwork::Train: Sparseness penalty is not supported\n");
+        return false;
+    }
+
+    for (NNCpuLayer* pLayer : _vFPOrder)
+    {
+        if (pLayer->_bBatchNormalization || pLayer->_bDenoising || (pLayer->_deltaNorm > (NNFloat)0.0))
+        {
+            printf("NNCpuNetwork::Train: Batch normalization, denoising and delta normalization of layer %s are not supported\n", pLayer->_name.c_str());
+            return false;
+        }
+        if ((pLayer->_kind == NNLayer::Kind::Input) && (pLayer->_pDropout > (NNFloat)0.0))
+        {
+            printf("NNCpuNetwork::Train: Dropout of input layer %s is not supported\n", pLayer->_name.c_str());
+            return false;
+        }
+
+        if (pLayer->_kind == NNLayer::Kind::Output)
+        {
+            uint32_t attributes             = (pLayer->_pDataSet != NULL) ? pLayer->_pDataSet->_attributes : 0;
+            if (!(attributes & NNDataSetEnums::Sparse) || !(attributes & NNDataSetEnums::Boolean))
+            {
+                printf("NNCpuNetwork::Train: Output layer %s needs a Boolean sparse data set\n", pLayer->_name.c_str());
+                return false;
+            }
+        }
+
+        if ((pLayer->_kind == NNLayer::Kind::Input) && pLayer->_bFastSparse)
+        {
+            pLayer->_sparseTransposedIndices = pLayer->_pDataSet->GenerateSparseTransposedStartOnHost(_batch, pLayer->_vSparseTransposedStart);
+            if (pLayer->_sparseTransposedIndices == 0)
+                return false;
+        }
+    }
+
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if (pWeight->_norm > (NNFloat)0.0)
+        {
+            printf("NNCpuNetwork::Train: Weight normalization of weights %s to %s is not supported\n", pWeight->_pInputLayer->_name.c_str(), pWeight->_pOutputLayer->_name.c_str());
+            return false;
+        }
+        if (pWeight->_pInputLayer->_bFastSparse && pWeight->_bTransposed)
+        {
+            printf("NNCpuNetwork::Train: Transposed weights from fast sparse layer %s are not supported\n", pWeight->_pInputLayer->_name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Output deltas, or the hidden deltas gathered from the outgoing layers times the activation derivative, then the
+// weight gradients and the deltas of the incoming layers as in NNLayer::BackPropagateFullyConnected.  The
+// gradient of weights from a fast sparse layer only has rows for the features of the batch, so under plain SGD
+// (no velocities and no regularization of untouched rows) it is added straight to the shared weights.
+void NNCpuNetwork::BackPropagate(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t position, uint32_t batch, uint32_t* pShuffleIndex, NNFloat alpha, NNFloat lambda, NNFloat lambda1)
+{
+    uint32_t stride                         = pLayer->_stride;
+    NNFloat* pUnit                          = w._vUnit[pLayer->_index].data();
+    NNFloat* pDelta                         = w._vDelta[pLayer->_index].data();
+    if (pLayer->_kind == NNLayer::Kind::Output)
+        pLayer->_pDataSet->CalculateOutputDeltaOnHost(_errorFunction, pLayer->_activation, position, batch, stride, pUnit, pDelta, pLayer->_RELUSlope, pLayer->_ELUAlpha, pLayer->_SELULambda, pShuffleIndex);
+    else
+        hCalculateHadamardProduct(pLayer->_activation, (uint64_t)batch * stride, (NNFloat)1.0 / ((NNFloat)1.0 - pLayer->_pDropout), pUnit, pDelta, pLayer->_RELUSlope, pLayer->_ELUAlpha, pLayer->_SELULambda);
+
+    bool bDirectSparse                      = (_trainingMode == SGD) && (lambda == (NNFloat)0.0) && (lambda1 == (NNFloat)0.0);
+    for (size_t i = 0; i < pLayer->_vIncomingLayer.size(); i++)
+    {
+        NNCpuLayer* pInputLayer             = pLayer->_vIncomingLayer[i];
+        NNCpuWeight* pWeight                = pLayer->_vIncomingWeight[i];
+        NNCpuWeight* pSrcWeight             = pWeight->GetSourceWeight();
+        uint32_t k                          = pInputLayer->_stride;
+
+        if (!pWeight->_bLocked)
+        {
+            uint32_t j                      = pInputLayer->_index;
+            NNFloat gradientAlpha           = -(NNFloat)1.0 / (pSrcWeight->_sharingCount * (NNFloat)batch);
+            NNFloat* pSparseTransposedData  = pInputLayer->_bFastSparse && !w._vSparseTransposedData[j].empty() ? w._vSparseTransposedData[j].data() : NULL;
+            if (pInputLayer->_bFastSparse && bDirectSparse)
+            {
+                if (pSparseTransposedData)
+                    hCalculateSparseTransposedAnalogWeightGradient(alpha * gradientAlpha, (NNFloat)1.0, k, stride, pInputLayer->_vSparseTransposedStart.data(), w._vSparseTransposedEnd[j].data(),
+                                                                   w._vSparseTransposedIndex[j].data(), pSparseTransposedData, pDelta, pSrcWeight->_vWeight.data());
+                else
+                    hCalculateSparseTransposedWeightGradient(alpha * gradientAlpha, (NNFloat)1.0, k, stride, pInputLayer->_vSparseTransposedStart.data(), w._vSparseTransposedEnd[j].data(),
+                                                             w._vSparseTransposedIndex[j].data(), pDelta, pSrcWeight->_vWeight.data());
+            }
+            else
+            {
+                vector<NNFloat>& vGradient  = w._vWeightGradient[pSrcWeight->_index];
+                if (vGradient.empty())
+                    vGradient.resize(pSrcWeight->_vWeight.size());
+                NNFloat beta                = (w._vUpdateCount[pSrcWeight->_index] == 0) ? (NNFloat)0.0 : (NNFloat)1.0;
+                if (pInputLayer->_bFastSparse)
+                {
+                    if (pSparseTransposedData)
+                        hCalculateSparseTransposedAnalogWeightGradient(gradientAlpha, beta, k, stride, pInputLayer->_vSparseTransposedStart.data(), w._vSparseTransposedEnd[j].data(),
+                                                                       w._vSparseTransposedIndex[j].data(), pSparseTransposedData, pDelta, vGradient.data());
+                    else
+                        hCalculateSparseTransposedWeightGradient(gradientAlpha, beta, k, stride, pInputLayer->_vSparseTransposedStart.data(), w._vSparseTransposedEnd[j].data(),
+                                                                 w._vSparseTransposedIndex[j].data(), pDelta, vGradient.data());
+                }
+                else if (pWeight->_bTransposed)
+                {
+                    // G[stride][k] = alpha * Delta^T * X
+                    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, stride, k, batch, gradientAlpha, pDelta, stride, w._vUnit[j].data(), k, beta, vGradient.data(), k);
+                }
+                else
+                {
+                    // G[k][stride] = alpha * X^T * Delta
+                    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, k, stride, batch, gradientAlpha, w._vUnit[j].data(), k, pDelta, stride, beta, vGradient.data(), stride);
+                }
+                w._vUpdateCount[pSrcWeight->_index]++;
+            }
+        }
+
+        // Delta(input) += Delta * W^T, W is [k][stride], or [stride][k] if transposed
+        if (pInputLayer->_kind != NNLayer::Kind::Input)
+        {
+            cblas_sgemm(CblasRowMajor, CblasNoTrans, pWeight->_bTransposed ? CblasNoTrans : CblasTrans,
+                        batch, k, stride,
+                        (NNFloat)1.0,
+                        pDelta, stride,
+                        pWeight->GetWeightBuffer(), pWeight->_bTransposed ? k : stride,
+                        (NNFloat)1.0,
+                        w._vDelta[pInputLayer->_index].data(), k);
+        }
+    }
+
+    for (NNCpuLayer* pSkipLayer : pLayer->_vIncomingSkip)
+    {
+        if (pSkipLayer->_kind != NNLayer::Kind::Input)
+            hAddBuffers(w._vDelta[pSkipLayer->_index].data(), pDelta, (uint64_t)batch * stride);
+    }
+}
+
+// Applies the gradients of a minibatch like NNWeight::UpdateWeights, racing the other training threads
+void NNCpuNetwork::UpdateWeights(NNCpuWorkspace& w, uint32_t batch, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1, NNFloat t)
+{
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if (pWeight->_bLocked)
+            continue;
+
+        // Weights that only received direct sparse updates have no gradient
+        if (!pWeight->_bShared && (w._vUpdateCount[pWeight->_index] > 0))
+        {
+            uint64_t size                   = pWeight->_vWeight.size();
+            NNFloat* pGradient              = w._vWeightGradient[pWeight->_index].data();
+            NNFloat* pW                     = pWeight->_vWeight.data();
+            switch (_trainingMode)
+            {
+                case SGD:
+                    hSGDUpdateWeights(alpha, lambda, lambda1, size, pGradient, pW);
+                    break;
+
+                case Momentum:
+                    hMomentumUpdateWeights(alpha, lambda, lambda1, mu, size, pWeight->_vWeightVelocity.data(), pGradient, pW);
+                    break;
+
+                case AdaGrad:
+                    hAdaGradUpdateWeights(alpha, lambda, lambda1, size, pWeight->_vWeightVelocity.data(), pGradient, pW);
+                    break;
+
+                case Nesterov:
+                    hNesterovUpdateWeights(alpha, lambda, lambda1, mu, size, pWeight->_vWeightVelocity.data(), pGradient, pW);
+                    break;
+
+                case RMSProp:
+                    hRMSPropUpdateWeights(alpha, lambda, lambda1, mu, size, pWeight->_vWeightVelocity.data(), pGradient, pW);
+                    break;
+
+                case AdaDelta:
+                    hAdaDeltaUpdateWeights(lambda, lambda1, mu, size, pWeight->_vWeightVelocity.data(), pGradient, pWeight->_vWeightGradientVelocity.data(), pW);
+                    break;
+
+                case Adam:
+                    hAdamUpdateWeights(alpha, lambda, lambda1, mu, mu1, t, size, pWeight->_vWeightVelocity.data(), pGradient, pWeight->_vWeightGradientVelocity.data(), pW);
+                    break;
+            }
+        }
+
+        // Biases are unshared so always update them
+        uint32_t width                      = pWeight->_pOutputLayer->_stride;
+        NNFloat* pDelta                     = w._vDelta[pWeight->_pOutputLayer->_index].data();
+        NNFloat* pBias                      = pWeight->_vBias.data();
+        switch (_trainingMode)
+        {
+            case SGD:
+                hSGDUpdateBiases(alpha, batch, width, pDelta, pBias);
+                break;
+
+            case Momentum:
+                hMomentumUpdateBiases(alpha, mu, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pBias);
+                break;
+
+            case AdaGrad:
+                hAdaGradUpdateBiases(alpha, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pBias);
+                break;
+
+            case Nesterov:
+                hNesterovUpdateBiases(alpha, mu, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pBias);
+                break;
+
+            case RMSProp:
+                hRMSPropUpdateBiases(alpha, mu, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pBias);
+                break;
+
+            case AdaDelta:
+                hAdaDeltaUpdateBiases(mu, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pWeight->_vBiasGradientVelocity.data(), pBias);
+                break;
+
+            case Adam:
+                hAdamUpdateBiases(alpha, mu, mu1, t, batch, width, pDelta, pWeight->_vBiasVelocity.data(), pWeight->_vBiasGradientVelocity.data(), pBias);
+                break;
+        }
+    }
+    std::fill(w._vUpdateCount.begin(), w._vUpdateCount.end(), 0);
+}
+
+// One minibatch of NNNetwork::Train in a thread's workspace, returns its training error
+NNFloat NNCpuNetwork::TrainBatch(NNCpuWorkspace& w, uint32_t position, uint32_t batch, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1)
+{
+    uint32_t* pShuffleIndex                 = _vShuffleIndex.empty() ? NULL : _vShuffleIndex.data();
+    for (NNCpuLayer* pLayer : _vFPOrder)
+        ForwardPropagate(w, pLayer, position, batch, pShuffleIndex, true);
+
+    NNFloat error                           = (NNFloat)0.0;
+    for (NNCpuLayer* pLayer : _vFPOrder)
+    {
+        if (pLayer->_kind == NNLayer::Kind::Output)
+            error                          += pLayer->_pDataSet->CalculateErrorOnHost(_errorFunction, pLayer->_activation, position, batch, pLayer->_stride, w._vUnit[pLayer->_index].data(), pShuffleIndex);
+        else if (pLayer->_kind == NNLayer::Kind::Hidden)
+            memset(w._vDelta[pLayer->_index].data(), 0, (uint64_t)batch * pLayer->_stride * sizeof(NNFloat));
+    }
+
+    // Time step of Adam and the learning rate decay, counted across threads
+    uint64_t batches;
+#pragma omp atomic capture
+    batches                                 = _batches++;
+    NNFloat stepAlpha                       = (_decay <= (NNFloat)0.0) ? alpha : alpha * ((NNFloat)1.0 / ((NNFloat)1.0 + _decay * (NNFloat)batches));
+
+    for (auto it = _vFPOrder.rbegin(); it != _vFPOrder.rend(); it++)
+    {
+        if ((*it)->_kind != NNLayer::Kind::Input)
+            BackPropagate(w, *it, position, batch, pShuffleIndex, stepAlpha, lambda, lambda1);
+    }
+    UpdateWeights(w, batch, stepAlpha, lambda, lambda1, mu, mu1, (NNFloat)(batches + 1));
+    return error;
+}
+
+NNFloat NNCpuNetwork::CalculateRegularizationError(NNFloat lambda, NNFloat lambda1)
+{
+    // Error on a shared set of weights is only calculated from its original source
+    double error                            = 0.0;
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if (pWeight->_bShared)
+            continue;
+        for (NNFloat w : pWeight->_vWeight)
+            error                          += (NNFloat)0.5 * lambda * w * w + lambda1 * fabs(w);
+    }
+    return (NNFloat)error;
+}
+
+NNFloat NNCpuNetwork::Train(uint32_t epochs, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1)
+{
+    if (!CheckTraining())
+        return FLT_MAX;
+    ClearQuantization();
+
+    hSetDeltaBoost(_deltaBoost_one, _deltaBoost_zero);
+    hSetSMCE(_SMCE_oneTarget, _SMCE_zeroTarget, _SMCE_oneScale, _SMCE_zeroScale);
+
+    // One workspace per thread, but no more threads than minibatches
+    uint32_t batches                        = (_examples + _batch - 1) / _batch;
+    uint32_t threads                        = (_threads > 0) ? _threads : omp_get_max_threads();
+    threads                                 = std::max(1u, std::min(threads, batches));
+    while (_vWorkspace.size() < threads)
+    {
+        _vWorkspace.push_back(NNCpuWorkspace());
+        _vWorkspace.back()._rng.seed(_rng());
+    }
+    for (uint32_t i = 0; i < threads; i++)
+        AllocateWorkspace(_vWorkspace[i], true);
+
+    // Clear velocities as NNNetwork::Train does by default
+    if (_trainingMode != SGD)
+    {
+        bool bGradientVelocity              = (_trainingMode == AdaDelta) || (_trainingMode == Adam);
+        for (NNCpuWeight* pWeight : _vWeight)
+        {
+            if (!pWeight->_bShared)
+                pWeight->_vWeightVelocity.assign(pWeight->_vWeight.size(), (NNFloat)0.0);
+            pWeight->_vBiasVelocity.assign(pWeight->_vBias.size(), (NNFloat)0.0);
+            if (bGradientVelocity)
+            {
+                if (!pWeight->_bShared)
+                    pWeight->_vWeightGradientVelocity.assign(pWeight->_vWeight.size(), (NNFloat)0.0);
+                pWeight->_vBiasGradientVelocity.assign(pWeight->_vBias.size(), (NNFloat)0.0);
+            }
+        }
+        _batches                            = 0;
+    }
+
+    NNFloat average_error_training          = (NNFloat)FLT_MAX;
+    NNFloat average_error_regularization    = (NNFloat)0.0;
+    for (uint32_t epoch = 0; epoch < epochs; epoch++)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        if (_bShuffleIndices)
+        {
+            _vShuffleIndex.resize(_examples);
+            std::iota(_vShuffleIndex.begin(), _vShuffleIndex.end(), 0);
+            std::shuffle(_vShuffleIndex.begin(), _vShuffleIndex.end(), _rng);
+        }
+        else
+            _vShuffleIndex.clear();
+
+        // Each thread takes a contiguous range of the epoch's minibatches.  A single thread keeps the kernels'
+        // own OpenMP parallelism.
+        double total_error_training         = 0.0;
+#pragma omp parallel num_threads(threads) if(threads > 1) reduction(+:total_error_training)
+        {
+            uint32_t t                      = omp_get_thread_num();
+            uint32_t first                  = ((uint64_t)batches * t) / threads;
+            uint32_t last                   = ((uint64_t)batches * (t + 1)) / threads;
+            for (uint32_t b = first; b < last; b++)
+            {
+                uint32_t pos                = b * _batch;
+                uint32_t minibatch          = std::min(_batch, _examples - pos);
+                total_error_training       += TrainBatch(_vWorkspace[t], pos, minibatch, alpha, lambda, lambda1, mu, mu1);
+            }
+        }
+        auto const end = std::chrono::steady_clock::now();
+
+        // Regularization error of the weights at the end of the epoch rather than of every minibatch
+        average_error_training              = total_error_training / _examples;
+        average_error_regularization        = ((lambda != (NNFloat)0.0) || (lambda1 != (NNFloat)0.0)) ? CalculateRegularizationError(lambda, lambda1) : (NNFloat)0.0;
+        double seconds                      = elapsed_seconds(start, end);
+        printf("NNCpuNetwork::Train: Epoch %u, average error %f, average training error %f, average regularization error %f, elapsed time %fs, %.0f examples/s, %u threads\n", ++_epochs,
+               average_error_training + average_error_regularization,
+               average_error_training, average_error_regularization,
+               seconds, _examples / seconds, threads);
+    }
+    return average_error_training + average_error_regularization;
+}
+
+bool NNCpuNetwork::GetWeights(const string& inputLayer, const string& outputLayer, vector<NNFloat>& vWeight, vector<NNFloat>& vBias)
+{
+    for (NNCpuWeight* pWeight : _vWeight)
+    {
+        if ((pWeight->_pInputLayer->_name == inputLayer) && (pWeight->_pOutputLayer->_name == outputLayer))
+        {
+            vWeight                         = pWeight->GetSourceWeight()->_vWeight;
+            vBias                           = pWeight->_vBias;
+            return true;
+        }
+    }
+    printf("NNCpuNetwork::GetWeights: No weights from layer %s to layer %s\n", inputLayer.c_str(), outputLayer.c_str());
+    return false;
+}
+
+vector<tuple<string, string> > NNCpuNetwork::GetWeightLayers() const
+{
+    vector<tuple<string, string> > vLayer;
+    for (const NNCpuWeight* pWeight : _vWeight)
+        vLayer.push_back(make_tuple(pWeight->_pInputLayer->_name, pWeight->_pOutputLayer->_name));
+    return vLayer;
+}
+
+NNCpuNetwork* LoadCpuNeuralNetworkNetCDF(const string& fname, uint32_t batch)
+{
+    NNNetworkDescriptor nd;
+    if (!LoadNNNetworkDescriptorNetCDF(fname, nd))
+        return NULL;
+    return new NNCpuNetwork(nd, batch);
+}
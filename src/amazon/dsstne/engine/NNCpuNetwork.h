@@ -0,0 +1,185 @@
+/*
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef NNCPUNETWORK_H
+#define NNCPUNETWORK_H
+#ifndef __NVCC__
+
+// Forward propagation and training of fully connected networks on the CPU.  Built from the same NNNetworkDescriptor
+// (and so the same NetCDF files) as NNNetwork, it mirrors NNLayer::ForwardPropagateFullyConnected in prediction mode
+// using the host kernels of hostkernels.h and BLAS sgemm, and never touches the GPU.  Data sets must stay unsharded
+// so that their host copies are complete (see LoadNetCDF).
+//
+// Train is Hogwild style asynchronous SGD: each epoch's (shuffled) minibatches are split into one contiguous range
+// per thread, and every thread runs forward and back propagation of its minibatches in its own workspace and then
+// applies the update of the training mode to the shared weights and velocities without any locking.  The
+// minibatches read weights that other threads are updating, which is what makes it asynchronous; with sparse input
+// and output rows most updates of the large input weights touch different rows.  Each thread calls the host kernels
+// and sgemm single threaded, so BLAS must not spawn threads of its own inside OpenMP regions (OpenMP builds of
+// OpenBLAS detect this, pthreads builds need OPENBLAS_NUM_THREADS=1).
+//
+// Quantize switches prediction to int8 weights (see hostkernels.h) with one scale per output unit.  The units
+// feeding each dense weight matrix get one scale per layer, calibrated on their largest magnitude while predicting
+// the first examples of the data sets in single precision.  Weights from fast sparse input layers are multiplied
+// by the sparse input values in single precision.  Training or loading data sets discards the quantization.
+class NNCpuNetwork {
+public:
+    NNCpuNetwork(const NNNetworkDescriptor& d, uint32_t batch = DefaultBatch);
+    ~NNCpuNetwork();
+
+    bool LoadDataSets(vector<NNDataSetBase*>& vData);      // Input layers need a data set, output layers only to train
+    bool SetPosition(uint32_t position);
+    bool SetBatch(uint32_t batch);
+    uint32_t GetBatch() const;
+    uint32_t GetExamples() const;
+    uint32_t GetPosition() const;
+    string GetName() const;
+
+    bool PredictBatch();
+    NNFloat* GetUnitBuffer(const string& layer);           // batch x stride units of a layer, NULL if not found
+    bool GetUnits(const string& layer, vector<NNFloat>& vUnit);
+    bool CalculateTopK(const string& layer, uint32_t k, vector<NNFloat>& vKey, vector<uint32_t>& vValue);
+    bool DumpBatch(FILE* fp);
+
+    bool Quantize(uint32_t examples);                       // Calibrates on the first examples and predicts in int8
+    bool SetQuantized(bool bQuantized);                     // Switches between int8 and fp32 once quantized
+    bool IsQuantized() const;
+    uint64_t GetWeightBytes(bool bQuantized) const;         // Bytes of the fp32 or int8 weights, scales and biases
+
+    void SetTrainingMode(TrainingMode mode);
+    void SetThreads(uint32_t threads);                      // Training threads, 0 (default) for omp_get_max_threads()
+    void SetRandomSeed(unsigned long seed);                 // Seeds shuffling and dropout
+    NNFloat Train(uint32_t epochs, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1);
+    bool GetWeights(const string& inputLayer, const string& outputLayer, vector<NNFloat>& vWeight, vector<NNFloat>& vBias);
+    vector<tuple<string, string> > GetWeightLayers() const; // Input and output layer of each set of weights
+
+private:
+    struct NNCpuWeight;
+
+    struct NNCpuLayer {
+        string                  _name;                      // Name of layer
+        uint32_t                _index;                     // Index in _vLayer and the workspace buffers
+        NNLayer::Kind           _kind;                      // Input, Hidden, Output or Target
+        string                  _dataSet;                   // Name of data set for input and output layers
+        uint32_t                _Nx;                        // Unit X size
+        uint32_t                _Ny;                        // Unit Y size
+        uint32_t                _Nz;                        // Unit Z size
+        uint32_t                _Nw;                        // Unit W size
+        uint32_t                _stride;                    // Units per example
+        Activation              _activation;                // Activation function
+        NNFloat                 _RELUSlope;                 // Leaky RELU slope parameter
+        NNFloat                 _ELUAlpha;                  // Alpha parameter for ELU and SELU activations
+        NNFloat                 _SELULambda;                // Lambda parameter for SELU activations
+        NNFloat                 _biasInit;                  // Bias for weights saved without one
+        NNFloat                 _pDropout;                  // Dropout probability while training
+        NNFloat                 _deltaNorm;                 // Maximum delta vector length (training unsupported)
+        bool                    _bSparse;                   // Sparse input layer
+        bool                    _bFastSparse;               // Use sparse Z calculation instead of sgemm
+        bool                    _bDenoising;                // Denoised input layer (training unsupported)
+        bool                    _bBatchNormalization;       // Apply batch normalization (inference statistics)
+        vector<NNFloat>         _vScaleBN;                  // Batch normalization scale
+        vector<NNFloat>         _vBiasBN;                   // Batch normalization bias
+        vector<NNFloat>         _vRunningMeanBN;            // Batch normalization running mean
+        vector<NNFloat>         _vRunningVarianceBN;        // Batch normalization running variance
+        vector<NNCpuLayer*>     _vIncomingLayer;            // Source layers
+        vector<NNCpuWeight*>    _vIncomingWeight;           // Weights from the source layers
+        vector<NNCpuLayer*>     _vIncomingSkip;             // Skip layer sources
+        NNDataSetBase*          _pDataSet;                  // Data set of input and output layers
+        vector<uint32_t>        _vSparseTransposedStart;    // Transposed matrix layout of fast sparse input layers
+        uint64_t                _sparseTransposedIndices;   // Transposed matrix entries per batch
+        NNFloat                 _quantizedUnitScale;        // Scale of the int8 units of a quantized network, 0 if none
+    };
+
+    struct NNCpuWeight {
+        uint32_t                _index;                     // Index in _vWeight and the workspace buffers
+        NNCpuLayer*             _pInputLayer;
+        NNCpuLayer*             _pOutputLayer;
+        bool                    _bShared;
+        bool                    _bTransposed;               // Weights are stored [output][input]
+        bool                    _bLocked;                   // Weights and biases are not trained
+        NNFloat                 _norm;                      // Maximum weight vector length (training unsupported)
+        uint32_t                _sharingCount;              // Weights sharing these (including themselves)
+        vector<NNFloat>         _vWeight;                   // [input][output] unless transposed
+        vector<NNFloat>         _vBias;
+        vector<NNFloat>         _vWeightVelocity;           // Shared between training threads
+        vector<NNFloat>         _vWeightGradientVelocity;
+        vector<NNFloat>         _vBiasVelocity;
+        vector<NNFloat>         _vBiasGradientVelocity;
+        NNCpuWeight*            _pSharedWeight;             // Owner of the weights if shared
+        vector<int8_t>          _vQuantizedWeight;          // [output][hQuantizedStride(input)], or [input][output] from fast sparse layers
+        vector<NNFloat>         _vQuantizedScale;           // Scale of each output's int8 weights
+        vector<int32_t>         _vQuantizedSum;             // Sum of each output's int8 weights
+
+        NNCpuWeight* GetSourceWeight() { return _bShared ? _pSharedWeight : this; }
+        NNFloat* GetWeightBuffer() { return GetSourceWeight()->_vWeight.data(); }
+    };
+
+    // Per thread state of a minibatch; prediction uses _workspace and training one per thread
+    struct NNCpuWorkspace {
+        vector<vector<NNFloat> >    _vUnit;                 // batch x stride units per layer
+        vector<vector<NNFloat> >    _vDelta;                // batch x stride deltas per layer
+        vector<vector<NNFloat> >    _vRandom;               // Dropout randoms per layer
+        vector<vector<NNFloat> >    _vWeightGradient;       // Gradients per source weight
+        vector<uint32_t>            _vUpdateCount;          // Gradient contributions per source weight
+        vector<vector<uint32_t> >   _vSparseTransposedEnd;  // Transposed matrices of fast sparse input layers
+        vector<vector<uint32_t> >   _vSparseTransposedIndex;
+        vector<vector<NNFloat> >    _vSparseTransposedData;
+        vector<vector<int8_t> >     _vQuantizedUnit;        // batch x hQuantizedStride(stride) int8 units per layer
+        std::mt19937                _rng;                   // Dropout random number generator
+    };
+
+    string                      _name;                      // Name of network
+    uint32_t                    _batch;                     // Batch size
+    uint32_t                    _position;                  // Current position
+    uint32_t                    _examples;                  // Examples in the data sets
+    bool                        _bExamplesFound;            // Has the examples count been set by a data set
+    vector<NNCpuLayer*>         _vLayer;                    // Layers in descriptor order
+    vector<NNCpuLayer*>         _vFPOrder;                  // Forward propagation order
+    vector<NNCpuWeight*>        _vWeight;                   // Weights in descriptor order
+    map<string, NNCpuLayer*>    _mLayer;                    // Layers by name
+    NNCpuWorkspace              _workspace;                 // Prediction workspace
+    bool                        _bQuantized;                // Predict with the int8 weights
+
+    // Training settings and state
+    ErrorFunction               _errorFunction;             // Error function of the output layers
+    TrainingMode                _trainingMode;              // Optimizer applied by Train
+    bool                        _bShuffleIndices;           // Shuffle the examples every epoch
+    bool                        _bSparsenessPenalty;        // Sparseness penalty (training unsupported)
+    NNFloat                     _decay;                     // Learning rate decay per minibatch
+    NNFloat                     _deltaBoost_one;            // Delta scaling of nonzero targets
+    NNFloat                     _deltaBoost_zero;           // Delta scaling of zero targets
+    NNFloat                     _SMCE_oneTarget;            // Scaled marginal cross entropy settings
+    NNFloat                     _SMCE_zeroTarget;
+    NNFloat                     _SMCE_oneScale;
+    NNFloat                     _SMCE_zeroScale;
+    uint32_t                    _epochs;                    // Epochs trained
+    uint64_t                    _batches;                   // Minibatches trained, the Adam time step
+    uint32_t                    _threads;                   // Training threads, 0 for omp_get_max_threads()
+    std::mt19937                _rng;                       // Shuffling and workspace seeds
+    vector<uint32_t>            _vShuffleIndex;             // Example order of the current epoch
+    vector<NNCpuWorkspace>      _vWorkspace;                // Training workspaces
+
+    NNCpuLayer* GetLayer(const string& layer) const;
+    void CalculateFPOrder();
+    void AllocateWorkspace(NNCpuWorkspace& w, bool bTraining);
+    void ClearQuantization();
+    bool CheckTraining();
+    void ForwardPropagate(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t position, uint32_t batch, uint32_t* pShuffleIndex, bool bTraining);
+    void CalculateActivation(NNCpuLayer* pLayer, NNFloat* pUnit, uint32_t batch);
+    void CalculateDropout(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t batch);
+    void BackPropagate(NNCpuWorkspace& w, NNCpuLayer* pLayer, uint32_t position, uint32_t batch, uint32_t* pShuffleIndex, NNFloat alpha, NNFloat lambda, NNFloat lambda1);
+    void UpdateWeights(NNCpuWorkspace& w, uint32_t batch, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1, NNFloat t);
+    NNFloat TrainBatch(NNCpuWorkspace& w, uint32_t position, uint32_t batch, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1);
+    NNFloat CalculateRegularizationError(NNFloat lambda, NNFloat lambda1);
+};
+
+NNCpuNetwork* LoadCpuNeuralNetworkNetCDF(const string& fname, uint32_t batch = DefaultBatch);
+#endif // __NVCC__
+#endif
@@ -584,7 +584,7 @@ static void DumpTensor(cudnnTensorDescriptor_t t)
     
 }
 
-void NNLayer::Allocate(bool validate)
+void NNLayer::Allocate(bool validate, bool bInference)
 {
     Deallocate();
     uint64_t size                   = (uint64_t)_maxLocalStride * (uint64_t)_localBatch; 
@@ -642,19 +642,21 @@ void NNLayer::Allocate(bool validate)
         DumpTensor(_tensorDescriptor);
     }
 
-    // Allocate hidden unit data for hidden and output layers and for non-sparse input layers
-    if (!_bSparse || !_bFastSparse || (_kind != Input)
-        || (_bSparse && (_kind == Input) && validate) // only for validation
-    )
+    // Allocate hidden unit data for hidden and output layers and for non-sparse input layers, unless only
+    // predicting, where NNNetwork::PlanUnitBuffers points the unit data into arenas shared between layers
+    if (HasUnitBuffer(validate))
     {
         _vUnit.resize(size);
-        _pbUnit.reset(new GpuBuffer<NNFloat>(size));
-        if (getGpu()._id == 0)
-            printf("NNLayer::Allocate: Allocating %" PRIu64 " bytes (%u, %u) of unit data for layer %s\n", size * sizeof(NNFloat), _maxLocalStride, _localBatch, _name.c_str());
+        if (!bInference)
+        {
+            _pbUnit.reset(new GpuBuffer<NNFloat>(size));
+            if (getGpu()._id == 0)
+                printf("NNLayer::Allocate: Allocating %" PRIu64 " bytes (%u, %u) of unit data for layer %s\n", size * sizeof(NNFloat), _maxLocalStride, _localBatch, _name.c_str());
+        }
     }
 
-    // Allocate delta data for non-input layers
-    if (_kind != Input)
+    // Allocate delta data for non-input layers unless only predicting
+    if ((_kind != Input) && !bInference)
     {
         _vDelta.resize(size);
         _pbDelta.reset(new GpuBuffer<NNFloat>(size));
@@ -669,8 +671,8 @@ void NNLayer::Allocate(bool validate)
         
     }
     
-    // Allocate dropout data if active
-    if (_pDropout > (NNFloat)0.0)
+    // Allocate dropout data if active, dropout is only applied in training
+    if ((_pDropout > (NNFloat)0.0) && !bInference)
     {
         _pbDropout.reset(new GpuBuffer<NNFloat>(size));
         if (getGpu()._id == 0)        
@@ -819,11 +821,11 @@ void NNLayer::RefreshState(NNNetwork* pNetwork, TrainingMode trainingMode, bool
         if (getGpu()._numprocs > 1)
             RefreshParallelization();
 
-        Allocate(validate);
+        Allocate(validate, pNetwork->_bInference);
         
         if (_bBatchNormalization)
         {
-            if (trainingMode != TrainingMode::SGD)
+            if ((trainingMode != TrainingMode::SGD) && !pNetwork->_bInference)
             {
                 if (!_pbScaleVelocityBN)
                     _pbScaleVelocityBN.reset(new GpuBuffer<NNFloat>(_localStride));
@@ -161,7 +161,7 @@ private:
     int32_t                     _priority;                  // Mutable priority for calculating propagation ordering
     NNLayer(NNLayerDescriptor& l, uint32_t batch);
     ~NNLayer();
-    void Allocate(bool validate);
+    void Allocate(bool validate, bool bInference);
     void Deallocate();
     void SetBatch(uint32_t batch);
     void RefreshParallelization();
@@ -196,6 +196,10 @@ private:
             return _pbUnit ? _pbUnit->_pDevData : NULL;
     }
     NNFloat* GetUnitBuffer() { return _pbUnit ? _pbUnit->_pDevData : NULL; }
+    bool HasUnitBuffer(bool validate) const                 // Fast sparse input layers only need unit data for validation
+    {
+        return !_bSparse || !_bFastSparse || (_kind != Input) || validate;
+    }
     NNFloat* GetIncomingDeltaBuffer() 
     { 
         if (_bBatchNormalization)
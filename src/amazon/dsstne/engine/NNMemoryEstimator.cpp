@@ -0,0 +1,321 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+
+// Sparse input layers denser than this use dense units instead of the fast sparse kernels (see NNLayer::RefreshState)
+static const NNFloat cMaxFastSparseDensity  = (NNFloat)0.1;
+
+NNMemoryFootprint::NNMemoryFootprint(const string& name) :
+_name(name),
+_units(0),
+_deltas(0),
+_weights(0),
+_gradients(0),
+_velocities(0),
+_sparseTransposed(0),
+_data(0),
+_other(0)
+{
+}
+
+uint64_t NNMemoryFootprint::GetTotal() const
+{
+    return _units + _deltas + _weights + _gradients + _velocities + _sparseTransposed + _data + _other;
+}
+
+uint64_t NNMemoryEstimate::GetTotal() const
+{
+    uint64_t total                          = _unitArenas;
+    for (auto& f : _vLayer)
+        total                              += f.GetTotal() - (_unitArenas ? f._units : 0);
+    for (auto& f : _vWeight)
+        total                              += f.GetTotal();
+    for (auto& f : _vDataSet)
+        total                              += f.GetTotal();
+    return total;
+}
+
+static uint64_t DataTypeSize(NNDataSetEnums::DataType dataType)
+{
+    switch (dataType)
+    {
+        case NNDataSetEnums::LLInt:
+        case NNDataSetEnums::ULLInt:
+        case NNDataSetEnums::Double:
+            return 8;
+
+        case NNDataSetEnums::RGB8:
+        case NNDataSetEnums::UChar:
+        case NNDataSetEnums::Char:
+            return 1;
+
+        case NNDataSetEnums::RGB16:
+            return 2;
+
+        default:
+            return 4;
+    }
+}
+
+bool EstimateNetworkMemory(const NNNetworkDescriptor& nd, const vector<NNDataSetDescriptor>& vDataSetDescriptor, uint32_t batch, TrainingMode mode, bool bInference, NNMemoryEstimate& estimate)
+{
+    estimate._batch                         = batch;
+    estimate._vLayer.resize(0);
+    estimate._vWeight.resize(0);
+    estimate._vDataSet.resize(0);
+    estimate._unitArenas                    = 0;
+
+    map<string, uint32_t> mLayer;
+    for (uint32_t i = 0; i < nd._vLayerDescriptor.size(); i++)
+        mLayer[nd._vLayerDescriptor[i]._name] = i;
+    map<string, const NNDataSetDescriptor*> mDataSet;
+    for (auto& d : vDataSetDescriptor)
+        mDataSet[d._name]                   = &d;
+
+    // Velocities per weight (or batch normalization parameter) of each optimizer
+    uint64_t velocities                     = 0;
+    if (!bInference && (mode != TrainingMode::SGD))
+        velocities                          = ((mode == TrainingMode::AdaDelta) || (mode == TrainingMode::Adam)) ? 2 : 1;
+
+    // Data sets
+    for (auto& d : vDataSetDescriptor)
+    {
+        NNMemoryFootprint f(d._name);
+        uint64_t N                          = (uint64_t)d._dim._width * d._dim._height * d._dim._length;
+        if (d._attributes & NNDataSetEnums::Sparse)
+        {
+            uint64_t datapoints             = (uint64_t)((double)d._examples * (double)N * d._sparseDensity);
+            f._data                         = 2 * d._examples * sizeof(uint64_t) + datapoints * sizeof(uint32_t);
+            if (!(d._attributes & NNDataSetEnums::Boolean))
+                f._data                    += datapoints * DataTypeSize(d._dataType);
+        }
+        else
+        {
+            f._data                         = (uint64_t)d._examples * N * DataTypeSize(d._dataType);
+        }
+        estimate._vDataSet.push_back(f);
+    }
+
+    // Layers
+    for (auto& l : nd._vLayerDescriptor)
+    {
+        NNMemoryFootprint f(l._name);
+        uint64_t stride                     = (uint64_t)l._Nx * l._Ny * l._Nz * l._Nw;
+        uint64_t size                       = stride * batch;
+        auto pd                             = mDataSet.find(l._dataSet);
+        const NNDataSetDescriptor* pDataSet = (pd != mDataSet.end()) ? pd->second : NULL;
+        bool bSparse                        = (l._attributes & NNLayer::Attributes::Sparse) != 0;
+        bool bFastSparse                    = (l._kind == NNLayer::Kind::Input) && bSparse && (pDataSet != NULL) && (pDataSet->_sparseDensity <= cMaxFastSparseDensity);
+        bool bBatchNormalization            = (l._attributes & NNLayer::Attributes::BatchNormalization) != 0;
+
+        if (!bFastSparse)
+            f._units                        = size * sizeof(NNFloat);
+        if ((l._kind != NNLayer::Kind::Input) && !bInference)
+        {
+            f._deltas                       = size * sizeof(NNFloat);
+            if (bBatchNormalization)
+            {
+                f._units                   += size * sizeof(NNFloat);
+                f._deltas                  += size * sizeof(NNFloat);
+            }
+        }
+        if ((l._pDropout > (NNFloat)0.0) && !bInference)
+            f._other                       += size * sizeof(NNFloat);
+        if ((l._type == NNLayer::Type::Pooling) && (l._poolingFunction == PoolingFunction::Cosine))
+            f._other                       += 2 * size * sizeof(NNFloat);
+
+        // Batch normalization scale, bias, running and saved statistics and their gradients
+        if (bBatchNormalization)
+        {
+            uint64_t strideBN               = (l._type == NNLayer::Type::Convolutional) ? l._Nz : stride;
+            f._weights                      = 8 * strideBN * sizeof(NNFloat);
+            f._velocities                   = 2 * velocities * stride * sizeof(NNFloat);
+        }
+
+        // Transposed sparse input of a training batch, bounded by both the batch and the data set's datapoints with
+        // each feature's list padded to 32 entries as in NNDataSet::GenerateSparseTransposedMatrix
+        if (bFastSparse && !bInference)
+        {
+            uint64_t N                      = (uint64_t)pDataSet->_dim._width * pDataSet->_dim._height * pDataSet->_dim._length;
+            N                               = max(N, stride);
+            uint64_t datapoints             = (uint64_t)((double)pDataSet->_examples * (double)N * pDataSet->_sparseDensity);
+            uint64_t indices                = min(N * batch, datapoints) + 31 * N;
+            f._sparseTransposed             = 2 * N * sizeof(uint32_t) + indices * sizeof(uint32_t);
+            if (!(pDataSet->_attributes & NNDataSetEnums::Boolean) || (pDataSet->_attributes & NNDataSetEnums::Weighted))
+                f._sparseTransposed        += indices * sizeof(NNFloat);
+
+            // Denoising randoms, one per datapoint of the data set
+            if (l._attributes & NNLayer::Attributes::Denoising)
+                f._other                   += datapoints * sizeof(NNFloat);
+        }
+        estimate._vLayer.push_back(f);
+    }
+
+    // Weights
+    for (auto& wd : nd._vWeightDescriptor)
+    {
+        auto pi                             = mLayer.find(wd._inputLayer);
+        auto po                             = mLayer.find(wd._outputLayer);
+        if ((pi == mLayer.end()) || (po == mLayer.end()))
+        {
+            printf("EstimateNetworkMemory: Unable to find layers %s and %s of weight.\n", wd._inputLayer.c_str(), wd._outputLayer.c_str());
+            return false;
+        }
+        const NNLayerDescriptor& in         = nd._vLayerDescriptor[pi->second];
+        const NNLayerDescriptor& out        = nd._vLayerDescriptor[po->second];
+        NNMemoryFootprint f(wd._inputLayer + " -> " + wd._outputLayer);
+
+        // Sizes as in the NNWeight constructor
+        uint64_t size, biasSize;
+        bool bConvolution                   = (out._type == NNLayer::Type::Convolutional);
+        if (bConvolution)
+        {
+            uint64_t outputs                = (out._dimensions == 2) ? out._Ny : (out._dimensions == 3) ? out._Nz : out._Nw;
+            uint64_t inputs                 = (out._dimensions == 2) ? in._Ny : (out._dimensions == 3) ? in._Nz : in._Nw;
+            size                            = outputs * inputs * out._kernelX * out._kernelY * out._kernelZ;
+            biasSize                        = outputs;
+        }
+        else
+        {
+            uint64_t inputStride            = (uint64_t)in._Nx * in._Ny * in._Nz * in._Nw;
+            biasSize                        = (uint64_t)out._Nx * out._Ny * out._Nz * out._Nw;
+            size                            = inputStride * biasSize;
+        }
+
+        f._weights                          = ((wd._bShared ? 0 : size) + biasSize) * sizeof(NNFloat);
+        if (!bInference)
+        {
+            f._gradients                    = ((wd._bShared ? 0 : size) + (bConvolution ? biasSize : 0)) * sizeof(NNFloat);
+            f._velocities                   = velocities * (size + biasSize) * sizeof(NNFloat);
+        }
+        estimate._vWeight.push_back(f);
+    }
+
+    // Unit data shared by NNNetwork::PlanUnitBuffers, with the forward propagation order of CalculatePropagationOrder
+    if (bInference)
+    {
+        uint32_t layers                     = nd._vLayerDescriptor.size();
+        vector<int32_t> vPriority(layers, -1);
+        for (uint32_t i = 0; i < layers; i++)
+        {
+            if (nd._vLayerDescriptor[i]._kind == NNLayer::Kind::Input)
+                vPriority[i]                = 0;
+        }
+        for (uint32_t pass = 0; pass < layers; pass++)
+        {
+            bool bChanged                   = false;
+            for (uint32_t i = 0; i < layers; i++)
+            {
+                const NNLayerDescriptor& l  = nd._vLayerDescriptor[i];
+                for (auto& s : l._vSource)
+                {
+                    auto p                  = mLayer.find(s);
+                    if ((p != mLayer.end()) && (vPriority[p->second] >= 0) && (vPriority[i] < vPriority[p->second] + 1))
+                    {
+                        vPriority[i]        = vPriority[p->second] + 1;
+                        bChanged            = true;
+                    }
+                }
+                for (auto& s : l._vSkip)
+                {
+                    auto p                  = mLayer.find(s);
+                    if ((p != mLayer.end()) && (vPriority[p->second] >= 0) && (vPriority[i] < vPriority[p->second] + 1))
+                    {
+                        vPriority[i]        = vPriority[p->second] + 1;
+                        bChanged            = true;
+                    }
+                }
+            }
+            if (!bChanged)
+                break;
+        }
+
+        vector<uint32_t> vOrder(layers);
+        for (uint32_t i = 0; i < layers; i++)
+            vOrder[i]                       = i;
+        stable_sort(vOrder.begin(), vOrder.end(), [&vPriority](uint32_t a, uint32_t b) { return vPriority[a] < vPriority[b]; });
+        vector<uint32_t> vStep(layers);
+        for (uint32_t i = 0; i < layers; i++)
+            vStep[vOrder[i]]                = i;
+
+        vector<NNBufferLifetime> vLifetime;
+        for (uint32_t i = 0; i < layers; i++)
+        {
+            const NNLayerDescriptor& l      = nd._vLayerDescriptor[i];
+            if (estimate._vLayer[i]._units == 0)
+                continue;
+            NNBufferLifetime lifetime;
+            lifetime._size                  = estimate._vLayer[i]._units / sizeof(NNFloat);
+            lifetime._first                 = (l._kind == NNLayer::Kind::Input) ? 0 : vStep[i];
+            lifetime._last                  = (l._kind == NNLayer::Kind::Output) ? layers : lifetime._first;
+            vLifetime.push_back(lifetime);
+        }
+
+        // Extend each source's lifetime through the step of its last consumer
+        uint32_t index                      = 0;
+        for (uint32_t i = 0; i < layers; i++)
+        {
+            if (estimate._vLayer[i]._units == 0)
+                continue;
+            for (uint32_t j = 0; j < layers; j++)
+            {
+                const NNLayerDescriptor& c  = nd._vLayerDescriptor[j];
+                bool bConsumer              = (find(c._vSource.begin(), c._vSource.end(), nd._vLayerDescriptor[i]._name) != c._vSource.end()) ||
+                                              (find(c._vSkip.begin(), c._vSkip.end(), nd._vLayerDescriptor[i]._name) != c._vSkip.end());
+                if (bConsumer)
+                    vLifetime[index]._last  = max(vLifetime[index]._last, vStep[j]);
+            }
+            index++;
+        }
+
+        vector<uint32_t> vArena;
+        vector<uint64_t> vArenaSize;
+        estimate._unitArenas                = PlanBufferArenas(vLifetime, vArena, vArenaSize) * sizeof(NNFloat);
+    }
+    return true;
+}
+
+uint32_t FindLargestBatch(const NNNetworkDescriptor& nd, const vector<NNDataSetDescriptor>& vDataSetDescriptor, TrainingMode mode, bool bInference, uint64_t budget)
+{
+    // Memory only grows with the batch, so bracket the largest fitting batch by doubling and then bisect
+    NNMemoryEstimate estimate;
+    uint32_t lo                             = 0;
+    uint32_t hi                             = 1;
+    while (true)
+    {
+        if (!EstimateNetworkMemory(nd, vDataSetDescriptor, hi, mode, bInference, estimate))
+            return 0;
+        if (estimate.GetTotal() > budget)
+            break;
+        lo                                  = hi;
+        if (hi >= (1u << 30))
+            return lo;
+        hi                                 *= 2;
+    }
+
+    while (hi - lo > 1)
+    {
+        uint32_t mid                        = lo + (hi - lo) / 2;
+        EstimateNetworkMemory(nd, vDataSetDescriptor, mid, mode, bInference, estimate);
+        if (estimate.GetTotal() > budget)
+            hi                              = mid;
+        else
+            lo                              = mid;
+    }
+    return lo;
+}
@@ -401,10 +401,11 @@ bool NNNetwork::SetCheckpoint(string name, int32_t interval)
     return true;
 }
 
-NNNetwork::NNNetwork(NNNetworkDescriptor& d, uint32_t batch) :
+NNNetwork::NNNetwork(NNNetworkDescriptor& d, uint32_t batch, bool bInference) :
 _name(d._name),
 _kind(d._kind),
 _mode(Prediction),
+_bInference(bInference),
 _trainingMode(SGD),
 _batch(batch),
 _localBatch(batch),
@@ -454,6 +455,7 @@ _receiveIndex(1),
 _CUDNNWorkspaceSize(0),
 _maxCUDNNWorkspaceSize(0),
 _pbCUDNNWorkspace(),
+_vUnitArena(),
 _verbose(false)
 {
 
@@ -823,6 +825,59 @@ void NNNetwork::SetTrainingMode(TrainingMode mode)
 
 }
 
+void NNNetwork::PlanUnitBuffers()
+{
+    // Release old arenas first so peak memory never holds both plans
+    for (auto l : _vLayer)
+        l->_pbUnit.reset();
+    _vUnitArena.resize(0);
+
+    // A layer's units are live from the forward propagation step that writes them through the last step that
+    // reads them, input layers from the start since LoadBatch loads all of them first.  Output layers are read
+    // by the caller after prediction and so stay live through the end.
+    bool validate                           = (_mode == Validation);
+    uint32_t steps                          = _vFPOrder.size();
+    map<NNLayer*, uint32_t> mStep;
+    for (uint32_t i = 0; i < steps; i++)
+        mStep[_vFPOrder[i]]                 = i;
+
+    vector<NNLayer*> vLayer;
+    vector<NNBufferLifetime> vLifetime;
+    uint64_t unplannedSize                  = 0;
+    for (auto l : _vFPOrder)
+    {
+        if (!l->HasUnitBuffer(validate))
+            continue;
+
+        NNBufferLifetime lifetime;
+        lifetime._size                      = (uint64_t)l->_maxLocalStride * (uint64_t)l->_localBatch;
+        lifetime._first                     = (l->_kind == NNLayer::Kind::Input) ? 0 : mStep[l];
+        lifetime._last                      = lifetime._first;
+        if (l->_kind == NNLayer::Kind::Output)
+            lifetime._last                  = steps;
+        for (auto p : l->_vOutgoingLayer)
+            lifetime._last                  = max(lifetime._last, mStep[p]);
+        for (auto p : l->_vOutgoingSkip)
+            lifetime._last                  = max(lifetime._last, mStep[p]);
+        vLayer.push_back(l);
+        vLifetime.push_back(lifetime);
+        unplannedSize                      += lifetime._size;
+    }
+
+    // Allocate arenas and point each layer's unit data at the start of its arena
+    vector<uint32_t> vArena;
+    vector<uint64_t> vArenaSize;
+    uint64_t plannedSize                    = PlanBufferArenas(vLifetime, vArena, vArenaSize);
+    for (auto size : vArenaSize)
+        _vUnitArena.push_back(unique_ptr<GpuBuffer<NNFloat>>(new GpuBuffer<NNFloat>(size)));
+    for (size_t i = 0; i < vLayer.size(); i++)
+        vLayer[i]->_pbUnit.reset(new GpuBuffer<NNFloat>(_vUnitArena[vArena[i]]->_pDevData, vLifetime[i]._size));
+
+    if (getGpu()._id == 0)
+        printf("NNNetwork::PlanUnitBuffers: Allocating %" PRIu64 " bytes in %u arenas of unit data for %u layers instead of %" PRIu64 " bytes\n",
+               plannedSize * sizeof(NNFloat), (uint32_t)vArenaSize.size(), (uint32_t)vLayer.size(), unplannedSize * sizeof(NNFloat));
+}
+
 void NNNetwork::RefreshShuffleBuffers()
 {
     // Shuffle buffers are sticky once training has been triggered to prevent malloc thrashing
@@ -943,14 +998,20 @@ void NNNetwork::RefreshState()
     if (_bDirty)
     {
         // Reallocate layers if batch size doesn't match
+        bool bLayerRefreshed                    = false;
         for (auto l: _vLayer)
         {
             if (l->_bDirty)
             {
                 l->RefreshState(this, _trainingMode, _mode == Validation);
+                bLayerRefreshed                 = true;
             }
         }
 
+        // Share unit data between layers that are never live at the same time if only predicting
+        if (_bInference && bLayerRefreshed)
+            PlanUnitBuffers();
+
         // Add weight gradients and velocity if needed
         for (auto w: _vWeight)
         {
@@ -1535,6 +1596,14 @@ void NNNetwork::PredictValidationBatch(uint32_t layers)
 
 NNFloat NNNetwork::Train(uint32_t epochs, NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1)
 {
+    // Inference networks have no deltas or gradients to train with
+    if (_bInference)
+    {
+        if (getGpu()._id == 0)
+            printf("NNNetwork::Train: Attempt to train neural network %s, which was loaded for inference only\n", _name.c_str());
+        return (NNFloat)FLT_MAX;
+    }
+
     // Check if already in training mode
     if (_mode != Training)
     {
@@ -2485,6 +2554,12 @@ bool NNNetwork::Validate()
         return false;
     }
 
+    if (_bInference)
+    {
+        cout << "NNNetwork::Validate: Neural network " << _name << " was loaded for inference only" << endl;
+        return false;
+    }
+
     // Check if already in validate mode
     if (_mode != Validation)
     {
@@ -2789,933 +2864,928 @@ uint32_t MPI_Bcast_NNNetworkDescriptor(NNNetworkDescriptor& d)
     return 0;
 }
 
-NNNetwork* LoadNeuralNetworkJSON(const string& fname, const uint32_t batch, const vector<NNDataSetBase*>& vDataSet)
+bool LoadNNNetworkDescriptorJSON(const string& fname, const vector<NNDataSetDescriptor>& vDataSetDescriptor, NNNetworkDescriptor& nd)
 {
-    NNNetwork* pNetwork                             = NULL;
-    NNNetworkDescriptor nd;
     Json::Value index;
     Json::Reader reader;
     bool bValid                                     = true;
     bool bWeightsSupplied                           = false;
     string wfname;
 
-    if (getGpu()._id == 0)
-    {
-        std::ifstream stream(fname, std::ifstream::binary);
-        bool parsedSuccess                          = reader.parse(stream, index, false);
+    std::ifstream stream(fname, std::ifstream::binary);
+    bool parsedSuccess                              = reader.parse(stream, index, false);
 
-        if (!parsedSuccess)
-        {
-            // Report failures and their locations
-            // in the document.
-            printf("LoadNeuralNetworkJSON: Failed to parse JSON file: %s, error: %s\n", fname.c_str(), reader.getFormattedErrorMessages().c_str());
-            bValid                                  = false;
-        }
-        else
+    if (!parsedSuccess)
+    {
+        // Report failures and their locations
+        // in the document.
+        printf("LoadNeuralNetworkJSON: Failed to parse JSON file: %s, error: %s\n", fname.c_str(), reader.getFormattedErrorMessages().c_str());
+        bValid                                      = false;
+    }
+    else
+    {
+        // Iterate through network in a case-insensitive manner
+        NNFloat version                             = NN_VERSION;
+        set<string> sLayer;
+        for (Json::ValueIterator itr = index.begin(); itr != index.end() ; itr++)
         {
-            // Iterate through network in a case-insensitive manner
-            NNFloat version                         = NN_VERSION;
-            set<string> sLayer;
-            for (Json::ValueIterator itr = index.begin(); itr != index.end() ; itr++)
+            // Extract JSON object key/value pair
+            string name                             = itr.name();
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            Json::Value key                         = itr.key();
+            Json::Value value                       = *itr;
+            string vstring                          = value.isString() ? value.asString() : "";
+            std::transform(vstring.begin(), vstring.end(), vstring.begin(), ::tolower);
+
+            // Read version if present
+            if (name.compare("version") == 0)
             {
-                // Extract JSON object key/value pair
-                string name                         = itr.name();
-                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-                Json::Value key                     = itr.key();
-                Json::Value value                   = *itr;
-                string vstring                      = value.isString() ? value.asString() : "";
-                std::transform(vstring.begin(), vstring.end(), vstring.begin(), ::tolower);
-
-                // Read version if present
-                if (name.compare("version") == 0)
+                version                             = value.asFloat();
+                if (version < 0.6999)
                 {
-                    version                         = value.asFloat();
-                    if (version < 0.6999)
-                    {
-                        printf("LoadNeuralNetworkJSON: version %f (must be at least 0.7)\n", version);
-                        bValid                      = false;
-                        goto exit;
-                    }
+                    printf("LoadNeuralNetworkJSON: version %f (must be at least 0.7)\n", version);
+                    bValid                          = false;
+                    goto exit;
                 }
+            }
+
+            // Read name if present
+            else if (name.compare("name") == 0)
+            {
+                nd._name                            = value.asString();
+            }
 
-                // Read name if present
-                else if (name.compare("name") == 0)
+            // Read kind if present
+            else if (name.compare("kind") == 0)
+            {
+                if (vstring.compare("feedforward") == 0)
+                    nd._kind                        = NNNetwork::Kind::FeedForward;
+                else if (vstring.compare("autoencoder") == 0)
+                    nd._kind                        = NNNetwork::Kind::AutoEncoder;
+                else
                 {
-                    nd._name                        = value.asString();
+                    printf("LoadNeuralNetworkJSON: Invalid network kind: %s\n", value.asString().c_str());
+                    bValid                          = false;
+                    goto exit;
                 }
+            }
+
+            // Read weights data if present
+            else if (name.compare("weightsdata") == 0)
+            {
+                bWeightsSupplied                    = true;
+                wfname                              = value.asString();
+            }
 
-                // Read kind if present
-                else if (name.compare("kind") == 0)
+            // Read LRN parameters if present
+            else if ((name.compare("lrn") == 0) || (name.compare("localresponsenormalization") == 0))
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    if (vstring.compare("feedforward") == 0)
-                        nd._kind                    = NNNetwork::Kind::FeedForward;
-                    else if (vstring.compare("autoencoder") == 0)
-                        nd._kind                    = NNNetwork::Kind::AutoEncoder;
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("k") == 0)
+                        nd._LRN_k                   = pvalue.asFloat();
+                    else if (pname.compare("n") == 0)
+                        nd._LRN_n                   = pvalue.asInt();
+                    else if (pname.compare("alpha") == 0)
+                        nd._LRN_alpha               = pvalue.asFloat();
+                    else if (pname.compare("beta") == 0)
+                        nd._LRN_beta                = pvalue.asFloat();
                     else
                     {
-                        printf("LoadNeuralNetworkJSON: Invalid network kind: %s\n", value.asString().c_str());
-                        bValid                      = false;
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid LocalResponseNormalization parameter: %s\n", name.c_str());
+                        bValid                          = false;
                         goto exit;
                     }
                 }
+            }
 
-                // Read weights data if present
-                else if (name.compare("weightsdata") == 0)
-                {
-                    bWeightsSupplied                = true;
-                    wfname                          = value.asString();
-                }
-
-                // Read LRN parameters if present
-                else if ((name.compare("lrn") == 0) || (name.compare("localresponsenormalization") == 0))
+            // Read Maxout parameters if present
+            else if (name.compare("maxout") == 0)
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("k") == 0)
+                        nd._maxout_k                = pvalue.asFloat();
+                    else
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("k") == 0)
-                            nd._LRN_k               = pvalue.asFloat();
-                        else if (pname.compare("n") == 0)
-                            nd._LRN_n               = pvalue.asInt();
-                        else if (pname.compare("alpha") == 0)
-                            nd._LRN_alpha           = pvalue.asFloat();
-                        else if (pname.compare("beta") == 0)
-                            nd._LRN_beta            = pvalue.asFloat();
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid LocalResponseNormalization parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid MaxOut parameter: %s\n", name.c_str());
+                        bValid                          = false;
+                        goto exit;
                     }
                 }
+            }
 
-                // Read Maxout parameters if present
-                else if (name.compare("maxout") == 0)
+            // Read Sparseness parameters if present
+            else if (name.compare("sparsenesspenalty") == 0)
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("p") == 0)
+                        nd._sparsenessPenalty_p = pvalue.asFloat();
+                    else if (pname.compare("beta") == 0)
+                        nd._sparsenessPenalty_beta      = pvalue.asFloat();
+                    else
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("k") == 0)
-                            nd._maxout_k            = pvalue.asFloat();
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid MaxOut parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid SparsenessPenalty parameter: %s\n", name.c_str());
+                        bValid                          = false;
+                        goto exit;
                     }
                 }
+            }
 
-                // Read Sparseness parameters if present
-                else if (name.compare("sparsenesspenalty") == 0)
+            // Read denoising parameters if present
+            else if (name.compare("denoising") == 0)
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("p") == 0)
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("p") == 0)
-                            nd._sparsenessPenalty_p = pvalue.asFloat();
-                        else if (pname.compare("beta") == 0)
-                            nd._sparsenessPenalty_beta  = pvalue.asFloat();
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid SparsenessPenalty parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        nd._denoising_p             = pvalue.asFloat();
                     }
-                }
-
-                // Read denoising parameters if present
-                else if (name.compare("denoising") == 0)
-                {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    else
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("p") == 0)
-                        {
-                            nd._denoising_p         = pvalue.asFloat();
-                        }
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid Denoising parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid Denoising parameter: %s\n", name.c_str());
+                        bValid                          = false;
+                        goto exit;
                     }
                 }
+            }
 
-                // Read Delta Boost parameters if present
-                else if (name.compare("deltaboost") == 0)
+            // Read Delta Boost parameters if present
+            else if (name.compare("deltaboost") == 0)
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("one") == 0)
+                        nd._deltaBoost_one          = pvalue.asFloat();
+                    else if (pname.compare("zero") == 0)
+                        nd._deltaBoost_zero         = pvalue.asFloat();
+                    else
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("one") == 0)
-                            nd._deltaBoost_one      = pvalue.asFloat();
-                        else if (pname.compare("zero") == 0)
-                            nd._deltaBoost_zero     = pvalue.asFloat();
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid DeltaBoost parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid DeltaBoost parameter: %s\n", name.c_str());
+                        bValid                          = false;
+                        goto exit;
                     }
                 }
+            }
 
-                // Read ScaledMarginalCrossEntropy parameters if present
-                else if ((name.compare("scaledmarginalcrossentropy") == 0) ||
-                         (name.compare("datascaledmarginalcrossentropy") == 0))
+            // Read ScaledMarginalCrossEntropy parameters if present
+            else if ((name.compare("scaledmarginalcrossentropy") == 0) ||
+                     (name.compare("datascaledmarginalcrossentropy") == 0))
+            {
+                for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
                 {
-                    for (Json::ValueIterator pitr = value.begin(); pitr != value.end() ; pitr++)
+                    string pname                    = pitr.name();
+                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                    Json::Value pkey                = pitr.key();
+                    Json::Value pvalue              = *pitr;
+                    if (pname.compare("onescale") == 0)
+                        nd._SMCE_oneScale           = pvalue.asFloat();
+                    else if (pname.compare("zeroscale") == 0)
+                        nd._SMCE_zeroScale          = pvalue.asFloat();
+                    else if (pname.compare("onetarget") == 0)
+                        nd._SMCE_oneTarget          = pvalue.asFloat();
+                    else if (pname.compare("zerotarget") == 0)
+                        nd._SMCE_zeroTarget         = pvalue.asFloat();
+                    else
                     {
-                        string pname                = pitr.name();
-                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                        Json::Value pkey            = pitr.key();
-                        Json::Value pvalue          = *pitr;
-                        if (pname.compare("onescale") == 0)
-                            nd._SMCE_oneScale       = pvalue.asFloat();
-                        else if (pname.compare("zeroscale") == 0)
-                            nd._SMCE_zeroScale      = pvalue.asFloat();
-                        else if (pname.compare("onetarget") == 0)
-                            nd._SMCE_oneTarget      = pvalue.asFloat();
-                        else if (pname.compare("zerotarget") == 0)
-                            nd._SMCE_zeroTarget     = pvalue.asFloat();
-                        else
-                        {
-                            name = pitr.name();
-                            printf("LoadNeuralNetworkJSON: Invalid ScaledMarginalCrossentropy parameter: %s\n", name.c_str());
-                            bValid                      = false;
-                            goto exit;
-                        }
+                        name = pitr.name();
+                        printf("LoadNeuralNetworkJSON: Invalid ScaledMarginalCrossentropy parameter: %s\n", name.c_str());
+                        bValid                          = false;
+                        goto exit;
                     }
                 }
+            }
 
-                // Read SchuffleIndices parameter if present
-                else if (name.compare("shuffleindices") == 0)
-                {
-                    nd._bShuffleIndices             = value.asBool();
-                }
+            // Read SchuffleIndices parameter if present
+            else if (name.compare("shuffleindices") == 0)
+            {
+                nd._bShuffleIndices                 = value.asBool();
+            }
 
-                // Read default ELU parameters
-                else if ((name.compare("reluslope") == 0) || (name.compare("slope") == 0))
-                {
-                    nd._RELUSlope                   = value.asFloat();
-                }
-                else if (name.compare("elualpha") == 0)
-                {
-                    nd._ELUAlpha                    = value.asFloat();
-                }
-                else if (name.compare("selulambda") == 0)
-                {
-                    nd._SELULambda                  = value.asFloat();
-                }
-                else if (name.compare("decay") == 0)
+            // Read default ELU parameters
+            else if ((name.compare("reluslope") == 0) || (name.compare("slope") == 0))
+            {
+                nd._RELUSlope                       = value.asFloat();
+            }
+            else if (name.compare("elualpha") == 0)
+            {
+                nd._ELUAlpha                        = value.asFloat();
+            }
+            else if (name.compare("selulambda") == 0)
+            {
+                nd._SELULambda                      = value.asFloat();
+            }
+            else if (name.compare("decay") == 0)
+            {
+                nd._decay                           = value.asFloat();
+            }
+
+            // Read error function
+            else if (name.compare("errorfunction") == 0)
+            {
+                if (vstring.compare("l1") == 0)
+                    nd._errorFunction               = ErrorFunction::L1;
+                else if (vstring.compare("l2") == 0)
+                    nd._errorFunction               = ErrorFunction::L2;
+                else if (vstring.compare("l2hinge") == 0)
+                    nd._errorFunction               = ErrorFunction::L2Hinge;
+                else if (vstring.compare("hinge") == 0)
+                    nd._errorFunction               = ErrorFunction::Hinge;
+                else if ((vstring.compare("crossentropy") == 0) || (vstring.compare("cross entropy") == 0))
+                    nd._errorFunction               = ErrorFunction::CrossEntropy;
+                else if (vstring.compare("scaledmarginalcrossentropy") == 0)
+                    nd._errorFunction               = ErrorFunction::ScaledMarginalCrossEntropy;
+                else if (vstring.compare("datascaledmarginalcrossentropy") == 0)
+                    nd._errorFunction               = ErrorFunction::DataScaledMarginalCrossEntropy;
+                else
                 {
-                    nd._decay                       = value.asFloat();
+                    printf("LoadNeuralNetworkJSON: Invalid error function: %s\n", value.asString().c_str());
+                    bValid                          = false;
+                    goto exit;
                 }
+            }
 
-                // Read error function
-                else if (name.compare("errorfunction") == 0)
+            // Read layer(s)
+            else if (name.compare("layers") == 0)
+            {
+                uint32_t size                       = value.isArray() ? value.size() : 1;
+                for (uint32_t i = 0; i < size; i++)
                 {
-                    if (vstring.compare("l1") == 0)
-                        nd._errorFunction           = ErrorFunction::L1;
-                    else if (vstring.compare("l2") == 0)
-                        nd._errorFunction           = ErrorFunction::L2;
-                    else if (vstring.compare("l2hinge") == 0)
-                        nd._errorFunction           = ErrorFunction::L2Hinge;
-                    else if (vstring.compare("hinge") == 0)
-                        nd._errorFunction           = ErrorFunction::Hinge;
-                    else if ((vstring.compare("crossentropy") == 0) || (vstring.compare("cross entropy") == 0))
-                        nd._errorFunction           = ErrorFunction::CrossEntropy;
-                    else if (vstring.compare("scaledmarginalcrossentropy") == 0)
-                        nd._errorFunction           = ErrorFunction::ScaledMarginalCrossEntropy;
-                    else if (vstring.compare("datascaledmarginalcrossentropy") == 0)
-                        nd._errorFunction           = ErrorFunction::DataScaledMarginalCrossEntropy;
+                    vector<NNWeightDescriptor> vSharedWeight;
+                    NNLayerDescriptor ldl;
+                    bool bSource                    = false;
+                    Json::Value layer               = value.isArray() ? value[i] : value;
+                    bool bAutoSize                  = false;
+
+                    // Determine default layer kind and type
+                    if (i == 0)
+                        ldl._kind                   = NNLayer::Kind::Input;
+                    else if (i == size - 1)
+                        ldl._kind                   = NNLayer::Kind::Output;
                     else
+                        ldl._kind                   = NNLayer::Kind::Hidden;
+                    ldl._type                       = NNLayer::Type::FullyConnected;
+
+
+                    // Search for supplied layer kind and type because we need to know this before parsing
+                    // the remainder of supplied keys
+                    for (Json::ValueIterator litr = layer.begin(); litr != layer.end() ; litr++)
                     {
-                        printf("LoadNeuralNetworkJSON: Invalid error function: %s\n", value.asString().c_str());
-                        bValid                      = false;
-                        goto exit;
+                        string lname                = litr.name();
+                        std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+                        Json::Value lkey            = litr.key();
+                        Json::Value lvalue          = *litr;
+
+                        // Read kind if present (default: Hidden)
+                        if (lname.compare("kind") == 0)
+                        {
+                            string s                = lvalue.asString();
+                            std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+                            if (s.compare("input") == 0)
+                                ldl._kind           = NNLayer::Kind::Input;
+                            else if (s.compare("hidden") == 0)
+                                ldl._kind           = NNLayer::Kind::Hidden;
+                            else if (s.compare("target") == 0)
+                                ldl._kind           = NNLayer::Kind::Target;
+                            else if (s.compare("output") == 0)
+                                ldl._kind           = NNLayer::Kind::Output;
+                            else
+                            {
+                                printf("LoadNeuralNetworkJSON: Invalid layer kind: %s\n", lvalue.asString().c_str());
+                                bValid              = false;
+                                goto exit;
+                            }
+                        }
+
+                        // Read type if present (default: FullyConnected)
+                        else if (lname.compare("type") == 0)
+                        {
+                            string s            = lvalue.asString();
+                            std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+                            if (s.compare("fullyconnected") == 0)
+                                ldl._type       = NNLayer::Type::FullyConnected;
+                            else if (s.compare("convolutional") == 0)
+                                ldl._type       = NNLayer::Type::Convolutional;
+                            else if (s.compare("pooling") == 0)
+                                ldl._type = NNLayer::Type::Pooling;
+                            else
+                            {
+                                printf("LoadNeuralNetworkJSON: Invalid layer type: %s\n", lvalue.asString().c_str());
+                                bValid          = false;
+                                goto exit;
+                            }
+                        }
                     }
-                }
 
-                // Read layer(s)
-                else if (name.compare("layers") == 0)
-                {
-                    uint32_t size                   = value.isArray() ? value.size() : 1;
-                    for (uint32_t i = 0; i < size; i++)
+                    // FullyConnected non-pooling Layers have default dimensions, others must be supplied or calculated
+                    if ((ldl._type == NNLayer::Type::Pooling) || (ldl._type == NNLayer::Type::Convolutional))
                     {
-                        vector<NNWeightDescriptor> vSharedWeight;
-                        NNLayerDescriptor ldl;
-                        bool bSource                = false;
-                        Json::Value layer           = value.isArray() ? value[i] : value;
-                        bool bAutoSize              = false;
-
-                        // Determine default layer kind and type
-                        if (i == 0)
-                            ldl._kind               = NNLayer::Kind::Input;
-                        else if (i == size - 1)
-                            ldl._kind               = NNLayer::Kind::Output;
-                        else
-                            ldl._kind               = NNLayer::Kind::Hidden;
-                        ldl._type                   = NNLayer::Type::FullyConnected;
+                        ldl._bDimensionsProvided = false;
+                    }
 
+                    // Determine default layer name
+                    switch (ldl._kind)
+                    {
+                        case NNLayer::Kind::Input:
+                            ldl._name               = "Input" + to_string(nd._vLayerDescriptor.size());
+                            break;
+
+                        case NNLayer::Kind::Hidden:
+                            ldl._name               = "Hidden" + to_string(nd._vLayerDescriptor.size());
+                            break;
+
+                        case NNLayer::Kind::Output:
+                            ldl._name               = "Output" + to_string(nd._vLayerDescriptor.size());
+                            break;
+
+                        case NNLayer::Kind::Target:
+                            ldl._name               = "Target" + to_string(nd._vLayerDescriptor.size());
+                            break;
+                    }
+
+                    for (Json::ValueIterator litr = layer.begin(); litr != layer.end() ; litr++)
+                    {
+                        string lname                = litr.name();
+                        std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
+                        Json::Value lkey            = litr.key();
+                        Json::Value lvalue          = *litr;
 
-                        // Search for supplied layer kind and type because we need to know this before parsing
-                        // the remainder of supplied keys
-                        for (Json::ValueIterator litr = layer.begin(); litr != layer.end() ; litr++)
+                        // Skip what we already know
+                        if ((lname.compare("kind") == 0) || (lname.compare("type") == 0))
                         {
-                            string lname            = litr.name();
-                            std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-                            Json::Value lkey        = litr.key();
-                            Json::Value lvalue      = *litr;
+                            continue;
+                        }
 
-                            // Read kind if present (default: Hidden)
-                            if (lname.compare("kind") == 0)
+                        // Read name if present
+                        if (lname.compare("name") == 0)
+                        {
+                            ldl._name               = lvalue.asString();
+                            if (sLayer.find(ldl._name) != sLayer.end())
                             {
-                                string s            = lvalue.asString();
-                                std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-                                if (s.compare("input") == 0)
-                                    ldl._kind       = NNLayer::Kind::Input;
-                                else if (s.compare("hidden") == 0)
-                                    ldl._kind       = NNLayer::Kind::Hidden;
-                                else if (s.compare("target") == 0)
-                                    ldl._kind       = NNLayer::Kind::Target;
-                                else if (s.compare("output") == 0)
-                                    ldl._kind       = NNLayer::Kind::Output;
+                                printf("LoadNeuralNetworkJSON: Duplicate layer name detected: %s\n", ldl._name.c_str());
+                                bValid              = false;
+                                goto exit;
+                            }
+                            sLayer.insert(ldl._name);
+                            continue;
+                        }
+
+                        if (lname.compare("sparse") == 0)
+                        {
+                            if (lvalue.asBool())
+                                ldl._attributes|= NNLayer::Attributes::Sparse;
+                            continue;
+                        }
+                        else if (lname.compare("n") == 0)
+                        {
+                            if (lvalue.isArray())
+                            {
+                                if (lvalue.size() < 5)
+                                {
+                                    ldl._dimensions         = lvalue.size();
+                                    switch (lvalue.size())
+                                    {
+                                        case 4:
+                                            ldl._Nw = lvalue[3].asInt();
+                                        case 3:
+                                            ldl._Nz = lvalue[2].asInt();
+                                        case 2:
+                                            ldl._Ny = lvalue[1].asInt();
+                                        case 1:
+                                            ldl._Nx = lvalue[0].asInt();
+                                    }
+
+                                }
                                 else
                                 {
-                                    printf("LoadNeuralNetworkJSON: Invalid layer kind: %s\n", lvalue.asString().c_str());
-                                    bValid          = false;
+                                    printf("LoadNeuralNetworkJSON: >4 dimensions detected in layer: %s\n", ldl._name.c_str());
+                                    bValid              = false;
                                     goto exit;
                                 }
-                            }
 
-                            // Read type if present (default: FullyConnected)
-                            else if (lname.compare("type") == 0)
+                            }
+                            else if (lvalue.isString())
                             {
-                                string s        = lvalue.asString();
-                                std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-                                if (s.compare("fullyconnected") == 0)
-                                    ldl._type   = NNLayer::Type::FullyConnected;
-                                else if (s.compare("convolutional") == 0)
-                                    ldl._type   = NNLayer::Type::Convolutional;
-                                else if (s.compare("pooling") == 0)
-                                    ldl._type = NNLayer::Type::Pooling;
-                                else
+                                string nstring              = lvalue.asString();
+                                std::transform(nstring.begin(), nstring.end(), nstring.begin(), ::tolower);
+                                if ((ldl._kind != NNLayer::Kind::Hidden) && (nstring.compare("auto") == 0))
+                                    bAutoSize           = true;
+                                else if (nstring.compare("auto") == 0)
                                 {
-                                    printf("LoadNeuralNetworkJSON: Invalid layer type: %s\n", lvalue.asString().c_str());
-                                    bValid      = false;
+                                    printf("LoadNeuralNetworkJSON: Illegal attempt to use auto for hidden layer: %s\n", ldl._name.c_str());
+                                    bValid              = false;
                                     goto exit;
                                 }
                             }
+                            else
+                            {
+                                ldl._Nx                 = lvalue.asInt();
+                                ldl._dimensions         = 1;
+                            }
+                            continue;
                         }
-
-                        // FullyConnected non-pooling Layers have default dimensions, others must be supplied or calculated
-                        if ((ldl._type == NNLayer::Type::Pooling) || (ldl._type == NNLayer::Type::Convolutional))
+                        else if (lname.compare("pdropout") == 0)
                         {
-                            ldl._bDimensionsProvided = false;
+                            ldl._pDropout               = lvalue.asFloat();
+                            continue;
                         }
 
-                        // Determine default layer name
-                        switch (ldl._kind)
-                        {
-                            case NNLayer::Kind::Input:
-                                ldl._name           = "Input" + to_string(nd._vLayerDescriptor.size());
-                                break;
-
-                            case NNLayer::Kind::Hidden:
-                                ldl._name           = "Hidden" + to_string(nd._vLayerDescriptor.size());
-                                break;
-
-                            case NNLayer::Kind::Output:
-                                ldl._name           = "Output" + to_string(nd._vLayerDescriptor.size());
-                                break;
-
-                            case NNLayer::Kind::Target:
-                                ldl._name           = "Target" + to_string(nd._vLayerDescriptor.size());
-                                break;
-                        }
 
-                        for (Json::ValueIterator litr = layer.begin(); litr != layer.end() ; litr++)
+                        // Read types common present in everything but input layers
+                        if (ldl._kind != NNLayer::Kind::Input)
                         {
-                            string lname            = litr.name();
-                            std::transform(lname.begin(), lname.end(), lname.begin(), ::tolower);
-                            Json::Value lkey        = litr.key();
-                            Json::Value lvalue      = *litr;
-
-                            // Skip what we already know
-                            if ((lname.compare("kind") == 0) || (lname.compare("type") == 0))
+                            // Read source(s) if present
+                            if (lname.compare("source") == 0)
                             {
-                                continue;
-                            }
+                                uint32_t size           = lvalue.isArray() ? lvalue.size() : 1;
 
-                            // Read name if present
-                            if (lname.compare("name") == 0)
-                            {
-                                ldl._name           = lvalue.asString();
-                                if (sLayer.find(ldl._name) != sLayer.end())
+                                // MaxPooling and LRN layers can only have one source
+#if 0
+                                if ((ldl._type == NNLayer::Type::Pooling) && (size > 1))
                                 {
-                                    printf("LoadNeuralNetworkJSON: Duplicate layer name detected: %s\n", ldl._name.c_str());
-                                    bValid          = false;
-                                    goto exit;
+                                        printf("LoadNeuralNetworkJSON: Pooling layer %s has multiple sources\n", ldl._name.c_str());
+                                        bValid                      = false;
+                                        goto exit;
                                 }
-                                sLayer.insert(ldl._name);
-                                continue;
-                            }
+#endif
 
-                            if (lname.compare("sparse") == 0)
-                            {
-                                if (lvalue.asBool())
-                                    ldl._attributes|= NNLayer::Attributes::Sparse;
+                                for (uint32_t j = 0; j < size; j++)
+                                {
+                                    Json::Value src = lvalue.isArray() ? lvalue[j] : lvalue;
+                                    ldl._vSource.push_back(src.asString());
+                                    bSource             = true;             // Signal existence of at least one source
+                                }
                                 continue;
                             }
-                            else if (lname.compare("n") == 0)
+
+                            else if ((lname.compare("kernel") == 0) || (lname.compare("kernelstride") == 0))
                             {
+                                uint32_t x                      = 1;
+                                uint32_t y                      = 1;
+                                uint32_t z                      = 1;
+                                uint32_t dimensions             = 1;
                                 if (lvalue.isArray())
                                 {
-                                    if (lvalue.size() < 5)
+                                    if (lvalue.size() < 4)
                                     {
-                                        ldl._dimensions     = lvalue.size();
+                                        dimensions              = lvalue.size();
                                         switch (lvalue.size())
                                         {
-                                            case 4:
-                                                ldl._Nw = lvalue[3].asInt();
                                             case 3:
-                                                ldl._Nz = lvalue[2].asInt();
+                                                z               = lvalue[2].asInt();
                                             case 2:
-                                                ldl._Ny = lvalue[1].asInt();
+                                                y               = lvalue[1].asInt();
                                             case 1:
-                                                ldl._Nx = lvalue[0].asInt();
+                                                x               = lvalue[0].asInt();
                                         }
-
                                     }
                                     else
                                     {
-                                        printf("LoadNeuralNetworkJSON: >4 dimensions detected in layer: %s\n", ldl._name.c_str());
-                                        bValid          = false;
+                                        bValid                  = false;
                                         goto exit;
                                     }
-
                                 }
-                                else if (lvalue.isString())
+                                else
                                 {
-                                    string nstring          = lvalue.asString();
-                                    std::transform(nstring.begin(), nstring.end(), nstring.begin(), ::tolower);
-                                    if ((ldl._kind != NNLayer::Kind::Hidden) && (nstring.compare("auto") == 0))
-                                        bAutoSize       = true;
-                                    else if (nstring.compare("auto") == 0)
-                                    {
-                                        printf("LoadNeuralNetworkJSON: Illegal attempt to use auto for hidden layer: %s\n", ldl._name.c_str());
-                                        bValid          = false;
-                                        goto exit;
-                                    }
+                                    x                           = lvalue.asInt();
+                                }
+
+                                // Copy values to kernel or kernel stride
+                                if (lname.compare("kernel") == 0)
+                                {
+                                    ldl._kernelX                = x;
+                                    ldl._kernelY                = y;
+                                    ldl._kernelZ                = z;
+                                    ldl._kernelDimensions       = dimensions;
                                 }
                                 else
                                 {
-                                    ldl._Nx             = lvalue.asInt();
-                                    ldl._dimensions     = 1;
+                                    ldl._kernelStrideX          = x;
+                                    ldl._kernelStrideY          = y;
+                                    ldl._kernelStrideZ          = z;
                                 }
                                 continue;
                             }
-                            else if (lname.compare("pdropout") == 0)
+                        }
+
+
+
+
+                        // Hidden layer-specific features
+                        if (ldl._kind == NNLayer::Kind::Hidden)
+                        {
+                            // Layer-specific sparse penalty
+                            if (lname.compare("batchnormalization") == 0)
                             {
-                                ldl._pDropout           = lvalue.asFloat();
+                                if (lvalue.asBool())
+                                    ldl._attributes|= NNLayer::Attributes::BatchNormalization;
                                 continue;
                             }
 
-
-                            // Read types common present in everything but input layers
-                            if (ldl._kind != NNLayer::Kind::Input)
+                            else if (lname.compare("sparsenesspenalty") == 0)
                             {
-                                // Read source(s) if present
-                                if (lname.compare("source") == 0)
+                                for (Json::ValueIterator pitr = lvalue.begin(); pitr != lvalue.end() ; pitr++)
                                 {
-                                    uint32_t size       = lvalue.isArray() ? lvalue.size() : 1;
-
-                                    // MaxPooling and LRN layers can only have one source
-#if 0
-                                    if ((ldl._type == NNLayer::Type::Pooling) && (size > 1))
-                                    {
-                                            printf("LoadNeuralNetworkJSON: Pooling layer %s has multiple sources\n", ldl._name.c_str());
-                                            bValid                  = false;
-                                            goto exit;
-                                    }
-#endif
-
-                                    for (uint32_t j = 0; j < size; j++)
+                                    string pname                    = pitr.name();
+                                    std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
+                                    Json::Value pkey                = pitr.key();
+                                    Json::Value pvalue              = *pitr;
+                                    if (pname.compare("p") == 0)
+                                        ldl._sparsenessPenalty_p = pvalue.asFloat();
+                                    else if (pname.compare("beta") == 0)
+                                        ldl._sparsenessPenalty_beta      = pvalue.asFloat();
+                                    else
                                     {
-                                        Json::Value src = lvalue.isArray() ? lvalue[j] : lvalue;
-                                        ldl._vSource.push_back(src.asString());
-                                        bSource         = true;             // Signal existence of at least one source
+                                        printf("LoadNeuralNetworkJSON: Invalid sparseness penalty parameter for hidden layer %s\n", ldl._name.c_str());
+                                        bValid                      = false;
+                                        goto exit;
                                     }
-                                    continue;
                                 }
+                                continue;
+                            }
+                        }
 
-                                else if ((lname.compare("kernel") == 0) || (lname.compare("kernelstride") == 0))
-                                {
-                                    uint32_t x                  = 1;
-                                    uint32_t y                  = 1;
-                                    uint32_t z                  = 1;
-                                    uint32_t dimensions         = 1;
-                                    if (lvalue.isArray())
-                                    {
-                                        if (lvalue.size() < 4)
-                                        {
-                                            dimensions          = lvalue.size();
-                                            switch (lvalue.size())
-                                            {
-                                                case 3:
-                                                    z           = lvalue[2].asInt();
-                                                case 2:
-                                                    y           = lvalue[1].asInt();
-                                                case 1:
-                                                    x           = lvalue[0].asInt();
-                                            }
-                                        }
-                                        else
-                                        {
-                                            bValid              = false;
-                                            goto exit;
-                                        }
-                                    }
-                                    else
-                                    {
-                                        x                       = lvalue.asInt();
-                                    }
+                        // Output layer-specific features
+                        if (ldl._kind == NNLayer::Kind::Output)
+                        {
 
-                                    // Copy values to kernel or kernel stride
-                                    if (lname.compare("kernel") == 0)
-                                    {
-                                        ldl._kernelX            = x;
-                                        ldl._kernelY            = y;
-                                        ldl._kernelZ            = z;
-                                        ldl._kernelDimensions   = dimensions;
-                                    }
+                        }
+
+                        // Hidden and output layer-specific features
+                        if ((ldl._kind == NNLayer::Kind::Hidden) || (ldl._kind == NNLayer::Kind::Output))
+                        {
+                            // Pooling layer-specific features
+                            if (ldl._type == NNLayer::Type::Pooling)
+                            {
+                                if (lname.compare("function") == 0)
+                                {
+                                    string s              = lvalue.asString();
+                                    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+                                    if (s.compare("max") == 0)
+                                        ldl._poolingFunction = PoolingFunction::Max;
+                                    else if (s.compare("maxout") == 0)
+                                        ldl._poolingFunction = PoolingFunction::Maxout;
+                                    else if (s.compare("dotproduct") == 0)
+                                        ldl._poolingFunction = PoolingFunction::DotProduct;
+                                    else if (s.compare("cosine") == 0)
+                                        ldl._poolingFunction = PoolingFunction::Cosine;
+                                    else if (s.compare("average") == 0)
+                                        ldl._poolingFunction = PoolingFunction::Average;
+                                    else if ((s.compare("lrn") == 0) || (s.compare("localresponsenormalization") == 0))
+                                        ldl._poolingFunction = PoolingFunction::LRN;
                                     else
                                     {
-                                        ldl._kernelStrideX      = x;
-                                        ldl._kernelStrideY      = y;
-                                        ldl._kernelStrideZ      = z;
+                                        printf("LoadNeuralNetworkJSON: Invalid pooling function (%s) for pooling layer %s\n", lvalue.asString().c_str(), ldl._name.c_str());
+                                        bValid                      = false;
+                                        goto exit;
                                     }
                                     continue;
                                 }
                             }
 
-
-
-
-                            // Hidden layer-specific features
-                            if (ldl._kind == NNLayer::Kind::Hidden)
+                            // Read skip(s) if present
+                            if (lname.compare("skip") == 0)
                             {
-                                // Layer-specific sparse penalty
-                                if (lname.compare("batchnormalization") == 0)
+                                uint32_t size           = lvalue.isArray() ? lvalue.size() : 1;
+                                for (uint32_t j = 0; j < size; j++)
                                 {
-                                    if (lvalue.asBool())
-                                        ldl._attributes|= NNLayer::Attributes::BatchNormalization;
-                                    continue;
+                                    Json::Value src = lvalue.isArray() ? lvalue[j] : lvalue;
+                                    ldl._vSkip.push_back(src.asString());
                                 }
+                                continue;
+                            }
 
-                                else if (lname.compare("sparsenesspenalty") == 0)
+                            // Read activation if present
+                            else if (lname.compare("activation") == 0)
+                            {
+                                string s            = lvalue.asString();
+                                std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+                                if (s.compare("sigmoid") == 0)
+                                    ldl._activation = Activation::Sigmoid;
+                                else if (s.compare("tanh") == 0)
+                                    ldl._activation = Activation::Tanh;
+                                else if (s.compare("linear") == 0)
+                                    ldl._activation = Activation::Linear;
+                                else if ((s.compare("relu") == 0) || (s.compare("rectifiedlinear") == 0))
+                                    ldl._activation = Activation::RectifiedLinear;
+                                else if ((s.compare("lrelu") == 0) || (s.compare("leakyrectifiedlinear") == 0))
+                                    ldl._activation = Activation::LeakyRectifiedLinear;
+                                else if ((s.compare("elu") == 0) || (s.compare("exponentiallinear") == 0))
+                                    ldl._activation = Activation::ExponentialLinear;
+                                else if ((s.compare("selu") == 0) || (s.compare("scaledexponentiallinear") == 0))
+                                    ldl._activation = Activation::ScaledExponentialLinear;
+                                else if (s.compare("softplus") == 0)
+                                    ldl._activation = Activation::SoftPlus;
+                                else if (s.compare("softsign") == 0)
+                                    ldl._activation = Activation::SoftSign;
+                                else if (s.compare("softmax") == 0)
+                                    ldl._activation = Activation::SoftMax;
+                                else if (s.compare("relumax") == 0)
+                                    ldl._activation = Activation::RELUMax;
+                                else if (s.compare("linearmax") == 0)
+                                    ldl._activation = Activation::LinearMax;
+                                else
                                 {
-                                    for (Json::ValueIterator pitr = lvalue.begin(); pitr != lvalue.end() ; pitr++)
-                                    {
-                                        string pname                = pitr.name();
-                                        std::transform(pname.begin(), pname.end(), pname.begin(), ::tolower);
-                                        Json::Value pkey            = pitr.key();
-                                        Json::Value pvalue          = *pitr;
-                                        if (pname.compare("p") == 0)
-                                            ldl._sparsenessPenalty_p = pvalue.asFloat();
-                                        else if (pname.compare("beta") == 0)
-                                            ldl._sparsenessPenalty_beta  = pvalue.asFloat();
-                                        else
-                                        {
-                                            printf("LoadNeuralNetworkJSON: Invalid sparseness penalty parameter for hidden layer %s\n", ldl._name.c_str());
-                                            bValid                  = false;
-                                            goto exit;
-                                        }
-                                    }
-                                    continue;
+                                    printf("LoadNeuralNetworkJSON: Invalid layer activation: %s\n", lvalue.asString().c_str());
+                                    bValid              = false;
+                                    goto exit;
                                 }
+                                continue;
                             }
 
-                            // Output layer-specific features
-                            if (ldl._kind == NNLayer::Kind::Output)
+                            // Read layer-specific ELU parameters
+                            else if ((lname.compare("reluslope") == 0) || (lname.compare("slope") == 0))
                             {
-
+                                ldl._RELUSlope                  = lvalue.asFloat();
+                                continue;
+                            }
+                            else if (lname.compare("elualpha") == 0)
+                            {
+                                ldl._ELUAlpha                   = lvalue.asFloat();
+                                continue;
+                            }
+                            else if (lname.compare("selulambda") == 0)
+                            {
+                                ldl._SELULambda                 = lvalue.asFloat();
+                                continue;
                             }
 
-                            // Hidden and output layer-specific features
-                            if ((ldl._kind == NNLayer::Kind::Hidden) || (ldl._kind == NNLayer::Kind::Output))
+                            // Weight normalization
+                            else if (lname.compare("weightnorm") == 0)
                             {
-                                // Pooling layer-specific features
-                                if (ldl._type == NNLayer::Type::Pooling)
-                                {
-                                    if (lname.compare("function") == 0)
-                                    {
-                                        string s          = lvalue.asString();
-                                        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-                                        if (s.compare("max") == 0)
-                                            ldl._poolingFunction = PoolingFunction::Max;
-                                        else if (s.compare("maxout") == 0)
-                                            ldl._poolingFunction = PoolingFunction::Maxout;
-                                        else if (s.compare("dotproduct") == 0)
-                                            ldl._poolingFunction = PoolingFunction::DotProduct;
-                                        else if (s.compare("cosine") == 0)
-                                            ldl._poolingFunction = PoolingFunction::Cosine;
-                                        else if (s.compare("average") == 0)
-                                            ldl._poolingFunction = PoolingFunction::Average;
-                                        else if ((s.compare("lrn") == 0) || (s.compare("localresponsenormalization") == 0))
-                                            ldl._poolingFunction = PoolingFunction::LRN;
-                                        else
-                                        {
-                                            printf("LoadNeuralNetworkJSON: Invalid pooling function (%s) for pooling layer %s\n", lvalue.asString().c_str(), ldl._name.c_str());
-                                            bValid                  = false;
-                                            goto exit;
-                                        }
-                                        continue;
-                                    }
-                                }
+                                ldl._weightNorm                 = lvalue.asFloat();
+                                continue;
+                            }
 
-                                // Read skip(s) if present
-                                if (lname.compare("skip") == 0)
-                                {
-                                    uint32_t size       = lvalue.isArray() ? lvalue.size() : 1;
-                                    for (uint32_t j = 0; j < size; j++)
-                                    {
-                                        Json::Value src = lvalue.isArray() ? lvalue[j] : lvalue;
-                                        ldl._vSkip.push_back(src.asString());
-                                    }
-                                    continue;
-                                }
+                            // Read delta normalization cap if active
+                            else if (lname.compare("deltanorm") == 0)
+                            {
+                                ldl._deltaNorm                  = lvalue.asFloat();
+                                continue;
+                            }
 
-                                // Read activation if present
-                                else if (lname.compare("activation") == 0)
+                            // Read weight initialization scheme
+                            else if (lname.compare("weightinit") == 0)
+                            {
+                                for (int i = 0; i < lvalue.size(); i++)
                                 {
-                                    string s        = lvalue.asString();
-                                    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-                                    if (s.compare("sigmoid") == 0)
-                                        ldl._activation = Activation::Sigmoid;
-                                    else if (s.compare("tanh") == 0)
-                                        ldl._activation = Activation::Tanh;
-                                    else if (s.compare("linear") == 0)
-                                        ldl._activation = Activation::Linear;
-                                    else if ((s.compare("relu") == 0) || (s.compare("rectifiedlinear") == 0))
-                                        ldl._activation = Activation::RectifiedLinear;
-                                    else if ((s.compare("lrelu") == 0) || (s.compare("leakyrectifiedlinear") == 0))
-                                        ldl._activation = Activation::LeakyRectifiedLinear;
-                                    else if ((s.compare("elu") == 0) || (s.compare("exponentiallinear") == 0))
-                                        ldl._activation = Activation::ExponentialLinear;
-                                    else if ((s.compare("selu") == 0) || (s.compare("scaledexponentiallinear") == 0))
-                                        ldl._activation = Activation::ScaledExponentialLinear;
-                                    else if (s.compare("softplus") == 0)
-                                        ldl._activation = Activation::SoftPlus;
-                                    else if (s.compare("softsign") == 0)
-                                        ldl._activation = Activation::SoftSign;
-                                    else if (s.compare("softmax") == 0)
-                                        ldl._activation = Activation::SoftMax;
-                                    else if (s.compare("relumax") == 0)
-                                        ldl._activation = Activation::RELUMax;
-                                    else if (s.compare("linearmax") == 0)
-                                        ldl._activation = Activation::LinearMax;
-                                    else
+                                    for (Json::ValueIterator witr = lvalue.begin(); witr != lvalue.end() ; witr++)
                                     {
-                                        printf("LoadNeuralNetworkJSON: Invalid layer activation: %s\n", lvalue.asString().c_str());
-                                        bValid          = false;
-                                        goto exit;
-                                    }
-                                    continue;
-                                }
-
-                                // Read layer-specific ELU parameters
-                                else if ((lname.compare("reluslope") == 0) || (lname.compare("slope") == 0))
-                                {
-                                    ldl._RELUSlope              = lvalue.asFloat();
-                                    continue;
-                                }
-                                else if (lname.compare("elualpha") == 0)
-                                {
-                                    ldl._ELUAlpha               = lvalue.asFloat();
-                                    continue;
-                                }
-                                else if (lname.compare("selulambda") == 0)
-                                {
-                                    ldl._SELULambda             = lvalue.asFloat();
-                                    continue;
-                                }
-
-                                // Weight normalization
-                                else if (lname.compare("weightnorm") == 0)
-                                {
-                                    ldl._weightNorm             = lvalue.asFloat();
-                                    continue;
-                                }
-
-                                // Read delta normalization cap if active
-                                else if (lname.compare("deltanorm") == 0)
-                                {
-                                    ldl._deltaNorm              = lvalue.asFloat();
-                                    continue;
-                                }
+                                        string wname                    = witr.name();
+                                        std::transform(wname.begin(), wname.end(), wname.begin(), ::tolower);
+                                        Json::Value wkey                = witr.key();
+                                        Json::Value wvalue              = *witr;
 
-                                // Read weight initialization scheme
-                                else if (lname.compare("weightinit") == 0)
-                                {
-                                    for (int i = 0; i < lvalue.size(); i++)
-                                    {
-                                        for (Json::ValueIterator witr = lvalue.begin(); witr != lvalue.end() ; witr++)
+                                        if (wname.compare("scheme") == 0)
                                         {
-                                            string wname                = witr.name();
-                                            std::transform(wname.begin(), wname.end(), wname.begin(), ::tolower);
-                                            Json::Value wkey            = witr.key();
-                                            Json::Value wvalue          = *witr;
-
-                                            if (wname.compare("scheme") == 0)
-                                            {
-                                                string scheme           = wvalue.asString();
-                                                std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
-                                                if (scheme.compare("xavier") == 0)
-                                                    ldl._weightInit     = Xavier;
-                                                else if (scheme.compare("caffexavier") == 0)
-                                                    ldl._weightInit     = CaffeXavier;
-                                                else if (scheme.compare("gaussian") == 0)
-                                                    ldl._weightInit     = Gaussian;
-                                                else if (scheme.compare("uniform") == 0)
-                                                    ldl._weightInit     = Uniform;
-                                                else if (scheme.compare("unitball") == 0)
-                                                    ldl._weightInit     = UnitBall;
-                                                else if (scheme.compare("constant") == 0)
-                                                    ldl._weightInit     = Constant;
-                                                else if (scheme.compare("selu") == 0)
-                                                    ldl._weightInit     = SELU;
-                                                else
-                                                {
-                                                    printf("LoadNeuralNetworkJSON: Invalid weight initialization scheme: %s\n", scheme.c_str());
-                                                    bValid          = false;
-                                                    goto exit;
-                                                }
-                                            }
-                                            else if (wname.compare("scale") == 0)
-                                            {
-                                               ldl._weightInitScale     = wvalue.asFloat();
-                                            }
-                                            else if (wname.compare("bias") == 0)
-                                            {
-                                               ldl._biasInit            = wvalue.asFloat();
-                                            }
+                                            string scheme               = wvalue.asString();
+                                            std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
+                                            if (scheme.compare("xavier") == 0)
+                                                ldl._weightInit         = Xavier;
+                                            else if (scheme.compare("caffexavier") == 0)
+                                                ldl._weightInit         = CaffeXavier;
+                                            else if (scheme.compare("gaussian") == 0)
+                                                ldl._weightInit         = Gaussian;
+                                            else if (scheme.compare("uniform") == 0)
+                                                ldl._weightInit         = Uniform;
+                                            else if (scheme.compare("unitball") == 0)
+                                                ldl._weightInit         = UnitBall;
+                                            else if (scheme.compare("constant") == 0)
+                                                ldl._weightInit         = Constant;
+                                            else if (scheme.compare("selu") == 0)
+                                                ldl._weightInit         = SELU;
                                             else
                                             {
-                                                printf("LoadNeuralNetworkJSON: Invalid weight initialization field: %s\n", wname.c_str());
-                                                bValid                  = false;
+                                                printf("LoadNeuralNetworkJSON: Invalid weight initialization scheme: %s\n", scheme.c_str());
+                                                bValid              = false;
                                                 goto exit;
                                             }
                                         }
+                                        else if (wname.compare("scale") == 0)
+                                        {
+                                           ldl._weightInitScale         = wvalue.asFloat();
+                                        }
+                                        else if (wname.compare("bias") == 0)
+                                        {
+                                           ldl._biasInit                = wvalue.asFloat();
+                                        }
+                                        else
+                                        {
+                                            printf("LoadNeuralNetworkJSON: Invalid weight initialization field: %s\n", wname.c_str());
+                                            bValid                      = false;
+                                            goto exit;
+                                        }
                                     }
-                                    continue;
                                 }
+                                continue;
+                            }
 
-                                // Read shared weight entry
-                                else if (lname.compare("sharedweights") == 0)
+                            // Read shared weight entry
+                            else if (lname.compare("sharedweights") == 0)
+                            {
+                                uint32_t size                           = lvalue.isArray() ? lvalue.size() : 1;
+                                for (uint32_t i = 0; i < size; i++)
                                 {
-                                    uint32_t size                       = lvalue.isArray() ? lvalue.size() : 1;
-                                    for (uint32_t i = 0; i < size; i++)
+                                    NNWeightDescriptor nd;
+                                    Json::Value share       = lvalue.isArray() ? lvalue[i] : lvalue;
+                                    for (Json::ValueIterator sitr = share.begin(); sitr != share.end() ; sitr++)
                                     {
-                                        NNWeightDescriptor nd;
-                                        Json::Value share   = lvalue.isArray() ? lvalue[i] : lvalue;
-                                        for (Json::ValueIterator sitr = share.begin(); sitr != share.end() ; sitr++)
-                                        {
-                                            string sname                = sitr.name();
-                                            std::transform(sname.begin(), sname.end(), sname.begin(), ::tolower);
-                                            Json::Value skey            = sitr.key();
-                                            Json::Value svalue          = *sitr;
+                                        string sname                    = sitr.name();
+                                        std::transform(sname.begin(), sname.end(), sname.begin(), ::tolower);
+                                        Json::Value skey                = sitr.key();
+                                        Json::Value svalue              = *sitr;
 
-                                            if (sname.compare("sourceinputlayer") == 0)
-                                            {
-                                                nd._sourceInputLayer    = svalue.asString();
-                                            }
-                                            else if (sname.compare("sourceoutputlayer") == 0)
-                                            {
-                                                nd._sourceOutputLayer   = svalue.asString();
-                                            }
-                                            else if (sname.compare("inputlayer") == 0)
-                                            {
-                                                nd._inputLayer          = svalue.asString();
-                                            }
-                                            else if (sname.compare("transposed") == 0)
-                                            {
-                                                nd._bTransposed         = svalue.asBool();
-                                            }
-                                            else
-                                            {
-                                                printf("LoadNeuralNetworkJSON: Invalid shared weight field: %s\n", sname.c_str());
-                                                bValid                  = false;
-                                                goto exit;
-                                            }
+                                        if (sname.compare("sourceinputlayer") == 0)
+                                        {
+                                            nd._sourceInputLayer        = svalue.asString();
+                                        }
+                                        else if (sname.compare("sourceoutputlayer") == 0)
+                                        {
+                                            nd._sourceOutputLayer       = svalue.asString();
+                                        }
+                                        else if (sname.compare("inputlayer") == 0)
+                                        {
+                                            nd._inputLayer              = svalue.asString();
+                                        }
+                                        else if (sname.compare("transposed") == 0)
+                                        {
+                                            nd._bTransposed             = svalue.asBool();
+                                        }
+                                        else
+                                        {
+                                            printf("LoadNeuralNetworkJSON: Invalid shared weight field: %s\n", sname.c_str());
+                                            bValid                      = false;
+                                            goto exit;
                                         }
-                                        nd._bShared                     = true;
-                                        vSharedWeight.push_back(nd);
                                     }
-                                    continue;
+                                    nd._bShared                         = true;
+                                    vSharedWeight.push_back(nd);
                                 }
+                                continue;
                             }
+                        }
 
 
-                            // Input and output layer-specific features
-                            if ((ldl._kind == NNLayer::Kind::Input) || (ldl._kind == NNLayer::Kind::Output))
+                        // Input and output layer-specific features
+                        if ((ldl._kind == NNLayer::Kind::Input) || (ldl._kind == NNLayer::Kind::Output))
+                        {
+                            if (lname.compare("dataset") == 0)
                             {
-                                if (lname.compare("dataset") == 0)
-                                {
-                                    ldl._dataSet                        = lvalue.asString();
-                                    continue;
-                                }
-
+                                ldl._dataSet                            = lvalue.asString();
+                                continue;
                             }
 
-                            // If we reach here, we didn't recognize the field
-                            printf("LoadNeuralNetworkJSON: Unknown neural network layer field: %s\n", lname.c_str());
-                            bValid                                      = false;
-                            goto exit;
                         }
 
-                        // Automagically determine dimensions of input or output units
-                        if (bAutoSize)
+                        // If we reach here, we didn't recognize the field
+                        printf("LoadNeuralNetworkJSON: Unknown neural network layer field: %s\n", lname.c_str());
+                        bValid                                          = false;
+                        goto exit;
+                    }
+
+                    // Automagically determine dimensions of input or output units
+                    if (bAutoSize)
+                    {
+                        bool bFound                                     = false;
+                        for (auto& d : vDataSetDescriptor)
                         {
-                            bool bFound                                 = false;
-                            for (auto p : vDataSet)
+                            if (d._name.compare(ldl._dataSet) == 0)
                             {
-                                if (p->_name.compare(ldl._dataSet) == 0)
-                                {
-                                    ldl._Nx                             = p->_width;
-                                    ldl._Ny                             = p->_height;
-                                    ldl._Nz                             = p->_length;
-                                    ldl._dimensions                     = p->_dimensions;
-                                    bFound                              = true;
-                                }
-                            }
-                            if (!bFound)
-                            {
-                                printf("LoadNeuralNetworkJSON: Unable to find data set %s to determine dimensions for layer: %s\n", ldl._dataSet.c_str(), ldl._name.c_str());
-                                bValid                                  = false;
-                                goto exit;
+                                ldl._Nx                                 = d._dim._width;
+                                ldl._Ny                                 = d._dim._height;
+                                ldl._Nz                                 = d._dim._length;
+                                ldl._dimensions                         = d._dim._dimensions;
+                                bFound                                  = true;
                             }
                         }
-
-                        // Add default source to hidden and output layers if none supplied
-                        if (!bSource && (ldl._kind != NNLayer::Kind::Input))
+                        if (!bFound)
                         {
-                            ldl._vSource.push_back(nd._vLayerDescriptor.back()._name);
+                            printf("LoadNeuralNetworkJSON: Unable to find data set %s to determine dimensions for layer: %s\n", ldl._dataSet.c_str(), ldl._name.c_str());
+                            bValid                                      = false;
+                            goto exit;
                         }
+                    }
 
-                        // Automagically compute dimensions of dot-product pooling layer (harmless BUG maybe?  Resolve)
-                        if ((ldl._type == NNLayer::Type::Pooling) &&
-                            (ldl._poolingFunction == PoolingFunction::DotProduct) || (ldl._poolingFunction == PoolingFunction::Cosine))
+                    // Add default source to hidden and output layers if none supplied
+                    if (!bSource && (ldl._kind != NNLayer::Kind::Input))
+                    {
+                        ldl._vSource.push_back(nd._vLayerDescriptor.back()._name);
+                    }
+
+                    // Automagically compute dimensions of dot-product pooling layer (harmless BUG maybe?  Resolve)
+                    if ((ldl._type == NNLayer::Type::Pooling) &&
+                        (ldl._poolingFunction == PoolingFunction::DotProduct) || (ldl._poolingFunction == PoolingFunction::Cosine))
+                    {
+                        // Make sure dot product has 2 or more sources
+                        if (ldl._vSource.size() < 2)
                         {
-                            // Make sure dot product has 2 or more sources
-                            if (ldl._vSource.size() < 2)
-                            {
-                                printf("LoadNeuralNetworkJSON: Dot product layer %s must have 2 or more sources\n", ldl._name.c_str());
-                                bValid                                  = false;
-                                goto exit;
-                            }
-                            ldl._Nx                                     = ldl._vSource.size() - 1;
-                            ldl._Ny                                     = 1;
-                            ldl._Nz                                     = 1;
-                            ldl._dimensions                             = 1;
+                            printf("LoadNeuralNetworkJSON: Dot product layer %s must have 2 or more sources\n", ldl._name.c_str());
+                            bValid                                      = false;
+                            goto exit;
                         }
+                        ldl._Nx                                         = ldl._vSource.size() - 1;
+                        ldl._Ny                                         = 1;
+                        ldl._Nz                                         = 1;
+                        ldl._dimensions                                 = 1;
+                    }
 
-                        // Add weight descriptors to non-pooling layers
-                        if (ldl._type != NNLayer::Type::Pooling)
+                    // Add weight descriptors to non-pooling layers
+                    if (ldl._type != NNLayer::Type::Pooling)
+                    {
+
+                        uint32_t sharedWeightsFound             = 0;
+                        for (uint32_t i = 0; i < ldl._vSource.size(); i++)
                         {
+                            NNWeightDescriptor wd;
+                            wd._inputLayer                      = ldl._vSource[i];
+                            wd._outputLayer                     = ldl._name;
+                            wd._norm                            = ldl._weightNorm;
 
-                            uint32_t sharedWeightsFound         = 0;
-                            for (uint32_t i = 0; i < ldl._vSource.size(); i++)
+                            // Search for shared weights
+                            for (uint32_t j = 0; j < vSharedWeight.size(); j++)
                             {
-                                NNWeightDescriptor wd;
-                                wd._inputLayer                  = ldl._vSource[i];
-                                wd._outputLayer                 = ldl._name;
-                                wd._norm                        = ldl._weightNorm;
-
-                                // Search for shared weights
-                                for (uint32_t j = 0; j < vSharedWeight.size(); j++)
+                                // Copy shared bits if match is located
+                                if (vSharedWeight[j]._inputLayer == wd._inputLayer)
                                 {
-                                    // Copy shared bits if match is located
-                                    if (vSharedWeight[j]._inputLayer == wd._inputLayer)
-                                    {
-                                        wd._bShared             = true;
-                                        wd._bTransposed         = vSharedWeight[j]._bTransposed;
-                                        wd._sourceInputLayer    = vSharedWeight[j]._sourceInputLayer;
-                                        wd._sourceOutputLayer   = vSharedWeight[j]._sourceOutputLayer;
-                                        sharedWeightsFound++;
-                                        break;
-                                    }
+                                    wd._bShared                 = true;
+                                    wd._bTransposed             = vSharedWeight[j]._bTransposed;
+                                    wd._sourceInputLayer        = vSharedWeight[j]._sourceInputLayer;
+                                    wd._sourceOutputLayer       = vSharedWeight[j]._sourceOutputLayer;
+                                    sharedWeightsFound++;
+                                    break;
                                 }
-                                nd._vWeightDescriptor.push_back(wd);
-                            }
-
-                            // Guarantee all shared weights were found
-                            if (sharedWeightsFound < vSharedWeight.size())
-                            {
-                                printf("LoadNeuralNetworkJSON: Unable to locate all shared weights\n");
-                                bValid                          = false;
-                                goto exit;
                             }
+                            nd._vWeightDescriptor.push_back(wd);
                         }
 
-                        // Determine if full layer dimensions have been provided or they need to
-                        // be calculated from all sources
-                        if (ldl._dimensions < ldl._kernelDimensions)
+                        // Guarantee all shared weights were found
+                        if (sharedWeightsFound < vSharedWeight.size())
                         {
-                            ldl._bDimensionsProvided = false;
+                            printf("LoadNeuralNetworkJSON: Unable to locate all shared weights\n");
+                            bValid                              = false;
+                            goto exit;
                         }
+                    }
 
-                        nd._vLayerDescriptor.push_back(ldl);
+                    // Determine if full layer dimensions have been provided or they need to
+                    // be calculated from all sources
+                    if (ldl._dimensions < ldl._kernelDimensions)
+                    {
+                        ldl._bDimensionsProvided = false;
                     }
-                }
 
-                else
-                {
-                    printf("LoadNeuralNetworkJSON: Unknown neural network field: %s\n", name.c_str());
-                    bValid                      = false;
-                    goto exit;
+                    nd._vLayerDescriptor.push_back(ldl);
                 }
             }
+
+            else
+            {
+                printf("LoadNeuralNetworkJSON: Unknown neural network field: %s\n", name.c_str());
+                bValid                          = false;
+                goto exit;
+            }
         }
+    }
 
-        // Calculate booleans
-        if (nd._sparsenessPenalty_beta > (NNFloat)0.0)
-            nd._bSparsenessPenalty                      = true;
+    // Calculate booleans
+    if (nd._sparsenessPenalty_beta > (NNFloat)0.0)
+        nd._bSparsenessPenalty                          = true;
 
-        // Turn on denoising if active
-        if (nd._denoising_p > (NNFloat)0.0)
+    // Turn on denoising if active
+    if (nd._denoising_p > (NNFloat)0.0)
+    {
+        nd._bDenoising                                  = true;
+        for (size_t i = 0; i <  nd._vLayerDescriptor.size(); i++)
         {
-            nd._bDenoising                              = true;
-            for (size_t i = 0; i <  nd._vLayerDescriptor.size(); i++)
+            if ((nd._vLayerDescriptor[i]._kind == NNLayer::Kind::Input) && ((nd._vLayerDescriptor[i]._attributes & NNLayer::Attributes::Sparse) != 0))
             {
-                if ((nd._vLayerDescriptor[i]._kind == NNLayer::Kind::Input) && ((nd._vLayerDescriptor[i]._attributes & NNLayer::Attributes::Sparse) != 0))
-                {
-                    nd._vLayerDescriptor[i]._attributes |= NNLayer::Attributes::Denoising;
-                }
+                nd._vLayerDescriptor[i]._attributes |= NNLayer::Attributes::Denoising;
             }
         }
     }
@@ -3734,8 +3804,36 @@ NNNetwork* LoadNeuralNetworkJSON(const string& fname, const uint32_t batch, cons
     // Calculate dimensions for unspecified convolution and pooling layers
     CalculateDerivedLayerDimensions(nd);
 
-    // Check for success, shut down upon failure
 exit:
+    return bValid;
+}
+
+NNNetwork* LoadNeuralNetworkJSON(const string& fname, const uint32_t batch, const vector<NNDataSetBase*>& vDataSet)
+{
+    NNNetwork* pNetwork                             = NULL;
+    NNNetworkDescriptor nd;
+    bool bValid                                     = true;
+
+    if (getGpu()._id == 0)
+    {
+        // Only the dimensions of the data sets are needed to size input and output layers
+        vector<NNDataSetDescriptor> vDataSetDescriptor;
+        for (auto p : vDataSet)
+        {
+            NNDataSetDescriptor d;
+            d._name                                 = p->_name;
+            d._dataType                             = p->_dataType;
+            d._attributes                           = p->_attributes;
+            d._dim                                  = NNDataSetDimensions(p->_width, p->_height, p->_length);
+            d._dim._dimensions                      = p->_dimensions;
+            d._examples                             = p->_examples;
+            d._sparseDensity                        = p->_sparseDensity;
+            vDataSetDescriptor.push_back(d);
+        }
+        bValid                                      = LoadNNNetworkDescriptorJSON(fname, vDataSetDescriptor, nd);
+    }
+
+    // Check for success, shut down upon failure
     MPI_Bcast(&bValid, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
     if (!bValid)
     {
@@ -3758,278 +3856,286 @@ exit:
     return pNetwork;
 }
 
-NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
+bool LoadNNNetworkDescriptorNetCDF(const string& fname, NNNetworkDescriptor& nd)
 {
-    NNNetwork* pNetwork                         = NULL;
-    NNNetworkDescriptor nd;
-
-    // Load network data into GPU 0
     bool bResult                                = true;
     NNFloat version                             = (NNFloat)0.0;
     uint32_t layers                             = 0;
     uint32_t weights                            = 0;
 
-    MPI_Bcast_string(nd._name);
-
-    // Turn off calculation of convolution layer dimensions in NNNetwork constructor
-    nd._bConvLayersCalculated                   = true;
-
-    if (getGpu()._id == 0)
+    bool bOpened                            = false;
+    try
     {
-        bool bOpened                            = false;
-        try
-        {
-            // Work around stupid unformative exception throwing here with a bool
-            NcFile nc(fname, NcFile::read);
-            bOpened                             = true;
+        // Work around stupid unformative exception throwing here with a bool
+        NcFile nc(fname, NcFile::read);
+        bOpened                             = true;
 
-            // Read network attributes
-            NcGroupAtt versionAtt               = nc.getAtt("version");
-            if (versionAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNNetwork::NNetwork: No version supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            versionAtt.getValues(&version);
+        // Read network attributes
+        NcGroupAtt versionAtt               = nc.getAtt("version");
+        if (versionAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNNetwork::NNetwork: No version supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        versionAtt.getValues(&version);
 
-            NcGroupAtt nameAtt                  = nc.getAtt("name");
-            if (nameAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No name supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            nameAtt.getValues(nd._name);
+        NcGroupAtt nameAtt                  = nc.getAtt("name");
+        if (nameAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No name supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        nameAtt.getValues(nd._name);
 
-            NcGroupAtt kindAtt                  = nc.getAtt("kind");
-            if (nameAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No kind supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            kindAtt.getValues(&(nd._kind));
+        NcGroupAtt kindAtt                  = nc.getAtt("kind");
+        if (nameAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No kind supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        kindAtt.getValues(&(nd._kind));
 
-            NcGroupAtt errorFunctionAtt         = nc.getAtt("errorFunction");
-            if (errorFunctionAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No error function supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            errorFunctionAtt.getValues(&(nd._errorFunction));
+        NcGroupAtt errorFunctionAtt         = nc.getAtt("errorFunction");
+        if (errorFunctionAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No error function supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        errorFunctionAtt.getValues(&(nd._errorFunction));
 
-            NcGroupAtt decayAtt              = nc.getAtt("decay");
-            if (decayAtt.isNull())
-            {
-                nd._decay = (NNFloat)0.0;
-            } else {
-                decayAtt.getValues(&(nd._decay));
-            }
+        NcGroupAtt decayAtt              = nc.getAtt("decay");
+        if (decayAtt.isNull())
+        {
+            nd._decay = (NNFloat)0.0;
+        } else {
+            decayAtt.getValues(&(nd._decay));
+        }
 
-            NcGroupAtt maxout_kAtt              = nc.getAtt("maxout_k");
-            if (maxout_kAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No maxout_k supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            maxout_kAtt.getValues(&(nd._maxout_k));
+        NcGroupAtt maxout_kAtt              = nc.getAtt("maxout_k");
+        if (maxout_kAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No maxout_k supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        maxout_kAtt.getValues(&(nd._maxout_k));
 
-            NcGroupAtt LRN_kAtt                 = nc.getAtt("LRN_k");
-            if (LRN_kAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_k supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            LRN_kAtt.getValues(&(nd._LRN_k));
+        NcGroupAtt LRN_kAtt                 = nc.getAtt("LRN_k");
+        if (LRN_kAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_k supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        LRN_kAtt.getValues(&(nd._LRN_k));
 
-            NcGroupAtt LRN_nAtt                 = nc.getAtt("LRN_n");
-            if (LRN_nAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_n supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            LRN_nAtt.getValues(&(nd._LRN_n));
+        NcGroupAtt LRN_nAtt                 = nc.getAtt("LRN_n");
+        if (LRN_nAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_n supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        LRN_nAtt.getValues(&(nd._LRN_n));
 
-            NcGroupAtt LRN_alphaAtt             = nc.getAtt("LRN_alpha");
-            if (LRN_alphaAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_alpha supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            LRN_alphaAtt.getValues(&(nd._LRN_alpha));
+        NcGroupAtt LRN_alphaAtt             = nc.getAtt("LRN_alpha");
+        if (LRN_alphaAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_alpha supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        LRN_alphaAtt.getValues(&(nd._LRN_alpha));
 
-            NcGroupAtt LRN_betaAtt              = nc.getAtt("LRN_beta");
-            if (LRN_betaAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_beta supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            LRN_betaAtt.getValues(&(nd._LRN_beta));
+        NcGroupAtt LRN_betaAtt              = nc.getAtt("LRN_beta");
+        if (LRN_betaAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No LRN_beta supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        LRN_betaAtt.getValues(&(nd._LRN_beta));
 
-            NcGroupAtt bSparsenessPenaltyAtt    = nc.getAtt("bSparsenessPenalty");
-            if (bSparsenessPenaltyAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No bSparsenessPenalty supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            uint32_t bSparsenessPenalty;
-            bSparsenessPenaltyAtt.getValues(&bSparsenessPenalty);
-            nd._bSparsenessPenalty              = (bSparsenessPenalty != 0);
+        NcGroupAtt bSparsenessPenaltyAtt    = nc.getAtt("bSparsenessPenalty");
+        if (bSparsenessPenaltyAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No bSparsenessPenalty supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        uint32_t bSparsenessPenalty;
+        bSparsenessPenaltyAtt.getValues(&bSparsenessPenalty);
+        nd._bSparsenessPenalty              = (bSparsenessPenalty != 0);
 
-            NcGroupAtt sparsenessPenalty_pAtt   = nc.getAtt("sparsenessPenalty_p");
-            if (sparsenessPenalty_pAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No sparsenessPenalty_p supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            sparsenessPenalty_pAtt.getValues(&(nd._sparsenessPenalty_p));
+        NcGroupAtt sparsenessPenalty_pAtt   = nc.getAtt("sparsenessPenalty_p");
+        if (sparsenessPenalty_pAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No sparsenessPenalty_p supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        sparsenessPenalty_pAtt.getValues(&(nd._sparsenessPenalty_p));
 
-            NcGroupAtt sparsenessPenalty_betaAtt= nc.getAtt("sparsenessPenalty_beta");
-            if (sparsenessPenalty_betaAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No sparsenessPenalty_beta supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            sparsenessPenalty_betaAtt.getValues(&(nd._sparsenessPenalty_beta));
+        NcGroupAtt sparsenessPenalty_betaAtt= nc.getAtt("sparsenessPenalty_beta");
+        if (sparsenessPenalty_betaAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No sparsenessPenalty_beta supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        sparsenessPenalty_betaAtt.getValues(&(nd._sparsenessPenalty_beta));
 
-            NcGroupAtt bDenoisingAtt            = nc.getAtt("bDenoising");
-            if (bDenoisingAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No bDenoising supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            uint32_t bDenoising;
-            bDenoisingAtt.getValues(&bDenoising);
-            nd._bDenoising                      = (bDenoising != 0);
+        NcGroupAtt bDenoisingAtt            = nc.getAtt("bDenoising");
+        if (bDenoisingAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No bDenoising supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        uint32_t bDenoising;
+        bDenoisingAtt.getValues(&bDenoising);
+        nd._bDenoising                      = (bDenoising != 0);
 
-            NcGroupAtt denoising_pAtt           = nc.getAtt("denoising_p");
-            if (denoising_pAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No denoising_p supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            denoising_pAtt.getValues(&(nd._denoising_p));
+        NcGroupAtt denoising_pAtt           = nc.getAtt("denoising_p");
+        if (denoising_pAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No denoising_p supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        denoising_pAtt.getValues(&(nd._denoising_p));
 
 
-            // Read DeltaBoost parameters
-            NcGroupAtt deltaBoost_oneAtt        = nc.getAtt("deltaBoost_one");
-            if (deltaBoost_oneAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No deltaBoost_one supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            deltaBoost_oneAtt.getValues(&(nd._deltaBoost_one));
+        // Read DeltaBoost parameters
+        NcGroupAtt deltaBoost_oneAtt        = nc.getAtt("deltaBoost_one");
+        if (deltaBoost_oneAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No deltaBoost_one supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        deltaBoost_oneAtt.getValues(&(nd._deltaBoost_one));
 
-            NcGroupAtt deltaBoost_zeroAtt       = nc.getAtt("deltaBoost_zero");
-            if (deltaBoost_zeroAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No deltaBoost_zero supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            deltaBoost_zeroAtt.getValues(&(nd._deltaBoost_zero));
+        NcGroupAtt deltaBoost_zeroAtt       = nc.getAtt("deltaBoost_zero");
+        if (deltaBoost_zeroAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No deltaBoost_zero supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        deltaBoost_zeroAtt.getValues(&(nd._deltaBoost_zero));
 
-            // Read Scaled Marginal CrossEntropy parameters
-            NcGroupAtt SMCE_oneScaleAtt         = nc.getAtt("SMCE_oneScale");
-            if (SMCE_oneScaleAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_oneScale supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            SMCE_oneScaleAtt.getValues(&(nd._SMCE_oneScale));
+        // Read Scaled Marginal CrossEntropy parameters
+        NcGroupAtt SMCE_oneScaleAtt         = nc.getAtt("SMCE_oneScale");
+        if (SMCE_oneScaleAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_oneScale supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        SMCE_oneScaleAtt.getValues(&(nd._SMCE_oneScale));
 
-            NcGroupAtt SMCE_zeroScaleAtt        = nc.getAtt("SMCE_zeroScale");
-            if (SMCE_zeroScaleAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_zeroScale supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            SMCE_zeroScaleAtt.getValues(&(nd._SMCE_zeroScale));
+        NcGroupAtt SMCE_zeroScaleAtt        = nc.getAtt("SMCE_zeroScale");
+        if (SMCE_zeroScaleAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_zeroScale supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        SMCE_zeroScaleAtt.getValues(&(nd._SMCE_zeroScale));
 
-            NcGroupAtt SMCE_oneTargetAtt        = nc.getAtt("SMCE_oneTarget");
-            if (SMCE_oneTargetAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_oneTarget supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            SMCE_oneTargetAtt.getValues(&(nd._SMCE_oneTarget));
+        NcGroupAtt SMCE_oneTargetAtt        = nc.getAtt("SMCE_oneTarget");
+        if (SMCE_oneTargetAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_oneTarget supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        SMCE_oneTargetAtt.getValues(&(nd._SMCE_oneTarget));
 
-            NcGroupAtt SMCE_zeroTargetAtt       = nc.getAtt("SMCE_zeroTarget");
-            if (SMCE_zeroTargetAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_zeroTarget supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            SMCE_zeroTargetAtt.getValues(&(nd._SMCE_zeroTarget));
+        NcGroupAtt SMCE_zeroTargetAtt       = nc.getAtt("SMCE_zeroTarget");
+        if (SMCE_zeroTargetAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No SMCE_zeroTarget supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        SMCE_zeroTargetAtt.getValues(&(nd._SMCE_zeroTarget));
 
-            NcGroupAtt checkpoint_nameAtt       = nc.getAtt("checkpoint_name");
-            if (checkpoint_nameAtt.isNull())
-            {
-                //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_name supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-                // Use default value from constructor
-            }
-            else
-                checkpoint_nameAtt.getValues(nd._checkpoint_name);
+        NcGroupAtt checkpoint_nameAtt       = nc.getAtt("checkpoint_name");
+        if (checkpoint_nameAtt.isNull())
+        {
+            //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_name supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+            // Use default value from constructor
+        }
+        else
+            checkpoint_nameAtt.getValues(nd._checkpoint_name);
 
-            NcGroupAtt checkpoint_intervalAtt   = nc.getAtt("checkpoint_interval");
-            if (checkpoint_intervalAtt.isNull())
-            {
-                //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_interval supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-                // Use default value from constructor
-            }
-            else
-                checkpoint_intervalAtt.getValues(&(nd._checkpoint_interval));
+        NcGroupAtt checkpoint_intervalAtt   = nc.getAtt("checkpoint_interval");
+        if (checkpoint_intervalAtt.isNull())
+        {
+            //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_interval supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+            // Use default value from constructor
+        }
+        else
+            checkpoint_intervalAtt.getValues(&(nd._checkpoint_interval));
 
-            NcGroupAtt checkpoint_epochsAtt     = nc.getAtt("checkpoint_epochs");
-            if (checkpoint_epochsAtt.isNull())
-            {
-                //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_epochs supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-                // Use default value from constructor
-            }
-            else
-                checkpoint_epochsAtt.getValues(&(nd._checkpoint_epochs));
+        NcGroupAtt checkpoint_epochsAtt     = nc.getAtt("checkpoint_epochs");
+        if (checkpoint_epochsAtt.isNull())
+        {
+            //throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No checkpoint_epochs supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+            // Use default value from constructor
+        }
+        else
+            checkpoint_epochsAtt.getValues(&(nd._checkpoint_epochs));
 
 
-            NcGroupAtt shuffleIndicesAtt        = nc.getAtt("ShuffleIndices");
-            if (shuffleIndicesAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No shuffleIndices supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            uint32_t bShuffleIndices;
-            shuffleIndicesAtt.getValues(&bShuffleIndices);
-            nd._bShuffleIndices                 = (bShuffleIndices != 0);
+        NcGroupAtt shuffleIndicesAtt        = nc.getAtt("ShuffleIndices");
+        if (shuffleIndicesAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No shuffleIndices supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        uint32_t bShuffleIndices;
+        shuffleIndicesAtt.getValues(&bShuffleIndices);
+        nd._bShuffleIndices                 = (bShuffleIndices != 0);
 
-            // Read network layer count
-            NcGroupAtt layersAtt                = nc.getAtt("layers");
-            if (layersAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No layers supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            layersAtt.getValues(&layers);
+        // Read network layer count
+        NcGroupAtt layersAtt                = nc.getAtt("layers");
+        if (layersAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No layers supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        layersAtt.getValues(&layers);
 
-            // Get layer descriptors
-            for (uint32_t i = 0; i < layers; i++)
+        // Get layer descriptors
+        for (uint32_t i = 0; i < layers; i++)
+        {
+            NNLayerDescriptor ld;
+            if (!LoadNNLayerDescriptorNetCDF(fname, nc, i, ld))
             {
-                NNLayerDescriptor ld;
-                if (!LoadNNLayerDescriptorNetCDF(fname, nc, i, ld))
-                {
-                    throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: Error reading layer data in NetCDF input file " + fname, __FILE__, __LINE__);
-                }
-                nd._vLayerDescriptor.push_back(ld);
+                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: Error reading layer data in NetCDF input file " + fname, __FILE__, __LINE__);
             }
+            nd._vLayerDescriptor.push_back(ld);
+        }
 
-            // Read network weight count
-            NcGroupAtt weightsAtt               = nc.getAtt("weights");
-            if (weightsAtt.isNull())
-            {
-                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No weights supplied in NetCDF input file " + fname, __FILE__, __LINE__);
-            }
-            weightsAtt.getValues(&weights);
+        // Read network weight count
+        NcGroupAtt weightsAtt               = nc.getAtt("weights");
+        if (weightsAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: No weights supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        weightsAtt.getValues(&weights);
 
-            // Get weight descriptors and data
-            for (uint32_t i = 0; i < weights; i++)
+        // Get weight descriptors and data
+        for (uint32_t i = 0; i < weights; i++)
+        {
+            NNWeightDescriptor wd;
+            if (!LoadNNWeightDescriptorNetCDF(fname, nc, i, wd))
             {
-                NNWeightDescriptor wd;
-                if (!LoadNNWeightDescriptorNetCDF(fname, nc, i, wd))
-                {
-                    throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: Error reading weight data in NetCDF input file " + fname, __FILE__, __LINE__);
-                }
-                nd._vWeightDescriptor.push_back(wd);
+                throw NC_EXCEPTION("NcException", "NNetwork::NNetwork: Error reading weight data in NetCDF input file " + fname, __FILE__, __LINE__);
             }
+            nd._vWeightDescriptor.push_back(wd);
+        }
 
 
-            //cout << nd << endl;
+        //cout << nd << endl;
 
+    }
+    catch (NcException& e)
+    {
+        if (!bOpened)
+        {
+            cout << "Exception: NNetWork::NNetwork: Error opening NetCDF input file " << fname << endl;
         }
-        catch (NcException& e)
+        else
         {
-            if (!bOpened)
-            {
-                cout << "Exception: NNetWork::NNetwork: Error opening NetCDF input file " << fname << endl;
-            }
-            else
-            {
-                cout << "Exception: " << e.what() << endl;
-            }
-            bResult                         = false;
+            cout << "Exception: " << e.what() << endl;
         }
+        bResult                         = false;
+    }
+    return bResult;
+}
+
+NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch, const bool bInference)
+{
+    NNNetwork* pNetwork                         = NULL;
+    NNNetworkDescriptor nd;
+
+    // Load network data into GPU 0
+    bool bResult                                = true;
+
+    MPI_Bcast_string(nd._name);
+
+    // Turn off calculation of convolution layer dimensions in NNNetwork constructor
+    nd._bConvLayersCalculated                   = true;
+
+    if (getGpu()._id == 0)
+    {
+        bResult                                 = LoadNNNetworkDescriptorNetCDF(fname, nd);
     }
 
     // Gather and test on result
@@ -4051,7 +4157,7 @@ NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch)
     }
 
     // Create network
-    pNetwork                                    = new NNNetwork(nd, batch);
+    pNetwork                                    = new NNNetwork(nd, batch, bInference);
     pNetwork->RefreshState();
     return pNetwork;
 }
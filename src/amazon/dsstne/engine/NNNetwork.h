@@ -15,6 +15,7 @@
 #include <memory>
 
 struct NNNetworkDescriptor;
+struct NNDataSetDescriptor;
 
 
 class NNNetwork {
@@ -32,7 +33,7 @@ public:
 
 private:
     friend NNNetwork* LoadNeuralNetworkJSON(const string& fname, const uint32_t batch, const vector<NNDataSetBase*>& vDataSet);
-    friend NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch);
+    friend NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch, const bool bInference);
     friend NNNetwork* ImportAutoEncoder(const string& fname, uint32_t batch);
     string                      _name;                      // ASCII name for network
     uint32_t                    _batch;                     // Overall batch size
@@ -46,6 +47,7 @@ private:
     ErrorFunction               _errorFunction;             // Error function for output layer(s)
     TrainingMode                _trainingMode;              // Specified training mode
     Mode                        _mode;                      // Operational mode (training or prediction)
+    const bool                  _bInference;                // Loaded for inference only: no deltas, dropout, gradients or velocities, and hidden layers share unit data (see PlanUnitBuffers)
     uint32_t                    _epochs;                    // Total number of training epochs
     uint32_t                    _indices;                   // Total number of indices in all input and output data
     uint32_t                    _batches;                   // Total number of batches trained
@@ -127,6 +129,9 @@ private:
     size_t                      _maxCUDNNWorkspaceSize;     // Maximum requested size of cuDNN workspace
     unique_ptr<GpuBuffer<uint8_t>> _pbCUDNNWorkspace;       // CUDNN workspace buffer
 
+    // Unit data shared by layers with disjoint lifetimes when only predicting
+    vector<unique_ptr<GpuBuffer<NNFloat>>> _vUnitArena;     // Arenas holding the unit data of all layers
+
     bool                         _verbose;                // determines how much to print during usage
 
 
@@ -199,6 +204,7 @@ public:
     tuple<bool> GetShuffleIndices() const;                                              // Returns ShuffleIndices boolean
     tuple<string, int32_t> GetCheckPoint() const;                                       // Returns Checkpoint name and interval
     bool GetDebugLevel() const {return _verbose;}
+    bool GetInference() const {return _bInference;}
 
     // Non-const getters
     NNFloat* GetUnitBuffer(const string& layer);
@@ -234,12 +240,13 @@ private:
     void PredictTrainingBatch(uint32_t layers = 0);
     void PredictValidationBatch(uint32_t layers = 0);
     void RefreshShuffleBuffers();
+    void PlanUnitBuffers();
     void ShuffleIndices();
     tuple<NNFloat, NNFloat> CalculateError(NNFloat lambda, NNFloat lambda1);
     void ClearUpdates();
     void BackPropagate();
     void UpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1);
-    NNNetwork(NNNetworkDescriptor& nd, uint32_t batch = DefaultBatch);
+    NNNetwork(NNNetworkDescriptor& nd, uint32_t batch = DefaultBatch, bool bInference = false);
     void RefreshState();
     void Shuffle();
     void SetCUDNNWorkspace(size_t size);
@@ -284,9 +291,42 @@ struct NNNetworkDescriptor
 };
 
 ostream& operator<< (ostream& out, NNNetworkDescriptor& d);
-NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch = DefaultBatch);
+NNNetwork* LoadNeuralNetworkNetCDF(const string& fname, const uint32_t batch = DefaultBatch, const bool bInference = false);
+bool LoadNNNetworkDescriptorNetCDF(const string& fname, NNNetworkDescriptor& nd);   // Reads the descriptor only, no GPU required
+bool LoadNNNetworkDescriptorJSON(const string& fname, const vector<NNDataSetDescriptor>& vDataSetDescriptor, NNNetworkDescriptor& nd);  // Sizes input and output layers from the data set dimensions, no GPU required
 NNNetwork* LoadNeuralNetworkJSON(const string &fname, const uint32_t batch = DefaultBatch, const vector<NNDataSetBase*>& vDataSet = vector<NNDataSetBase*>());
 bool SaveNeuralNetworkJSON(const NNNetwork& net, const string& fname);
+
+// Device memory in bytes of one layer, weight or data set of a network
+struct NNMemoryFootprint
+{
+    string                      _name;                      // Layer or data set name, or "input -> output" for weights
+    uint64_t                    _units;                     // Unit data, including batch normalization copies
+    uint64_t                    _deltas;                    // Delta data, including batch normalization copies
+    uint64_t                    _weights;                   // Weights and biases, or batch normalization parameters
+    uint64_t                    _gradients;                 // Weight and bias gradients
+    uint64_t                    _velocities;                // Optimizer velocities
+    uint64_t                    _sparseTransposed;          // Transposed sparse input for sparse weight gradients
+    uint64_t                    _data;                      // Data set examples
+    uint64_t                    _other;                     // Dropout masks, pooling and denoising buffers
+    NNMemoryFootprint(const string& name = "");
+    uint64_t GetTotal() const;
+};
+
+// Device memory of a network at one batch size, following the allocations of NNLayer, NNWeight and NNDataSet on a
+// single GPU.  Excludes the cuDNN workspace, the CUDA context and the shuffle and scratch buffers.
+struct NNMemoryEstimate
+{
+    uint32_t                    _batch;                     // Batch size of the estimate
+    vector<NNMemoryFootprint>   _vLayer;                    // Per layer footprints
+    vector<NNMemoryFootprint>   _vWeight;                   // Per weight footprints
+    vector<NNMemoryFootprint>   _vDataSet;                  // Per data set footprints
+    uint64_t                    _unitArenas;                // Unit data shared by PlanUnitBuffers when only predicting, 0 otherwise
+    uint64_t GetTotal() const;                              // Total bytes, with the unit arenas in place of the layer units if present
+};
+
+bool EstimateNetworkMemory(const NNNetworkDescriptor& nd, const vector<NNDataSetDescriptor>& vDataSetDescriptor, uint32_t batch, TrainingMode mode, bool bInference, NNMemoryEstimate& estimate);
+uint32_t FindLargestBatch(const NNNetworkDescriptor& nd, const vector<NNDataSetDescriptor>& vDataSetDescriptor, TrainingMode mode, bool bInference, uint64_t budget);  // 0 if not even a batch of 1 fits
 bool SaveNeuralNetworkNetCDF(const NNNetwork& net, const string& jname);
 NNNetwork* ImportAutoEncoder(const string& fname, uint32_t batch = DefaultBatch);
 #endif // __NVCC__
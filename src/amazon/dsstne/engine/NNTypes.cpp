@@ -1569,6 +1569,38 @@ template<typename T> bool NNDataSet<T>::GenerateSparseTransposedMatrix(uint32_t
     return true;
 }
 
+// Same layout as GenerateSparseTransposedMatrix for the host copies: fills the start of each feature's list and
+// returns the number of transposed matrix entries a batch can need, or 0 if the data set is not sparse
+template<typename T> uint64_t NNDataSet<T>::GenerateSparseTransposedStartOnHost(uint32_t batch, vector<uint32_t>& vSparseTransposedStart)
+{
+    if (!(_attributes & NNDataSetEnums::Sparse))
+    {
+        printf("NNDataSet::GenerateSparseTransposedStartOnHost: Data set %s is not sparse\n", _name.c_str());
+        return 0;
+    }
+
+    // Leaves _bDirty to GenerateSparseTransposedMatrix, which also has to rebuild the GPU copies
+    if (_bDirty || _vSparseDatapointCount.empty())
+        CalculateSparseDatapointCounts();
+
+    vSparseTransposedStart.resize(_vSparseDatapointCount.size());
+    uint64_t offset                         = 0;
+    for (size_t i = 0; i < _vSparseDatapointCount.size(); i++)
+    {
+        vSparseTransposedStart[i]           = offset;
+        size_t size1 = _vSparseDatapointCount[i];
+        size1 = std::min((size_t)batch, size1);
+        if (_vSparseMaxDatapointCount[i] > 1)
+        {
+            size_t size2 = std::min(_vSparseMaxDatapointCount[i] * batch, batch + (_vSparseMaxDatapointCount[i] - 1) * _vSparseMultiDatapointCount[i]);
+            size1 = std::max(size1, size2);
+        }
+        offset                             += size1;
+        offset                              = ((offset + 31) >> 5) << 5;
+    }
+    return offset;
+}
+
 template<typename T> bool NNDataSet<T>::SetDenoising(bool flag)
 {
     if (!(_attributes & NNDataSetEnums::Sparse))
@@ -2578,6 +2610,117 @@ vector<NNDataSetBase*> LoadNetCDF(const string& fname)
 
     return vDataSet;
 }
+// Reads the name, type, attributes, examples, dimensions and sparse density of every data set in a NetCDF file
+// without loading any data, so it needs neither a GPU nor the memory of the data sets themselves
+bool LoadNNDataSetDescriptorsNetCDF(const string& fname, vector<NNDataSetDescriptor>& vDescriptor)
+{
+    bool bResult                                = true;
+    bool bOpened                                = false;
+    try
+    {
+        NcFile nfc(fname.c_str(), NcFile::read);
+        bOpened                                 = true;
+
+        NcGroupAtt dataSetsAtt                  = nfc.getAtt("datasets");
+        if (dataSetsAtt.isNull())
+        {
+            throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No datasets count supplied in NetCDF input file " + fname, __FILE__, __LINE__);
+        }
+        uint32_t datasets;
+        dataSetsAtt.getValues(&datasets);
+
+        for (uint32_t i = 0; i < datasets; i++)
+        {
+            NNDataSetDescriptor d;
+            string nstring                      = to_string(i);
+            string vname                        = "name" + nstring;
+            NcGroupAtt nameAtt                  = nfc.getAtt(vname);
+            if (nameAtt.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " attribute located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            nameAtt.getValues(d._name);
+
+            vname                               = "dataType" + nstring;
+            NcGroupAtt dataTypeAtt              = nfc.getAtt(vname);
+            if (dataTypeAtt.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " attribute located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            int dataType;
+            dataTypeAtt.getValues(&dataType);
+            d._dataType                         = (NNDataSetEnums::DataType)dataType;
+
+            vname                               = "attributes" + nstring;
+            NcGroupAtt attributesAtt            = nfc.getAtt(vname);
+            if (attributesAtt.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " attribute located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            attributesAtt.getValues(&d._attributes);
+
+            vname                               = "examplesDim" + nstring;
+            NcDim examplesDim                   = nfc.getDim(vname);
+            if (examplesDim.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " dimension located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            d._examples                         = examplesDim.getSize();
+            vname                               = "uniqueExamplesDim" + nstring;
+            NcDim uniqueExamplesDim             = nfc.getDim(vname);
+            uint32_t uniqueExamples             = uniqueExamplesDim.isNull() ? d._examples : uniqueExamplesDim.getSize();
+
+            vname                               = "dimensions" + nstring;
+            NcGroupAtt dimensionsAtt            = nfc.getAtt(vname);
+            if (dimensionsAtt.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " attribute located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            dimensionsAtt.getValues(&d._dim._dimensions);
+
+            vname                               = "width" + nstring;
+            NcGroupAtt widthAtt                 = nfc.getAtt(vname);
+            if (widthAtt.isNull())
+            {
+                throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " attribute located in NetCDF input file " + fname, __FILE__, __LINE__);
+            }
+            widthAtt.getValues(&d._dim._width);
+            if (d._dim._dimensions > 1)
+                nfc.getAtt("height" + nstring).getValues(&d._dim._height);
+            if (d._dim._dimensions > 2)
+                nfc.getAtt("length" + nstring).getValues(&d._dim._length);
+
+            // Density of sparse data sets from their datapoint count, dense data sets are fully populated
+            d._sparseDensity                    = 1.0f;
+            if (d._attributes & NNDataSetEnums::Sparse)
+            {
+                vname                           = "sparseDataDim" + nstring;
+                NcDim sparseDataDim             = nfc.getDim(vname);
+                if (sparseDataDim.isNull())
+                {
+                    throw NC_EXCEPTION("NcException", "LoadNNDataSetDescriptorsNetCDF: No " + vname + " dimension located in NetCDF input file " + fname, __FILE__, __LINE__);
+                }
+                uint64_t N                      = (uint64_t)d._dim._width * d._dim._height * d._dim._length;
+                d._sparseDensity                = (double_t)sparseDataDim.getSize() / (double_t)(uniqueExamples * N);
+            }
+            vDescriptor.push_back(d);
+        }
+    }
+    catch (NcException& e)
+    {
+        if (!bOpened)
+        {
+            cout << "NcException: LoadNNDataSetDescriptorsNetCDF: Error opening NetCDF input file " << fname << endl;
+        }
+        else
+        {
+            cout << "Exception: " << e.what() << endl;
+        }
+        bResult                                 = false;
+    }
+    return bResult;
+}
+
 vector<NNDataSetBase*> LoadImageData(const string& fname) {}
 vector<NNDataSetBase*> LoadCSVData(const string& fname) {}
 vector<NNDataSetBase*> LoadJSONData(const string& fname) {}
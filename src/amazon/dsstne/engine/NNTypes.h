@@ -22,6 +22,7 @@
 #include <netcdf>
 #ifndef __NVCC__
 #include <tuple>
+#include <random>
 #include <json/json.h>
 #endif
 #include <cmath>
@@ -135,11 +136,13 @@ enum PoolingFunction {
 ostream& operator<< (ostream& out, const PoolingFunction& p);
 
 #include "kernels.h"
+#include "hostkernels.h"
 #include "GpuSort.h"
 #include "NNEnum.h"
 #include "NNWeight.h"
 #include "NNLayer.h"
 #include "NNNetwork.h"
+#include "NNCpuNetwork.h"
 
 
 int MPI_Bcast_string(string& s);
@@ -268,6 +271,14 @@ struct NNDataSetBase {
     virtual bool LoadSparseDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual bool CalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
     virtual bool CalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0) = 0;
+    virtual bool LoadInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual bool LoadSparseInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual bool CalculateSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual bool CalculateQuantizedSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta = (NNFloat)0.0, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual uint64_t GenerateSparseTransposedStartOnHost(uint32_t batch, vector<uint32_t>& vSparseTransposedStart) = 0;
+    virtual bool CalculateSparseTransposedMatrixOnHost(uint32_t position, uint32_t batch, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual float CalculateErrorOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex = NULL) = 0;
+    virtual bool CalculateOutputDeltaOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL) = 0;
     virtual float CalculateL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual float CalculateL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;
     virtual float CalculateL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit) = 0;    
@@ -396,6 +407,14 @@ private:
     bool LoadSparseDenoisedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     bool CalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta);
     bool CalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta);
+    bool LoadInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex);
+    bool LoadSparseInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex);
+    bool CalculateSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex);
+    bool CalculateQuantizedSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex);
+    uint64_t GenerateSparseTransposedStartOnHost(uint32_t batch, vector<uint32_t>& vSparseTransposedStart);
+    bool CalculateSparseTransposedMatrixOnHost(uint32_t position, uint32_t batch, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex);
+    float CalculateErrorOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex);
+    bool CalculateOutputDeltaOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex);
     float CalculateL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     float CalculateL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
     float CalculateL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit);
@@ -564,6 +583,206 @@ template<typename T> bool NNDataSet<T>::CalculateSparseDenoisedZ(uint32_t positi
     return true;
 }
 
+// Host versions of the above for NNCpuNetwork, reading the host copies of the data set
+template<typename T> bool NNDataSet<T>::LoadInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex)
+{
+    if (_attributes & NNDataSetEnums::Indexed)
+        hLoadIndexedInputUnit(position, batch, stride, pUnit, _vIndex.data(), _vData.data(), pShuffleIndex);
+    else
+        hLoadInputUnit(position, batch, stride, pUnit, _vData.data(), pShuffleIndex);
+    return true;
+}
+
+template<typename T> bool NNDataSet<T>::LoadSparseInputUnitOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex)
+{
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    if (_attributes & NNDataSetEnums::Boolean)
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hLoadIndexedSparseInputUnit(position, batch, stride, pUnit, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex);
+        else
+            hLoadSparseInputUnit(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex);
+    }
+    else
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hLoadIndexedSparseAnalogInputUnit(position, batch, stride, pUnit, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pShuffleIndex);
+        else
+            hLoadSparseAnalogInputUnit(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pShuffleIndex);
+    }
+    return true;
+}
+
+template<typename T> bool NNDataSet<T>::CalculateSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    if (_attributes & NNDataSetEnums::Boolean)
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedSparseZ(position, batch, stride, pWeight, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pUnit, beta, pShuffleIndex);
+        else
+            hCalculateSparseZ(position, batch, stride, pWeight, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pUnit, beta, pShuffleIndex);
+    }
+    else
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedSparseAnalogZ(position, batch, stride, pWeight, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pUnit, beta, pShuffleIndex);
+        else
+            hCalculateSparseAnalogZ(position, batch, stride, pWeight, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pUnit, beta, pShuffleIndex);
+    }
+    return true;
+}
+
+template<typename T> bool NNDataSet<T>::CalculateQuantizedSparseZOnHost(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    if (_attributes & NNDataSetEnums::Boolean)
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pUnit, beta, pShuffleIndex);
+        else
+            hCalculateQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pUnit, beta, pShuffleIndex);
+    }
+    else
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedQuantizedSparseAnalogZ(position, batch, stride, pQWeight, pWeightScale, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pUnit, beta, pShuffleIndex);
+        else
+            hCalculateQuantizedSparseAnalogZ(position, batch, stride, pQWeight, pWeightScale, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pUnit, beta, pShuffleIndex);
+    }
+    return true;
+}
+
+// Per thread counterpart of CalculateSparseTransposedMatrix: the caller owns the transposed matrix, laid out by
+// GenerateSparseTransposedStartOnHost, so that several batches can be transposed at once
+template<typename T> bool NNDataSet<T>::CalculateSparseTransposedMatrixOnHost(uint32_t position, uint32_t batch, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    if (!(_attributes & NNDataSetEnums::Sparse))
+    {
+        printf("NNDataSet::CalculateSparseTransposedMatrixOnHost: Data set %s is not sparse\n", _name.c_str());
+        return false;
+    }
+
+    memcpy(pSparseTransposedEnd, pSparseTransposedStart, _vSparseDatapointCount.size() * sizeof(uint32_t));
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    if (_attributes & NNDataSetEnums::Boolean)
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedSparseTransposedMatrix(position, batch, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+        else
+            hCalculateSparseTransposedMatrix(position, batch, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+    }
+    else
+    {
+        if (_attributes & NNDataSetEnums::Indexed)
+            hCalculateIndexedSparseTransposedAnalogMatrix(position, batch, _vIndex.data(), _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+        else
+            hCalculateSparseTransposedAnalogMatrix(position, batch, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, _vSparseData.data(), pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+    }
+    return true;
+}
+
+// Host errors and output deltas, which only cover Boolean sparse data sets, the case where skipping the zero
+// targets pays off on the CPU
+template<typename T> float NNDataSet<T>::CalculateErrorOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pShuffleIndex)
+{
+    if (!(_attributes & NNDataSetEnums::Sparse) || !(_attributes & NNDataSetEnums::Boolean))
+    {
+        printf("NNDataSet::CalculateErrorOnHost: Data set %s is not Boolean sparse\n", _name.c_str());
+        return (NNFloat)0.0;
+    }
+
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    uint32_t* pIndex = (_attributes & NNDataSetEnums::Indexed) ? _vIndex.data() : NULL;
+    bool bSparseIgnoreZero = _attributes & NNDataSetEnums::SparseIgnoreZero;
+    switch (ef)
+    {
+        case L1:
+            return pIndex ? hCalculateIndexedSparseL1Error(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                          : hCalculateSparseL1Error(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+
+        case L2:
+            return pIndex ? hCalculateIndexedSparseL2Error(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                          : hCalculateSparseL2Error(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+
+        case L2Hinge:
+            return pIndex ? hCalculateIndexedSparseL2HingeError(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                          : hCalculateSparseL2HingeError(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+
+        case CrossEntropy:
+            if (activation == SoftMax)
+                return pIndex ? hCalculateIndexedSparseMultinomialCrossEntropyError(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex)
+                              : hCalculateSparseMultinomialCrossEntropyError(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex);
+            return pIndex ? hCalculateIndexedSparseCrossEntropyError(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                          : hCalculateSparseCrossEntropyError(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+
+        case ScaledMarginalCrossEntropy:
+            if (activation == SoftMax)
+                return pIndex ? hCalculateIndexedSparseMultinomialScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex)
+                              : hCalculateSparseMultinomialScaledMarginalCrossEntropyError(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, pShuffleIndex);
+            return pIndex ? hCalculateIndexedSparseScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                          : hCalculateSparseScaledMarginalCrossEntropyError(position, batch, stride, pUnit, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+
+        default:
+            printf("NNDataSet::CalculateErrorOnHost: Unsupported error function %d\n", (int)ef);
+            return (NNFloat)0.0;
+    }
+}
+
+template<typename T> bool NNDataSet<T>::CalculateOutputDeltaOnHost(ErrorFunction ef, Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    if (!(_attributes & NNDataSetEnums::Sparse) || !(_attributes & NNDataSetEnums::Boolean))
+    {
+        printf("NNDataSet::CalculateOutputDeltaOnHost: Data set %s is not Boolean sparse\n", _name.c_str());
+        return false;
+    }
+
+    NNFloat* pDataWeight = (_attributes & NNDataSetEnums::Weighted) ? _vDataWeight.data() : NULL;
+    uint32_t* pIndex = (_attributes & NNDataSetEnums::Indexed) ? _vIndex.data() : NULL;
+    bool bSparseIgnoreZero = _attributes & NNDataSetEnums::SparseIgnoreZero;
+    switch (ef)
+    {
+        case L1:
+            if (pIndex)
+                hCalculateIndexedSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            else
+                hCalculateSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            return true;
+
+        case L2:
+            if (pIndex)
+                hCalculateIndexedSparseOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            else
+                hCalculateSparseOutputDelta(activation, position, batch, stride, pUnit, pDelta, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            return true;
+
+        case L2Hinge:
+            if (pIndex)
+                hCalculateIndexedSparseL2HingeOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            else
+                hCalculateSparseL2HingeOutputDelta(activation, position, batch, stride, pUnit, pDelta, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+            return true;
+
+        case CrossEntropy:
+            if (pIndex)
+                hCalculateIndexedSparseCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            else
+                hCalculateSparseCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            return true;
+
+        case ScaledMarginalCrossEntropy:
+            if (pIndex)
+                hCalculateIndexedSparseScaledMarginalCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            else
+                hCalculateSparseScaledMarginalCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, _vSparseStart.data(), _vSparseEnd.data(), _vSparseIndex.data(), pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            return true;
+
+        default:
+            printf("NNDataSet::CalculateOutputDeltaOnHost: Unsupported error function %d\n", (int)ef);
+            return false;
+    }
+}
+
 template<typename T> bool NNDataSet<T>::CalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, NNLayer* pLayer)
 {
     // Rebuild sparse data table if dataset changed
@@ -1252,9 +1471,23 @@ template<typename T> bool NNDataSet<T>::CalculateHingeOutputDelta(Activation act
 
 vector<NNDataSetBase*> LoadNetCDF(const string& fname);
 bool SaveNetCDF(const string& fname, vector<NNDataSetBase*> vDataset);
+bool LoadNNDataSetDescriptorsNetCDF(const string& fname, vector<NNDataSetDescriptor>& vDescriptor);
 vector<NNDataSetBase*> LoadImageData(const string& fname);
 vector<NNDataSetBase*> LoadCSVData(const string& fname);
 vector<NNDataSetBase*> LoadJSONData(const string& fname);
 vector<NNDataSetBase*> LoadAudioData(const string& name);
 
+// Lifetime of a buffer over the steps of a schedule, from the step that writes it through the last step that reads it
+struct NNBufferLifetime
+{
+    uint64_t                    _size;                      // Buffer size in elements
+    uint32_t                    _first;                     // First step during which the buffer is live
+    uint32_t                    _last;                      // Last step during which the buffer is live
+};
+
+// Assigns buffers to arenas such that no two buffers sharing an arena are live during the same step.  On return
+// vArena holds the arena of each buffer and vArenaSize the size of each arena in elements, which is the size of
+// its largest buffer.  Returns the total size of all arenas in elements.
+uint64_t PlanBufferArenas(const vector<NNBufferLifetime>& vLifetime, vector<uint32_t>& vArena, vector<uint64_t>& vArenaSize);
+
 #endif
@@ -465,17 +465,12 @@ _pbBiasGradientVelocity()
     {
         _vWeight.resize(_localSize);
         _pbWeight.reset(new GpuBuffer<NNFloat>(_localSize));
-        _pbWeightGradient.reset(new GpuBuffer<NNFloat>(_localSize));
     }
 
     _vBias.resize(_localBiasSize);
     _pbBias.reset(new GpuBuffer<NNFloat>(_localBiasSize));
 
-    // Add bias gradient to convolutions
-    if (_transform == Convolution)
-    {
-        _pbBiasGradient.reset(new GpuBuffer<NNFloat>(_localBiasSize));
-    }
+    // Gradients are allocated by RefreshState, which knows if the network is only used for inference
 }
 
 NNWeight::~NNWeight()
@@ -572,7 +567,23 @@ void NNWeight::Unlock()
 
 void NNWeight::RefreshState(NNNetwork* pNetwork, TrainingMode mode)
 {
-    if (mode != TrainingMode::SGD)
+    // Inference networks never allocate gradients or velocities
+    if (pNetwork->_bInference)
+    {
+        _pbWeightGradient.reset();
+        _pbBiasGradient.reset();
+    }
+    else
+    {
+        if (!_bShared && !_pbWeightGradient)
+            _pbWeightGradient.reset(new GpuBuffer<NNFloat>(_localSize));
+
+        // Add bias gradient to convolutions
+        if ((_transform == Convolution) && !_pbBiasGradient)
+            _pbBiasGradient.reset(new GpuBuffer<NNFloat>(_localBiasSize));
+    }
+
+    if ((mode != TrainingMode::SGD) && !pNetwork->_bInference)
     {
         if (!_pbWeightVelocity)
             _pbWeightVelocity.reset(new GpuBuffer<NNFloat>(_localSize));
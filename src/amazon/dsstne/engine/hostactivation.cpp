@@ -0,0 +1,303 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "hostvector.h"
+
+// Host activation functions and their derivatives (the host side of kActivation.cu and
+// kCalculateHadamardProduct in kDelta.cu), written over the vector operations of hostvector.h.
+
+template<typename S, template<typename> class A> static inline void hActivationForward(NNFloat* pData, uint64_t size, const HostActivationParameters& a)
+{
+    uint64_t pos                        = 0;
+    for (; pos + S::W <= size; pos += S::W)
+        S::store(pData + pos, A<S>::forward(S::load(pData + pos), a));
+    for (; pos < size; pos++)
+        pData[pos]                      = A<HostVectorScalar>::forward(pData[pos], a);
+}
+
+template<typename S, template<typename> class A> static inline void hActivationDerivative(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a)
+{
+    uint64_t pos                        = 0;
+    for (; pos + S::W <= size; pos += S::W)
+        S::store(pDelta + pos, A<S>::derivative(S::load(pUnit + pos), S::load(pDelta + pos), a));
+    for (; pos < size; pos++)
+        pDelta[pos]                     = A<HostVectorScalar>::derivative(pUnit[pos], pDelta[pos], a);
+}
+
+// Rows are shifted by their maximum like kCalculateSoftMaxActivation_kernel
+template<typename S> static inline void hSoftMaxRow(NNFloat* pRow, uint32_t stride)
+{
+    typedef typename S::V V;
+    uint32_t vectorStride               = stride - stride % S::W;
+    V vMax                              = S::set1(-MAX_VALUE);
+    for (uint32_t j = 0; j < vectorStride; j += S::W)
+        vMax                            = S::max(vMax, S::load(pRow + j));
+    NNFloat maxValue                    = S::hmax(vMax);
+    for (uint32_t j = vectorStride; j < stride; j++)
+        maxValue                        = max(maxValue, pRow[j]);
+
+    V vSum                              = S::set1(0.0f);
+    for (uint32_t j = 0; j < vectorStride; j += S::W)
+    {
+        V e                             = hExp<S>(S::sub(S::load(pRow + j), S::set1(maxValue)));
+        S::store(pRow + j, e);
+        vSum                            = S::add(vSum, e);
+    }
+    NNFloat sum                         = S::hsum(vSum);
+    for (uint32_t j = vectorStride; j < stride; j++)
+    {
+        pRow[j]                         = hExp<HostVectorScalar>(pRow[j] - maxValue);
+        sum                            += pRow[j];
+    }
+
+    NNFloat scale                       = (NNFloat)1.0 / sum;
+    for (uint32_t j = 0; j < vectorStride; j += S::W)
+        S::store(pRow + j, S::mul(S::load(pRow + j), S::set1(scale)));
+    for (uint32_t j = vectorStride; j < stride; j++)
+        pRow[j]                        *= scale;
+}
+
+typedef void (*ActivationForwardFunction)(NNFloat* pData, uint64_t size, const HostActivationParameters& a);
+typedef void (*ActivationDerivativeFunction)(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a);
+typedef void (*SoftMaxRowFunction)(NNFloat* pRow, uint32_t stride);
+
+// One flattened function per instruction set and activation
+template<template<typename> class A> __attribute__((flatten))
+static void hActivationForwardScalar(NNFloat* pData, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationForward<HostVectorScalar, A>(pData, size, a);
+}
+
+template<template<typename> class A> __attribute__((target("avx2,fma"), flatten))
+static void hActivationForwardAVX2(NNFloat* pData, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationForward<HostVectorAVX2, A>(pData, size, a);
+}
+
+template<template<typename> class A> __attribute__((target("avx512f"), flatten))
+static void hActivationForwardAVX512(NNFloat* pData, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationForward<HostVectorAVX512, A>(pData, size, a);
+}
+
+template<template<typename> class A> __attribute__((flatten))
+static void hActivationDerivativeScalar(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationDerivative<HostVectorScalar, A>(pUnit, pDelta, size, a);
+}
+
+template<template<typename> class A> __attribute__((target("avx2,fma"), flatten))
+static void hActivationDerivativeAVX2(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationDerivative<HostVectorAVX2, A>(pUnit, pDelta, size, a);
+}
+
+template<template<typename> class A> __attribute__((target("avx512f"), flatten))
+static void hActivationDerivativeAVX512(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a)
+{
+    hActivationDerivative<HostVectorAVX512, A>(pUnit, pDelta, size, a);
+}
+
+__attribute__((flatten)) static void hSoftMaxRowScalar(NNFloat* pRow, uint32_t stride)
+{
+    hSoftMaxRow<HostVectorScalar>(pRow, stride);
+}
+
+__attribute__((target("avx2,fma"), flatten)) static void hSoftMaxRowAVX2(NNFloat* pRow, uint32_t stride)
+{
+    hSoftMaxRow<HostVectorAVX2>(pRow, stride);
+}
+
+__attribute__((target("avx512f"), flatten)) static void hSoftMaxRowAVX512(NNFloat* pRow, uint32_t stride)
+{
+    hSoftMaxRow<HostVectorAVX512>(pRow, stride);
+}
+
+// Elements per parallel task, large enough to amortize the scheduling and small enough to balance the threads
+static const uint64_t ACTIVATION_CHUNK  = 16384;
+
+template<template<typename> class A> static void hCalculateActivation(NNFloat* pData, uint64_t size, const HostActivationParameters& a)
+{
+    HostSimd simd                       = hGetSimd();
+    ActivationForwardFunction forward   = (simd == HostSimdAVX512) ? hActivationForwardAVX512<A> :
+                                          (simd == HostSimdAVX2) ? hActivationForwardAVX2<A> : hActivationForwardScalar<A>;
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t pos = 0; pos < size; pos += ACTIVATION_CHUNK)
+        forward(pData + pos, min(ACTIVATION_CHUNK, size - pos), a);
+}
+
+template<template<typename> class A> static void hCalculateHadamardProduct(NNFloat* pUnit, NNFloat* pDelta, uint64_t size, const HostActivationParameters& a)
+{
+    HostSimd simd                           = hGetSimd();
+    ActivationDerivativeFunction derivative = (simd == HostSimdAVX512) ? hActivationDerivativeAVX512<A> :
+                                              (simd == HostSimdAVX2) ? hActivationDerivativeAVX2<A> : hActivationDerivativeScalar<A>;
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t pos = 0; pos < size; pos += ACTIVATION_CHUNK)
+        derivative(pUnit + pos, pDelta + pos, min(ACTIVATION_CHUNK, size - pos), a);
+}
+
+void hCalculateSigmoidActivation(NNFloat* pData, uint64_t size)
+{
+    hCalculateActivation<HostSigmoid>(pData, size, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateTanhActivation(NNFloat* pData, uint64_t size)
+{
+    hCalculateActivation<HostTanh>(pData, size, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateRELUActivation(NNFloat* pData, uint64_t size)
+{
+    hCalculateActivation<HostRELU>(pData, size, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateLRELUActivation(NNFloat* pData, uint64_t size, NNFloat slope)
+{
+    hCalculateActivation<HostLRELU>(pData, size, hActivationParameters(slope, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateELUActivation(NNFloat* pData, uint64_t size, NNFloat alpha)
+{
+    hCalculateActivation<HostELU>(pData, size, hActivationParameters(0.0f, alpha, 0.0f, 1.0f));
+}
+
+void hCalculateSELUActivation(NNFloat* pData, uint64_t size, NNFloat alpha, NNFloat lambda)
+{
+    hCalculateActivation<HostSELU>(pData, size, hActivationParameters(0.0f, alpha, lambda, 1.0f));
+}
+
+void hCalculateSoftPlusActivation(NNFloat* pData, uint64_t size)
+{
+    hCalculateActivation<HostSoftPlus>(pData, size, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateSoftSignActivation(NNFloat* pData, uint64_t size)
+{
+    hCalculateActivation<HostSoftSign>(pData, size, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void hCalculateSoftMaxActivation(NNFloat* pData, uint32_t batch, uint32_t stride)
+{
+    HostSimd simd                       = hGetSimd();
+    SoftMaxRowFunction softMaxRow       = (simd == HostSimdAVX512) ? hSoftMaxRowAVX512 :
+                                          (simd == HostSimdAVX2) ? hSoftMaxRowAVX2 : hSoftMaxRowScalar;
+
+#pragma omp parallel for schedule(static)
+    for (uint32_t i = 0; i < batch; i++)
+        softMaxRow(pData + (uint64_t)i * stride, stride);
+}
+
+void hCalculateActivation(Activation activation, NNFloat* pData, uint32_t batch, uint32_t stride, NNFloat slope, NNFloat alpha, NNFloat lambda)
+{
+    uint64_t size                       = (uint64_t)batch * stride;
+    switch (activation)
+    {
+        case Sigmoid:
+            hCalculateSigmoidActivation(pData, size);
+            break;
+
+        case Tanh:
+            hCalculateTanhActivation(pData, size);
+            break;
+
+        case RectifiedLinear:
+        case RELUMax:
+            hCalculateRELUActivation(pData, size);
+            break;
+
+        case LeakyRectifiedLinear:
+        case ParametricRectifiedLinear:
+            hCalculateLRELUActivation(pData, size, slope);
+            break;
+
+        case ExponentialLinear:
+            hCalculateELUActivation(pData, size, alpha);
+            break;
+
+        case ScaledExponentialLinear:
+            hCalculateSELUActivation(pData, size, alpha, lambda);
+            break;
+
+        case SoftPlus:
+            hCalculateSoftPlusActivation(pData, size);
+            break;
+
+        case SoftSign:
+            hCalculateSoftSignActivation(pData, size);
+            break;
+
+        case SoftMax:
+            hCalculateSoftMaxActivation(pData, batch, stride);
+            break;
+
+        case Linear:
+        case LinearMax:
+            break;
+    }
+}
+
+void hCalculateHadamardProduct(Activation activation, uint64_t size, NNFloat scale, NNFloat* pUnit, NNFloat* pDelta, NNFloat slope, NNFloat alpha, NNFloat lambda)
+{
+    HostActivationParameters a          = hActivationParameters(slope, alpha, lambda, scale);
+    switch (activation)
+    {
+        case Sigmoid:
+            hCalculateHadamardProduct<HostSigmoid>(pUnit, pDelta, size, a);
+            break;
+
+        case Tanh:
+            hCalculateHadamardProduct<HostTanh>(pUnit, pDelta, size, a);
+            break;
+
+        case RectifiedLinear:
+        case RELUMax:
+            hCalculateHadamardProduct<HostRELU>(pUnit, pDelta, size, a);
+            break;
+
+        case LeakyRectifiedLinear:
+        case ParametricRectifiedLinear:
+            hCalculateHadamardProduct<HostLRELU>(pUnit, pDelta, size, a);
+            break;
+
+        case ExponentialLinear:
+            hCalculateHadamardProduct<HostELU>(pUnit, pDelta, size, a);
+            break;
+
+        case ScaledExponentialLinear:
+            hCalculateHadamardProduct<HostSELU>(pUnit, pDelta, size, a);
+            break;
+
+        case SoftPlus:
+            hCalculateHadamardProduct<HostSoftPlus>(pUnit, pDelta, size, a);
+            break;
+
+        case SoftSign:
+            hCalculateHadamardProduct<HostSoftSign>(pUnit, pDelta, size, a);
+            break;
+
+        // Derivative of linear output is 1, and SoftMax is only differentiated through the output delta kernels
+        case Linear:
+        case LinearMax:
+        case SoftMax:
+            break;
+    }
+}
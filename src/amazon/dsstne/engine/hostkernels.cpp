@@ -0,0 +1,647 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "hostvector.h"
+
+// Dense input values, normalized like kLoadNormalizedInputUnit_kernel for 8-bit data
+template<typename T> static inline NNFloat hDenseValue(T v)     { return (NNFloat)v; }
+template<> inline NNFloat hDenseValue(unsigned char v)          { return (NNFloat)v * (NNFloat)(1.0 / 256.0) - (NNFloat)0.5; }
+template<> inline NNFloat hDenseValue(char v)                   { return (NNFloat)v * (NNFloat)(1.0 / 128.0); }
+
+void hClearUnit(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch)
+{
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        memcpy(pUnit + (uint64_t)i * stride, pBias, stride * sizeof(NNFloat));
+    }
+}
+
+void hAddBias(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch)
+{
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        NNFloat* pRow                   = pUnit + (uint64_t)i * stride;
+        for (uint32_t j = 0; j < stride; j++)
+            pRow[j]                    += pBias[j];
+    }
+}
+
+void hAddBuffers(NNFloat* pDest, NNFloat* pSrc, uint64_t size)
+{
+#pragma omp parallel for
+    for (uint64_t pos = 0; pos < size; pos++)
+        pDest[pos]                     += pSrc[pos];
+}
+
+void hCalculateDropout(NNFloat* pUnit, NNFloat* pRandom, uint32_t batch, uint32_t stride, NNFloat p, NNFloat target)
+{
+    uint64_t size                       = (uint64_t)batch * stride;
+    NNFloat scale                       = (target == (NNFloat)0.0) ? (NNFloat)1.0 / ((NNFloat)1.0 - p) : (NNFloat)1.0;
+#pragma omp parallel for
+    for (uint64_t pos = 0; pos < size; pos++)
+        pUnit[pos]                      = (pRandom[pos] < p) ? target : scale * pUnit[pos];
+}
+
+void hCalculateScaledBiasedDropout(NNFloat* pUnit, NNFloat* pRandom, uint32_t batch, uint32_t stride, NNFloat p, NNFloat target, NNFloat a, NNFloat b)
+{
+    uint64_t size                       = (uint64_t)batch * stride;
+    NNFloat dropped                     = a * target + b;
+#pragma omp parallel for
+    for (uint64_t pos = 0; pos < size; pos++)
+        pUnit[pos]                      = (pRandom[pos] < p) ? dropped : a * pUnit[pos] + b;
+}
+
+void hCalculateBatchNormalization(NNFloat* pUnit, NNFloat* pScale, NNFloat* pBias, NNFloat* pMean, NNFloat* pVariance, NNFloat epsilon, uint32_t stride, uint32_t batch)
+{
+    // Fold each unit's statistics into a single scale and shift
+    vector<NNFloat> vScale(stride);
+    vector<NNFloat> vShift(stride);
+    for (uint32_t j = 0; j < stride; j++)
+    {
+        vScale[j]                       = pScale[j] / sqrt(pVariance[j] + epsilon);
+        vShift[j]                       = pBias[j] - vScale[j] * pMean[j];
+    }
+
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        NNFloat* pRow                   = pUnit + (uint64_t)i * stride;
+        for (uint32_t j = 0; j < stride; j++)
+            pRow[j]                     = vScale[j] * pRow[j] + vShift[j];
+    }
+}
+
+void hCalculateTopK(NNFloat* pOutput, NNFloat* pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k)
+{
+#pragma omp parallel
+    {
+        vector<uint32_t> vIndex(width);
+
+#pragma omp for schedule(dynamic, 16)
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            NNFloat* pRow               = pOutput + (uint64_t)i * width;
+            for (uint32_t j = 0; j < width; j++)
+                vIndex[j]               = j;
+
+            // Highest values first, ties broken by lower index
+            auto greater                = [pRow](uint32_t a, uint32_t b) { return (pRow[a] > pRow[b]) || ((pRow[a] == pRow[b]) && (a < b)); };
+            uint32_t count              = min(k, width);
+            if (count < width)
+                std::nth_element(vIndex.begin(), vIndex.begin() + count, vIndex.end(), greater);
+            std::sort(vIndex.begin(), vIndex.begin() + count, greater);
+
+            NNFloat* pRowKey            = pKey + (uint64_t)i * k;
+            uint32_t* pRowValue         = pValue + (uint64_t)i * k;
+            for (uint32_t j = 0; j < k; j++)
+            {
+                pRowKey[j]              = (j < count) ? pRow[vIndex[j]] : -MAX_VALUE;
+                pRowValue[j]            = (j < count) ? vIndex[j] : 0;
+            }
+        }
+    }
+}
+
+template<typename T> static void hLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, T* pData, uint32_t* pShuffleIndex)
+{
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        T* pSrc                         = pData + (uint64_t)hExample(position, i, pIndex, pShuffleIndex) * stride;
+        NNFloat* pDst                   = pUnit + (uint64_t)i * stride;
+        for (uint32_t j = 0; j < stride; j++)
+            pDst[j]                     = hDenseValue(pSrc[j]);
+    }
+}
+
+template<typename T> void hLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData, uint32_t* pShuffleIndex)
+{
+    hLoadInputUnit(position, batch, stride, pUnit, (uint32_t*)NULL, pData, pShuffleIndex);
+}
+
+template<typename T> void hLoadIndexedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, T* pData, uint32_t* pShuffleIndex)
+{
+    hLoadInputUnit(position, batch, stride, pUnit, pIndex, pData, pShuffleIndex);
+}
+
+// Boolean data sets are handled as analog ones with a NULL pSparseData (every nonzero is 1)
+template<typename T> static void hLoadSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pShuffleIndex)
+{
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+        NNFloat w                       = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0;
+        NNFloat* pDst                   = pUnit + (uint64_t)i * stride;
+        memset(pDst, 0, stride * sizeof(NNFloat));
+        for (uint64_t j = pSparseStart[example]; j < pSparseEnd[example]; j++)
+            pDst[pSparseIndex[j]]       = (pSparseData != NULL) ? w * (NNFloat)pSparseData[j] : w;
+    }
+}
+
+void hLoadSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    hLoadSparseInputUnit(position, batch, stride, pUnit, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pShuffleIndex);
+}
+
+void hLoadIndexedSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    hLoadSparseInputUnit(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pShuffleIndex);
+}
+
+template<typename T> void hLoadSparseAnalogInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pShuffleIndex)
+{
+    hLoadSparseInputUnit(position, batch, stride, pUnit, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pShuffleIndex);
+}
+
+template<typename T> void hLoadIndexedSparseAnalogInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pShuffleIndex)
+{
+    hLoadSparseInputUnit(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pShuffleIndex);
+}
+
+// Row accumulation of the sparse Z kernels: y[0, n) = beta * y + sum over j < count of pScale[j] * pRow[j][0, n).
+// Outputs are processed in tiles held in registers across all rows, so each unit is read and written once per
+// example, and the rows prefetchDistance positions ahead are prefetched tile by tile when prefetchDistance > 0.
+typedef void (*AccumulateRowsFunction)(NNFloat* pY, const NNFloat* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, NNFloat beta, uint32_t prefetchDistance);
+
+static void hAccumulateRowsScalar(NNFloat* pY, const NNFloat* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, NNFloat beta, uint32_t prefetchDistance)
+{
+    static const uint32_t TILE      = 64;
+    NNFloat acc[TILE];
+    for (uint32_t o = 0; o < n; o += TILE)
+    {
+        uint32_t width              = min(TILE, n - o);
+        for (uint32_t k = 0; k < width; k++)
+            acc[k]                  = (beta == (NNFloat)0.0) ? (NNFloat)0.0 : beta * pY[o + k];
+        for (uint32_t j = 0; j < count; j++)
+        {
+            if (prefetchDistance && (j + prefetchDistance < count))
+                __builtin_prefetch(pRow[j + prefetchDistance] + o);
+            const NNFloat* pX       = pRow[j] + o;
+            NNFloat a               = pScale[j];
+            for (uint32_t k = 0; k < width; k++)
+                acc[k]             += a * pX[k];
+        }
+        memcpy(pY + o, acc, width * sizeof(NNFloat));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void hAccumulateRowsAVX2(NNFloat* pY, const NNFloat* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, NNFloat beta, uint32_t prefetchDistance)
+{
+    const __m256 vBeta              = _mm256_set1_ps(beta);
+    const bool bClear               = (beta == (NNFloat)0.0);
+    uint32_t o                      = 0;
+
+    // 32 outputs (4 registers, 2 cache lines) per tile
+    for (; o + 32 <= n; o += 32)
+    {
+        __m256 acc0                 = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY + o));
+        __m256 acc1                 = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY + o + 8));
+        __m256 acc2                 = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY + o + 16));
+        __m256 acc3                 = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY + o + 24));
+        for (uint32_t j = 0; j < count; j++)
+        {
+            if (prefetchDistance && (j + prefetchDistance < count))
+            {
+                _mm_prefetch((const char*)(pRow[j + prefetchDistance] + o), _MM_HINT_T0);
+                _mm_prefetch((const char*)(pRow[j + prefetchDistance] + o + 16), _MM_HINT_T0);
+            }
+            const NNFloat* pX       = pRow[j] + o;
+            __m256 a                = _mm256_set1_ps(pScale[j]);
+            acc0                    = _mm256_fmadd_ps(a, _mm256_loadu_ps(pX), acc0);
+            acc1                    = _mm256_fmadd_ps(a, _mm256_loadu_ps(pX + 8), acc1);
+            acc2                    = _mm256_fmadd_ps(a, _mm256_loadu_ps(pX + 16), acc2);
+            acc3                    = _mm256_fmadd_ps(a, _mm256_loadu_ps(pX + 24), acc3);
+        }
+        _mm256_storeu_ps(pY + o, acc0);
+        _mm256_storeu_ps(pY + o + 8, acc1);
+        _mm256_storeu_ps(pY + o + 16, acc2);
+        _mm256_storeu_ps(pY + o + 24, acc3);
+    }
+
+    for (; o + 8 <= n; o += 8)
+    {
+        __m256 acc                  = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY + o));
+        for (uint32_t j = 0; j < count; j++)
+            acc                     = _mm256_fmadd_ps(_mm256_set1_ps(pScale[j]), _mm256_loadu_ps(pRow[j] + o), acc);
+        _mm256_storeu_ps(pY + o, acc);
+    }
+
+    for (; o < n; o++)
+    {
+        NNFloat acc                 = bClear ? (NNFloat)0.0 : beta * pY[o];
+        for (uint32_t j = 0; j < count; j++)
+            acc                    += pScale[j] * pRow[j][o];
+        pY[o]                       = acc;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void hAccumulateRowsAVX512(NNFloat* pY, const NNFloat* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, NNFloat beta, uint32_t prefetchDistance)
+{
+    const __m512 vBeta              = _mm512_set1_ps(beta);
+    const bool bClear               = (beta == (NNFloat)0.0);
+    uint32_t o                      = 0;
+
+    // 64 outputs (4 registers, 4 cache lines) per tile
+    for (; o + 64 <= n; o += 64)
+    {
+        __m512 acc0                 = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_loadu_ps(pY + o));
+        __m512 acc1                 = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_loadu_ps(pY + o + 16));
+        __m512 acc2                 = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_loadu_ps(pY + o + 32));
+        __m512 acc3                 = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_loadu_ps(pY + o + 48));
+        for (uint32_t j = 0; j < count; j++)
+        {
+            if (prefetchDistance && (j + prefetchDistance < count))
+            {
+                const char* pNext   = (const char*)(pRow[j + prefetchDistance] + o);
+                _mm_prefetch(pNext, _MM_HINT_T0);
+                _mm_prefetch(pNext + 64, _MM_HINT_T0);
+                _mm_prefetch(pNext + 128, _MM_HINT_T0);
+                _mm_prefetch(pNext + 192, _MM_HINT_T0);
+            }
+            const NNFloat* pX       = pRow[j] + o;
+            __m512 a                = _mm512_set1_ps(pScale[j]);
+            acc0                    = _mm512_fmadd_ps(a, _mm512_loadu_ps(pX), acc0);
+            acc1                    = _mm512_fmadd_ps(a, _mm512_loadu_ps(pX + 16), acc1);
+            acc2                    = _mm512_fmadd_ps(a, _mm512_loadu_ps(pX + 32), acc2);
+            acc3                    = _mm512_fmadd_ps(a, _mm512_loadu_ps(pX + 48), acc3);
+        }
+        _mm512_storeu_ps(pY + o, acc0);
+        _mm512_storeu_ps(pY + o + 16, acc1);
+        _mm512_storeu_ps(pY + o + 32, acc2);
+        _mm512_storeu_ps(pY + o + 48, acc3);
+    }
+
+    // Remaining outputs 16 at a time, the last partial vector masked
+    for (; o < n; o += 16)
+    {
+        __mmask16 mask              = (n - o >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - o)) - 1);
+        __m512 acc                  = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_maskz_loadu_ps(mask, pY + o));
+        for (uint32_t j = 0; j < count; j++)
+            acc                     = _mm512_fmadd_ps(_mm512_set1_ps(pScale[j]), _mm512_maskz_loadu_ps(mask, pRow[j] + o), acc);
+        _mm512_mask_storeu_ps(pY + o, mask, acc);
+    }
+}
+
+static HostSimd hGetBestSimd()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return HostSimdAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return HostSimdAVX2;
+    return HostSimdScalar;
+}
+
+static AccumulateRowsFunction hGetAccumulateRows(HostSimd simd)
+{
+    switch (simd)
+    {
+        case HostSimdAVX512:
+            return hAccumulateRowsAVX512;
+
+        case HostSimdAVX2:
+            return hAccumulateRowsAVX2;
+
+        default:
+            return hAccumulateRowsScalar;
+    }
+}
+
+static HostSimd sSimd                           = hGetBestSimd();
+static AccumulateRowsFunction sAccumulateRows   = hGetAccumulateRows(sSimd);
+static uint32_t sWeightPrefetchDistance         = 0;
+
+HostSimd hGetSimd()
+{
+    return sSimd;
+}
+
+bool hSetSimd(HostSimd simd)
+{
+    if (simd > hGetBestSimd())
+        return false;
+    sSimd                                       = simd;
+    sAccumulateRows                             = hGetAccumulateRows(simd);
+    return true;
+}
+
+const char* hGetSimdName(HostSimd simd)
+{
+    switch (simd)
+    {
+        case HostSimdAVX512:
+            return "AVX-512";
+
+        case HostSimdAVX2:
+            return "AVX2";
+
+        default:
+            return "Scalar";
+    }
+}
+
+void hSetWeightPrefetch(uint32_t distance)
+{
+    sWeightPrefetchDistance                     = distance;
+}
+
+uint32_t hGetWeightPrefetch()
+{
+    return sWeightPrefetchDistance;
+}
+
+// unit[i] = beta * unit[i] + sum over the nonzeros j of example i of w * value(j) * W[index(j)].  Like
+// kCalculateSparseZ_kernel, a row with no nonzeros is left untouched and beta == 0 ignores its old contents.
+// If pRandom is not NULL, nonzeros with pRandom[j] < p are dropped and w is scaled by 1 / (1 - p) like in
+// kCalculateSparseDenoisedZ_kernel (which also scales beta * unit[i] by w, this version does not).
+template<typename T> static void hCalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat p, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    NNFloat q                               = (pRandom != NULL) ? (NNFloat)1.0 / ((NNFloat)1.0 - p) : (NNFloat)1.0;
+    AccumulateRowsFunction accumulateRows   = sAccumulateRows;
+    uint32_t prefetchDistance               = sWeightPrefetchDistance;
+
+#pragma omp parallel
+    {
+        vector<const NNFloat*> vRow;
+        vector<NNFloat> vScale;
+
+#pragma omp for schedule(dynamic, 16)
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+            uint64_t start                  = pSparseStart[example];
+            uint64_t end                    = pSparseEnd[example];
+            if (start == end)
+                continue;
+
+            // Gather the weight rows and their scales of the nonzeros
+            NNFloat w                       = q * ((pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0);
+            vRow.clear();
+            vScale.clear();
+            for (uint64_t j = start; j < end; j++)
+            {
+                if ((pRandom != NULL) && (pRandom[j] < p))
+                    continue;
+                vRow.push_back(pWeight + (uint64_t)pSparseIndex[j] * stride);
+                vScale.push_back((pSparseData != NULL) ? w * hSparseValue(pSparseData[j]) : w);
+            }
+            accumulateRows(pUnit + (uint64_t)i * stride, vRow.data(), vScale.data(), vRow.size(), stride, beta, prefetchDistance);
+        }
+    }
+}
+
+void hCalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, (NNFloat*)NULL, (NNFloat)0.0, pUnit, beta, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, (NNFloat*)NULL, (NNFloat)0.0, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, (NNFloat*)NULL, (NNFloat)0.0, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateIndexedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, (NNFloat*)NULL, (NNFloat)0.0, pUnit, beta, pShuffleIndex);
+}
+
+void hCalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pRandom, p, pUnit, beta, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pRandom, p, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pRandom, p, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateIndexedSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseZ(position, batch, stride, pWeight, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pRandom, p, pUnit, beta, pShuffleIndex);
+}
+
+// Parallel counting sort of the nonzeros of a batch by feature.  Each thread takes a contiguous range of
+// batch rows and counts its nonzeros per owner thread (feature modulo the thread count).  Prefix sums over
+// [owner][source thread] then give every thread a region of the staging buffer for each owner, which keeps
+// entries in batch order within an owner.  Finally each thread appends the entries it owns to their feature
+// lists, so no two threads ever touch the same pSparseTransposedEnd element and no atomics are needed.
+struct HostTransposedEntry
+{
+    uint32_t                            _feature;
+    uint32_t                            _row;
+    NNFloat                             _value;
+};
+
+template<typename T> static void hCalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat p, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    NNFloat q                                   = (pRandom != NULL) ? (NNFloat)1.0 / ((NNFloat)1.0 - p) : (NNFloat)1.0;
+    uint32_t threads                            = 0;
+    vector<uint64_t> vOffset;                   // [source][owner] counts, then staging offsets
+    vector<HostTransposedEntry> vEntry;
+
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            threads                             = omp_get_num_threads();
+            vOffset.assign((size_t)threads * threads, 0);
+        }
+
+        uint32_t t                              = omp_get_thread_num();
+        uint32_t first                          = (uint32_t)(((uint64_t)batch * t) / threads);
+        uint32_t last                           = (uint32_t)(((uint64_t)batch * (t + 1)) / threads);
+        uint64_t* pOffset                       = vOffset.data() + (size_t)t * threads;
+        for (uint32_t i = first; i < last; i++)
+        {
+            uint32_t example                    = hExample(position, i, pIndex, pShuffleIndex);
+            for (uint64_t j = pSparseStart[example]; j < pSparseEnd[example]; j++)
+            {
+                if ((pRandom == NULL) || (pRandom[j] >= p))
+                    pOffset[pSparseIndex[j] % threads]++;
+            }
+        }
+
+#pragma omp barrier
+#pragma omp single
+        {
+            uint64_t offset                     = 0;
+            for (uint32_t owner = 0; owner < threads; owner++)
+            {
+                for (uint32_t source = 0; source < threads; source++)
+                {
+                    uint64_t count              = vOffset[(size_t)source * threads + owner];
+                    vOffset[(size_t)source * threads + owner] = offset;
+                    offset                     += count;
+                }
+            }
+            vEntry.resize(offset);
+        }
+
+        for (uint32_t i = first; i < last; i++)
+        {
+            uint32_t example                    = hExample(position, i, pIndex, pShuffleIndex);
+            NNFloat w                           = q * ((pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0);
+            for (uint64_t j = pSparseStart[example]; j < pSparseEnd[example]; j++)
+            {
+                if ((pRandom != NULL) && (pRandom[j] < p))
+                    continue;
+                HostTransposedEntry& entry      = vEntry[pOffset[pSparseIndex[j] % threads]++];
+                entry._feature                  = pSparseIndex[j];
+                entry._row                      = i;
+                entry._value                    = (pSparseData != NULL) ? w * hSparseValue(pSparseData[j]) : w;
+            }
+        }
+
+#pragma omp barrier
+        // Offsets now point past each region: the owner's entries end at its last source's offset
+        uint64_t start                          = (t == 0) ? 0 : vOffset[(size_t)(threads - 1) * threads + t - 1];
+        uint64_t end                            = vOffset[(size_t)(threads - 1) * threads + t];
+        for (uint64_t j = start; j < end; j++)
+        {
+            const HostTransposedEntry& entry    = vEntry[j];
+            uint32_t opos                       = pSparseTransposedEnd[entry._feature]++;
+            pSparseTransposedIndex[opos]        = entry._row;
+            if (pSparseTransposedData != NULL)
+                pSparseTransposedData[opos]     = entry._value;
+        }
+    }
+}
+
+void hCalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, (NNFloat*)NULL, (NNFloat)0.0, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseTransposedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, (NNFloat*)NULL, (NNFloat)0.0, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+void hCalculateSparseTransposedDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pRandom, p, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseTransposedDenoisedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pRandom, p, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+template<typename T> void hCalculateSparseTransposedAnalogMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, (NNFloat*)NULL, (NNFloat)0.0, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+template<typename T> void hCalculateIndexedSparseTransposedAnalogMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, (NNFloat*)NULL, (NNFloat)0.0, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+template<typename T> void hCalculateSparseTransposedAnalogDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pRandom, p, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+template<typename T> void hCalculateIndexedSparseTransposedAnalogDenoisedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex)
+{
+    hCalculateSparseTransposedMatrix(position, batch, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pRandom, p, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pShuffleIndex);
+}
+
+// Each weight row is the row accumulation of the delta rows of its feature's entries, scaled by alpha (* value)
+static void hCalculateSparseTransposedWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient)
+{
+    AccumulateRowsFunction accumulateRows   = sAccumulateRows;
+    uint32_t prefetchDistance               = sWeightPrefetchDistance;
+
+#pragma omp parallel
+    {
+        vector<const NNFloat*> vRow;
+        vector<NNFloat> vScale;
+
+#pragma omp for schedule(dynamic, 64)
+        for (uint32_t r = 0; r < m; r++)
+        {
+            uint32_t start                  = pSparseTransposedStart[r];
+            uint32_t end                    = pSparseTransposedEnd[r];
+            if ((start == end) && (beta == (NNFloat)1.0))
+                continue;
+
+            vRow.clear();
+            vScale.clear();
+            for (uint32_t j = start; j < end; j++)
+            {
+                vRow.push_back(pDelta + (uint64_t)pSparseTransposedIndex[j] * n);
+                vScale.push_back((pSparseTransposedData != NULL) ? alpha * pSparseTransposedData[j] : alpha);
+            }
+            accumulateRows(pWeightGradient + (uint64_t)r * n, vRow.data(), vScale.data(), vRow.size(), n, beta, prefetchDistance);
+        }
+    }
+}
+
+void hCalculateSparseTransposedWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pDelta, NNFloat* pWeightGradient)
+{
+    hCalculateSparseTransposedWeightGradient(alpha, beta, m, n, pSparseTransposedStart, pSparseTransposedEnd, pSparseTransposedIndex, (NNFloat*)NULL, pDelta, pWeightGradient);
+}
+
+void hCalculateSparseTransposedAnalogWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient)
+{
+    hCalculateSparseTransposedWeightGradient(alpha, beta, m, n, pSparseTransposedStart, pSparseTransposedEnd, pSparseTransposedIndex, pSparseTransposedData, pDelta, pWeightGradient);
+}
+
+// Instantiates the templated kernels for the data set types of kernels.cu#EXPLICITLY_INSTANTIATE_KERNELS
+#define EXPLICITLY_INSTANTIATE_HOST_KERNELS(T)                                                                                                                                                                    \
+template void hLoadInputUnit<T>(uint32_t, uint32_t, uint32_t, NNFloat*, T*, uint32_t*);                                                                                                                           \
+template void hLoadIndexedInputUnit<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint32_t*, T*, uint32_t*);                                                                                                         \
+template void hLoadSparseAnalogInputUnit<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, uint32_t*);                                                                    \
+template void hLoadIndexedSparseAnalogInputUnit<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, uint32_t*);                                                  \
+template void hCalculateSparseAnalogZ<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat, uint32_t*);                                                    \
+template void hCalculateIndexedSparseAnalogZ<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat, uint32_t*);                                  \
+template void hCalculateSparseAnalogDenoisedZ<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat*, NNFloat, NNFloat, uint32_t*);                         \
+template void hCalculateIndexedSparseAnalogDenoisedZ<T>(uint32_t, uint32_t, uint32_t, NNFloat*, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat*, NNFloat, NNFloat, uint32_t*);       \
+template void hCalculateSparseTransposedAnalogMatrix<T>(uint32_t, uint32_t, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, uint32_t*, uint32_t*, NNFloat*, uint32_t*);                                            \
+template void hCalculateIndexedSparseTransposedAnalogMatrix<T>(uint32_t, uint32_t, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, uint32_t*, uint32_t*, NNFloat*, uint32_t*);                          \
+template void hCalculateSparseTransposedAnalogDenoisedMatrix<T>(uint32_t, uint32_t, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, uint32_t*, uint32_t*, NNFloat*, NNFloat, uint32_t*);                 \
+template void hCalculateIndexedSparseTransposedAnalogDenoisedMatrix<T>(uint32_t, uint32_t, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, uint32_t*, uint32_t*, NNFloat*, NNFloat, uint32_t*);
+/**/
+
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(NNFloat)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(double)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(unsigned char)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(char)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(uint32_t)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(uint64_t)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(int32_t)
+EXPLICITLY_INSTANTIATE_HOST_KERNELS(int64_t)
@@ -0,0 +1,197 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef HOSTKERNELS_H
+#define HOSTKERNELS_H
+
+// Host (CPU) counterparts of the kernels in kernels.h for execution without a GPU.  They follow the
+// argument conventions of their k* twins: unit buffers are batch x stride row-major, pDataWeight may be
+// NULL, and example i of a batch is pShuffleIndex[position + i] if pShuffleIndex is not NULL (the GPU
+// kernels read the shuffle index from cData) or position + i otherwise.  All of them are parallelized
+// across the batch with OpenMP.
+
+// Instruction sets of the vectorized kernels.  The best one the CPU supports is selected at startup,
+// hSetSimd can select a lower one (e.g. for testing or benchmarking) and fails for unsupported ones.
+enum HostSimd {
+    HostSimdScalar,
+    HostSimdAVX2,
+    HostSimdAVX512,
+};
+
+HostSimd hGetSimd();
+bool hSetSimd(HostSimd simd);
+const char* hGetSimdName(HostSimd simd);
+
+// Weight rows the sparse Z kernels prefetch ahead of the row being accumulated (0, the default, disables it)
+void hSetWeightPrefetch(uint32_t distance);
+uint32_t hGetWeightPrefetch();
+
+// Miscellaneous kernels
+void hClearUnit(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch);
+void hAddBias(NNFloat* pUnit, NNFloat* pBias, uint32_t stride, uint32_t batch);
+void hAddBuffers(NNFloat* pDest, NNFloat* pSrc, uint64_t size);
+void hCalculateBatchNormalization(NNFloat* pUnit, NNFloat* pScale, NNFloat* pBias, NNFloat* pMean, NNFloat* pVariance, NNFloat epsilon, uint32_t stride, uint32_t batch);
+void hCalculateTopK(NNFloat* pOutput, NNFloat* pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t k);
+
+// Dropout of training units, as kCalculateDropout and kCalculateScaledBiasedDropout.  pRandom holds batch x stride
+// uniform randoms drawn by the caller (the GPU versions draw them with curand).
+void hCalculateDropout(NNFloat* pUnit, NNFloat* pRandom, uint32_t batch, uint32_t stride, NNFloat p, NNFloat target);
+void hCalculateScaledBiasedDropout(NNFloat* pUnit, NNFloat* pRandom, uint32_t batch, uint32_t stride, NNFloat p, NNFloat target, NNFloat a, NNFloat b);
+
+// Input layer data loaders
+template<typename T> void hLoadInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, T* pData, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hLoadIndexedInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, T* pData, uint32_t* pShuffleIndex = NULL);
+void hLoadSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+void hLoadIndexedSparseInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hLoadSparseAnalogInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hLoadIndexedSparseAnalogInputUnit(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pShuffleIndex = NULL);
+
+// Sparse input layer matrix multiply: accumulates the weight rows of each example's nonzero inputs
+void hCalculateSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateIndexedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+
+// Denoised versions drop the nonzeros with pRandom < p and scale the others by 1 / (1 - p)
+void hCalculateSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateIndexedSparseAnalogDenoisedZ(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pWeight, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, NNFloat* pUnit, NNFloat beta, NNFloat p, uint32_t* pShuffleIndex = NULL);
+
+// Sparse input layer weight gradient.  The transposed matrix kernels append the nonzeros of the batch to
+// the per feature lists [pSparseTransposedStart[f], pSparseTransposedEnd[f]), where the caller initializes
+// pSparseTransposedEnd to pSparseTransposedStart as NNDataSet::CalculateSparseTransposedMatrix does.  Each
+// entry is the batch row (pSparseTransposedIndex) and, if pSparseTransposedData is not NULL, the input value
+// times its data weight (and 1 / (1 - p) for denoised ones).  Unlike their GPU twins, which append with
+// atomics, rows are listed in batch order so the gradients below are reproducible.
+void hCalculateSparseTransposedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseTransposedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex = NULL);
+void hCalculateSparseTransposedDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseTransposedDenoisedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateSparseTransposedAnalogMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateIndexedSparseTransposedAnalogMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateSparseTransposedAnalogDenoisedMatrix(uint32_t position, uint32_t batch, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateIndexedSparseTransposedAnalogDenoisedMatrix(uint32_t position, uint32_t batch, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pRandom, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat p, uint32_t* pShuffleIndex = NULL);
+
+// pWeightGradient[f] = beta * pWeightGradient[f] + alpha * sum over the entries of feature f of (value *) pDelta[row],
+// for the m features (weight rows) of n outputs.  Rows are split between threads, so no two threads update the
+// same weights.  kCalculateSparseTransposedWeightGradient also scales alpha by the denoising 1 / (1 - p); callers
+// fold it into alpha here.  Rows of features absent from the batch are skipped when beta is 1.
+void hCalculateSparseTransposedWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pDelta, NNFloat* pWeightGradient);
+void hCalculateSparseTransposedAnalogWeightGradient(NNFloat alpha, NNFloat beta, uint32_t m, uint32_t n, uint32_t* pSparseTransposedStart, uint32_t* pSparseTransposedEnd, uint32_t* pSparseTransposedIndex, NNFloat* pSparseTransposedData, NNFloat* pDelta, NNFloat* pWeightGradient);
+
+// Activation functions (hostactivation.cpp).  hCalculateActivation covers every Activation: ParametricRectifiedLinear
+// uses slope like LeakyRectifiedLinear, RELUMax and LinearMax apply RELU and no activation, and SoftPlus and SoftSign
+// have no GPU kernel.  exp, tanh and log are vectorized polynomial approximations with these bounds against double
+// precision, enforced by TestHostActivation for x in [-40, 40]:
+//   Sigmoid, Tanh, SoftSign        absolute error <= 2e-7
+//   ELU, SELU                      relative error <= 4e-7 (ELU/SELU values divided by alpha and lambda * alpha)
+//   SoftPlus                       relative error <= 4e-7
+//   SoftMax                        absolute error <= 2e-7 per output
+// RELU, LRELU and Linear are exact.
+void hCalculateActivation(Activation activation, NNFloat* pData, uint32_t batch, uint32_t stride, NNFloat slope, NNFloat alpha, NNFloat lambda);
+void hCalculateSigmoidActivation(NNFloat* pData, uint64_t size);
+void hCalculateTanhActivation(NNFloat* pData, uint64_t size);
+void hCalculateRELUActivation(NNFloat* pData, uint64_t size);
+void hCalculateLRELUActivation(NNFloat* pData, uint64_t size, NNFloat slope);
+void hCalculateELUActivation(NNFloat* pData, uint64_t size, NNFloat alpha);
+void hCalculateSELUActivation(NNFloat* pData, uint64_t size, NNFloat alpha, NNFloat lambda);
+void hCalculateSoftPlusActivation(NNFloat* pData, uint64_t size);
+void hCalculateSoftSignActivation(NNFloat* pData, uint64_t size);
+void hCalculateSoftMaxActivation(NNFloat* pData, uint32_t batch, uint32_t stride);
+
+// pDelta *= derivative of the activation at the units pUnit (its outputs), like kCalculateHadamardProduct: scale is
+// the dropout scale of Tanh units, and Linear, LinearMax and SoftMax leave pDelta unchanged.  Same error bounds.
+void hCalculateHadamardProduct(Activation activation, uint64_t size, NNFloat scale, NNFloat* pUnit, NNFloat* pDelta, NNFloat slope, NNFloat alpha, NNFloat lambda);
+
+// Sparse output deltas and errors for Boolean targets (hostloss.cpp).  Each output row is swept once with vector
+// code as if all its targets were zero and then only the nonzero targets are corrected, which is O(batch x stride)
+// streaming plus O(nonzeros) scattered work.  bSparseIgnoreZero clears the deltas of zero targets and leaves them
+// out of the error, as on the GPU.  hSetDeltaBoost and hSetSMCE hold the settings the GPU reads from cData
+// (GpuContext::SetNeuralNetwork sets both).  Where the CUDA kernels disagree across activations the host ones
+// follow the general formula: delta boost scales every activation's delta, the SELU derivative is taken from its
+// output like kCalculateHadamardProduct, and the SoftMax SMCE delta is oneScale * (a - t).  Errors are summed in
+// double precision rather than with the fixed point accumulator.
+void hSetDeltaBoost(NNFloat one, NNFloat zero);
+void hSetSMCE(NNFloat oneTarget, NNFloat zeroTarget, NNFloat oneScale, NNFloat zeroScale);
+void hCalculateSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateSparseL2HingeOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseL2HingeOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex = NULL);
+void hCalculateSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+void hCalculateSparseScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedSparseScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateSparseMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+NNFloat hCalculateIndexedSparseMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex = NULL);
+
+// Weight and bias updates (hostoptimizer.cpp) with the arguments and results of their kernels.cu counterparts.
+// Each is one vectorized pass that reads and writes every weight, gradient and velocity once with the L1 and L2
+// regularization applied on the fly, split across the OpenMP threads.  The bias updates first average the
+// delta of the batch over a block of columns and then apply the same update to it.  Square roots are exact
+// where the GPU uses rsqrt.
+void hSGDUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, uint64_t size, NNFloat* pWeightGradient, NNFloat* pWeight);
+void hSGDUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBias);
+void hMomentumUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight);
+void hMomentumUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias);
+void hAdaGradUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight);
+void hAdaGradUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias);
+void hNesterovShiftWeights(NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeight);
+void hNesterovShiftBiases(NNFloat mu, uint32_t width, NNFloat* pBiasVelocity, NNFloat* pBias);
+void hNesterovUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight);
+void hNesterovUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias);
+void hRMSPropUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight);
+void hRMSPropUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias);
+void hAdaDeltaUpdateWeights(NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeightGradientVelocity, NNFloat* pWeight);
+void hAdaDeltaUpdateBiases(NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBiasGradientVelocity, NNFloat* pBias);
+void hAdamUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1, NNFloat t, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeightGradientVelocity, NNFloat* pWeight);
+void hAdamUpdateBiases(NNFloat alpha, NNFloat mu, NNFloat mu1, NNFloat t, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBiasGradientVelocity, NNFloat* pBias);
+
+// Int8 quantized prediction (hostquantize.cpp).  Weights are quantized symmetrically per output unit, w ~ scale[j] * q
+// with q in [-127, 127] and scale[j] = max |W[.][j]| / 127, and the units feeding them with a single scale per layer
+// calibrated by the caller.  hQuantizeWeightsByOutput stores the k x n weights [n][hQuantizedStride(k)] for the int8
+// GEMM, zero padded, along with the sum of each output's q, and hQuantizeWeightsByInput stores them [k][n] for the
+// sparse Z kernels.  pWeight is [k][n], or [n][k] if bTransposed.
+uint32_t hQuantizedStride(uint32_t k);
+void hQuantizeWeightsByOutput(uint32_t k, uint32_t n, const NNFloat* pWeight, bool bTransposed, NNFloat* pScale, int8_t* pQWeight, int32_t* pWeightSum);
+void hQuantizeWeightsByInput(uint32_t k, uint32_t n, const NNFloat* pWeight, bool bTransposed, NNFloat* pScale, int8_t* pQWeight);
+void hQuantizeUnits(const NNFloat* pUnit, uint32_t batch, uint32_t k, NNFloat scale, int8_t* pQUnit);
+
+// pUnit[i][j] = beta * pUnit[i][j] + unitScale * pWeightScale[j] * sum over l of pQUnit[i][l] * pQWeight[j][l] for the
+// quantized units and weights above.  The dot products are exact in 32-bit integers for k < 133144 at every
+// instruction set: AVX2 widens to 16 bits and the AVX-512 level uses VNNI (vpdpbusd) on CPUs that have it and the
+// AVX2 code otherwise.
+void hCalculateQuantizedZ(uint32_t batch, uint32_t k, uint32_t n, const int8_t* pQUnit, NNFloat unitScale, const int8_t* pQWeight, const NNFloat* pWeightScale, const int32_t* pWeightSum, NNFloat* pUnit, NNFloat beta);
+const char* hGetQuantizedKernelName();
+
+// Sparse input layer matrix multiply of hCalculateSparseZ with weights quantized by input: the int8 rows of the
+// nonzeros are accumulated in single precision and scaled by pWeightScale, reading a quarter of the weight bytes.
+void hCalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+void hCalculateIndexedQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateQuantizedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+template<typename T> void hCalculateIndexedQuantizedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex = NULL);
+
+#endif // HOSTKERNELS_H
@@ -0,0 +1,547 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "hostvector.h"
+
+// Host sparse output deltas and errors (the host side of the sparse kernels of kDelta.cu and kLoss.cu).  Like
+// the CUDA kernels, each output row is first swept as if every target were zero, here with the vector
+// operations of hostvector.h, and then only the units with a nonzero target are corrected.  With
+// bSparseIgnoreZero the sweep becomes a clear for deltas and is skipped for errors.
+
+// Host copy of the network settings the CUDA kernels read from cData
+struct HostLossParameters
+{
+    NNFloat                             _deltaBoostOne;         // Scaling of nonzero-valued outputs
+    NNFloat                             _deltaBoostZero;        // Scaling of zero-valued outputs
+    NNFloat                             _SMCEOneTarget;         // Relaxed target for nonzero target values
+    NNFloat                             _SMCEZeroTarget;        // Relaxed target for zero target values
+    NNFloat                             _SMCEOneScale;          // Scaling factor for nonzero target values
+    NNFloat                             _SMCEZeroScale;         // Scaling factor for zero target values
+};
+
+static HostLossParameters sLossParameters = { 1.0f, 1.0f, 0.9f, 0.1f, 1.0f, 1.0f };
+
+void hSetDeltaBoost(NNFloat one, NNFloat zero)
+{
+    sLossParameters._deltaBoostOne      = one;
+    sLossParameters._deltaBoostZero     = zero;
+}
+
+void hSetSMCE(NNFloat oneTarget, NNFloat zeroTarget, NNFloat oneScale, NNFloat zeroScale)
+{
+    sLossParameters._SMCEOneTarget      = oneTarget;
+    sLossParameters._SMCEZeroTarget     = zeroTarget;
+    sLossParameters._SMCEOneScale       = oneScale;
+    sLossParameters._SMCEZeroScale      = zeroScale;
+}
+
+// -log(max(MIN_ERROR, x)) as the CUDA error kernels clamp it
+template<typename S> static inline typename S::V hNegativeLog(const typename S::V& x)
+{
+    return S::sub(S::set1(0.0f), hLog<S>(S::max(x, S::set1(MIN_ERROR))));
+}
+
+// Each loss provides the output delta before the activation derivative for a zero target (zeroDelta) and for a
+// target t (oneDelta), the error of both (zeroError, oneError), and the weights that scale the two deltas
+template<typename S> struct HostL2Loss
+{
+    typedef typename S::V V;
+    static inline V zeroDelta(const V& a, const HostLossParameters& p)                     { return a; }
+    static inline V oneDelta(const V& a, const V& t, const HostLossParameters& p)          { return S::sub(a, t); }
+    static inline V zeroError(const V& a, const HostLossParameters& p)                     { return S::mul(S::set1(0.5f), S::mul(a, a)); }
+    static inline V oneError(const V& a, const HostLossParameters& p)
+    {
+        V d                             = S::sub(a, S::set1(1.0f));
+        return S::mul(S::set1(0.5f), S::mul(d, d));
+    }
+    static inline NNFloat zeroWeight(const HostLossParameters& p)                          { return p._deltaBoostZero; }
+    static inline NNFloat oneWeight(const HostLossParameters& p)                           { return p._deltaBoostOne; }
+};
+
+// Zero targets only penalize positive outputs and nonzero targets only outputs below them
+template<typename S> struct HostL2HingeLoss
+{
+    typedef typename S::V V;
+    static inline V zeroDelta(const V& a, const HostLossParameters& p)                     { return S::max(a, S::set1(0.0f)); }
+    static inline V oneDelta(const V& a, const V& t, const HostLossParameters& p)          { return S::min(S::sub(a, t), S::set1(0.0f)); }
+    static inline V zeroError(const V& a, const HostLossParameters& p)
+    {
+        V d                             = S::max(a, S::set1(0.0f));
+        return S::mul(S::set1(0.5f), S::mul(d, d));
+    }
+    static inline V oneError(const V& a, const HostLossParameters& p)
+    {
+        V d                             = S::min(S::sub(a, S::set1(1.0f)), S::set1(0.0f));
+        return S::mul(S::set1(0.5f), S::mul(d, d));
+    }
+    static inline NNFloat zeroWeight(const HostLossParameters& p)                          { return p._deltaBoostZero; }
+    static inline NNFloat oneWeight(const HostLossParameters& p)                           { return p._deltaBoostOne; }
+};
+
+template<typename S> struct HostL1Loss
+{
+    typedef typename S::V V;
+    static inline V zeroDelta(const V& a, const HostLossParameters& p)                     { return hSign<S>(a); }
+    static inline V oneDelta(const V& a, const V& t, const HostLossParameters& p)          { return hSign<S>(S::sub(a, t)); }
+    static inline V zeroError(const V& a, const HostLossParameters& p)                     { return S::abs(a); }
+    static inline V oneError(const V& a, const HostLossParameters& p)                      { return S::abs(S::sub(a, S::set1(1.0f))); }
+    static inline NNFloat zeroWeight(const HostLossParameters& p)                          { return p._deltaBoostZero; }
+    static inline NNFloat oneWeight(const HostLossParameters& p)                           { return p._deltaBoostOne; }
+};
+
+// The delta is taken with respect to the input of a Sigmoid or SoftMax output, so it has no activation derivative
+template<typename S> struct HostCrossEntropyLoss
+{
+    typedef typename S::V V;
+    static inline V zeroDelta(const V& a, const HostLossParameters& p)                     { return a; }
+    static inline V oneDelta(const V& a, const V& t, const HostLossParameters& p)          { return S::sub(a, t); }
+    static inline V zeroError(const V& a, const HostLossParameters& p)                     { return hNegativeLog<S>(S::sub(S::set1(1.0f), a)); }
+    static inline V oneError(const V& a, const HostLossParameters& p)                      { return hNegativeLog<S>(a); }
+    static inline NNFloat zeroWeight(const HostLossParameters& p)                          { return p._deltaBoostZero; }
+    static inline NNFloat oneWeight(const HostLossParameters& p)                           { return p._deltaBoostOne; }
+};
+
+// Cross entropy that ignores outputs already past their relaxed targets, scaled by the SMCE parameters
+template<typename S> struct HostScaledMarginalCrossEntropyLoss
+{
+    typedef typename S::V V;
+    static inline V zeroDelta(const V& a, const HostLossParameters& p)
+    {
+        return S::select(S::gt(a, S::set1(p._SMCEZeroTarget)), S::mul(S::set1(p._SMCEZeroScale), a), S::set1(0.0f));
+    }
+    static inline V oneDelta(const V& a, const V& t, const HostLossParameters& p)
+    {
+        return S::select(S::lt(a, S::set1(p._SMCEOneTarget)), S::mul(S::set1(p._SMCEOneScale), S::sub(a, t)), S::set1(0.0f));
+    }
+    static inline V zeroError(const V& a, const HostLossParameters& p)
+    {
+        V e                             = S::mul(S::set1(p._SMCEZeroScale), hNegativeLog<S>(S::sub(S::set1(1.0f), a)));
+        return S::select(S::gt(a, S::set1(p._SMCEZeroTarget)), e, S::set1(0.0f));
+    }
+    static inline V oneError(const V& a, const HostLossParameters& p)
+    {
+        V e                             = S::mul(S::set1(p._SMCEOneScale), hNegativeLog<S>(a));
+        return S::select(S::lt(a, S::set1(p._SMCEOneTarget)), e, S::set1(0.0f));
+    }
+    static inline NNFloat zeroWeight(const HostLossParameters& p)                          { return 1.0f; }
+    static inline NNFloat oneWeight(const HostLossParameters& p)                           { return 1.0f; }
+};
+
+// Zero target pass over one row: delta = derivative(a, w * zeroDelta(a))
+template<typename S, template<typename> class L, template<typename> class A>
+static inline void hSparseZeroDeltaRow(const NNFloat* pUnit, NNFloat* pDelta, uint32_t stride, NNFloat w, const HostActivationParameters& a, const HostLossParameters& p)
+{
+    typename S::V vW                    = S::set1(w);
+    uint32_t pos                        = 0;
+    for (; pos + S::W <= stride; pos += S::W)
+    {
+        typename S::V u                 = S::load(pUnit + pos);
+        S::store(pDelta + pos, A<S>::derivative(u, S::mul(vW, L<S>::zeroDelta(u, p)), a));
+    }
+    for (; pos < stride; pos++)
+        pDelta[pos]                     = A<HostVectorScalar>::derivative(pUnit[pos], w * L<HostVectorScalar>::zeroDelta(pUnit[pos], p), a);
+}
+
+// Elements summed in single precision before the sum moves to double precision
+static const uint32_t ERROR_BLOCK       = 4096;
+
+// Zero target error of one row
+template<typename S, template<typename> class L>
+static inline double hSparseZeroErrorRow(const NNFloat* pUnit, uint32_t stride, const HostLossParameters& p)
+{
+    double error                        = 0.0;
+    uint32_t vectorStride               = stride - stride % S::W;
+    for (uint32_t block = 0; block < vectorStride; block += ERROR_BLOCK)
+    {
+        uint32_t end                    = min(block + ERROR_BLOCK, vectorStride);
+        typename S::V vSum              = S::set1(0.0f);
+        for (uint32_t pos = block; pos < end; pos += S::W)
+            vSum                        = S::add(vSum, L<S>::zeroError(S::load(pUnit + pos), p));
+        error                          += S::hsum(vSum);
+    }
+    for (uint32_t pos = vectorStride; pos < stride; pos++)
+        error                          += L<HostVectorScalar>::zeroError(pUnit[pos], p);
+    return error;
+}
+
+typedef void (*SparseZeroDeltaFunction)(const NNFloat* pUnit, NNFloat* pDelta, uint32_t stride, NNFloat w, const HostActivationParameters& a, const HostLossParameters& p);
+typedef double (*SparseZeroErrorFunction)(const NNFloat* pUnit, uint32_t stride, const HostLossParameters& p);
+
+// One flattened function per instruction set, loss and activation
+template<template<typename> class L, template<typename> class A> __attribute__((flatten))
+static void hSparseZeroDeltaScalar(const NNFloat* pUnit, NNFloat* pDelta, uint32_t stride, NNFloat w, const HostActivationParameters& a, const HostLossParameters& p)
+{
+    hSparseZeroDeltaRow<HostVectorScalar, L, A>(pUnit, pDelta, stride, w, a, p);
+}
+
+template<template<typename> class L, template<typename> class A> __attribute__((target("avx2,fma"), flatten))
+static void hSparseZeroDeltaAVX2(const NNFloat* pUnit, NNFloat* pDelta, uint32_t stride, NNFloat w, const HostActivationParameters& a, const HostLossParameters& p)
+{
+    hSparseZeroDeltaRow<HostVectorAVX2, L, A>(pUnit, pDelta, stride, w, a, p);
+}
+
+template<template<typename> class L, template<typename> class A> __attribute__((target("avx512f"), flatten))
+static void hSparseZeroDeltaAVX512(const NNFloat* pUnit, NNFloat* pDelta, uint32_t stride, NNFloat w, const HostActivationParameters& a, const HostLossParameters& p)
+{
+    hSparseZeroDeltaRow<HostVectorAVX512, L, A>(pUnit, pDelta, stride, w, a, p);
+}
+
+template<template<typename> class L> __attribute__((flatten))
+static double hSparseZeroErrorScalar(const NNFloat* pUnit, uint32_t stride, const HostLossParameters& p)
+{
+    return hSparseZeroErrorRow<HostVectorScalar, L>(pUnit, stride, p);
+}
+
+template<template<typename> class L> __attribute__((target("avx2,fma"), flatten))
+static double hSparseZeroErrorAVX2(const NNFloat* pUnit, uint32_t stride, const HostLossParameters& p)
+{
+    return hSparseZeroErrorRow<HostVectorAVX2, L>(pUnit, stride, p);
+}
+
+template<template<typename> class L> __attribute__((target("avx512f"), flatten))
+static double hSparseZeroErrorAVX512(const NNFloat* pUnit, uint32_t stride, const HostLossParameters& p)
+{
+    return hSparseZeroErrorRow<HostVectorAVX512, L>(pUnit, stride, p);
+}
+
+// Output delta of an elementwise activation: the zero target sweep (or a clear) then the nonzero targets
+template<template<typename> class L, template<typename> class A>
+static void hSparseOutputDelta(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, const HostActivationParameters& a, uint32_t* pShuffleIndex)
+{
+    typedef L<HostVectorScalar> Loss;
+    const HostLossParameters p          = sLossParameters;
+    HostSimd simd                       = hGetSimd();
+    SparseZeroDeltaFunction zeroDelta   = (simd == HostSimdAVX512) ? hSparseZeroDeltaAVX512<L, A> :
+                                          (simd == HostSimdAVX2) ? hSparseZeroDeltaAVX2<L, A> : hSparseZeroDeltaScalar<L, A>;
+
+#pragma omp parallel for schedule(static)
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+        NNFloat dataWeight              = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0;
+        const NNFloat* pUnitRow         = pUnit + (uint64_t)i * stride;
+        NNFloat* pDeltaRow              = pDelta + (uint64_t)i * stride;
+        if (bSparseIgnoreZero)
+            memset(pDeltaRow, 0, stride * sizeof(NNFloat));
+        else
+            zeroDelta(pUnitRow, pDeltaRow, stride, dataWeight * Loss::zeroWeight(p), a, p);
+
+        NNFloat w                       = dataWeight * Loss::oneWeight(p);
+        for (uint64_t pos = pSparseStart[example]; pos < pSparseEnd[example]; pos++)
+        {
+            uint32_t j                  = pSparseIndex[pos];
+            NNFloat u                   = pUnitRow[j];
+            pDeltaRow[j]                = A<HostVectorScalar>::derivative(u, w * Loss::oneDelta(u, (NNFloat)1.0, p), a);
+        }
+    }
+}
+
+// SoftMax output delta: the nonzero targets share a total target of 1 (or the data weight each) like
+// kCalculateSparseNonZeroSoftMaxOutputDelta_kernel
+template<template<typename> class L>
+static void hSparseSoftMaxOutputDelta(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    typedef L<HostVectorScalar> Loss;
+    const HostLossParameters p          = sLossParameters;
+    const HostActivationParameters a    = hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f);
+    HostSimd simd                       = hGetSimd();
+    SparseZeroDeltaFunction zeroDelta   = (simd == HostSimdAVX512) ? hSparseZeroDeltaAVX512<L, HostLinear> :
+                                          (simd == HostSimdAVX2) ? hSparseZeroDeltaAVX2<L, HostLinear> : hSparseZeroDeltaScalar<L, HostLinear>;
+
+#pragma omp parallel for schedule(static)
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+        const NNFloat* pUnitRow         = pUnit + (uint64_t)i * stride;
+        NNFloat* pDeltaRow              = pDelta + (uint64_t)i * stride;
+        if (bSparseIgnoreZero)
+            memset(pDeltaRow, 0, stride * sizeof(NNFloat));
+        else
+            zeroDelta(pUnitRow, pDeltaRow, stride, ((pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0) * Loss::zeroWeight(p), a, p);
+
+        uint64_t start                  = pSparseStart[example];
+        uint64_t end                    = pSparseEnd[example];
+        NNFloat t                       = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0 / (NNFloat)(end - start);
+        for (uint64_t pos = start; pos < end; pos++)
+        {
+            uint32_t j                  = pSparseIndex[pos];
+            pDeltaRow[j]                = Loss::oneDelta(pUnitRow[j], t, p);
+        }
+    }
+}
+
+// Error of the batch: the zero target error of every unit, corrected at the nonzero targets, or with
+// bSparseIgnoreZero the nonzero target error alone
+template<template<typename> class L>
+static NNFloat hSparseError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    typedef L<HostVectorScalar> Loss;
+    const HostLossParameters p          = sLossParameters;
+    HostSimd simd                       = hGetSimd();
+    SparseZeroErrorFunction zeroError   = (simd == HostSimdAVX512) ? hSparseZeroErrorAVX512<L> :
+                                          (simd == HostSimdAVX2) ? hSparseZeroErrorAVX2<L> : hSparseZeroErrorScalar<L>;
+
+    double error                        = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:error)
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+        NNFloat w                       = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0;
+        const NNFloat* pUnitRow         = pUnit + (uint64_t)i * stride;
+        double rowError                 = 0.0;
+        if (!bSparseIgnoreZero)
+            rowError                    = zeroError(pUnitRow, stride, p);
+        for (uint64_t pos = pSparseStart[example]; pos < pSparseEnd[example]; pos++)
+        {
+            NNFloat u                   = pUnitRow[pSparseIndex[pos]];
+            rowError                   += Loss::oneError(u, p);
+            if (!bSparseIgnoreZero)
+                rowError               -= Loss::zeroError(u, p);
+        }
+        error                          += w * rowError;
+    }
+    return (NNFloat)error;
+}
+
+// Error of SoftMax outputs, whose zero targets carry no error, with the nonzero targets weighted like
+// kCalculateSparseMultinomialCrossEntropyError_kernel
+template<template<typename> class L>
+static NNFloat hSparseMultinomialError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    typedef L<HostVectorScalar> Loss;
+    const HostLossParameters p          = sLossParameters;
+    double error                        = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:error)
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t example                = hExample(position, i, pIndex, pShuffleIndex);
+        uint64_t start                  = pSparseStart[example];
+        uint64_t end                    = pSparseEnd[example];
+        NNFloat w                       = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0 / (NNFloat)(end - start);
+        const NNFloat* pUnitRow         = pUnit + (uint64_t)i * stride;
+        double rowError                 = 0.0;
+        for (uint64_t pos = start; pos < end; pos++)
+            rowError                   += Loss::oneError(pUnitRow[pSparseIndex[pos]], p);
+        error                          += w * rowError;
+    }
+    return (NNFloat)error;
+}
+
+// Activation dispatch shared by the L2, L2 hinge and L1 deltas, which support every elementwise activation
+template<template<typename> class L>
+static void hSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    HostActivationParameters a          = hActivationParameters(slope, alpha, lambda, 1.0f);
+    switch (activation)
+    {
+        case Sigmoid:
+            hSparseOutputDelta<L, HostSigmoid>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case Tanh:
+            hSparseOutputDelta<L, HostTanh>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case Linear:
+        case LinearMax:
+            hSparseOutputDelta<L, HostLinear>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case RectifiedLinear:
+        case RELUMax:
+            hSparseOutputDelta<L, HostRELU>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case LeakyRectifiedLinear:
+        case ParametricRectifiedLinear:
+            hSparseOutputDelta<L, HostLRELU>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case ExponentialLinear:
+            hSparseOutputDelta<L, HostELU>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case ScaledExponentialLinear:
+            hSparseOutputDelta<L, HostSELU>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case SoftPlus:
+            hSparseOutputDelta<L, HostSoftPlus>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case SoftSign:
+            hSparseOutputDelta<L, HostSoftSign>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, a, pShuffleIndex);
+            break;
+
+        case SoftMax:
+            hSparseSoftMaxOutputDelta<L>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            break;
+    }
+}
+
+// Cross entropy deltas only exist for Sigmoid and SoftMax outputs
+template<template<typename> class L>
+static void hSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    switch (activation)
+    {
+        case Sigmoid:
+            hSparseOutputDelta<L, HostLinear>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, hActivationParameters(0.0f, 0.0f, 0.0f, 1.0f), pShuffleIndex);
+            break;
+
+        case SoftMax:
+            hSparseSoftMaxOutputDelta<L>(position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            break;
+
+        default:
+            if (bSparseIgnoreZero)
+                memset(pDelta, 0, (uint64_t)batch * stride * sizeof(NNFloat));
+            break;
+    }
+}
+
+// Like kCalculateSparseL1OutputDelta, there is no L1 delta for SoftMax outputs
+static void hSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    if (activation != SoftMax)
+        hSparseOutputDelta<HostL1Loss>(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+    else if (bSparseIgnoreZero)
+        memset(pDelta, 0, (uint64_t)batch * stride * sizeof(NNFloat));
+}
+
+void hCalculateSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseOutputDelta<HostL2Loss>(activation, position, batch, stride, pUnit, pDelta, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseOutputDelta<HostL2Loss>(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateSparseL2HingeOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseOutputDelta<HostL2HingeLoss>(activation, position, batch, stride, pUnit, pDelta, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseL2HingeOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseOutputDelta<HostL2HingeLoss>(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseL1OutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, NNFloat slope, NNFloat alpha, NNFloat lambda, uint32_t* pShuffleIndex)
+{
+    hSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+}
+
+void hCalculateSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    hSparseCrossEntropyOutputDelta<HostCrossEntropyLoss>(activation, position, batch, stride, pUnit, pDelta, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    hSparseCrossEntropyOutputDelta<HostCrossEntropyLoss>(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+void hCalculateSparseScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    hSparseCrossEntropyOutputDelta<HostScaledMarginalCrossEntropyLoss>(activation, position, batch, stride, pUnit, pDelta, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+void hCalculateIndexedSparseScaledMarginalCrossEntropyOutputDelta(Activation activation, uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    hSparseCrossEntropyOutputDelta<HostScaledMarginalCrossEntropyLoss>(activation, position, batch, stride, pUnit, pDelta, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL1Loss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseL1Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL1Loss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL2Loss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseL2Error(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL2Loss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL2HingeLoss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseL2HingeError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostL2HingeLoss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostCrossEntropyLoss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostCrossEntropyLoss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostScaledMarginalCrossEntropyLoss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, bool bSparseIgnoreZero, uint32_t* pShuffleIndex)
+{
+    return hSparseError<HostScaledMarginalCrossEntropyLoss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    return hSparseMultinomialError<HostCrossEntropyLoss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseMultinomialCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    return hSparseMultinomialError<HostCrossEntropyLoss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+}
+
+NNFloat hCalculateSparseMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    return hSparseMultinomialError<HostScaledMarginalCrossEntropyLoss>(position, batch, stride, pUnit, NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+}
+
+NNFloat hCalculateIndexedSparseMultinomialScaledMarginalCrossEntropyError(uint32_t position, uint32_t batch, uint32_t stride, NNFloat* pUnit, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, uint32_t* pShuffleIndex)
+{
+    return hSparseMultinomialError<HostScaledMarginalCrossEntropyLoss>(position, batch, stride, pUnit, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+}
@@ -0,0 +1,423 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "hostvector.h"
+
+// Host weight and bias updates (the host side of the update kernels of kernels.cu).  Every update is a single
+// pass over the weight, gradient and velocity buffers: each element is loaded once, regularized, used to update
+// its velocities and written back, so the updates run at memory bandwidth once enough threads share the work.
+
+struct HostOptimizerParameters
+{
+    NNFloat                             _alpha;                 // Learning rate
+    NNFloat                             _lambda;                // L2 regularization
+    NNFloat                             _lambda1;               // L1 regularization
+    NNFloat                             _mu;                    // Momentum, decay or Adam beta1
+    NNFloat                             _mu1;                   // Adam beta2
+    NNFloat                             _beta1Correction;       // Adam bias correction 1 - beta1^(t + 1)
+    NNFloat                             _beta2Correction;       // Adam bias correction 1 - beta2^(t + 1)
+};
+
+static HostOptimizerParameters hOptimizerParameters(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1, NNFloat t)
+{
+    HostOptimizerParameters p;
+    p._alpha                            = alpha;
+    p._lambda                           = lambda;
+    p._lambda1                          = lambda1;
+    p._mu                               = mu;
+    p._mu1                              = mu1;
+    p._beta1Correction                  = (NNFloat)1.0 - pow(mu, t + (NNFloat)1.0);
+    p._beta2Correction                  = (NNFloat)1.0 - pow(mu1, t + (NNFloat)1.0);
+    return p;
+}
+
+// Floor of the accumulated squares before their square root is taken, as in kernels.cu
+static const NNFloat VELOCITY_EPSILON   = (NNFloat)0.000000001;
+
+// Each optimizer updates one weight from its regularized gradient g (the direction the weight moves in) and its
+// velocities v and vg, of which it uses the first VELOCITIES
+template<typename S> struct HostSGD
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 0;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        return S::fmadd(S::set1(p._alpha), g, w);
+    }
+};
+
+template<typename S> struct HostMomentum
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 1;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        v                               = S::fmadd(S::set1(p._mu), v, S::mul(S::set1(p._alpha), g));
+        return S::add(w, v);
+    }
+};
+
+template<typename S> struct HostAdaGrad
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 1;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        v                               = S::fmadd(g, g, v);
+        return S::add(w, S::div(S::mul(S::set1(p._alpha), g), S::sqrt(S::max(S::set1(VELOCITY_EPSILON), v))));
+    }
+};
+
+template<typename S> struct HostNesterov
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 1;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        V vOld                          = v;
+        v                               = S::fmadd(S::set1(p._mu), vOld, S::mul(S::set1(p._alpha), g));
+        return S::add(S::add(w, v), S::mul(S::set1(p._mu), S::sub(v, vOld)));
+    }
+};
+
+template<typename S> struct HostRMSProp
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 1;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        v                               = S::fmadd(S::set1(p._mu), v, S::mul(S::set1((NNFloat)1.0 - p._mu), S::mul(g, g)));
+        return S::add(w, S::div(S::mul(S::set1(p._alpha), g), S::sqrt(S::max(S::set1(VELOCITY_EPSILON), v))));
+    }
+};
+
+template<typename S> struct HostAdaDelta
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 2;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        V mu                            = S::set1(p._mu);
+        V mu0                           = S::set1((NNFloat)1.0 - p._mu);
+        V epsilon                       = S::set1(VELOCITY_EPSILON);
+        vg                              = S::fmadd(mu, vg, S::mul(mu0, S::mul(g, g)));
+        V dw                            = S::mul(S::sqrt(S::div(S::max(epsilon, v), S::max(epsilon, vg))), g);
+        v                               = S::fmadd(mu, v, S::mul(mu0, S::mul(dw, dw)));
+        return S::add(w, dw);
+    }
+};
+
+template<typename S> struct HostAdam
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 2;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        v                               = S::fmadd(S::set1(p._mu), v, S::mul(S::set1((NNFloat)1.0 - p._mu), g));
+        vg                              = S::fmadd(S::set1(p._mu1), vg, S::mul(S::set1((NNFloat)1.0 - p._mu1), S::mul(g, g)));
+        V vHat                          = S::div(v, S::set1(p._beta1Correction));
+        V vgHat                         = S::div(vg, S::set1(p._beta2Correction));
+        return S::add(w, S::div(S::mul(S::set1(p._alpha), vHat), S::add(S::sqrt(vgHat), S::set1((NNFloat)1.0e-8))));
+    }
+};
+
+// kAdamUpdateBiases keeps the average of the delta, the negated gradient, in its first velocity
+template<typename S> struct HostAdamBias
+{
+    typedef typename S::V V;
+    static const uint32_t VELOCITIES    = 2;
+    static inline V update(const V& w, const V& g, V& v, V& vg, const HostOptimizerParameters& p)
+    {
+        V ng                            = S::sub(S::set1((NNFloat)0.0), g);
+        v                               = S::fmadd(S::set1(p._mu), v, S::mul(S::set1((NNFloat)1.0 - p._mu), ng));
+        vg                              = S::fmadd(S::set1(p._mu1), vg, S::mul(S::set1((NNFloat)1.0 - p._mu1), S::mul(ng, ng)));
+        V vHat                          = S::div(v, S::set1(p._beta1Correction));
+        V vgHat                         = S::div(vg, S::set1(p._beta2Correction));
+        return S::sub(w, S::div(S::mul(S::set1(p._alpha), vHat), S::add(S::sqrt(vgHat), S::set1((NNFloat)1.0e-8))));
+    }
+};
+
+// One element (or vector of elements) of an update: g - lambda * w - lambda1 * sgn(w) followed by the optimizer
+template<typename S, template<typename> class O>
+static inline void hUpdate(uint64_t pos, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    typedef typename S::V V;
+    V w                                 = S::load(pWeight + pos);
+    V g                                 = S::load(pGradient + pos);
+    g                                   = S::sub(g, S::fmadd(S::set1(p._lambda), w, S::mul(S::set1(p._lambda1), hSign<S>(w))));
+    V v                                 = S::set1((NNFloat)0.0);
+    V vg                                = v;
+    if (O<S>::VELOCITIES > 0)
+        v                               = S::load(pVelocity + pos);
+    if (O<S>::VELOCITIES > 1)
+        vg                              = S::load(pGradientVelocity + pos);
+    S::store(pWeight + pos, O<S>::update(w, g, v, vg, p));
+    if (O<S>::VELOCITIES > 0)
+        S::store(pVelocity + pos, v);
+    if (O<S>::VELOCITIES > 1)
+        S::store(pGradientVelocity + pos, vg);
+}
+
+// Update of elements [start, end)
+template<typename S, template<typename> class O>
+static inline void hUpdateRange(uint64_t start, uint64_t end, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    uint64_t pos                        = start;
+    for (; pos + S::W <= end; pos += S::W)
+        hUpdate<S, O>(pos, pGradient, pVelocity, pGradientVelocity, pWeight, p);
+    for (; pos < end; pos++)
+        hUpdate<HostVectorScalar, O>(pos, pGradient, pVelocity, pGradientVelocity, pWeight, p);
+}
+
+// Columns [start, start + count) of the bias gradient, the negated mean of the delta over the batch as the
+// bias kernels compute it
+template<typename S>
+static inline void hBiasGradient(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pGradient)
+{
+    memset(pGradient, 0, count * sizeof(NNFloat));
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        const NNFloat* pDeltaRow        = pDelta + (uint64_t)i * width + start;
+        uint32_t pos                    = 0;
+        for (; pos + S::W <= count; pos += S::W)
+            S::store(pGradient + pos, S::add(S::load(pGradient + pos), S::load(pDeltaRow + pos)));
+        for (; pos < count; pos++)
+            pGradient[pos]             += pDeltaRow[pos];
+    }
+
+    NNFloat scale                       = (NNFloat)batch;
+    uint32_t pos                        = 0;
+    for (; pos + S::W <= count; pos += S::W)
+        S::store(pGradient + pos, S::sub(S::set1((NNFloat)0.0), S::div(S::load(pGradient + pos), S::set1(scale))));
+    for (; pos < count; pos++)
+        pGradient[pos]                  = -(pGradient[pos] / scale);
+}
+
+// Bias columns handled together: their gradient is summed in a buffer on the stack and then applied in place
+static const uint32_t BIAS_BLOCK        = 1024;
+
+template<typename S, template<typename> class O>
+static inline void hUpdateBiasBlock(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p)
+{
+    NNFloat gradient[BIAS_BLOCK];
+    hBiasGradient<S>(batch, width, start, count, pDelta, gradient);
+    hUpdateRange<S, O>(0, count, gradient, (pVelocity != NULL) ? pVelocity + start : NULL, (pGradientVelocity != NULL) ? pGradientVelocity + start : NULL, pBias + start, p);
+}
+
+// pWeight += mu * pVelocity, the look ahead step of Nesterov momentum
+template<typename S>
+static inline void hNesterovShiftRange(uint64_t start, uint64_t end, NNFloat mu, const NNFloat* pVelocity, NNFloat* pWeight)
+{
+    uint64_t pos                        = start;
+    for (; pos + S::W <= end; pos += S::W)
+        S::store(pWeight + pos, S::fmadd(S::set1(mu), S::load(pVelocity + pos), S::load(pWeight + pos)));
+    for (; pos < end; pos++)
+        pWeight[pos]                   += mu * pVelocity[pos];
+}
+
+typedef void (*UpdateFunction)(uint64_t start, uint64_t end, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p);
+typedef void (*UpdateBiasFunction)(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p);
+typedef void (*NesterovShiftFunction)(uint64_t start, uint64_t end, NNFloat mu, const NNFloat* pVelocity, NNFloat* pWeight);
+
+// One flattened function per instruction set and optimizer
+template<template<typename> class O> __attribute__((flatten))
+static void hUpdateScalar(uint64_t start, uint64_t end, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    hUpdateRange<HostVectorScalar, O>(start, end, pGradient, pVelocity, pGradientVelocity, pWeight, p);
+}
+
+template<template<typename> class O> __attribute__((target("avx2,fma"), flatten))
+static void hUpdateAVX2(uint64_t start, uint64_t end, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    hUpdateRange<HostVectorAVX2, O>(start, end, pGradient, pVelocity, pGradientVelocity, pWeight, p);
+}
+
+template<template<typename> class O> __attribute__((target("avx512f"), flatten))
+static void hUpdateAVX512(uint64_t start, uint64_t end, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    hUpdateRange<HostVectorAVX512, O>(start, end, pGradient, pVelocity, pGradientVelocity, pWeight, p);
+}
+
+template<template<typename> class O> __attribute__((flatten))
+static void hUpdateBiasScalar(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p)
+{
+    hUpdateBiasBlock<HostVectorScalar, O>(batch, width, start, count, pDelta, pVelocity, pGradientVelocity, pBias, p);
+}
+
+template<template<typename> class O> __attribute__((target("avx2,fma"), flatten))
+static void hUpdateBiasAVX2(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p)
+{
+    hUpdateBiasBlock<HostVectorAVX2, O>(batch, width, start, count, pDelta, pVelocity, pGradientVelocity, pBias, p);
+}
+
+template<template<typename> class O> __attribute__((target("avx512f"), flatten))
+static void hUpdateBiasAVX512(uint32_t batch, uint32_t width, uint32_t start, uint32_t count, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p)
+{
+    hUpdateBiasBlock<HostVectorAVX512, O>(batch, width, start, count, pDelta, pVelocity, pGradientVelocity, pBias, p);
+}
+
+__attribute__((flatten))
+static void hNesterovShiftScalar(uint64_t start, uint64_t end, NNFloat mu, const NNFloat* pVelocity, NNFloat* pWeight)
+{
+    hNesterovShiftRange<HostVectorScalar>(start, end, mu, pVelocity, pWeight);
+}
+
+__attribute__((target("avx2,fma"), flatten))
+static void hNesterovShiftAVX2(uint64_t start, uint64_t end, NNFloat mu, const NNFloat* pVelocity, NNFloat* pWeight)
+{
+    hNesterovShiftRange<HostVectorAVX2>(start, end, mu, pVelocity, pWeight);
+}
+
+__attribute__((target("avx512f"), flatten))
+static void hNesterovShiftAVX512(uint64_t start, uint64_t end, NNFloat mu, const NNFloat* pVelocity, NNFloat* pWeight)
+{
+    hNesterovShiftRange<HostVectorAVX512>(start, end, mu, pVelocity, pWeight);
+}
+
+// Elements updated by one task.  Static scheduling hands each thread a contiguous range, so its pages stay on
+// the thread that first touched them.
+static const uint64_t UPDATE_BLOCK      = 16384;
+
+template<template<typename> class O>
+static void hUpdateWeights(uint64_t size, const NNFloat* pGradient, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pWeight, const HostOptimizerParameters& p)
+{
+    HostSimd simd                       = hGetSimd();
+    UpdateFunction update               = (simd == HostSimdAVX512) ? hUpdateAVX512<O> :
+                                          (simd == HostSimdAVX2) ? hUpdateAVX2<O> : hUpdateScalar<O>;
+    uint64_t blocks                     = (size + UPDATE_BLOCK - 1) / UPDATE_BLOCK;
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t block = 0; block < blocks; block++)
+    {
+        uint64_t start                  = block * UPDATE_BLOCK;
+        update(start, min(start + UPDATE_BLOCK, size), pGradient, pVelocity, pGradientVelocity, pWeight, p);
+    }
+}
+
+template<template<typename> class O>
+static void hUpdateBiases(uint32_t batch, uint32_t width, const NNFloat* pDelta, NNFloat* pVelocity, NNFloat* pGradientVelocity, NNFloat* pBias, const HostOptimizerParameters& p)
+{
+    HostSimd simd                       = hGetSimd();
+    UpdateBiasFunction update           = (simd == HostSimdAVX512) ? hUpdateBiasAVX512<O> :
+                                          (simd == HostSimdAVX2) ? hUpdateBiasAVX2<O> : hUpdateBiasScalar<O>;
+    uint32_t blocks                     = (width + BIAS_BLOCK - 1) / BIAS_BLOCK;
+
+#pragma omp parallel for schedule(static)
+    for (uint32_t block = 0; block < blocks; block++)
+    {
+        uint32_t start                  = block * BIAS_BLOCK;
+        update(batch, width, start, min(BIAS_BLOCK, width - start), pDelta, pVelocity, pGradientVelocity, pBias, p);
+    }
+}
+
+static void hNesterovShift(NNFloat mu, uint64_t size, const NNFloat* pVelocity, NNFloat* pWeight)
+{
+    HostSimd simd                       = hGetSimd();
+    NesterovShiftFunction shift         = (simd == HostSimdAVX512) ? hNesterovShiftAVX512 :
+                                          (simd == HostSimdAVX2) ? hNesterovShiftAVX2 : hNesterovShiftScalar;
+    uint64_t blocks                     = (size + UPDATE_BLOCK - 1) / UPDATE_BLOCK;
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t block = 0; block < blocks; block++)
+    {
+        uint64_t start                  = block * UPDATE_BLOCK;
+        shift(start, min(start + UPDATE_BLOCK, size), mu, pVelocity, pWeight);
+    }
+}
+
+void hSGDUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, uint64_t size, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+    hUpdateWeights<HostSGD>(size, pWeightGradient, NULL, NULL, pWeight, hOptimizerParameters(alpha, lambda, lambda1, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hSGDUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBias)
+{
+    hUpdateBiases<HostSGD>(batch, width, pDelta, NULL, NULL, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hMomentumUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+    hUpdateWeights<HostMomentum>(size, pWeightGradient, pWeightVelocity, NULL, pWeight, hOptimizerParameters(alpha, lambda, lambda1, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hMomentumUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostMomentum>(batch, width, pDelta, pBiasVelocity, NULL, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hAdaGradUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+    hUpdateWeights<HostAdaGrad>(size, pWeightGradient, pWeightVelocity, NULL, pWeight, hOptimizerParameters(alpha, lambda, lambda1, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hAdaGradUpdateBiases(NNFloat alpha, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostAdaGrad>(batch, width, pDelta, pBiasVelocity, NULL, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hNesterovShiftWeights(NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeight)
+{
+    hNesterovShift(mu, size, pWeightVelocity, pWeight);
+}
+
+void hNesterovShiftBiases(NNFloat mu, uint32_t width, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    hNesterovShift(mu, width, pBiasVelocity, pBias);
+}
+
+void hNesterovUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+    hUpdateWeights<HostNesterov>(size, pWeightGradient, pWeightVelocity, NULL, pWeight, hOptimizerParameters(alpha, lambda, lambda1, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hNesterovUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostNesterov>(batch, width, pDelta, pBiasVelocity, NULL, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hRMSPropUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeight)
+{
+    hUpdateWeights<HostRMSProp>(size, pWeightGradient, pWeightVelocity, NULL, pWeight, hOptimizerParameters(alpha, lambda, lambda1, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hRMSPropUpdateBiases(NNFloat alpha, NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostRMSProp>(batch, width, pDelta, pBiasVelocity, NULL, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hAdaDeltaUpdateWeights(NNFloat lambda, NNFloat lambda1, NNFloat mu, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeightGradientVelocity, NNFloat* pWeight)
+{
+    hUpdateWeights<HostAdaDelta>(size, pWeightGradient, pWeightVelocity, pWeightGradientVelocity, pWeight, hOptimizerParameters((NNFloat)0.0, lambda, lambda1, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hAdaDeltaUpdateBiases(NNFloat mu, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBiasGradientVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostAdaDelta>(batch, width, pDelta, pBiasVelocity, pBiasGradientVelocity, pBias, hOptimizerParameters((NNFloat)0.0, (NNFloat)0.0, (NNFloat)0.0, mu, (NNFloat)0.0, (NNFloat)0.0));
+}
+
+void hAdamUpdateWeights(NNFloat alpha, NNFloat lambda, NNFloat lambda1, NNFloat mu, NNFloat mu1, NNFloat t, uint64_t size, NNFloat* pWeightVelocity, NNFloat* pWeightGradient, NNFloat* pWeightGradientVelocity, NNFloat* pWeight)
+{
+    hUpdateWeights<HostAdam>(size, pWeightGradient, pWeightVelocity, pWeightGradientVelocity, pWeight, hOptimizerParameters(alpha, lambda, lambda1, mu, mu1, t));
+}
+
+void hAdamUpdateBiases(NNFloat alpha, NNFloat mu, NNFloat mu1, NNFloat t, uint32_t batch, uint32_t width, NNFloat* pDelta, NNFloat* pBiasVelocity, NNFloat* pBiasGradientVelocity, NNFloat* pBias)
+{
+    hUpdateBiases<HostAdamBias>(batch, width, pDelta, pBiasVelocity, pBiasGradientVelocity, pBias, hOptimizerParameters(alpha, (NNFloat)0.0, (NNFloat)0.0, mu, mu1, t));
+}
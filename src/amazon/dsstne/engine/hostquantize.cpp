@@ -0,0 +1,537 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+#include <omp.h>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "hostvector.h"
+
+// Int8 quantized prediction.  Prediction of wide fully connected layers streams every weight once per batch, so
+// storing them as int8 instead of fp32 cuts both the model size and the memory traffic by four.  Dense layers are
+// multiplied as int8 x int8 products summed in 32-bit integers and scaled back to single precision once per output,
+// fast sparse input layers accumulate their int8 weight rows in single precision.
+
+// Quantized rows are padded with zeros to a multiple of one AVX-512 vector of int8
+static const uint32_t QUANTIZED_ALIGNMENT       = 64;
+
+uint32_t hQuantizedStride(uint32_t k)
+{
+    return (k + QUANTIZED_ALIGNMENT - 1) / QUANTIZED_ALIGNMENT * QUANTIZED_ALIGNMENT;
+}
+
+// Round to nearest even like cvtps2dq, then saturate to the symmetric int8 range
+static inline int8_t hQuantize(NNFloat x, NNFloat rScale)
+{
+    NNFloat q                                   = nearbyintf(x * rScale);
+    return (int8_t)min(max(q, (NNFloat)-127.0), (NNFloat)127.0);
+}
+
+static inline NNFloat hWeight(const NNFloat* pWeight, bool bTransposed, uint32_t k, uint32_t n, uint32_t l, uint32_t j)
+{
+    return bTransposed ? pWeight[(uint64_t)j * k + l] : pWeight[(uint64_t)l * n + j];
+}
+
+// scale[j] = max |W[.][j]| / 127, or 1 for outputs whose weights are all zero.  Each thread takes a block of
+// outputs so that rows of untransposed weights are read a block at a time.
+static void hCalculateWeightScales(uint32_t k, uint32_t n, const NNFloat* pWeight, bool bTransposed, NNFloat* pScale)
+{
+    static const uint32_t BLOCK                 = 256;
+    uint32_t blocks                             = (n + BLOCK - 1) / BLOCK;
+
+#pragma omp parallel for schedule(dynamic)
+    for (uint32_t block = 0; block < blocks; block++)
+    {
+        uint32_t start                          = block * BLOCK;
+        uint32_t end                            = min(start + BLOCK, n);
+        NNFloat vMax[BLOCK]                     = {};
+        for (uint32_t l = 0; l < k; l++)
+            for (uint32_t j = start; j < end; j++)
+                vMax[j - start]                 = max(vMax[j - start], fabsf(hWeight(pWeight, bTransposed, k, n, l, j)));
+        for (uint32_t j = start; j < end; j++)
+            pScale[j]                           = (vMax[j - start] > (NNFloat)0.0) ? vMax[j - start] / (NNFloat)127.0 : (NNFloat)1.0;
+    }
+}
+
+void hQuantizeWeightsByOutput(uint32_t k, uint32_t n, const NNFloat* pWeight, bool bTransposed, NNFloat* pScale, int8_t* pQWeight, int32_t* pWeightSum)
+{
+    uint32_t kp                                 = hQuantizedStride(k);
+    hCalculateWeightScales(k, n, pWeight, bTransposed, pScale);
+
+#pragma omp parallel for
+    for (uint32_t j = 0; j < n; j++)
+    {
+        NNFloat rScale                          = (NNFloat)1.0 / pScale[j];
+        int8_t* pQ                              = pQWeight + (uint64_t)j * kp;
+        int32_t sum                             = 0;
+        for (uint32_t l = 0; l < k; l++)
+        {
+            pQ[l]                               = hQuantize(hWeight(pWeight, bTransposed, k, n, l, j), rScale);
+            sum                                += pQ[l];
+        }
+        memset(pQ + k, 0, kp - k);
+        pWeightSum[j]                           = sum;
+    }
+}
+
+void hQuantizeWeightsByInput(uint32_t k, uint32_t n, const NNFloat* pWeight, bool bTransposed, NNFloat* pScale, int8_t* pQWeight)
+{
+    hCalculateWeightScales(k, n, pWeight, bTransposed, pScale);
+    vector<NNFloat> vRScale(n);
+    for (uint32_t j = 0; j < n; j++)
+        vRScale[j]                              = (NNFloat)1.0 / pScale[j];
+
+#pragma omp parallel for
+    for (uint32_t l = 0; l < k; l++)
+    {
+        int8_t* pQ                              = pQWeight + (uint64_t)l * n;
+        for (uint32_t j = 0; j < n; j++)
+            pQ[j]                               = hQuantize(hWeight(pWeight, bTransposed, k, n, l, j), vRScale[j]);
+    }
+}
+
+// Quantizes the first k units of a row, 32 at a time.  The two packs interleave the 128-bit lanes of their inputs,
+// which the final permute undoes.
+__attribute__((target("avx2,fma")))
+static uint32_t hQuantizeRowAVX2(const NNFloat* pX, uint32_t k, NNFloat rScale, int8_t* pQ)
+{
+    const __m256 vRScale                        = _mm256_set1_ps(rScale);
+    const __m256 vMin                           = _mm256_set1_ps(-127.0f);
+    const __m256 vMax                           = _mm256_set1_ps(127.0f);
+    const __m256i vOrder                        = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t l                                  = 0;
+    for (; l + 32 <= k; l += 32)
+    {
+        __m256i q0                              = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pX + l), vRScale), vMin), vMax));
+        __m256i q1                              = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pX + l + 8), vRScale), vMin), vMax));
+        __m256i q2                              = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pX + l + 16), vRScale), vMin), vMax));
+        __m256i q3                              = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(pX + l + 24), vRScale), vMin), vMax));
+        __m256i q                               = _mm256_packs_epi16(_mm256_packs_epi32(q0, q1), _mm256_packs_epi32(q2, q3));
+        _mm256_storeu_si256((__m256i*)(pQ + l), _mm256_permutevar8x32_epi32(q, vOrder));
+    }
+    return l;
+}
+
+void hQuantizeUnits(const NNFloat* pUnit, uint32_t batch, uint32_t k, NNFloat scale, int8_t* pQUnit)
+{
+    uint32_t kp                                 = hQuantizedStride(k);
+    NNFloat rScale                              = (NNFloat)1.0 / scale;
+    bool bAVX2                                  = (hGetSimd() != HostSimdScalar);
+
+#pragma omp parallel for
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        const NNFloat* pX                       = pUnit + (uint64_t)i * k;
+        int8_t* pQ                              = pQUnit + (uint64_t)i * kp;
+        uint32_t l                              = bAVX2 ? hQuantizeRowAVX2(pX, k, rScale, pQ) : 0;
+        for (; l < k; l++)
+            pQ[l]                               = hQuantize(pX[l], rScale);
+        memset(pQ + k, 0, kp - k);
+    }
+}
+
+// Integer dot products of R quantized unit rows with C quantized weight rows, both kp apart, stored at
+// pDot[r * ldDot + c].  Each instruction set keeps an R x C tile of accumulators in registers so that every
+// load is used R or C times.
+struct HostDotScalar
+{
+    static const uint32_t R = 1;
+    static const uint32_t C = 1;
+
+    template<uint32_t TR, uint32_t TC>
+    static inline void tile(const int8_t* pA, const int8_t* pB, uint32_t kp, const int32_t* pWeightSum, int32_t* pDot, uint32_t ldDot)
+    {
+        for (uint32_t r = 0; r < TR; r++)
+            for (uint32_t c = 0; c < TC; c++)
+            {
+                int32_t sum                     = 0;
+                for (uint32_t l = 0; l < kp; l++)
+                    sum                        += (int32_t)pA[r * kp + l] * (int32_t)pB[c * kp + l];
+                pDot[r * ldDot + c]             = sum;
+            }
+    }
+};
+
+// Sign extends 16 int8 at a time to int16 and sums pairs of products into int32 with vpmaddwd, which is exact
+// since |q| <= 127.  2 x 4 tiles leave registers for the operands.
+struct HostDotAVX2
+{
+    static const uint32_t R = 2;
+    static const uint32_t C = 4;
+
+    template<uint32_t TR, uint32_t TC> __attribute__((target("avx2,fma")))
+    static inline void tile(const int8_t* pA, const int8_t* pB, uint32_t kp, const int32_t* pWeightSum, int32_t* pDot, uint32_t ldDot)
+    {
+        __m256i acc[TR][TC];
+        for (uint32_t r = 0; r < TR; r++)
+            for (uint32_t c = 0; c < TC; c++)
+                acc[r][c]                       = _mm256_setzero_si256();
+        for (uint32_t l = 0; l < kp; l += 16)
+        {
+            __m256i b[TC];
+            for (uint32_t c = 0; c < TC; c++)
+                b[c]                            = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(pB + c * kp + l)));
+            for (uint32_t r = 0; r < TR; r++)
+            {
+                __m256i a                       = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(pA + r * kp + l)));
+                for (uint32_t c = 0; c < TC; c++)
+                    acc[r][c]                   = _mm256_add_epi32(acc[r][c], _mm256_madd_epi16(a, b[c]));
+            }
+        }
+        for (uint32_t r = 0; r < TR; r++)
+            for (uint32_t c = 0; c < TC; c++)
+            {
+                __m128i s                       = _mm_add_epi32(_mm256_castsi256_si128(acc[r][c]), _mm256_extracti128_si256(acc[r][c], 1));
+                s                               = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+                s                               = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+                pDot[r * ldDot + c]             = _mm_cvtsi128_si32(s);
+            }
+    }
+};
+
+// vpdpbusd multiplies unsigned by signed bytes, so the units are offset by 128 (flipping their sign bit) and
+// 128 * sum(q) of each weight row is subtracted again.  The accumulators may wrap but the final difference is exact.
+struct HostDotVNNI
+{
+    static const uint32_t R = 4;
+    static const uint32_t C = 4;
+
+    template<uint32_t TR, uint32_t TC> __attribute__((target("avx512f,avx512vnni")))
+    static inline void tile(const int8_t* pA, const int8_t* pB, uint32_t kp, const int32_t* pWeightSum, int32_t* pDot, uint32_t ldDot)
+    {
+        const __m512i vOffset                   = _mm512_set1_epi8((char)0x80);
+        __m512i acc[TR][TC];
+        for (uint32_t r = 0; r < TR; r++)
+            for (uint32_t c = 0; c < TC; c++)
+                acc[r][c]                       = _mm512_setzero_si512();
+        for (uint32_t l = 0; l < kp; l += 64)
+        {
+            __m512i b[TC];
+            for (uint32_t c = 0; c < TC; c++)
+                b[c]                            = _mm512_loadu_si512(pB + c * kp + l);
+            for (uint32_t r = 0; r < TR; r++)
+            {
+                __m512i a                       = _mm512_xor_si512(_mm512_loadu_si512(pA + r * kp + l), vOffset);
+                for (uint32_t c = 0; c < TC; c++)
+                    acc[r][c]                   = _mm512_dpbusd_epi32(acc[r][c], a, b[c]);
+            }
+        }
+        for (uint32_t r = 0; r < TR; r++)
+            for (uint32_t c = 0; c < TC; c++)
+                pDot[r * ldDot + c]             = (int32_t)((uint32_t)_mm512_reduce_add_epi32(acc[r][c]) - 128u * (uint32_t)pWeightSum[c]);
+    }
+};
+
+// Dot products of a block of units and weights, pDot[e][o] for e < examples and o < outputs, in full tiles and
+// then single rows and columns
+template<class D>
+static inline void hDotBlock(const int8_t* pA, uint32_t examples, const int8_t* pB, const int32_t* pWeightSum, uint32_t outputs, uint32_t kp, int32_t* pDot)
+{
+    uint32_t e                                  = 0;
+    for (; e + D::R <= examples; e += D::R)
+    {
+        uint32_t o                              = 0;
+        for (; o + D::C <= outputs; o += D::C)
+            D::template tile<D::R, D::C>(pA + (uint64_t)e * kp, pB + (uint64_t)o * kp, kp, pWeightSum + o, pDot + e * outputs + o, outputs);
+        for (; o < outputs; o++)
+            D::template tile<D::R, 1>(pA + (uint64_t)e * kp, pB + (uint64_t)o * kp, kp, pWeightSum + o, pDot + e * outputs + o, outputs);
+    }
+    for (; e < examples; e++)
+    {
+        uint32_t o                              = 0;
+        for (; o + D::C <= outputs; o += D::C)
+            D::template tile<1, D::C>(pA + (uint64_t)e * kp, pB + (uint64_t)o * kp, kp, pWeightSum + o, pDot + e * outputs + o, outputs);
+        for (; o < outputs; o++)
+            D::template tile<1, 1>(pA + (uint64_t)e * kp, pB + (uint64_t)o * kp, kp, pWeightSum + o, pDot + e * outputs + o, outputs);
+    }
+}
+
+typedef void (*DotBlockFunction)(const int8_t* pA, uint32_t examples, const int8_t* pB, const int32_t* pWeightSum, uint32_t outputs, uint32_t kp, int32_t* pDot);
+
+__attribute__((flatten))
+static void hDotBlockScalar(const int8_t* pA, uint32_t examples, const int8_t* pB, const int32_t* pWeightSum, uint32_t outputs, uint32_t kp, int32_t* pDot)
+{
+    hDotBlock<HostDotScalar>(pA, examples, pB, pWeightSum, outputs, kp, pDot);
+}
+
+__attribute__((target("avx2,fma"), flatten))
+static void hDotBlockAVX2(const int8_t* pA, uint32_t examples, const int8_t* pB, const int32_t* pWeightSum, uint32_t outputs, uint32_t kp, int32_t* pDot)
+{
+    hDotBlock<HostDotAVX2>(pA, examples, pB, pWeightSum, outputs, kp, pDot);
+}
+
+__attribute__((target("avx512f,avx512vnni"), flatten))
+static void hDotBlockVNNI(const int8_t* pA, uint32_t examples, const int8_t* pB, const int32_t* pWeightSum, uint32_t outputs, uint32_t kp, int32_t* pDot)
+{
+    hDotBlock<HostDotVNNI>(pA, examples, pB, pWeightSum, outputs, kp, pDot);
+}
+
+static bool hSupportsVNNI()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512vnni");
+}
+
+const char* hGetQuantizedKernelName()
+{
+    HostSimd simd                               = hGetSimd();
+    return ((simd == HostSimdAVX512) && hSupportsVNNI()) ? "AVX-512 VNNI" : (simd != HostSimdScalar) ? "AVX2" : "Scalar";
+}
+
+// Examples and outputs of one task.  The units of a block of examples stay in L2 while the weights of a block of
+// outputs stay in L1 for k up to a few thousand inputs, and consecutive tasks of a thread share the weights.
+static const uint32_t QUANTIZED_EXAMPLE_BLOCK   = 64;
+static const uint32_t QUANTIZED_OUTPUT_BLOCK    = 16;
+
+void hCalculateQuantizedZ(uint32_t batch, uint32_t k, uint32_t n, const int8_t* pQUnit, NNFloat unitScale, const int8_t* pQWeight, const NNFloat* pWeightScale, const int32_t* pWeightSum, NNFloat* pUnit, NNFloat beta)
+{
+    HostSimd simd                               = hGetSimd();
+    DotBlockFunction dotBlock                   = ((simd == HostSimdAVX512) && hSupportsVNNI()) ? hDotBlockVNNI :
+                                                  (simd != HostSimdScalar) ? hDotBlockAVX2 : hDotBlockScalar;
+    uint32_t kp                                 = hQuantizedStride(k);
+    uint32_t exampleBlocks                      = (batch + QUANTIZED_EXAMPLE_BLOCK - 1) / QUANTIZED_EXAMPLE_BLOCK;
+    uint32_t outputBlocks                       = (n + QUANTIZED_OUTPUT_BLOCK - 1) / QUANTIZED_OUTPUT_BLOCK;
+
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (uint32_t outputBlock = 0; outputBlock < outputBlocks; outputBlock++)
+    {
+        for (uint32_t exampleBlock = 0; exampleBlock < exampleBlocks; exampleBlock++)
+        {
+            int32_t dot[QUANTIZED_EXAMPLE_BLOCK * QUANTIZED_OUTPUT_BLOCK];
+            uint32_t e                          = exampleBlock * QUANTIZED_EXAMPLE_BLOCK;
+            uint32_t o                          = outputBlock * QUANTIZED_OUTPUT_BLOCK;
+            uint32_t examples                   = min(QUANTIZED_EXAMPLE_BLOCK, batch - e);
+            uint32_t outputs                    = min(QUANTIZED_OUTPUT_BLOCK, n - o);
+            dotBlock(pQUnit + (uint64_t)e * kp, examples, pQWeight + (uint64_t)o * kp, pWeightSum + o, outputs, kp, dot);
+
+            for (uint32_t i = 0; i < examples; i++)
+            {
+                NNFloat* pY                     = pUnit + (uint64_t)(e + i) * n + o;
+                for (uint32_t j = 0; j < outputs; j++)
+                {
+                    NNFloat z                   = unitScale * pWeightScale[o + j] * (NNFloat)dot[i * outputs + j];
+                    pY[j]                       = (beta == (NNFloat)0.0) ? z : beta * pY[j] + z;
+                }
+            }
+        }
+    }
+}
+
+// Quantized row accumulation of the sparse Z kernels: y[0, n) = beta * y + pWeightScale[0, n) * sum over j < count
+// of pScale[j] * pRow[j][0, n), tiled like AccumulateRowsFunction in hostkernels.cpp
+typedef void (*AccumulateQuantizedRowsFunction)(NNFloat* pY, const int8_t* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, const NNFloat* pWeightScale, NNFloat beta);
+
+// Scalar accumulation of outputs [start, n), also the tail of the vector versions
+static void hAccumulateQuantizedRowsRange(NNFloat* pY, const int8_t* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t start, uint32_t n, const NNFloat* pWeightScale, NNFloat beta)
+{
+    static const uint32_t TILE                  = 64;
+    NNFloat acc[TILE];
+    for (uint32_t o = start; o < n; o += TILE)
+    {
+        uint32_t width                          = min(TILE, n - o);
+        memset(acc, 0, width * sizeof(NNFloat));
+        for (uint32_t j = 0; j < count; j++)
+        {
+            const int8_t* pX                    = pRow[j] + o;
+            NNFloat a                           = pScale[j];
+            for (uint32_t k = 0; k < width; k++)
+                acc[k]                         += a * (NNFloat)pX[k];
+        }
+        for (uint32_t k = 0; k < width; k++)
+            pY[o + k]                           = (beta == (NNFloat)0.0) ? acc[k] * pWeightScale[o + k] : beta * pY[o + k] + acc[k] * pWeightScale[o + k];
+    }
+}
+
+static void hAccumulateQuantizedRowsScalar(NNFloat* pY, const int8_t* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, const NNFloat* pWeightScale, NNFloat beta)
+{
+    hAccumulateQuantizedRowsRange(pY, pRow, pScale, count, 0, n, pWeightScale, beta);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 hLoadQuantizedAVX2(const int8_t* p)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline void hStoreQuantizedAVX2(NNFloat* pY, __m256 acc, const NNFloat* pWeightScale, __m256 vBeta, bool bClear)
+{
+    __m256 y                                    = bClear ? _mm256_setzero_ps() : _mm256_mul_ps(vBeta, _mm256_loadu_ps(pY));
+    _mm256_storeu_ps(pY, _mm256_fmadd_ps(acc, _mm256_loadu_ps(pWeightScale), y));
+}
+
+__attribute__((target("avx2,fma")))
+static void hAccumulateQuantizedRowsAVX2(NNFloat* pY, const int8_t* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, const NNFloat* pWeightScale, NNFloat beta)
+{
+    const __m256 vBeta                          = _mm256_set1_ps(beta);
+    const bool bClear                           = (beta == (NNFloat)0.0);
+    uint32_t o                                  = 0;
+
+    // 32 outputs (4 registers, half a cache line of weights) per tile
+    for (; o + 32 <= n; o += 32)
+    {
+        __m256 acc0                             = _mm256_setzero_ps();
+        __m256 acc1                             = _mm256_setzero_ps();
+        __m256 acc2                             = _mm256_setzero_ps();
+        __m256 acc3                             = _mm256_setzero_ps();
+        for (uint32_t j = 0; j < count; j++)
+        {
+            const int8_t* pX                    = pRow[j] + o;
+            __m256 a                            = _mm256_set1_ps(pScale[j]);
+            acc0                                = _mm256_fmadd_ps(a, hLoadQuantizedAVX2(pX), acc0);
+            acc1                                = _mm256_fmadd_ps(a, hLoadQuantizedAVX2(pX + 8), acc1);
+            acc2                                = _mm256_fmadd_ps(a, hLoadQuantizedAVX2(pX + 16), acc2);
+            acc3                                = _mm256_fmadd_ps(a, hLoadQuantizedAVX2(pX + 24), acc3);
+        }
+        hStoreQuantizedAVX2(pY + o, acc0, pWeightScale + o, vBeta, bClear);
+        hStoreQuantizedAVX2(pY + o + 8, acc1, pWeightScale + o + 8, vBeta, bClear);
+        hStoreQuantizedAVX2(pY + o + 16, acc2, pWeightScale + o + 16, vBeta, bClear);
+        hStoreQuantizedAVX2(pY + o + 24, acc3, pWeightScale + o + 24, vBeta, bClear);
+    }
+
+    for (; o + 8 <= n; o += 8)
+    {
+        __m256 acc                              = _mm256_setzero_ps();
+        for (uint32_t j = 0; j < count; j++)
+            acc                                 = _mm256_fmadd_ps(_mm256_set1_ps(pScale[j]), hLoadQuantizedAVX2(pRow[j] + o), acc);
+        hStoreQuantizedAVX2(pY + o, acc, pWeightScale + o, vBeta, bClear);
+    }
+
+    hAccumulateQuantizedRowsRange(pY, pRow, pScale, count, o, n, pWeightScale, beta);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 hLoadQuantizedAVX512(const int8_t* p)
+{
+    return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)p)));
+}
+
+__attribute__((target("avx512f")))
+static inline void hStoreQuantizedAVX512(NNFloat* pY, __m512 acc, const NNFloat* pWeightScale, __m512 vBeta, bool bClear)
+{
+    __m512 y                                    = bClear ? _mm512_setzero_ps() : _mm512_mul_ps(vBeta, _mm512_loadu_ps(pY));
+    _mm512_storeu_ps(pY, _mm512_fmadd_ps(acc, _mm512_loadu_ps(pWeightScale), y));
+}
+
+__attribute__((target("avx512f")))
+static void hAccumulateQuantizedRowsAVX512(NNFloat* pY, const int8_t* const* pRow, const NNFloat* pScale, uint32_t count, uint32_t n, const NNFloat* pWeightScale, NNFloat beta)
+{
+    const __m512 vBeta                          = _mm512_set1_ps(beta);
+    const bool bClear                           = (beta == (NNFloat)0.0);
+    uint32_t o                                  = 0;
+
+    // 64 outputs (4 registers, one cache line of weights) per tile
+    for (; o + 64 <= n; o += 64)
+    {
+        __m512 acc0                             = _mm512_setzero_ps();
+        __m512 acc1                             = _mm512_setzero_ps();
+        __m512 acc2                             = _mm512_setzero_ps();
+        __m512 acc3                             = _mm512_setzero_ps();
+        for (uint32_t j = 0; j < count; j++)
+        {
+            const int8_t* pX                    = pRow[j] + o;
+            __m512 a                            = _mm512_set1_ps(pScale[j]);
+            acc0                                = _mm512_fmadd_ps(a, hLoadQuantizedAVX512(pX), acc0);
+            acc1                                = _mm512_fmadd_ps(a, hLoadQuantizedAVX512(pX + 16), acc1);
+            acc2                                = _mm512_fmadd_ps(a, hLoadQuantizedAVX512(pX + 32), acc2);
+            acc3                                = _mm512_fmadd_ps(a, hLoadQuantizedAVX512(pX + 48), acc3);
+        }
+        hStoreQuantizedAVX512(pY + o, acc0, pWeightScale + o, vBeta, bClear);
+        hStoreQuantizedAVX512(pY + o + 16, acc1, pWeightScale + o + 16, vBeta, bClear);
+        hStoreQuantizedAVX512(pY + o + 32, acc2, pWeightScale + o + 32, vBeta, bClear);
+        hStoreQuantizedAVX512(pY + o + 48, acc3, pWeightScale + o + 48, vBeta, bClear);
+    }
+
+    for (; o + 16 <= n; o += 16)
+    {
+        __m512 acc                              = _mm512_setzero_ps();
+        for (uint32_t j = 0; j < count; j++)
+            acc                                 = _mm512_fmadd_ps(_mm512_set1_ps(pScale[j]), hLoadQuantizedAVX512(pRow[j] + o), acc);
+        hStoreQuantizedAVX512(pY + o, acc, pWeightScale + o, vBeta, bClear);
+    }
+
+    hAccumulateQuantizedRowsRange(pY, pRow, pScale, count, o, n, pWeightScale, beta);
+}
+
+// hCalculateSparseZ of hostkernels.cpp on int8 weight rows
+template<typename T> static void hCalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    HostSimd simd                               = hGetSimd();
+    AccumulateQuantizedRowsFunction accumulateRows = (simd == HostSimdAVX512) ? hAccumulateQuantizedRowsAVX512 :
+                                                     (simd == HostSimdAVX2) ? hAccumulateQuantizedRowsAVX2 : hAccumulateQuantizedRowsScalar;
+
+#pragma omp parallel
+    {
+        vector<const int8_t*> vRow;
+        vector<NNFloat> vScale;
+
+#pragma omp for schedule(dynamic, 16)
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example                    = hExample(position, i, pIndex, pShuffleIndex);
+            uint64_t start                      = pSparseStart[example];
+            uint64_t end                        = pSparseEnd[example];
+            if (start == end)
+                continue;
+
+            NNFloat w                           = (pDataWeight != NULL) ? pDataWeight[example] : (NNFloat)1.0;
+            vRow.clear();
+            vScale.clear();
+            for (uint64_t j = start; j < end; j++)
+            {
+                vRow.push_back(pQWeight + (uint64_t)pSparseIndex[j] * stride);
+                vScale.push_back((pSparseData != NULL) ? w * hSparseValue(pSparseData[j]) : w);
+            }
+            accumulateRows(pUnit + (uint64_t)i * stride, vRow.data(), vScale.data(), vRow.size(), stride, pWeightScale, beta);
+        }
+    }
+}
+
+void hCalculateQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pUnit, beta, pShuffleIndex);
+}
+
+void hCalculateIndexedQuantizedSparseZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, (NNFloat*)NULL, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateQuantizedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, (uint32_t*)NULL, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pUnit, beta, pShuffleIndex);
+}
+
+template<typename T> void hCalculateIndexedQuantizedSparseAnalogZ(uint32_t position, uint32_t batch, uint32_t stride, int8_t* pQWeight, NNFloat* pWeightScale, uint32_t* pIndex, uint64_t* pSparseStart, uint64_t* pSparseEnd, uint32_t* pSparseIndex, NNFloat* pDataWeight, T* pSparseData, NNFloat* pUnit, NNFloat beta, uint32_t* pShuffleIndex)
+{
+    hCalculateQuantizedSparseZ(position, batch, stride, pQWeight, pWeightScale, pIndex, pSparseStart, pSparseEnd, pSparseIndex, pDataWeight, pSparseData, pUnit, beta, pShuffleIndex);
+}
+
+// Instantiates the templated kernels for the data set types of kernels.cu#EXPLICITLY_INSTANTIATE_KERNELS
+#define EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(T)                                                                                                                                                          \
+template void hCalculateQuantizedSparseAnalogZ<T>(uint32_t, uint32_t, uint32_t, int8_t*, NNFloat*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat, uint32_t*);                                 \
+template void hCalculateIndexedQuantizedSparseAnalogZ<T>(uint32_t, uint32_t, uint32_t, int8_t*, NNFloat*, uint32_t*, uint64_t*, uint64_t*, uint32_t*, NNFloat*, T*, NNFloat*, NNFloat, uint32_t*);
+/**/
+
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(NNFloat)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(double)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(unsigned char)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(char)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(uint32_t)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(uint64_t)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(int32_t)
+EXPLICITLY_INSTANTIATE_QUANTIZED_HOST_KERNELS(int64_t)
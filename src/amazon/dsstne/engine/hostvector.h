@@ -0,0 +1,426 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+
+#ifndef HOSTVECTOR_H
+#define HOSTVECTOR_H
+
+// Vector operations, math and indexing shared by the host kernel translation units (hostkernels.cpp,
+// hostactivation.cpp, hostloss.cpp, hostoptimizer.cpp and hostquantize.cpp), included after <cmath>, <cstring>,
+// <immintrin.h> and NNTypes.h.
+//
+// Each instruction set below provides the same small set of vector operations, so every kernel is written once
+// as a template over it.  The template is instantiated in a function compiled for that instruction set whose
+// flatten attribute inlines all the operations into it, and the trailing elements of a buffer go through the
+// scalar instantiation of the same code.
+
+// The templates take vectors by reference and return them by value, which only changes the ABI of functions
+// that are inlined once flattened
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Example (row of the data set) processed by the ith row of a batch
+static inline uint32_t hExample(uint32_t position, uint32_t i, uint32_t* pIndex, uint32_t* pShuffleIndex)
+{
+    uint32_t example                    = (pShuffleIndex != NULL) ? pShuffleIndex[position + i] : position + i;
+    return (pIndex != NULL) ? pIndex[example] : example;
+}
+
+// Sparse analog values, normalized like the 8-bit specializations of kCalculateSparseAnalogZ
+template<typename T> static inline NNFloat hSparseValue(T v)    { return (NNFloat)v; }
+template<> inline NNFloat hSparseValue(unsigned char v)         { return (NNFloat)v * (NNFloat)(1.0 / 256.0); }
+template<> inline NNFloat hSparseValue(char v)                  { return (NNFloat)v * (NNFloat)(1.0 / 128.0); }
+
+struct HostVectorScalar
+{
+    typedef NNFloat V;
+    typedef bool M;
+    static const uint32_t W = 1;
+
+    static inline V load(const NNFloat* p)              { return *p; }
+    static inline void store(NNFloat* p, V a)           { *p = a; }
+    static inline V set1(NNFloat a)                     { return a; }
+    static inline V add(V a, V b)                       { return a + b; }
+    static inline V sub(V a, V b)                       { return a - b; }
+    static inline V mul(V a, V b)                       { return a * b; }
+    static inline V div(V a, V b)                       { return a / b; }
+    static inline V sqrt(V a)                           { return sqrtf(a); }
+    static inline V fmadd(V a, V b, V c)                { return a * b + c; }
+    static inline V max(V a, V b)                       { return (a > b) ? a : b; }
+    static inline V min(V a, V b)                       { return (a < b) ? a : b; }
+    static inline V abs(V a)                            { return fabsf(a); }
+    static inline V floor(V a)                          { return floorf(a); }
+    static inline M lt(V a, V b)                        { return a < b; }
+    static inline M gt(V a, V b)                        { return a > b; }
+    static inline M eq(V a, V b)                        { return a == b; }
+    static inline V select(M m, V a, V b)               { return m ? a : b; }
+    static inline NNFloat hmax(V a)                     { return a; }
+    static inline NNFloat hsum(V a)                     { return a; }
+
+    // 2^n for integral n in [-126, 127]
+    static inline V pow2(V n)
+    {
+        int32_t bits                    = ((int32_t)n + 127) << 23;
+        NNFloat a;
+        memcpy(&a, &bits, sizeof(a));
+        return a;
+    }
+
+    // a = m * 2^e with m in [0.5, 1) for normal positive a, returns e and sets m
+    static inline V frexp(V a, V* m)
+    {
+        int32_t bits;
+        memcpy(&bits, &a, sizeof(bits));
+        int32_t e                       = ((bits >> 23) & 0xff) - 126;
+        bits                            = (bits & 0x807fffff) | 0x3f000000;
+        memcpy(m, &bits, sizeof(bits));
+        return (V)e;
+    }
+};
+
+struct HostVectorAVX2
+{
+    typedef __m256 V;
+    typedef __m256 M;
+    static const uint32_t W = 8;
+
+#define HOST_AVX2 __attribute__((target("avx2,fma")))
+    HOST_AVX2 static inline V load(const NNFloat* p)    { return _mm256_loadu_ps(p); }
+    HOST_AVX2 static inline void store(NNFloat* p, V a) { _mm256_storeu_ps(p, a); }
+    HOST_AVX2 static inline V set1(NNFloat a)           { return _mm256_set1_ps(a); }
+    HOST_AVX2 static inline V add(V a, V b)             { return _mm256_add_ps(a, b); }
+    HOST_AVX2 static inline V sub(V a, V b)             { return _mm256_sub_ps(a, b); }
+    HOST_AVX2 static inline V mul(V a, V b)             { return _mm256_mul_ps(a, b); }
+    HOST_AVX2 static inline V div(V a, V b)             { return _mm256_div_ps(a, b); }
+    HOST_AVX2 static inline V sqrt(V a)                 { return _mm256_sqrt_ps(a); }
+    HOST_AVX2 static inline V fmadd(V a, V b, V c)      { return _mm256_fmadd_ps(a, b, c); }
+    HOST_AVX2 static inline V max(V a, V b)             { return _mm256_max_ps(a, b); }
+    HOST_AVX2 static inline V min(V a, V b)             { return _mm256_min_ps(a, b); }
+    HOST_AVX2 static inline V abs(V a)                  { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    HOST_AVX2 static inline V floor(V a)                { return _mm256_floor_ps(a); }
+    HOST_AVX2 static inline M lt(V a, V b)              { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    HOST_AVX2 static inline M gt(V a, V b)              { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    HOST_AVX2 static inline M eq(V a, V b)              { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    HOST_AVX2 static inline V select(M m, V a, V b)     { return _mm256_blendv_ps(b, a, m); }
+
+    HOST_AVX2 static inline NNFloat hmax(V a)
+    {
+        __m128 b                        = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        b                               = _mm_max_ps(b, _mm_movehl_ps(b, b));
+        b                               = _mm_max_ss(b, _mm_movehdup_ps(b));
+        return _mm_cvtss_f32(b);
+    }
+
+    HOST_AVX2 static inline NNFloat hsum(V a)
+    {
+        __m128 b                        = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        b                               = _mm_add_ps(b, _mm_movehl_ps(b, b));
+        b                               = _mm_add_ss(b, _mm_movehdup_ps(b));
+        return _mm_cvtss_f32(b);
+    }
+
+    HOST_AVX2 static inline V pow2(V n)
+    {
+        __m256i bits                    = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return _mm256_castsi256_ps(bits);
+    }
+
+    HOST_AVX2 static inline V frexp(V a, V* m)
+    {
+        __m256i bits                    = _mm256_castps_si256(a);
+        __m256i e                       = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff)), _mm256_set1_epi32(126));
+        bits                            = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)), _mm256_set1_epi32(0x3f000000));
+        *m                              = _mm256_castsi256_ps(bits);
+        return _mm256_cvtepi32_ps(e);
+    }
+#undef HOST_AVX2
+};
+
+struct HostVectorAVX512
+{
+    typedef __m512 V;
+    typedef __mmask16 M;
+    static const uint32_t W = 16;
+
+#define HOST_AVX512 __attribute__((target("avx512f")))
+    HOST_AVX512 static inline V load(const NNFloat* p)      { return _mm512_loadu_ps(p); }
+    HOST_AVX512 static inline void store(NNFloat* p, V a)   { _mm512_storeu_ps(p, a); }
+    HOST_AVX512 static inline V set1(NNFloat a)             { return _mm512_set1_ps(a); }
+    HOST_AVX512 static inline V add(V a, V b)               { return _mm512_add_ps(a, b); }
+    HOST_AVX512 static inline V sub(V a, V b)               { return _mm512_sub_ps(a, b); }
+    HOST_AVX512 static inline V mul(V a, V b)               { return _mm512_mul_ps(a, b); }
+    HOST_AVX512 static inline V div(V a, V b)               { return _mm512_div_ps(a, b); }
+    HOST_AVX512 static inline V sqrt(V a)                   { return _mm512_sqrt_ps(a); }
+    HOST_AVX512 static inline V fmadd(V a, V b, V c)        { return _mm512_fmadd_ps(a, b, c); }
+    HOST_AVX512 static inline V max(V a, V b)               { return _mm512_max_ps(a, b); }
+    HOST_AVX512 static inline V min(V a, V b)               { return _mm512_min_ps(a, b); }
+    HOST_AVX512 static inline V abs(V a)                    { return _mm512_abs_ps(a); }
+    HOST_AVX512 static inline V floor(V a)                  { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    HOST_AVX512 static inline M lt(V a, V b)                { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    HOST_AVX512 static inline M gt(V a, V b)                { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    HOST_AVX512 static inline M eq(V a, V b)                { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    HOST_AVX512 static inline V select(M m, V a, V b)       { return _mm512_mask_blend_ps(m, b, a); }
+    HOST_AVX512 static inline NNFloat hmax(V a)             { return _mm512_reduce_max_ps(a); }
+    HOST_AVX512 static inline NNFloat hsum(V a)             { return _mm512_reduce_add_ps(a); }
+
+    HOST_AVX512 static inline V pow2(V n)
+    {
+        __m512i bits                    = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+        return _mm512_castsi512_ps(bits);
+    }
+
+    HOST_AVX512 static inline V frexp(V a, V* m)
+    {
+        __m512i bits                    = _mm512_castps_si512(a);
+        __m512i e                       = _mm512_sub_epi32(_mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff)), _mm512_set1_epi32(126));
+        bits                            = _mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)), _mm512_set1_epi32(0x3f000000));
+        *m                              = _mm512_castsi512_ps(bits);
+        return _mm512_cvtepi32_ps(e);
+    }
+#undef HOST_AVX512
+};
+
+// -1, 0 or 1 like sgn in kernels.h
+template<typename S> static inline typename S::V hSign(const typename S::V& x)
+{
+    typedef typename S::V V;
+    V zero                              = S::set1(0.0f);
+    return S::select(S::gt(x, zero), S::set1(1.0f), S::select(S::lt(x, zero), S::set1(-1.0f), zero));
+}
+
+// exp(x) - 1 = 2^n * (1 + p) - 1 and exp(x) = 2^n * (1 + p) with Cephes' expf range reduction and polynomial:
+// x = n * ln(2) + r with |r| <= ln(2) / 2 and p = r + r^2 * P(r).  Inputs are clamped to [-87.3, 88.3] so
+// 2^n stays a normal float.  For |x| < ln(2) / 2, n is 0 and exp(x) - 1 is p itself without cancellation.
+template<typename S> static inline typename S::V hExpm1Parts(const typename S::V& x0, typename S::V* pScale)
+{
+    typedef typename S::V V;
+    V x                                 = S::min(S::max(x0, S::set1(-87.3f)), S::set1(88.3f));
+    V n                                 = S::floor(S::fmadd(x, S::set1(1.44269504088896341f), S::set1(0.5f)));
+    V r                                 = S::fmadd(n, S::set1(-0.693359375f), x);
+    r                                   = S::fmadd(n, S::set1(2.12194440e-4f), r);
+    V p                                 = S::set1(1.9875691500E-4f);
+    p                                   = S::fmadd(p, r, S::set1(1.3981999507E-3f));
+    p                                   = S::fmadd(p, r, S::set1(8.3334519073E-3f));
+    p                                   = S::fmadd(p, r, S::set1(4.1665795894E-2f));
+    p                                   = S::fmadd(p, r, S::set1(1.6666665459E-1f));
+    p                                   = S::fmadd(p, r, S::set1(5.0000001201E-1f));
+    p                                   = S::fmadd(p, S::mul(r, r), r);
+    *pScale                             = S::pow2(n);
+    return p;
+}
+
+template<typename S> static inline typename S::V hExp(const typename S::V& x)
+{
+    typename S::V scale;
+    typename S::V p                     = hExpm1Parts<S>(x, &scale);
+    return S::fmadd(p, scale, scale);
+}
+
+template<typename S> static inline typename S::V hExpm1(const typename S::V& x)
+{
+    typename S::V scale;
+    typename S::V p                     = hExpm1Parts<S>(x, &scale);
+    typename S::V one                   = S::set1(1.0f);
+    return S::select(S::eq(scale, one), p, S::sub(S::fmadd(p, scale, scale), one));
+}
+
+// log(x) for normal x > 0 with Cephes' logf: x = m * 2^e with m in [sqrt(0.5), sqrt(2)) and a polynomial in m - 1
+template<typename S> static inline typename S::V hLog(const typename S::V& x)
+{
+    typedef typename S::V V;
+    V m;
+    V e                                 = S::frexp(x, &m);
+    typename S::M small                 = S::lt(m, S::set1(0.707106781186547524f));
+    e                                   = S::select(small, S::sub(e, S::set1(1.0f)), e);
+    m                                   = S::sub(S::select(small, S::add(m, m), m), S::set1(1.0f));
+    V z                                 = S::mul(m, m);
+    V p                                 = S::set1(7.0376836292E-2f);
+    p                                   = S::fmadd(p, m, S::set1(-1.1514610310E-1f));
+    p                                   = S::fmadd(p, m, S::set1(1.1676998740E-1f));
+    p                                   = S::fmadd(p, m, S::set1(-1.2420140846E-1f));
+    p                                   = S::fmadd(p, m, S::set1(1.4249322787E-1f));
+    p                                   = S::fmadd(p, m, S::set1(-1.6668057665E-1f));
+    p                                   = S::fmadd(p, m, S::set1(2.0000714765E-1f));
+    p                                   = S::fmadd(p, m, S::set1(-2.4999993993E-1f));
+    p                                   = S::fmadd(p, m, S::set1(3.3333331174E-1f));
+    V y                                 = S::mul(S::mul(p, z), m);
+    y                                   = S::fmadd(e, S::set1(-2.12194440e-4f), y);
+    y                                   = S::fmadd(z, S::set1(-0.5f), y);
+    return S::fmadd(e, S::set1(0.693359375f), S::add(m, y));
+}
+
+// log(1 + x) for x >= 0, keeping the relative accuracy of small x: log(u) * x / (u - 1) with u = 1 + x rounded
+template<typename S> static inline typename S::V hLog1p(const typename S::V& x)
+{
+    typedef typename S::V V;
+    V u                                 = S::add(x, S::set1(1.0f));
+    V d                                 = S::sub(u, S::set1(1.0f));
+    typename S::M exact                 = S::eq(d, S::set1(0.0f));
+    V ratio                             = S::div(x, S::select(exact, S::set1(1.0f), d));
+    return S::select(exact, x, S::mul(hLog<S>(u), ratio));
+}
+
+// tanh(x) with Cephes' tanhf: an odd polynomial below 0.625, 1 - 2 / (exp(2|x|) + 1) with the sign of x above
+template<typename S> static inline typename S::V hTanh(const typename S::V& x)
+{
+    typedef typename S::V V;
+    V a                                 = S::abs(x);
+    V z                                 = S::mul(x, x);
+    V p                                 = S::set1(-5.70498872745E-3f);
+    p                                   = S::fmadd(p, z, S::set1(2.06390887954E-2f));
+    p                                   = S::fmadd(p, z, S::set1(-5.37397155531E-2f));
+    p                                   = S::fmadd(p, z, S::set1(1.33314422036E-1f));
+    p                                   = S::fmadd(p, z, S::set1(-3.33332819422E-1f));
+    V small                             = S::fmadd(S::mul(p, z), x, x);
+    V large                             = S::sub(S::set1(1.0f), S::div(S::set1(2.0f), S::add(hExp<S>(S::add(a, a)), S::set1(1.0f))));
+    large                               = S::select(S::lt(x, S::set1(0.0f)), S::sub(S::set1(0.0f), large), large);
+    return S::select(S::lt(a, S::set1(0.625f)), small, large);
+}
+
+// Activation parameters, named as in NNLayer
+struct HostActivationParameters
+{
+    NNFloat                             _slope;                 // Leaky and parametric RELU slope
+    NNFloat                             _alpha;                 // ELU and SELU alpha
+    NNFloat                             _lambda;                // SELU lambda
+    NNFloat                             _scale;                 // Dropout scale of the Tanh derivative
+};
+
+// Each activation provides forward(x) and derivative(y, delta), the incoming delta times the derivative expressed
+// in terms of the activation's output y, as kCalculateHadamardProduct computes it
+template<typename S> struct HostSigmoid
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return S::div(S::set1(1.0f), S::add(S::set1(1.0f), hExp<S>(S::sub(S::set1(0.0f), x))));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        return S::mul(S::mul(y, S::sub(S::set1(1.0f), y)), d);
+    }
+};
+
+template<typename S> struct HostTanh
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return hTanh<S>(x);
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        V x                             = S::div(y, S::set1(a._scale));
+        return S::mul(S::mul(S::set1(a._scale), S::sub(S::set1(1.0f), S::mul(x, x))), d);
+    }
+};
+
+template<typename S> struct HostLinear
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)                 { return x; }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)         { return d; }
+};
+
+template<typename S> struct HostRELU
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return S::max(x, S::set1(0.0f));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        return S::select(S::gt(y, S::set1(0.0f)), d, S::set1(0.0f));
+    }
+};
+
+template<typename S> struct HostLRELU
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return S::max(x, S::mul(x, S::set1(a._slope)));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        return S::select(S::gt(y, S::set1(0.0f)), d, S::mul(d, S::set1(a._slope)));
+    }
+};
+
+template<typename S> struct HostELU
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return S::select(S::gt(x, S::set1(0.0f)), x, S::mul(S::set1(a._alpha), hExpm1<S>(x)));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        return S::select(S::gt(y, S::set1(0.0f)), d, S::mul(d, S::add(y, S::set1(a._alpha))));
+    }
+};
+
+template<typename S> struct HostSELU
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        V negative                      = S::mul(S::set1(a._lambda * a._alpha), hExpm1<S>(x));
+        return S::select(S::gt(x, S::set1(0.0f)), S::mul(S::set1(a._lambda), x), negative);
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        V negative                      = S::mul(d, S::add(y, S::set1(a._lambda * a._alpha)));
+        return S::select(S::gt(y, S::set1(0.0f)), S::mul(d, S::set1(a._lambda)), negative);
+    }
+};
+
+// log(1 + exp(x)) = max(x, 0) + log(1 + exp(-|x|)), and its derivative sigmoid(x) = 1 - exp(-y)
+template<typename S> struct HostSoftPlus
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        V t                             = hExp<S>(S::sub(S::set1(0.0f), S::abs(x)));
+        return S::add(S::max(x, S::set1(0.0f)), hLog1p<S>(t));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        return S::mul(S::sub(S::set1(0.0f), hExpm1<S>(S::sub(S::set1(0.0f), y))), d);
+    }
+};
+
+// x / (1 + |x|), and its derivative 1 / (1 + |x|)^2 = (1 - |y|)^2
+template<typename S> struct HostSoftSign
+{
+    typedef typename S::V V;
+    static inline V forward(const V& x, const HostActivationParameters& a)
+    {
+        return S::div(x, S::add(S::set1(1.0f), S::abs(x)));
+    }
+    static inline V derivative(const V& y, const V& d, const HostActivationParameters& a)
+    {
+        V s                             = S::sub(S::set1(1.0f), S::abs(y));
+        return S::mul(S::mul(s, s), d);
+    }
+};
+
+static inline HostActivationParameters hActivationParameters(NNFloat slope, NNFloat alpha, NNFloat lambda, NNFloat scale)
+{
+    HostActivationParameters a;
+    a._slope                            = slope;
+    a._alpha                            = alpha;
+    a._lambda                           = lambda;
+    a._scale                            = scale;
+    return a;
+}
+
+#endif
@@ -15,31 +15,167 @@
  *
  */
 
-#include <exception>
-#include <fstream>
-#include <string>
-#include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cuda_fp16.h>
+#include <fcntl.h>
+#include <omp.h>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "DataReader.h"
 
 namespace
 {
-static const int success = 0;
-static const int failure = 1;
+// lower bound on the bytes per parse chunk, smaller files use fewer chunks
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+// chunks per thread, more chunks than threads balances uneven line lengths
+static const int CHUNKS_PER_THREAD = 4;
+// significant decimal digits that fit in the uint64_t mantissa
+static const int MAX_MANTISSA_DIGITS = 19;
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+    1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static const char BINARY_DATA_MAGIC[8] = { 'D', 'S', 'S', 'T', 'K', 'N', 'N', 'V' };
+static const uint32_t BINARY_DATA_VERSION = 1;
+static const size_t BINARY_DATA_ALIGNMENT = 64;
+
+size_t getBinaryElementSize(BinaryDataType dataType)
+{
+  return dataType == BinaryDataType::FP16 ? sizeof(half) : sizeof(float);
+}
 
-int splitKeyVector(const std::string &line, std::string &key, std::string &vector, char keyValueDelimiter)
+size_t alignUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/**
+ * Parses [begin, end) as a float with strtof (for inf, nan, hex, ...).
+ */
+bool parseFloatSlow(const char *begin, const char *end, float *value)
 {
-  int keyValDelimIndex = line.find_first_of(keyValueDelimiter);
+  char buffer[64];
+  size_t length = end - begin;
+  if (length == 0 || length >= sizeof(buffer))
+  {
+    return false;
+  }
+  memcpy(buffer, begin, length);
+  buffer[length] = '\0';
+  char *parsedEnd;
+  *value = strtof(buffer, &parsedEnd);
+  return parsedEnd == buffer + length;
+}
+
+/**
+ * Parses the token that starts at begin and ends at the next delimiter (or end) as a
+ * float, without allocating, and returns the end of the token or nullptr if the token
+ * is not a number. Decimals ([+-]digits[.digits][(e|E)[+-]digits]) are parsed in the
+ * same scan that finds the end of the token: the mantissa is accumulated in an integer
+ * and scaled once in double precision. Other formats (inf, nan, hex) fall back to strtof.
+ */
+const char *parseFloat(const char *begin, const char *end, char delimiter, float *value)
+{
+  const char *p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+  {
+    negative = *p == '-';
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int mantissaDigits = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+
+  for (; p < end && isDigit(*p); ++p)
+  {
+    hasDigits = true;
+    if (mantissaDigits < MAX_MANTISSA_DIGITS)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      mantissaDigits += mantissa != 0;
+    } else
+    {
+      ++exponent;
+    }
+  }
 
-  if (keyValDelimIndex == std::string::npos)
+  if (p < end && *p == '.')
   {
-    return failure;
+    ++p;
+    for (; p < end && isDigit(*p); ++p)
+    {
+      hasDigits = true;
+      if (mantissaDigits < MAX_MANTISSA_DIGITS)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        mantissaDigits += mantissa != 0;
+        --exponent;
+      }
+    }
   }
 
-  key = line.substr(0, keyValDelimIndex);
-  vector = line.substr(keyValDelimIndex + 1, line.size());
-  return success;
+  bool valid = hasDigits;
+  if (valid && p < end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+      negativeExponent = *p == '-';
+      ++p;
+    }
+    valid = p < end && isDigit(*p);
+    int explicitExponent = 0;
+    for (; p < end && isDigit(*p); ++p)
+    {
+      // saturate, anything this large over/underflows a float anyway
+      explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 100000);
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if (!valid || (p < end && *p != delimiter))
+  {
+    // not a plain decimal, or not a number
+    const char *tokenEnd = (const char*) memchr(p, delimiter, end - p);
+    tokenEnd = tokenEnd == nullptr ? end : tokenEnd;
+    return parseFloatSlow(begin, tokenEnd, value) ? tokenEnd : nullptr;
+  }
+
+  double result = (double) mantissa;
+  if (mantissa != 0 && exponent != 0)
+  {
+    if (exponent > 0 && exponent <= 22)
+    {
+      result *= POW10[exponent];
+    } else if (exponent < 0 && exponent >= -22)
+    {
+      result /= POW10[-exponent];
+    } else
+    {
+      result *= std::pow(10.0, exponent);
+    }
+  }
+  *value = (float) (negative ? -result : result);
+  return p;
 }
 }
 
@@ -53,114 +189,489 @@ int DataReader::getColumns() const
   return columns;
 }
 
+bool DataReader::appendRow(astdl::knn::KeyArena *keys, float *vector)
+{
+  if (!readRow(&rowKey, vector))
+  {
+    return false;
+  }
+  keys->append(rowKey);
+  return true;
+}
+
 TextFileDataReader::TextFileDataReader(const std::string &fileName, char keyValueDelimiter, char vectorDelimiter) :
     fileName(fileName),
-    fileStream(fileName, std::ios_base::in),
     keyValueDelimiter(keyValueDelimiter),
-    vectorDelimiter(vectorDelimiter)
+    vectorDelimiter(vectorDelimiter),
+    mappedData(nullptr),
+    mappedSize(0),
+    currentChunk(0),
+    currentRow(0),
+    keySize(0)
 {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::stringstream msg;
+    msg << "Unable to open file: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
 
-  findDataDimensions(fileName, rows, columns, keyValueDelimiter, vectorDelimiter);
-}
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0)
+  {
+    close(fd);
+    std::stringstream msg;
+    msg << "Unable to stat file: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
 
-void TextFileDataReader::findDataDimensions(const std::string &fileName, uint32_t &rows, int &columns,
-    char keyValueDelimiter, char vectorDelimiter)
-{
-  std::fstream fs(fileName, std::ios_base::in);
+  mappedSize = fileStat.st_size;
+  if (mappedSize > 0)
+  {
+    void *mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      close(fd);
+      std::stringstream msg;
+      msg << "Unable to mmap file: " << fileName;
+      throw std::runtime_error(msg.str());
+    }
+    madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+    mappedData = (const char*) mapped;
+  }
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
 
-  rows = 0;
-  columns = 0;
+  try
+  {
+    parse();
+  } catch (...)
+  {
+    if (mappedData != nullptr)
+    {
+      munmap((void*) mappedData, mappedSize);
+    }
+    throw;
+  }
+}
 
-  std::string line;
-  while (std::getline(fs, line))
+void TextFileDataReader::parseChunk(const char *begin, const char *end, Chunk &chunk) const
+{
+  const char *line = begin;
+  while (line < end && !chunk.failed)
   {
-    if (line.length() == 0)
+    const char *lineEnd = (const char*) memchr(line, '\n', end - line);
+    if (lineEnd == nullptr)
+    {
+      lineEnd = end;
+    }
+    const char *next = lineEnd + 1;
+    if (lineEnd > line && lineEnd[-1] == '\r')
+    {
+      --lineEnd;
+    }
+
+    if (lineEnd == line)
     {
       // skip empty lines
+      line = next;
       continue;
     }
 
-    ++rows;
-
-    std::string key;
-    std::string vectorStr;
-
-    if (splitKeyVector(line, key, vectorStr, keyValueDelimiter))
+    const char *keyEnd = (const char*) memchr(line, keyValueDelimiter, lineEnd - line);
+    if (keyEnd == nullptr)
     {
       std::stringstream msg;
-      msg << "In file: " << fileName << "#" << rows << ". Malformed line. key-value delimiter [" << keyValueDelimiter
-          << "] not found in: " << line;
-      throw std::invalid_argument(msg.str());
+      msg << "Malformed line. key-value delimiter [" << keyValueDelimiter << "] not found in: "
+          << std::string(line, lineEnd);
+      chunk.failed = true;
+      chunk.failedRow = chunk.rows + 1;
+      chunk.error = msg.str();
+      break;
     }
 
-    std::stringstream vectorStrStream(vectorStr);
-    std::string elementStr;
     int columnsInRow = 0;
-    while (std::getline(vectorStrStream, elementStr, vectorDelimiter))
+    const char *element = keyEnd + 1;
+    while (element < lineEnd)
     {
+      float value;
+      const char *elementEnd = parseFloat(element, lineEnd, vectorDelimiter, &value);
+      if (elementEnd == nullptr)
+      {
+        const char *tokenEnd = (const char*) memchr(element, vectorDelimiter, lineEnd - element);
+        std::stringstream msg;
+        msg << std::string(element, tokenEnd == nullptr ? lineEnd : tokenEnd) << " cannot be parsed as float. Column "
+            << columnsInRow << " of: " << std::string(line, lineEnd);
+        chunk.failed = true;
+        chunk.failedRow = chunk.rows + 1;
+        chunk.error = msg.str();
+        break;
+      }
+      chunk.values.push_back(value);
       ++columnsInRow;
+      element = elementEnd + 1;
+    }
+    if (chunk.failed)
+    {
+      break;
     }
 
     // check all rows have same nColumns
-    if (columns == 0)
+    if (chunk.columns == -1)
     {
-      columns = columnsInRow;
-    } else
+      chunk.columns = columnsInRow;
+    } else if (chunk.columns != columnsInRow)
+    {
+      std::stringstream msg;
+      msg << "Inconsistent num columns detected. Expected : " << chunk.columns << " Actual: " << columnsInRow;
+      chunk.failed = true;
+      chunk.failedRow = chunk.rows + 1;
+      chunk.error = msg.str();
+      break;
+    }
+
+    chunk.keys.push_back(std::make_pair((size_t) (line - mappedData), (uint32_t) (keyEnd - line)));
+    chunk.keySize += keyEnd - line;
+    ++chunk.rows;
+    line = next;
+  }
+}
+
+void TextFileDataReader::parse()
+{
+  const char *end = mappedData + mappedSize;
+
+  size_t numChunks = std::max((size_t) 1,
+      std::min((size_t) omp_get_max_threads() * CHUNKS_PER_THREAD, mappedSize / MIN_CHUNK_SIZE));
+
+  // chunk i starts at the first line that starts at or after i * mappedSize / numChunks
+  std::vector<const char*> boundaries(numChunks + 1, end);
+  boundaries[0] = mappedData;
+  for (size_t i = 1; i < numChunks; ++i)
+  {
+    const char *start = std::max(mappedData + i * (mappedSize / numChunks), boundaries[i - 1]);
+    const char *newline = start > mappedData ? (const char*) memchr(start - 1, '\n', end - start + 1) : start - 1;
+    boundaries[i] = newline == nullptr ? end : newline + 1;
+  }
+
+  chunks.resize(numChunks);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < numChunks; ++i)
+  {
+    parseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+  }
+
+  rows = 0;
+  columns = 0;
+  bool columnsKnown = false;
+  for (const Chunk &chunk : chunks)
+  {
+    if (chunk.failed)
+    {
+      std::stringstream msg;
+      msg << "In file: " << fileName << "#" << rows + chunk.failedRow << ". " << chunk.error;
+      throw std::invalid_argument(msg.str());
+    }
+
+    if (chunk.rows > 0)
     {
-      if (columns != columnsInRow)
+      if (!columnsKnown)
+      {
+        columns = chunk.columns;
+        columnsKnown = true;
+      } else if (columns != chunk.columns)
       {
         std::stringstream msg;
-        msg << "In file: " << fileName << "#" << rows << ". Inconsistent num columns detected. Expected : " << columns
-            << " Actual: " << columnsInRow;
+        msg << "In file: " << fileName << "#" << rows + 1 << ". Inconsistent num columns detected. Expected : "
+            << columns << " Actual: " << chunk.columns;
         throw std::invalid_argument(msg.str());
       }
     }
+    rows += chunk.rows;
+    keySize += chunk.keySize;
   }
+}
 
-  fs.close();
+void TextFileDataReader::findDataDimensions(const std::string &fileName, uint32_t &rows, int &columns,
+    char keyValueDelimiter, char vectorDelimiter)
+{
+  TextFileDataReader reader(fileName, keyValueDelimiter, vectorDelimiter);
+  rows = reader.getRows();
+  columns = reader.getColumns();
+}
+
+const std::pair<size_t, uint32_t> *TextFileDataReader::nextRow(float *vector)
+{
+  while (currentChunk < chunks.size() && currentRow == chunks[currentChunk].rows)
+  {
+    // release the parsed values of a chunk once it has been read
+    std::vector<float>().swap(chunks[currentChunk].values);
+    std::vector<std::pair<size_t, uint32_t>>().swap(chunks[currentChunk].keys);
+    ++currentChunk;
+    currentRow = 0;
+  }
+
+  if (currentChunk == chunks.size())
+  {
+    return nullptr;
+  }
+
+  const Chunk &chunk = chunks[currentChunk];
+  std::copy_n(chunk.values.data() + (size_t) currentRow * columns, columns, vector);
+  return &chunk.keys[currentRow++];
 }
 
 bool TextFileDataReader::readRow(std::string *key, float *vector)
 {
-  std::string line;
-  if (std::getline(fileStream, line))
+  const std::pair<size_t, uint32_t> *keyRef = nextRow(vector);
+  if (keyRef == nullptr)
+  {
+    return false;
+  }
+  key->assign(mappedData + keyRef->first, keyRef->second);
+  return true;
+}
+
+bool TextFileDataReader::appendRow(astdl::knn::KeyArena *keys, float *vector)
+{
+  const std::pair<size_t, uint32_t> *keyRef = nextRow(vector);
+  if (keyRef == nullptr)
+  {
+    return false;
+  }
+  keys->append(mappedData + keyRef->first, keyRef->second);
+  return true;
+}
+
+TextFileDataReader::~TextFileDataReader()
+{
+  if (mappedData != nullptr)
   {
-    std::string vectorStr;
-    splitKeyVector(line, *key, vectorStr, keyValueDelimiter);
+    munmap((void*) mappedData, mappedSize);
+  }
+}
 
-    std::stringstream vectorStrStream(vectorStr);
-    std::string elementStr;
-    size_t idx;
+BinaryFileDataReader::BinaryFileDataReader(const std::string &fileName) :
+    fileName(fileName),
+    mappedData(nullptr),
+    mappedSize(0),
+    currentRow(0)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::stringstream msg;
+    msg << "Unable to open file: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
 
-    for (int i = 0; std::getline(vectorStrStream, elementStr, vectorDelimiter); ++i)
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < sizeof(BinaryDataHeader))
+  {
+    close(fd);
+    std::stringstream msg;
+    msg << "Not a binary data file (too small): " << fileName;
+    throw std::invalid_argument(msg.str());
+  }
+
+  mappedSize = fileStat.st_size;
+  // shared mapping: every process that reads the file uses the same page cache pages
+  void *mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    std::stringstream msg;
+    msg << "Unable to mmap file: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
+  madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+  mappedData = (const char*) mapped;
+
+  BinaryDataHeader header;
+  memcpy(&header, mappedData, sizeof(header));
+
+  std::stringstream msg;
+  if (memcmp(header.magic, BINARY_DATA_MAGIC, sizeof(header.magic)) != 0)
+  {
+    msg << "Not a binary data file (bad magic): " << fileName;
+  } else if (header.version != BINARY_DATA_VERSION)
+  {
+    msg << "Unsupported binary data file version " << header.version << ": " << fileName;
+  } else if (header.dataType != (uint32_t) BinaryDataType::FP32 && header.dataType != (uint32_t) BinaryDataType::FP16)
+  {
+    msg << "Unknown data type " << header.dataType << " in binary data file: " << fileName;
+  } else if (header.rows > UINT32_MAX || header.columns > INT32_MAX)
+  {
+    msg << "Too many rows or columns (" << header.rows << " x " << header.columns << ") in: " << fileName;
+  } else
+  {
+    dataType = (BinaryDataType) header.dataType;
+    rowSize = (size_t) header.columns * getBinaryElementSize(dataType);
+    if (header.matrixOffset + header.rows * rowSize > mappedSize
+        || header.keyOffsetsOffset + (header.rows + 1) * sizeof(uint64_t) > mappedSize
+        || header.keyArenaOffset + header.keyArenaSize > mappedSize || header.keyOffsetsOffset % sizeof(uint64_t) != 0)
     {
-      try
-      {
-        vector[i] = std::stof(elementStr, &idx);
-        if(idx != elementStr.size()) {
-            std::stringstream msg;
-            msg << "Malformed vector element: " << elementStr;
-            throw std::invalid_argument(msg.str());
-        }
-      } catch (const std::exception& e)
-      {
-        std::stringstream msg;
-        msg << "ERROR: " << elementStr << " cannot be parsed as float. Column " << i << " of: " << line;
-        fprintf(stderr, "ERROR: %s cannot be parsed as float. Column %d, line: %s\n", elementStr.c_str(), i,
-            line.c_str());
-        throw;
-      }
+      msg << "Truncated or corrupt binary data file: " << fileName;
     }
+  }
+
+  if (!msg.str().empty())
+  {
+    munmap(mapped, mappedSize);
+    throw std::invalid_argument(msg.str());
+  }
+
+  rows = header.rows;
+  columns = header.columns;
+  matrix = mappedData + header.matrixOffset;
+  keyOffsets = (const uint64_t*) (mappedData + header.keyOffsetsOffset);
+  keyArena = mappedData + header.keyArenaOffset;
 
-    return true;
+  if (keyOffsets[rows] > header.keyArenaSize)
+  {
+    munmap(mapped, mappedSize);
+    std::stringstream keysMsg;
+    keysMsg << "Truncated or corrupt binary data file (keys): " << fileName;
+    throw std::invalid_argument(keysMsg.str());
+  }
+}
+
+bool BinaryFileDataReader::isBinaryDataFile(const std::string &fileName)
+{
+  char magic[sizeof(BINARY_DATA_MAGIC)];
+  FILE *fp = fopen(fileName.c_str(), "rb");
+  if (fp == nullptr)
+  {
+    return false;
+  }
+  bool isBinary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic)
+      && memcmp(magic, BINARY_DATA_MAGIC, sizeof(magic)) == 0;
+  fclose(fp);
+  return isBinary;
+}
+
+const void *BinaryFileDataReader::getRowData(uint32_t row) const
+{
+  return matrix + row * rowSize;
+}
+
+const char *BinaryFileDataReader::getKeyData(uint32_t row) const
+{
+  return keyArena + keyOffsets[row];
+}
+
+size_t BinaryFileDataReader::getKeyLength(uint32_t row) const
+{
+  return keyOffsets[row + 1] - keyOffsets[row];
+}
+
+void BinaryFileDataReader::copyRow(uint32_t row, float *vector) const
+{
+  const void *rowData = getRowData(row);
+  if (dataType == BinaryDataType::FP16)
+  {
+    const half *halfRow = (const half*) rowData;
+    for (int j = 0; j < columns; ++j)
+    {
+      vector[j] = __half2float(halfRow[j]);
+    }
   } else
+  {
+    memcpy(vector, rowData, rowSize);
+  }
+}
+
+bool BinaryFileDataReader::readRow(std::string *key, float *vector)
+{
+  if (currentRow >= rows)
+  {
+    return false;
+  }
+
+  key->assign(getKeyData(currentRow), getKeyLength(currentRow));
+  copyRow(currentRow, vector);
+  ++currentRow;
+  return true;
+}
+
+bool BinaryFileDataReader::appendRow(astdl::knn::KeyArena *keys, float *vector)
+{
+  if (currentRow >= rows)
   {
     return false;
   }
+
+  keys->append(keyArena, keyOffsets + currentRow, 1);
+  copyRow(currentRow, vector);
+  ++currentRow;
+  return true;
 }
 
-TextFileDataReader::~TextFileDataReader()
+BinaryFileDataReader::~BinaryFileDataReader()
 {
-  fileStream.close();
+  munmap((void*) mappedData, mappedSize);
 }
 
+void writeBinaryDataFile(DataReader *dataReader, const std::string &fileName, BinaryDataType dataType)
+{
+  FILE *fp = fopen(fileName.c_str(), "wb");
+  if (fp == nullptr)
+  {
+    std::stringstream msg;
+    msg << "Unable to open file for writing: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
+
+  int columns = dataReader->getColumns();
+  size_t elementSize = getBinaryElementSize(dataType);
+
+  BinaryDataHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BINARY_DATA_MAGIC, sizeof(header.magic));
+  header.version = BINARY_DATA_VERSION;
+  header.dataType = (uint32_t) dataType;
+  header.columns = columns;
+  header.matrixOffset = alignUp(sizeof(header), BINARY_DATA_ALIGNMENT);
+
+  // the matrix is streamed out, keys are collected and written after it
+  astdl::knn::KeyArena keys;
+  keys.reserve(dataReader->getRows(), dataReader->getKeySizeInBytes());
+  std::vector<float> vector(columns);
+  std::vector<half> halfVector(dataType == BinaryDataType::FP16 ? columns : 0);
+
+  bool ok = fseek(fp, header.matrixOffset, SEEK_SET) == 0;
+  while (ok && dataReader->appendRow(&keys, vector.data()))
+  {
+    if (dataType == BinaryDataType::FP16)
+    {
+      for (int j = 0; j < columns; ++j)
+      {
+        halfVector[j] = __float2half(vector[j]);
+      }
+      ok = fwrite(halfVector.data(), elementSize, columns, fp) == (size_t) columns;
+    } else
+    {
+      ok = fwrite(vector.data(), elementSize, columns, fp) == (size_t) columns;
+    }
+  }
+
+  header.rows = keys.size();
+  header.keyOffsetsOffset = alignUp(header.matrixOffset + header.rows * columns * elementSize, sizeof(uint64_t));
+  header.keyArenaOffset = header.keyOffsetsOffset + (header.rows + 1) * sizeof(uint64_t);
+  header.keyArenaSize = keys.getNumChars();
+
+  ok = ok && fseek(fp, header.keyOffsetsOffset, SEEK_SET) == 0;
+  ok = ok && fwrite(keys.getOffsets(), sizeof(uint64_t), header.rows + 1, fp) == header.rows + 1;
+  ok = ok && fwrite(keys.getChars(), 1, header.keyArenaSize, fp) == header.keyArenaSize;
+  ok = ok && fseek(fp, 0, SEEK_SET) == 0;
+  ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = (fclose(fp) == 0) && ok;
+
+  if (!ok)
+  {
+    std::stringstream msg;
+    msg << "Error writing binary data file: " << fileName;
+    throw std::runtime_error(msg.str());
+  }
+}
@@ -18,7 +18,12 @@
 #ifndef LIBKNN_DATAREADER_H_
 #define LIBKNN_DATAREADER_H_
 
-#include <fstream>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KeyArena.h"
 
 class DataReader
 {
@@ -30,6 +35,20 @@ class DataReader
      */
     virtual bool readRow(std::string *key, float *vector) = 0;
 
+    /**
+     * Reads the next row, appending its key to keys. Readers that already hold
+     * their keys in memory append them without going through a std::string.
+     */
+    virtual bool appendRow(astdl::knn::KeyArena *keys, float *vector);
+
+    /**
+     * Total bytes of the keys of all rows, used to size a KeyArena up front. 0 if unknown.
+     */
+    virtual size_t getKeySizeInBytes() const
+    {
+        return 0;
+    }
+
     uint32_t getRows() const;
 
     int getColumns() const;
@@ -41,8 +60,20 @@ class DataReader
   protected:
     uint32_t rows;
     int columns;
+
+  private:
+    std::string rowKey;
 };
 
+/**
+ * Reads "key<keyValueDelimiter>v1<vectorDelimiter>v2..." lines, empty lines are skipped.
+ *
+ * The file is memory mapped and parsed once, at construction: it is split into
+ * line aligned chunks which are parsed in parallel (OpenMP) with a non-allocating
+ * float parser while the number of rows and columns is discovered. readRow then
+ * copies the parsed rows out in file order. The parsed values (rows x columns floats)
+ * are held until the reader is destroyed.
+ */
 class TextFileDataReader: public DataReader
 {
 
@@ -51,16 +82,152 @@ class TextFileDataReader: public DataReader
 
     bool readRow(std::string *key, float *vector);
 
+    bool appendRow(astdl::knn::KeyArena *keys, float *vector);
+
+    size_t getKeySizeInBytes() const
+    {
+        return keySize;
+    }
+
     static void findDataDimensions(const std::string &fileName, uint32_t &rows, int &columns, char keyValueDelimiter =
         '\t', char vectorDelimiter = ' ');
 
     ~TextFileDataReader();
 
   private:
+    /*
+     * rows parsed from one line aligned chunk of the file
+     */
+    struct Chunk
+    {
+        std::vector<float> values; // row major
+        std::vector<std::pair<size_t, uint32_t>> keys; // (offset, length) into the mapped file
+        size_t keySize = 0; // sum of the key lengths
+        uint32_t rows = 0;
+        int columns = -1;
+
+        // first error in the chunk, reported with the row number relative to the chunk
+        bool failed = false;
+        uint32_t failedRow = 0;
+        std::string error;
+    };
+
     std::string fileName;
-    std::fstream fileStream;
     char keyValueDelimiter;
     char vectorDelimiter;
+
+    const char *mappedData;
+    size_t mappedSize;
+
+    std::vector<Chunk> chunks;
+    size_t currentChunk;
+    uint32_t currentRow;
+    size_t keySize;
+
+    void parse();
+
+    /**
+     * Copies the next row's vector out and returns its key, nullptr after the last row.
+     */
+    const std::pair<size_t, uint32_t> *nextRow(float *vector);
+
+    void parseChunk(const char *begin, const char *end, Chunk &chunk) const;
+};
+
+/**
+ * Element type of the matrix in a binary data file.
+ */
+enum class BinaryDataType : uint32_t
+{
+  FP32 = 0, FP16 = 1
+};
+
+/**
+ * Binary data file layout, all values little endian:
+ *
+ *   BinaryDataHeader (64 bytes)
+ *   matrix            rows x columns elements of dataType, row major, starts at matrixOffset (64 byte aligned)
+ *   key offsets       rows + 1 uint64_t, key i is arena[offsets[i], offsets[i + 1])
+ *   key arena         concatenated key bytes
+ */
+struct BinaryDataHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t dataType;
+    uint64_t rows;
+    uint32_t columns;
+    uint32_t reserved;
+    uint64_t matrixOffset;
+    uint64_t keyOffsetsOffset;
+    uint64_t keyArenaOffset;
+    uint64_t keyArenaSize;
+};
+
+/**
+ * Reads a binary data file (see BinaryDataHeader) directly from a shared, read only
+ * mmap of the file: nothing is parsed, load time is bounded by disk bandwidth and
+ * processes reading the same file share the page cache. Besides readRow, rows and
+ * keys can be accessed in place by index.
+ */
+class BinaryFileDataReader: public DataReader
+{
+
+  public:
+    BinaryFileDataReader(const std::string &fileName);
+
+    /**
+     * True if the file starts with the binary data file magic.
+     */
+    static bool isBinaryDataFile(const std::string &fileName);
+
+    bool readRow(std::string *key, float *vector);
+
+    bool appendRow(astdl::knn::KeyArena *keys, float *vector);
+
+    size_t getKeySizeInBytes() const
+    {
+        return keyOffsets[rows] - keyOffsets[0];
+    }
+
+    BinaryDataType getDataType() const
+    {
+        return dataType;
+    }
+
+    /**
+     * Row in place (columns elements of getDataType()).
+     */
+    const void *getRowData(uint32_t row) const;
+
+    const char *getKeyData(uint32_t row) const;
+
+    size_t getKeyLength(uint32_t row) const;
+
+    ~BinaryFileDataReader();
+
+  private:
+    std::string fileName;
+    const char *mappedData;
+    size_t mappedSize;
+    BinaryDataType dataType;
+    size_t rowSize;
+    const char *matrix;
+    const uint64_t *keyOffsets;
+    const char *keyArena;
+    uint32_t currentRow;
+
+    /**
+     * Copies the row's vector out, converting fp16 to fp32.
+     */
+    void copyRow(uint32_t row, float *vector) const;
 };
 
+/**
+ * Writes all remaining rows of the reader to fileName in the binary data file format,
+ * e.g. to convert a text file once so that later loads use BinaryFileDataReader.
+ */
+void writeBinaryDataFile(DataReader *dataReader, const std::string &fileName,
+    BinaryDataType dataType = BinaryDataType::FP32);
+
 #endif /* LIBKNN_DATAREADER_H_ */
@@ -0,0 +1,98 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "ExclusionSet.h"
+
+namespace astdl
+{
+namespace knn
+{
+
+ExclusionSet::ExclusionSet() :
+    isBitmask(false)
+{
+}
+
+ExclusionSet ExclusionSet::fromBitmasks(std::vector<std::vector<uint64_t>> bitmasks)
+{
+  ExclusionSet exclusions;
+  exclusions.isBitmask = true;
+  exclusions.bitmasks = std::move(bitmasks);
+  return exclusions;
+}
+
+ExclusionSet ExclusionSet::fromSortedIds(std::vector<uint64_t> ids)
+{
+  auto unsorted = std::is_sorted_until(ids.begin(), ids.end());
+  if (unsorted != ids.end())
+  {
+    std::stringstream msg;
+    msg << "ids must be sorted in ascending order, id " << *unsorted << " at position " << (unsorted - ids.begin())
+        << " is < " << *(unsorted - 1);
+    throw std::invalid_argument(msg.str());
+  }
+
+  ExclusionSet exclusions;
+  exclusions.ids = std::move(ids);
+  return exclusions;
+}
+
+bool ExclusionSet::containsId(uint64_t id) const
+{
+  return std::binary_search(ids.begin(), ids.end(), id);
+}
+
+void ExclusionSet::getRows(uint32_t partition, uint32_t numRows, std::vector<uint32_t> *rows) const
+{
+  rows->clear();
+  if (isBitmask)
+  {
+    if (partition >= bitmasks.size())
+    {
+      return;
+    }
+    const std::vector<uint64_t> &bitmask = bitmasks[partition];
+    size_t numWords = std::min(bitmask.size(), ((size_t) numRows + 63) / 64);
+    for (size_t w = 0; w < numWords; ++w)
+    {
+      for (uint64_t bits = bitmask[w]; bits != 0; bits &= bits - 1)
+      {
+        uint32_t row = w * 64 + __builtin_ctzll(bits);
+        if (row < numRows)
+        {
+          rows->push_back(row);
+        }
+      }
+    }
+  } else
+  {
+    auto first = std::lower_bound(ids.begin(), ids.end(), getId(partition, 0));
+    auto last = std::lower_bound(first, ids.end(), getId(partition, numRows));
+    for (auto id = first; id != last; ++id)
+    {
+      rows->push_back(*id & 0xFFFFFFFF);
+    }
+  }
+}
+
+} // namespace knn
+} // namespace astdl
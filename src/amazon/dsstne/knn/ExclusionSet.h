@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_EXCLUSION_SET_H_
+#define LIBKNN_EXCLUSION_SET_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * A set of data rows, identified by (partition, row) as returned by Knn::search,
+ * that a filtered search never returns. Either a bitmask per partition (cheap to
+ * test, for large sets) or a sorted list of ids (compact, for small sets).
+ *
+ *   // exclude row 7 of partition 0 and row 3 of partition 1
+ *   ExclusionSet excluded = ExclusionSet::fromSortedIds({ ExclusionSet::getId(0, 7), ExclusionSet::getId(1, 3) });
+ */
+class ExclusionSet
+{
+  public:
+    /**
+     * excludes nothing.
+     */
+    ExclusionSet();
+
+    /**
+     * row r of partition p is excluded iff bit r % 64 of bitmasks[p][r / 64] is set.
+     * rows past the end of a partition's bitmask (and partitions past the end of bitmasks) are not excluded.
+     */
+    static ExclusionSet fromBitmasks(std::vector<std::vector<uint64_t>> bitmasks);
+
+    /**
+     * excludes the rows with the given ids (see getId), which must be sorted in ascending order.
+     */
+    static ExclusionSet fromSortedIds(std::vector<uint64_t> ids);
+
+    static uint64_t getId(uint32_t partition, uint32_t row)
+    {
+        return ((uint64_t) partition << 32) | row;
+    }
+
+    bool contains(uint64_t id) const
+    {
+        if (isBitmask)
+        {
+            uint32_t partition = id >> 32;
+            uint32_t row = id & 0xFFFFFFFF;
+            return partition < bitmasks.size() && row / 64 < bitmasks[partition].size()
+                && ((bitmasks[partition][row / 64] >> (row % 64)) & 1);
+        }
+        return containsId(id);
+    }
+
+    bool contains(uint32_t partition, uint32_t row) const
+    {
+        return contains(getId(partition, row));
+    }
+
+    /**
+     * writes the excluded rows of partition that are < numRows to rows, in ascending order.
+     */
+    void getRows(uint32_t partition, uint32_t numRows, std::vector<uint32_t> *rows) const;
+
+  private:
+    bool isBitmask;
+    std::vector<std::vector<uint64_t>> bitmasks;
+    std::vector<uint64_t> ids;
+
+    bool containsId(uint64_t id) const;
+};
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_EXCLUSION_SET_H_ */
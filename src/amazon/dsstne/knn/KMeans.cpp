@@ -0,0 +1,144 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+extern "C"
+{
+#include <cblas.h>
+}
+
+#include "KMeans.h"
+
+namespace
+{
+// vectors per sgemm when assigning vectors to centroids
+static const size_t ASSIGN_BLOCK_SIZE = 4096;
+}  // namespace
+
+namespace astdl
+{
+namespace knn
+{
+
+void kmeansCentroidNorms(const float *centroids, int k, int columns, float *norms)
+{
+  for (int c = 0; c < k; ++c)
+  {
+    const float *centroid = centroids + (size_t) c * columns;
+    norms[c] = cblas_sdot(columns, centroid, 1, centroid, 1);
+  }
+}
+
+void kmeansAssign(const float *vectors, size_t n, int columns, const float *centroids, const float *centroidNorms, int k,
+    int *assignments)
+{
+#pragma omp parallel
+  {
+    std::vector<float> products(ASSIGN_BLOCK_SIZE * k);
+
+#pragma omp for schedule(dynamic)
+    for (size_t start = 0; start < n; start += ASSIGN_BLOCK_SIZE)
+    {
+      size_t count = std::min(ASSIGN_BLOCK_SIZE, n - start);
+
+      // products (count x k, row major) = vectors block x centroids^T
+      cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, count, k, columns, 1.0f, vectors + start * columns, columns,
+          centroids, columns, 0.0f, products.data(), k);
+
+      // argmin ||x - c||^2 == argmin ||c||^2 - 2 x.c
+      for (size_t i = 0; i < count; ++i)
+      {
+        const float *vectorProducts = products.data() + i * k;
+        int best = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (int c = 0; c < k; ++c)
+        {
+          float distance = centroidNorms[c] - 2.0f * vectorProducts[c];
+          if (distance < bestDistance)
+          {
+            bestDistance = distance;
+            best = c;
+          }
+        }
+        assignments[start + i] = best;
+      }
+    }
+  }
+}
+
+void kmeansTrain(const float *vectors, size_t n, int columns, int k, int iterations, unsigned int seed,
+    float *centroids)
+{
+  if (k <= 0 || (size_t) k > n)
+  {
+    throw std::invalid_argument("kmeansTrain requires 0 < k <= number of vectors");
+  }
+
+  // initial centroids are k distinct random vectors (partial fisher-yates)
+  std::mt19937 generator(seed);
+  std::vector<size_t> ids(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    ids[i] = i;
+  }
+  for (int c = 0; c < k; ++c)
+  {
+    std::uniform_int_distribution<size_t> pick(c, n - 1);
+    std::swap(ids[c], ids[pick(generator)]);
+    std::copy_n(vectors + ids[c] * columns, columns, centroids + (size_t) c * columns);
+  }
+
+  std::vector<float> norms(k);
+  std::vector<int> assignments(n);
+  std::vector<size_t> counts(k);
+  std::uniform_int_distribution<size_t> pickVector(0, n - 1);
+  for (int iteration = 0; iteration < iterations; ++iteration)
+  {
+    kmeansCentroidNorms(centroids, k, columns, norms.data());
+    kmeansAssign(vectors, n, columns, centroids, norms.data(), k, assignments.data());
+
+    std::fill(centroids, centroids + (size_t) k * columns, 0.0f);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+      int c = assignments[i];
+      ++counts[c];
+      cblas_saxpy(columns, 1.0f, vectors + i * columns, 1, centroids + (size_t) c * columns, 1);
+    }
+
+    for (int c = 0; c < k; ++c)
+    {
+      if (counts[c] == 0)
+      {
+        // empty cluster: restart it from a random vector so that every centroid stays in use
+        std::copy_n(vectors + pickVector(generator) * columns, columns, centroids + (size_t) c * columns);
+      } else
+      {
+        cblas_sscal(columns, 1.0f / counts[c], centroids + (size_t) c * columns, 1);
+      }
+    }
+  }
+}
+
+} // namespace knn
+} // namespace astdl
@@ -0,0 +1,53 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KMEANS_H_
+#define LIBKNN_KMEANS_H_
+
+#include <cstddef>
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * Lloyd's k-means over n row major vectors of the given number of columns.
+ * The centroids (k x columns, row major) are initialized from k distinct
+ * random vectors; a cluster that ends up empty is restarted from a random
+ * vector. Requires n >= k.
+ */
+void kmeansTrain(const float *vectors, size_t n, int columns, int k, int iterations, unsigned int seed,
+    float *centroids);
+
+/**
+ * Writes the squared l2 norm of each of the k centroids to norms.
+ */
+void kmeansCentroidNorms(const float *centroids, int k, int columns, float *norms);
+
+/**
+ * Writes the index of the l2-nearest centroid of each of the n row major
+ * vectors to assignments. centroidNorms are the squared centroid norms
+ * (see kmeansCentroidNorms). Blocks of vectors are assigned in parallel
+ * with one sgemm each.
+ */
+void kmeansAssign(const float *vectors, size_t n, int columns, const float *centroids, const float *centroidNorms, int k,
+    int *assignments);
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KMEANS_H_ */
@@ -0,0 +1,37 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include "KeyArena.h"
+
+namespace astdl
+{
+namespace knn
+{
+
+void KeyArena::append(const char *keyChars, const uint64_t *keyOffsets, size_t numKeys)
+{
+  uint64_t start = chars.size();
+  chars.insert(chars.end(), keyChars + keyOffsets[0], keyChars + keyOffsets[numKeys]);
+  offsets.reserve(offsets.size() + numKeys);
+  for (size_t i = 1; i <= numKeys; ++i)
+  {
+    offsets.push_back(start + (keyOffsets[i] - keyOffsets[0]));
+  }
+}
+
+} // namespace knn
+} // namespace astdl
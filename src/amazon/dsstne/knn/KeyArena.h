@@ -0,0 +1,211 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KEY_ARENA_H_
+#define LIBKNN_KEY_ARENA_H_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * Non owning reference to a key stored in a KeyArena (a minimal std::string_view,
+ * which needs C++17). Valid until the arena is modified or destroyed.
+ */
+struct KeyView
+{
+    const char *data;
+    size_t length;
+
+    KeyView() :
+        data(nullptr),
+        length(0)
+    {
+    }
+
+    KeyView(const char *data, size_t length) :
+        data(data),
+        length(length)
+    {
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    std::string str() const
+    {
+        return std::string(data, length);
+    }
+
+    bool operator==(const KeyView &other) const
+    {
+        return length == other.length && (length == 0 || memcmp(data, other.data, length) == 0);
+    }
+
+    bool operator!=(const KeyView &other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator==(const std::string &other) const
+    {
+        return *this == KeyView(other.data(), other.size());
+    }
+
+    bool operator!=(const std::string &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const KeyView &key)
+{
+    return out.write(key.data, key.length);
+}
+
+/**
+ * FNV-1a hash of the key characters, e.g. for an std::unordered_set<KeyView, KeyViewHash>.
+ */
+struct KeyViewHash
+{
+    size_t operator()(const KeyView &key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < key.length; ++i)
+        {
+            hash = (hash ^ (unsigned char) key.data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+/**
+ * Append only store of keys: all characters in one buffer, key i is
+ * chars[offsets[i], offsets[i + 1]). Two allocations per arena instead of one
+ * per key, which keeps the load and teardown of tens of millions of keys cheap
+ * and their memory compact. Same layout as the keys of a binary data file.
+ */
+class KeyArena
+{
+  public:
+    KeyArena() :
+        offsets(1, 0)
+    {
+    }
+
+    void reserve(size_t numKeys, size_t numChars)
+    {
+        offsets.reserve(numKeys + 1);
+        chars.reserve(numChars);
+    }
+
+    /**
+     * True if numKeys keys with numChars characters in total can be appended without reallocating
+     * (see reserve). Appends within the reserved capacity leave views of existing keys valid, so
+     * other threads may keep reading the keys that were appended before.
+     */
+    bool hasCapacity(size_t numKeys, size_t numChars) const
+    {
+        return offsets.size() + numKeys <= offsets.capacity() && chars.size() + numChars <= chars.capacity();
+    }
+
+    void append(const char *key, size_t length)
+    {
+        chars.insert(chars.end(), key, key + length);
+        offsets.push_back(chars.size());
+    }
+
+    void append(const std::string &key)
+    {
+        append(key.data(), key.size());
+    }
+
+    /**
+     * Appends numKeys keys stored in the arena layout: key i is keyChars[keyOffsets[i], keyOffsets[i + 1]).
+     */
+    void append(const char *keyChars, const uint64_t *keyOffsets, size_t numKeys);
+
+    size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+    KeyView operator[](size_t i) const
+    {
+        return KeyView(chars.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    /**
+     * Copies key i into key, reusing its capacity.
+     */
+    void copyKey(size_t i, std::string *key) const
+    {
+        key->assign(chars.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    const char *getChars() const
+    {
+        return chars.data();
+    }
+
+    /**
+     * size() + 1 offsets into getChars()
+     */
+    const uint64_t *getOffsets() const
+    {
+        return offsets.data();
+    }
+
+    size_t getNumChars() const
+    {
+        return chars.size();
+    }
+
+    /**
+     * Bytes of memory held by the arena.
+     */
+    size_t getSizeInBytes() const
+    {
+        return chars.capacity() + offsets.capacity() * sizeof(uint64_t);
+    }
+
+    /**
+     * Removes all keys and releases the memory.
+     */
+    void clear()
+    {
+        std::vector<char>().swap(chars);
+        std::vector<uint64_t>(1, 0).swap(offsets);
+    }
+
+  private:
+    std::vector<char> chars;
+    std::vector<uint64_t> offsets;
+};
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KEY_ARENA_H_ */
@@ -0,0 +1,137 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KNN_H_
+#define LIBKNN_KNN_H_
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ExclusionSet.h"
+#include "KnnData.h"
+
+namespace astdl
+{
+namespace knn
+{
+class Knn
+{
+  public:
+
+    /**
+     * marks result slots without a result (fewer than k rows in the data)
+     */
+    static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    virtual void search(int k, const float *inputs, std::string *keys, float *scores) = 0;
+
+    /**
+     * searches only the first size (<= batchSize) rows of inputs, e.g. a partially filled batch.
+     */
+    virtual void search(int k, const float *inputs, int size, std::string *keys, float *scores) = 0;
+
+    /**
+     * same as above, but returns the partition and row of each result instead of its key
+     * (data->hKeys[partition][row]), so that no key strings are copied.
+     */
+    virtual void search(int k, const float *inputs, uint32_t *partitions, uint32_t *rows, float *scores) = 0;
+
+    virtual void search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores) = 0;
+
+    /**
+     * filtered search: excluded rows are skipped while the top k is selected, so each query still gets
+     * k results (unless fewer than k rows are left). exclusions is empty (no filter), holds one set that
+     * applies to every query, or size sets, one per query (nullptr for no filter on that query).
+     */
+    virtual void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        std::string *keys, float *scores) = 0;
+
+    virtual void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        uint32_t *partitions, uint32_t *rows, float *scores) = 0;
+
+    /**
+     * key of a result returned as (partition, row), valid as long as the data (and only until
+     * the next KnnData::compact of the partition, like the row itself).
+     */
+    KeyView getKey(uint32_t partition, uint32_t row) const
+    {
+        return data->hKeys[partition][row];
+    }
+
+    virtual ~Knn()
+    {
+
+    }
+
+  protected:
+    KnnData *data;
+
+    Knn(KnnData *data) :
+        data(data)
+    {
+    }
+
+    /**
+     * throws std::invalid_argument unless exclusions is empty or has 1 or size sets.
+     */
+    static void checkExclusions(const std::vector<const ExclusionSet*> &exclusions, int size)
+    {
+        if (exclusions.size() > 1 && exclusions.size() != (size_t) size)
+        {
+            std::stringstream msg;
+            msg << "exclusions has " << exclusions.size() << " sets, must have 0, 1 or size = " << size;
+            throw std::invalid_argument(msg.str());
+        }
+    }
+
+    /**
+     * exclusion set of query q (nullptr for none), see checkExclusions.
+     */
+    static const ExclusionSet *getExclusions(const std::vector<const ExclusionSet*> &exclusions, int q)
+    {
+        if (exclusions.empty())
+        {
+            return nullptr;
+        }
+        return exclusions.size() == 1 ? exclusions[0] : exclusions[q];
+    }
+
+    /**
+     * looks up the keys of size results returned as (partition, row).
+     */
+    void resolveKeys(size_t size, const uint32_t *partitions, const uint32_t *rows, std::string *keys) const
+    {
+#pragma omp parallel for
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (partitions[i] == INVALID_INDEX)
+            {
+                keys[i].clear();
+            } else
+            {
+                data->hKeys[partitions[i]].copyKey(rows[i], &keys[i]);
+            }
+        }
+    }
+};
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KNN_H_ */
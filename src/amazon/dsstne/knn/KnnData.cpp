@@ -15,10 +15,16 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cuda_fp16.h>
+#include <numeric>
 #include <omp.h>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "cudautil.h"
 #include "KnnData.h"
@@ -27,8 +33,143 @@
 namespace
 {
 static const int ROW_PADDING = 8;
+// rows per partition sampled to train the INT8 and PQ quantizers
+static const size_t QUANTIZER_TRAINING_ROWS = 65536;
+static const int PQ_TRAIN_ITERATIONS = 10;
+// bytes of rows read (row major) from the DataReader before they are transposed into the column major
+// matrix; small enough for the block to still be in L2 when it is transposed
+static const size_t LOAD_BLOCK_SIZE = 256 * 1024;
+// edge of the square tiles the transpose works on; a 32 x 32 float tile is 4 KB, so both the
+// rows it reads and the columns it writes stay in L1
+static const int TRANSPOSE_TILE_SIZE = 32;
 static const std::unordered_map<std::string, astdl::knn::DataType> STRING_TO_DATA_TYPE = { { "fp32",
-    astdl::knn::DataType::FP32 }, { "fp16", astdl::knn::DataType::FP16 }, };
+    astdl::knn::DataType::FP32 }, { "fp16", astdl::knn::DataType::FP16 }, { "int8", astdl::knn::DataType::INT8 }, {
+    "pq", astdl::knn::DataType::PQ }, };
+static const std::unordered_map<std::string, astdl::knn::Backend> STRING_TO_BACKEND = { { "gpu",
+    astdl::knn::Backend::GPU }, { "cpu", astdl::knn::Backend::CPU }, };
+static const std::unordered_map<std::string, astdl::knn::Metric> STRING_TO_METRIC = { { "ip",
+    astdl::knn::Metric::INNER_PRODUCT }, { "cosine", astdl::knn::Metric::COSINE }, { "l2", astdl::knn::Metric::L2 }, };
+// rows per task of the row norm computation
+static const int64_t NORM_BLOCK_SIZE = 1024;
+
+/**
+ * Writes the row major block (blockRows x columns) to rows [rowStart, rowStart + blockRows) of the column major
+ * matrix (ld rows per column), converting each element with convert(column, value). Works in square tiles, in parallel.
+ */
+template<typename T, typename Convert>
+void transposeBlock(const float *block, int64_t blockRows, int64_t columns, T *matrix, size_t ld, size_t rowStart,
+                    Convert convert)
+{
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int64_t columnTile = 0; columnTile < columns; columnTile += TRANSPOSE_TILE_SIZE)
+    {
+        for (int64_t rowTile = 0; rowTile < blockRows; rowTile += TRANSPOSE_TILE_SIZE)
+        {
+            int64_t columnEnd = std::min(columnTile + TRANSPOSE_TILE_SIZE, columns);
+            int64_t rowEnd = std::min(rowTile + TRANSPOSE_TILE_SIZE, blockRows);
+            for (int64_t j = columnTile; j < columnEnd; ++j)
+            {
+                T *column = matrix + j * ld + rowStart;
+                for (int64_t i = rowTile; i < rowEnd; ++i)
+                {
+                    column[i] = convert(j, block[i * columns + j]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Reads up to rows rows from the reader, appending the keys to keys, into the column major matrix
+ * (ld >= rows rows per column) as T. Rows are read in blocks which are transposed (and converted) in parallel.
+ * Returns the number of rows read.
+ */
+template<typename T, typename Convert>
+uint32_t readColumnMajor(DataReader *dataReader, astdl::knn::KeyArena *keys, T *matrix, uint32_t rows, size_t ld,
+                         Convert convert)
+{
+    int columns = dataReader->getColumns();
+    uint32_t loadBlockRows = std::max((size_t) TRANSPOSE_TILE_SIZE, LOAD_BLOCK_SIZE / (columns * sizeof(float)));
+    std::vector<float> block((size_t) std::min(rows, loadBlockRows) * columns);
+    uint32_t rowStart = 0;
+    while (rowStart < rows)
+    {
+        uint32_t blockRows = 0;
+        uint32_t maxBlockRows = std::min(loadBlockRows, rows - rowStart);
+        while (blockRows < maxBlockRows && dataReader->appendRow(keys, block.data() + (size_t) blockRows * columns))
+        {
+            ++blockRows;
+        }
+        if (blockRows == 0)
+        {
+            break;
+        }
+        transposeBlock(block.data(), blockRows, columns, matrix, ld, rowStart, convert);
+        rowStart += blockRows;
+    }
+    return rowStart;
+}
+
+// element conversions of the transpose; functors (unlike function pointers) are inlined
+struct ToFloat
+{
+    float operator()(int64_t, float value) const
+    {
+        return value;
+    }
+};
+
+struct ToHalf
+{
+    half operator()(int64_t, float value) const
+    {
+        return __float2half(value);
+    }
+};
+
+inline float toFloat(float value)
+{
+    return value;
+}
+
+inline float toFloat(half value)
+{
+    return __half2float(value);
+}
+
+/**
+ * Writes the row side of the metric (see KnnData::hRowNorms) of the first rows rows of matrix to norms.
+ * Element (i, j) is matrix[i * rowStride + j * columnStride], so this works for row and column major data.
+ */
+template<typename T>
+void computeRowNorms(astdl::knn::Metric metric, const T *matrix, int64_t rows, int64_t columns, size_t rowStride,
+                     size_t columnStride, float *norms)
+{
+#pragma omp parallel for schedule(static)
+    for (int64_t rowStart = 0; rowStart < rows; rowStart += NORM_BLOCK_SIZE)
+    {
+        int64_t rowEnd = std::min(rowStart + NORM_BLOCK_SIZE, rows);
+        std::fill(norms + rowStart, norms + rowEnd, 0.0f);
+        // a column of the block at a time, sequential reads for column major data
+        for (int64_t j = 0; j < columns; ++j)
+        {
+            const T *column = matrix + j * columnStride;
+            for (int64_t i = rowStart; i < rowEnd; ++i)
+            {
+                float value = toFloat(column[i * rowStride]);
+                norms[i] += value * value;
+            }
+        }
+        if (metric == astdl::knn::Metric::COSINE)
+        {
+            for (int64_t i = rowStart; i < rowEnd; ++i)
+            {
+                // zero rows score 0 against every query
+                norms[i] = norms[i] > 0.0f ? 1.0f / std::sqrt(norms[i]) : 0.0f;
+            }
+        }
+    }
+}
 }  // namespace
 
 namespace astdl
@@ -56,13 +197,13 @@ Matrix::Matrix(void *data, uint32_t numRows, int numColumns, size_t elementSize,
 
 size_t Matrix::getSizeInBytes()
 {
-    size_t sizeInBytes = numRows * numColumns * elementSize;
+    size_t sizeInBytes = (size_t) numRows * numColumns * elementSize;
     return sizeInBytes;
 }
 
 size_t Matrix::getLength()
 {
-    size_t length = numRows * numColumns;
+    size_t length = (size_t) numRows * numColumns;
     return length;
 }
 
@@ -73,6 +214,10 @@ std::string getDataTypeString(DataType dataType)
             return "fp32";
         case DataType::FP16:
             return "fp16";
+        case DataType::INT8:
+            return "int8";
+        case DataType::PQ:
+            return "pq";
         default:
             return "unknown";
     }
@@ -90,6 +235,74 @@ DataType getDataTypeFromString(const std::string &dataTypeLiteral)
     return entry->second;
 }
 
+std::string getBackendString(Backend backend)
+{
+    switch (backend) {
+        case Backend::GPU:
+            return "gpu";
+        case Backend::CPU:
+            return "cpu";
+        default:
+            return "unknown";
+    }
+}
+
+Backend getBackendFromString(const std::string &backendLiteral)
+{
+    auto entry = STRING_TO_BACKEND.find(backendLiteral);
+    if (entry == STRING_TO_BACKEND.end())
+    {
+        std::stringstream msg;
+        msg << "Unknown Backend " << backendLiteral;
+        throw std::invalid_argument(msg.str());
+    }
+    return entry->second;
+}
+
+std::string getMetricString(Metric metric)
+{
+    switch (metric) {
+        case Metric::INNER_PRODUCT:
+            return "ip";
+        case Metric::COSINE:
+            return "cosine";
+        case Metric::L2:
+            return "l2";
+        default:
+            return "unknown";
+    }
+}
+
+Metric getMetricFromString(const std::string &metricLiteral)
+{
+    auto entry = STRING_TO_METRIC.find(metricLiteral);
+    if (entry == STRING_TO_METRIC.end())
+    {
+        std::stringstream msg;
+        msg << "Unknown Metric " << metricLiteral;
+        throw std::invalid_argument(msg.str());
+    }
+    return entry->second;
+}
+
+float getQueryNorm(Metric metric, const float *query, int columns)
+{
+    if (metric == Metric::INNER_PRODUCT)
+    {
+        return 1.0f;
+    }
+    float norm = 0.0f;
+    for (int j = 0; j < columns; ++j)
+    {
+        norm += query[j] * query[j];
+    }
+    if (metric == Metric::COSINE)
+    {
+        return norm > 0.0f ? 1.0f / std::sqrt(norm) : 0.0f;
+    }
+    return norm;
+}
+
 Matrix loadDataOnHost(DataReader *dataReader)
 {
     uint32_t rows = dataReader->getRows();
@@ -99,18 +312,25 @@ Matrix loadDataOnHost(DataReader *dataReader)
     Matrix matrix = allocateMatrixOnHost(rows, columns, elementSize);
 
     std::string ignored;
-    for (int rowNum = 0; dataReader->readRow(&ignored, ((float*) matrix.data) + (rowNum * columns)); ++rowNum)
+    for (size_t rowNum = 0; dataReader->readRow(&ignored, ((float*) matrix.data) + (rowNum * columns)); ++rowNum)
     {
     }
     return matrix;
 }
 
-KnnData::KnnData(int numGpus, int batchSize, int maxK, DataType dataType) :
+KnnData::KnnData(int numGpus, int batchSize, int maxK, DataType dataType, Backend backend, int pqSubspaceColumns,
+                 Metric metric) :
     numGpus(numGpus),
     batchSize(batchSize),
     maxK(maxK),
     dataType(dataType),
+    backend(backend),
+    pqSubspaceColumns(pqSubspaceColumns),
+    metric(metric),
     dCollectionPartitions(numGpus),
+    hCollectionPartitions(numGpus),
+    hScalarQuantizers(numGpus),
+    hProductQuantizers(numGpus),
     dInputBatches(numGpus),
     dProducts(numGpus),
     dResultScores(numGpus),
@@ -120,9 +340,51 @@ KnnData::KnnData(int numGpus, int batchSize, int maxK, DataType dataType) :
     dInputBatchTmpBuffers(numGpus),
     collectionRowsPadded(numGpus),
     hKeys(numGpus),
+    hRowNorms(numGpus),
+    dRowNorms(numGpus),
+    hNumRows(numGpus),
+    hRemovedRows(numGpus),
+    hNumRemovedRows(numGpus),
     elapsedSgemm(numGpus),
-    elapsedTopK(numGpus)
+    elapsedTopK(numGpus),
+    reservedRows(0),
+    reservedKeyBytes(0),
+    updatable(false),
+    generation(0)
 {
+    // readers first, so that a search may take the lock again (e.g. to resolve keys)
+    // while compact() waits for it
+    pthread_rwlockattr_t lockAttributes;
+    pthread_rwlockattr_init(&lockAttributes);
+    pthread_rwlockattr_setkind_np(&lockAttributes, PTHREAD_RWLOCK_PREFER_READER_NP);
+    pthread_rwlock_init(&partitionsLock, &lockAttributes);
+    pthread_rwlockattr_destroy(&lockAttributes);
+
+    if (backend == Backend::CPU)
+    {
+        fprintf(stderr,
+                "INFO: Initializing KnnData on CPU with numPartitions = %d, batchSize = %d, maxK = %d, dataType = %s, metric = %s\n",
+                numGpus, batchSize, maxK, getDataTypeString(dataType).c_str(), getMetricString(metric).c_str());
+        if (dataType == DataType::FP16)
+        {
+            fprintf(stderr, "WARNING: fp16 is not supported on the CPU backend. Storing data in fp32.\n");
+        }
+        if (dataType == DataType::PQ && pqSubspaceColumns <= 0)
+        {
+            std::stringstream msg;
+            msg << "pqSubspaceColumns = " << pqSubspaceColumns << " must be > 0";
+            throw std::invalid_argument(msg.str());
+        }
+        return;
+    }
+
+    if (dataType == DataType::INT8 || dataType == DataType::PQ)
+    {
+        std::stringstream msg;
+        msg << "DataType " << getDataTypeString(dataType) << " is only supported on the CPU backend";
+        throw std::invalid_argument(msg.str());
+    }
+
 // sanity check number of GPUs
     int deviceCount = astdl::cuda_util::getDeviceCount();
     if (deviceCount < 1)
@@ -139,8 +401,8 @@ KnnData::KnnData(int numGpus, int batchSize, int maxK, DataType dataType) :
         throw std::runtime_error(msg.str());
     }
 
-    fprintf(stderr, "INFO: Initializing KnnData with numGpus = %d, batchSize = %d, maxK = %d, dataType = %s\n", numGpus,
-            batchSize, maxK, getDataTypeString(dataType).c_str());
+    fprintf(stderr, "INFO: Initializing KnnData with numGpus = %d, batchSize = %d, maxK = %d, dataType = %s, metric = %s\n",
+            numGpus, batchSize, maxK, getDataTypeString(dataType).c_str(), getMetricString(metric).c_str());
 // fp16 mode only supported on sm >= 7
     if (dataType == DataType::FP16)
     {
@@ -174,11 +436,221 @@ KnnData::KnnData(int numGpus, int batchSize, int maxK, DataType dataType) :
 
 int KnnData::getFeatureSize() const
 {
+    if (backend == Backend::CPU)
+    {
+        if (dataType == DataType::PQ)
+        {
+            return hProductQuantizers[0].getColumns();
+        }
+        return hCollectionPartitions[0].numColumns;
+    }
     return dCollectionPartitions[0].numColumns;
 }
 
+void KnnData::reserve(uint32_t rowsPerPartition, size_t keyBytesPerPartition)
+{
+    if (backend != Backend::CPU || (dataType != DataType::FP32 && dataType != DataType::FP16))
+    {
+        std::stringstream msg;
+        msg << "add, remove and compact require the CPU backend with fp32 or fp16 data, got " <<
+            getDataTypeString(dataType);
+        throw std::invalid_argument(msg.str());
+    }
+    reservedRows = rowsPerPartition;
+    reservedKeyBytes = keyBytesPerPartition;
+    updatable = true;
+}
+
+void KnnData::checkUpdatable(int partition) const
+{
+    if (!updatable)
+    {
+        throw std::runtime_error("KnnData is not updatable, call reserve() before load");
+    }
+    if (partition < 0 || partition >= numGpus)
+    {
+        std::stringstream msg;
+        msg << "partition = " << partition << " must be in [0, " << numGpus << ")";
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+void KnnData::add(int partition, const std::vector<std::string> &keys, const float *vectors)
+{
+    checkUpdatable(partition);
+    std::lock_guard<std::mutex> lock(updateMutex);
+
+    Matrix &hCollection = hCollectionPartitions[partition];
+    KeyArena &partitionKeys = hKeys[partition];
+    uint32_t rows = hNumRows[partition].load(std::memory_order_relaxed);
+    uint32_t numKeys = keys.size();
+    size_t numChars = 0;
+    for (const std::string &key : keys)
+    {
+        numChars += key.size();
+    }
+
+    if (rows + numKeys > hCollection.numRows || !partitionKeys.hasCapacity(numKeys, numChars))
+    {
+        std::stringstream msg;
+        msg << "partition " << partition << " is full: " << rows << " of " << hCollection.numRows << " rows used, "
+            << numKeys << " rows (" << numChars << " key bytes) added. compact() the partition or reserve() more";
+        throw std::runtime_error(msg.str());
+    }
+
+    // the new rows are past getNumRows(partition), so searches do not read them until they are published
+    int columns = hCollection.numColumns;
+    transposeBlock(vectors, numKeys, columns, (float*) hCollection.data, hCollection.numRows, rows, ToFloat());
+    if (metric != Metric::INNER_PRODUCT)
+    {
+        computeRowNorms(metric, vectors, numKeys, columns, columns, 1, hRowNorms[partition].data() + rows);
+    }
+    for (const std::string &key : keys)
+    {
+        partitionKeys.append(key);
+    }
+
+    hNumRows[partition].store(rows + numKeys, std::memory_order_release);
+}
+
+size_t KnnData::remove(const std::vector<std::string> &keys)
+{
+    if (!updatable)
+    {
+        throw std::runtime_error("KnnData is not updatable, call reserve() before load");
+    }
+    std::lock_guard<std::mutex> lock(updateMutex);
+
+    std::unordered_set<KeyView, KeyViewHash> removedKeys;
+    for (const std::string &key : keys)
+    {
+        removedKeys.insert(KeyView(key.data(), key.size()));
+    }
+
+    size_t removed = 0;
+    for (int partition = 0; partition < numGpus; ++partition)
+    {
+        const KeyArena &partitionKeys = hKeys[partition];
+        std::vector<std::atomic<uint64_t>> &removedRows = hRemovedRows[partition];
+        int64_t rows = hNumRows[partition].load(std::memory_order_relaxed);
+        uint32_t partitionRemoved = 0;
+#pragma omp parallel for reduction(+:partitionRemoved) schedule(static)
+        for (int64_t row = 0; row < rows; ++row)
+        {
+            if (removedKeys.count(partitionKeys[row]) != 0)
+            {
+                uint64_t bit = 1ull << (row % 64);
+                // rows removed before are not counted again
+                if ((removedRows[row / 64].fetch_or(bit, std::memory_order_relaxed) & bit) == 0)
+                {
+                    ++partitionRemoved;
+                }
+            }
+        }
+        hNumRemovedRows[partition].fetch_add(partitionRemoved, std::memory_order_relaxed);
+        removed += partitionRemoved;
+    }
+    return removed;
+}
+
+void KnnData::compact(int partition)
+{
+    checkUpdatable(partition);
+    std::lock_guard<std::mutex> lock(updateMutex);
+
+    // build the compacted partition on the side; add() and remove() wait on updateMutex, searches go on
+    const Matrix &hCollection = hCollectionPartitions[partition];
+    const KeyArena &partitionKeys = hKeys[partition];
+    uint32_t rows = hNumRows[partition].load(std::memory_order_relaxed);
+    int columns = hCollection.numColumns;
+
+    std::vector<uint32_t> liveRows;
+    liveRows.reserve(rows - hNumRemovedRows[partition].load(std::memory_order_relaxed));
+    size_t liveChars = 0;
+    for (uint32_t row = 0; row < rows; ++row)
+    {
+        if (!isRemoved(partition, row))
+        {
+            liveRows.push_back(row);
+            liveChars += partitionKeys[row].size();
+        }
+    }
+
+    uint32_t liveCount = liveRows.size();
+    uint32_t capacity = liveCount + reservedRows;
+    Matrix compacted = allocateMatrixOnHost(capacity, columns, sizeof(float));
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < columns; ++j)
+    {
+        const float *column = (const float*) hCollection.data + (size_t) j * hCollection.numRows;
+        float *compactedColumn = (float*) compacted.data + (size_t) j * capacity;
+        for (uint32_t i = 0; i < liveCount; ++i)
+        {
+            compactedColumn[i] = column[liveRows[i]];
+        }
+    }
+
+    KeyArena compactedKeys;
+    compactedKeys.reserve(capacity, liveChars + reservedKeyBytes);
+    std::vector<float> compactedNorms(metric == Metric::INNER_PRODUCT ? 0 : capacity);
+    for (uint32_t i = 0; i < liveCount; ++i)
+    {
+        KeyView key = partitionKeys[liveRows[i]];
+        compactedKeys.append(key.data, key.size());
+        if (!compactedNorms.empty())
+        {
+            compactedNorms[i] = hRowNorms[partition][liveRows[i]];
+        }
+    }
+    std::vector<std::atomic<uint64_t>> compactedRemovedRows((capacity + 63) / 64);
+
+    // searches only wait for the swap
+    Matrix released = hCollection;
+    pthread_rwlock_wrlock(&partitionsLock);
+    hCollectionPartitions[partition] = compacted;
+    std::swap(hKeys[partition], compactedKeys);
+    hRowNorms[partition].swap(compactedNorms);
+    hRemovedRows[partition].swap(compactedRemovedRows);
+    hNumRows[partition].store(liveCount, std::memory_order_release);
+    hNumRemovedRows[partition].store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    pthread_rwlock_unlock(&partitionsLock);
+
+    freeMatrix(released);
+    fprintf(stderr, "INFO: compacted host partition %d from %u to %u rows\n", partition, rows, liveCount);
+}
+
+size_t KnnData::getHostDataSizeInBytes() const
+{
+    size_t size = 0;
+    for (Matrix hCollection : hCollectionPartitions)
+    {
+        size += hCollection.getSizeInBytes();
+    }
+    for (const ProductQuantizer &quantizer : hProductQuantizers)
+    {
+        size += quantizer.getCodebookSizeInBytes();
+    }
+    for (const std::vector<float> &rowNorms : hRowNorms)
+    {
+        size += rowNorms.size() * sizeof(float);
+    }
+    for (const std::vector<std::atomic<uint64_t>> &removedRows : hRemovedRows)
+    {
+        size += removedRows.size() * sizeof(uint64_t);
+    }
+    // INT8 adds 3 floats per column and partition, negligible
+    return size;
+}
+
 void KnnData::load(int device, DataReader *dataReader)
 {
+    if (backend == Backend::CPU)
+    {
+        loadOnHost(device, dataReader);
+        return;
+    }
+
     CHECK_ERR(cudaSetDevice(device));
 
 // pad by multiples of 4 for sgemm
@@ -187,40 +659,64 @@ void KnnData::load(int device, DataReader *dataReader)
     uint32_t rowsPadded = rows - actualRows;
     int columns = dataReader->getColumns();
 
-// holds the data on host memory until we copy it over to the device
-    Matrix hTmpMatrix = allocateMatrixOnHost(rows, columns, sizeof(float));
-    size_t hTmpDataBytes = hTmpMatrix.getSizeInBytes();
-    float *hTmpData = (float*) hTmpMatrix.data;
+// holds the data on host memory, column major and already in the device element type, until we copy it over
+    size_t elementSize = dataType == DataType::FP16 ? sizeof(half) : sizeof(float);
+    Matrix hTmpMatrix = allocateMatrixOnHost(rows, columns, elementSize);
 
     collectionRowsPadded[device] = rowsPadded;
 
-    std::string key;
-    float vector[columns];
-//    for (int rowNum = 0; dataReader->readRow(&key, hTmpData + (rowNum * columns)); ++rowNum)
-    for (int rowNum = 0; dataReader->readRow(&key, vector); ++rowNum)
+    hKeys[device].reserve(actualRows, dataReader->getKeySizeInBytes());
+    if (dataType == DataType::FP16)
     {
-        hKeys[device].push_back(key);
-        // copy vector into hTmpData in column major format
-        for(int j = 0; j < columns; ++j) {
-            hTmpData[j * rows + rowNum] = vector[j];
+        // the fp16 conversion is done by the transpose
+        half *hTmpData = (half*) hTmpMatrix.data;
+        uint32_t rowsRead = readColumnMajor(dataReader, &hKeys[device], hTmpData, actualRows, rows, ToHalf());
+        for (int j = 0; j < columns; ++j)
+        {
+            std::fill(hTmpData + (size_t) j * rows + rowsRead, hTmpData + (size_t) (j + 1) * rows, __float2half(0.0f));
+        }
+        if (metric != Metric::INNER_PRODUCT)
+        {
+            // norms of the fp16 values, which are the ones multiplied on the device
+            hRowNorms[device].resize(rows);
+            computeRowNorms(metric, hTmpData, rows, columns, 1, rows, hRowNorms[device].data());
         }
-    }
 
-    if (dataType == DataType::FP16)
-    {
         dCollectionPartitions[device] = allocateMatrixOnDevice(rows, columns, sizeof(half));
-        astdl::math::kFloatToHalf(hTmpData, hTmpDataBytes, (half*) dCollectionPartitions[device].data);
-
         dInputBatches[device] = allocateMatrixOnDevice(batchSize, columns, sizeof(half));
         dInputBatchTmpBuffers[device] = allocateMatrixOnDevice(batchSize, columns, sizeof(float));
     } else
     {
+        float *hTmpData = (float*) hTmpMatrix.data;
+        uint32_t rowsRead = readColumnMajor(dataReader, &hKeys[device], hTmpData, actualRows, rows, ToFloat());
+        for (int j = 0; j < columns; ++j)
+        {
+            std::fill(hTmpData + (size_t) j * rows + rowsRead, hTmpData + (size_t) (j + 1) * rows, 0.0f);
+        }
+        if (metric != Metric::INNER_PRODUCT)
+        {
+            hRowNorms[device].resize(rows);
+            computeRowNorms(metric, hTmpData, rows, columns, 1, rows, hRowNorms[device].data());
+        }
+
         dCollectionPartitions[device] = allocateMatrixOnDevice(rows, columns, sizeof(float));
-        CHECK_ERR(cudaMemcpy(dCollectionPartitions[device].data, hTmpData, hTmpDataBytes, cudaMemcpyHostToDevice));
         dInputBatches[device] = allocateMatrixOnDevice(batchSize, columns, sizeof(float));
     }
+    CHECK_ERR(cudaMemcpy(dCollectionPartitions[device].data, hTmpMatrix.data, hTmpMatrix.getSizeInBytes(),
+                  cudaMemcpyHostToDevice));
 
-    free(hTmpData);
+    freeMatrix(hTmpMatrix);
+
+    if (metric != Metric::INNER_PRODUCT)
+    {
+        // padded rows are zero and never selected (see kCalculateTopK), the host copy only keeps the actual rows
+        dRowNorms[device] = allocateMatrixOnDevice(1, rows, sizeof(float));
+        CHECK_ERR(cudaMemcpy(dRowNorms[device].data, hRowNorms[device].data(), dRowNorms[device].getSizeInBytes(),
+                      cudaMemcpyHostToDevice));
+        hRowNorms[device].resize(actualRows);
+        hRowNorms[device].shrink_to_fit();
+    }
+    hNumRows[device].store(actualRows, std::memory_order_release);
 
     dProducts[device] = allocateMatrixOnDevice(batchSize, rows, sizeof(float));
     dResultScores[device] = allocateMatrixOnDevice(batchSize, maxK, sizeof(float));
@@ -239,10 +735,102 @@ void KnnData::load(int device, DataReader *dataReader)
         actualRows, rows, columns, device, totalMemory - freeMemory, freeMemory, totalMemory);
 }
 
+void KnnData::loadOnHost(int partition, DataReader *dataReader)
+{
+    // no padding needed on the host
+    uint32_t rows = dataReader->getRows();
+    int columns = dataReader->getColumns();
+    collectionRowsPadded[partition] = 0;
+    hKeys[partition].reserve(rows + reservedRows, dataReader->getKeySizeInBytes() + reservedKeyBytes);
+
+    if (dataType == DataType::FP32 || dataType == DataType::FP16)
+    {
+        // reserved rows (see reserve()) are allocated up front, after the rows of each column
+        uint32_t capacity = rows + reservedRows;
+        Matrix hCollection = allocateMatrixOnHost(capacity, columns, sizeof(float));
+        float *hData = (float*) hCollection.data;
+
+        // column major, same layout as on the device
+        rows = readColumnMajor(dataReader, &hKeys[partition], hData, rows, capacity, ToFloat());
+        hCollectionPartitions[partition] = hCollection;
+        if (metric != Metric::INNER_PRODUCT)
+        {
+            hRowNorms[partition].resize(updatable ? capacity : rows);
+            computeRowNorms(metric, hData, rows, columns, 1, capacity, hRowNorms[partition].data());
+        }
+        if (updatable)
+        {
+            std::vector<std::atomic<uint64_t>>((capacity + 63) / 64).swap(hRemovedRows[partition]);
+        }
+    } else
+    {
+        // quantizers are trained on (and encode) row major vectors, the fp32 copy is released after encoding
+        Matrix hTmpMatrix = allocateMatrixOnHost(rows, columns, sizeof(float));
+        float *hTmpData = (float*) hTmpMatrix.data;
+
+        size_t rowNum = 0;
+        while (dataReader->appendRow(&hKeys[partition], hTmpData + rowNum * columns))
+        {
+            ++rowNum;
+        }
+
+        if (metric != Metric::INNER_PRODUCT)
+        {
+            // norms of the exact (row major) vectors, not of their codes
+            hRowNorms[partition].resize(rows);
+            computeRowNorms(metric, hTmpData, rows, columns, columns, 1, hRowNorms[partition].data());
+        }
+
+        // train on the first rows of an in place shuffle of the row ids (uniform sample)
+        size_t numSamples = std::min((size_t) rows, QUANTIZER_TRAINING_ROWS);
+        std::vector<float> samples(numSamples * columns);
+        std::vector<uint32_t> ids(rows);
+        std::iota(ids.begin(), ids.end(), 0);
+        std::mt19937 generator(partition);
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            std::uniform_int_distribution<size_t> pick(i, rows - 1);
+            std::swap(ids[i], ids[pick(generator)]);
+            std::copy_n(hTmpData + (size_t) ids[i] * columns, columns, samples.data() + i * columns);
+        }
+
+        if (dataType == DataType::INT8)
+        {
+            ScalarQuantizer &quantizer = hScalarQuantizers[partition];
+            quantizer.train(samples.data(), numSamples, columns);
+
+            // column major codes, same layout as fp32
+            Matrix hCollection = allocateMatrixOnHost(rows, columns, sizeof(uint8_t));
+            uint8_t *hCodes = (uint8_t*) hCollection.data;
+            transposeBlock(hTmpData, rows, columns, hCodes, rows, 0, [&quantizer](int64_t j, float value)
+            {
+                return quantizer.encode(j, value);
+            });
+            hCollectionPartitions[partition] = hCollection;
+        } else
+        {
+            ProductQuantizer &quantizer = hProductQuantizers[partition];
+            quantizer.train(samples.data(), numSamples, columns, pqSubspaceColumns, PQ_TRAIN_ITERATIONS, partition);
+
+            Matrix hCollection = allocateMatrixOnHost(rows, quantizer.getCodeSize(), sizeof(uint8_t));
+            quantizer.encode(hTmpData, rows, (uint8_t*) hCollection.data);
+            hCollectionPartitions[partition] = hCollection;
+        }
+
+        freeMatrix(hTmpMatrix);
+    }
+    hNumRows[partition].store(rows, std::memory_order_release);
+
+    fprintf(stderr, "INFO: loaded %u rows and %d columns into host partition %d as %s. Used: %zu MB\n", rows, columns,
+            partition, getDataTypeString(dataType).c_str(),
+            hCollectionPartitions[partition].getSizeInBytes() / (1024 * 1024));
+}
+
 void KnnData::load(const std::map<int, DataReader*> &deviceToData)
 {
-    omp_set_num_threads(numGpus);
-#pragma omp parallel
+    // one thread per partition. num_threads instead of omp_set_num_threads so that
+    // later parallel regions (e.g. CPU searches) still get all cores
+#pragma omp parallel num_threads(numGpus)
     {
         int device = omp_get_thread_num();
         auto dataReader = deviceToData.find(device);
@@ -260,22 +848,29 @@ void KnnData::load(const std::map<int, DataReader*> &deviceToData)
 
 void KnnData::load(const std::map<int, std::string> &deviceToFile, char keyValDelim, char vecDelim)
 {
-    std::map<int, DataReader*> deviceToData;
-    for (const auto &entry : deviceToFile)
+    // one file at a time: the reader parses its file in parallel and holds the parsed rows,
+    // so this bounds the extra memory to one partition
+    for (int device = 0; device < numGpus; ++device)
     {
-        int device = entry.first;
-        std::string file = entry.second;
-        DataReader *dataReader = new TextFileDataReader(file, keyValDelim, vecDelim);
-        deviceToData.insert( { device, dataReader });
-    }
-
-    load(deviceToData);
+        auto file = deviceToFile.find(device);
+        if (file == deviceToFile.end())
+        {
+            std::stringstream msg;
+            msg << "Data file for device " << device << " not specified. Must specify files for all " << numGpus
+                << " devices";
+            throw std::runtime_error(msg.str());
+        }
 
-    for (const auto &entry : deviceToData)
-    {
-        delete entry.second;
+        if (BinaryFileDataReader::isBinaryDataFile(file->second))
+        {
+            BinaryFileDataReader dataReader(file->second);
+            load(device, &dataReader);
+        } else
+        {
+            TextFileDataReader dataReader(file->second, keyValDelim, vecDelim);
+            load(device, &dataReader);
+        }
     }
-    deviceToData.clear();
 }
 
 KnnData::~KnnData()
@@ -288,6 +883,10 @@ KnnData::~KnnData()
     {
         freeMatrix(dCollection);
     }
+    for (auto hCollection : hCollectionPartitions)
+    {
+        freeMatrix(hCollection);
+    }
     for (auto dInputBatch : dInputBatches)
     {
         freeMatrix(dInputBatch);
@@ -312,37 +911,40 @@ KnnData::~KnnData()
     {
         freeMatrix(hResultIndex);
     }
-    for (auto hKey : hKeys)
-    {
-        hKey.clear();
-    }
-
     for (auto dInputBatchTmpBuffer : dInputBatchTmpBuffers)
     {
         freeMatrix(dInputBatchTmpBuffer);
     }
+    for (auto dRowNorm : dRowNorms)
+    {
+        freeMatrix(dRowNorm);
+    }
 
     cublasHandles.clear();
     dCollectionPartitions.clear();
+    hCollectionPartitions.clear();
     dInputBatches.clear();
     dProducts.clear();
     dResultScores.clear();
     dResultIndexes.clear();
     hKeys.clear();
+    hRowNorms.clear();
+    dRowNorms.clear();
     elapsedSgemm.clear();
     elapsedTopK.clear();
+    pthread_rwlock_destroy(&partitionsLock);
 }
 
 Matrix allocateMatrixOnHost(uint32_t numRows, int numColumns, size_t elementSize)
 {
-    void *data = malloc(numRows * numColumns * elementSize);
+    void *data = malloc((size_t) numRows * numColumns * elementSize);
     return Matrix(data, numRows, numColumns, elementSize, cudaMemoryTypeHost);
 }
 
 Matrix allocateMatrixOnDevice(uint32_t numRows, int numColumns, size_t elementSize)
 {
     void *data;
-    CHECK_ERR(cudaMalloc(&data, numRows * numColumns * elementSize));
+    CHECK_ERR(cudaMalloc(&data, (size_t) numRows * numColumns * elementSize));
     return Matrix(data, numRows, numColumns, elementSize, cudaMemoryTypeDevice);
 }
 
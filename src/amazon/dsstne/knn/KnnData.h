@@ -18,29 +18,91 @@
 #ifndef LIBKNN_KNN_HANDLE_H_
 #define LIBKNN_KNN_HANDLE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <map>
+#include <mutex>
+#include <pthread.h>
 #include <string>
 #include <vector>
 
 #include <cublas_v2.h>
 
 #include "DataReader.h"
+#include "KeyArena.h"
+#include "Quantizer.h"
 
 namespace astdl
 {
 namespace knn
 {
 
+/**
+ * Element type of the stored data. INT8 (8-bit scalar quantization) and PQ
+ * (product quantization) are only supported by the CPU backend, see Quantizer.h.
+ */
 enum class DataType
 {
-  FP32 = 0, FP16 = 1
+  FP32 = 0, FP16 = 1, INT8 = 2, PQ = 3
 };
 
 std::string getDataTypeString(DataType dataType);
 
 DataType getDataTypeFromString(const std::string &dataTypeLiteral);
 
+/**
+ * Where the data is stored and searched. GPU keeps one partition per device,
+ * CPU keeps the partitions in host memory and needs no GPU on the host.
+ */
+enum class Backend
+{
+  GPU = 0, CPU = 1
+};
+
+std::string getBackendString(Backend backend);
+
+Backend getBackendFromString(const std::string &backendLiteral);
+
+/**
+ * How queries are compared with the rows. Results are always ordered best first:
+ * INNER_PRODUCT and COSINE scores are similarities (descending), L2 scores are
+ * squared euclidean distances (ascending).
+ *
+ * COSINE and L2 are an inner product search whose scores are corrected with the
+ * row norms (computed once at load time, see KnnData::hRowNorms) while the top k
+ * is selected, and with the query norm once the top k is known.
+ */
+enum class Metric
+{
+  INNER_PRODUCT = 0, COSINE = 1, L2 = 2
+};
+
+std::string getMetricString(Metric metric);
+
+Metric getMetricFromString(const std::string &metricLiteral);
+
+/**
+ * Query side of the metric: 1 / |q| for COSINE, |q|^2 for L2 and unused (1) for INNER_PRODUCT.
+ */
+float getQueryNorm(Metric metric, const float *query, int columns);
+
+/**
+ * Score reported for a result whose row corrected score (see KnnData::hRowNorms) is score.
+ */
+inline float getFinalScore(Metric metric, float score, float queryNorm)
+{
+    switch (metric) {
+        case Metric::COSINE:
+            return score * queryNorm;
+        case Metric::L2:
+            // |q - x|^2 = |q|^2 - (2 q.x - |x|^2), clamped as rounding may take it slightly below 0
+            return std::max(queryNorm - score, 0.0f);
+        default:
+            return score;
+    }
+}
+
 /**
  * Holds the data pointer and row, column, and element size
  * information for a 2-d array in either host or device memory.
@@ -66,6 +128,10 @@ Matrix loadDataOnHost(DataReader *dataReader);
 
 struct KnnData
 {
+    /*
+     * number of data partitions. one per device for the GPU backend,
+     * independent host partitions for the CPU backend.
+     */
     const int numGpus;
     const int batchSize;
     const int maxK;
@@ -79,6 +145,14 @@ struct KnnData
      * data
      */
     std::vector<Matrix> dCollectionPartitions; // column major
+    /*
+     * CPU backend only. column major fp32 (FP32, FP16) or uint8 codes (INT8),
+     * row major codes of getCodeSize() bytes per row (PQ). numRows of the matrix is the
+     * capacity (rows per column); the first getNumRows(partition) rows hold data.
+     */
+    std::vector<Matrix> hCollectionPartitions;
+    std::vector<ScalarQuantizer> hScalarQuantizers; // per partition, INT8 only
+    std::vector<ProductQuantizer> hProductQuantizers; // per partition, PQ only
     std::vector<Matrix> dInputBatches;
     std::vector<Matrix> dProducts;
 
@@ -87,7 +161,24 @@ struct KnnData
 
     std::vector<Matrix> hResultScores;
     std::vector<Matrix> hResultIndexes;
-    std::vector<std::vector<std::string>> hKeys;
+    std::vector<KeyArena> hKeys; // per partition, key of each row
+
+    /*
+     * per partition, row side of the metric that the top k selection applies to the inner
+     * product q.x of each row: 1 / |x| for COSINE (score q.x / |x|) and |x|^2 for L2
+     * (score 2 q.x - |x|^2). Empty for INNER_PRODUCT. dRowNorms holds the same on the
+     * device, padded rows included.
+     */
+    std::vector<std::vector<float>> hRowNorms;
+    std::vector<Matrix> dRowNorms;
+
+    /*
+     * rows of each partition visible to searches (see getNumRows), and for the CPU backend one bit
+     * per row of capacity marking removed rows (empty unless reserve() was called).
+     */
+    std::vector<std::atomic<uint32_t>> hNumRows;
+    std::vector<std::vector<std::atomic<uint64_t>>> hRemovedRows;
+    std::vector<std::atomic<uint32_t>> hNumRemovedRows;
 
     /*
      * tmp buffers
@@ -113,17 +204,132 @@ struct KnnData
      */
     const DataType dataType;
 
-    KnnData(int numGpus, int batchSize, int maxK, DataType dataType);
+    const Backend backend;
+
+    /**
+     * Dimensions per PQ subspace (PQ stores one byte per subspace).
+     */
+    const int pqSubspaceColumns;
+
+    const Metric metric;
+
+    static const int DEFAULT_PQ_SUBSPACE_COLUMNS = 4;
+
+    KnnData(int numGpus, int batchSize, int maxK, DataType dataType, Backend backend = Backend::GPU,
+            int pqSubspaceColumns = DEFAULT_PQ_SUBSPACE_COLUMNS, Metric metric = Metric::INNER_PRODUCT);
 
     void load(int device, DataReader *dataReader);
 
+    /**
+     * Loads the partition into hCollectionPartitions[partition] for the CPU backend.
+     * For INT8 and PQ the partition's quantizer is trained on a sample of its rows.
+     */
+    void loadOnHost(int partition, DataReader *dataReader);
+
+    /**
+     * Bytes of host memory used by the data of all partitions (vectors, codebooks and row norms, not keys).
+     */
+    size_t getHostDataSizeInBytes() const;
+
     void load(const std::map<int, DataReader*> &deviceToData);
 
+    /**
+     * Loads each device's file, either a binary data file (see BinaryDataHeader) or
+     * a text file with the given delimiters.
+     */
     void load(const std::map<int, std::string> &deviceToFile, char keyValDelim, char vecDelim);
 
     int getFeatureSize() const;
 
+    /**
+     * Enables add(), remove() and compact() and leaves room for rowsPerPartition more rows with
+     * keyBytesPerPartition more key characters in each partition. Must be called before load.
+     * CPU backend with FP32 or FP16 data only.
+     */
+    void reserve(uint32_t rowsPerPartition, size_t keyBytesPerPartition);
+
+    /**
+     * Rows of the partition (removed rows included) visible to searches.
+     */
+    uint32_t getNumRows(int partition) const
+    {
+        return hNumRows[partition].load(std::memory_order_acquire);
+    }
+
+    /**
+     * Appends keys.size() rows (vectors is keys.size() x getFeatureSize(), row major) to the reserved
+     * capacity of the partition. They become visible to searches all at once, once they are written.
+     * Throws std::runtime_error if the partition does not have the room, see compact().
+     */
+    void add(int partition, const std::vector<std::string> &keys, const float *vectors);
+
+    /**
+     * Marks the rows with the given keys (in any partition) as removed. Searches skip removed rows
+     * from then on; their memory is reclaimed by compact(). Scans the keys of all rows, so remove
+     * keys in batches. Returns the number of rows removed.
+     */
+    size_t remove(const std::vector<std::string> &keys);
+
+    bool isRemoved(uint32_t partition, uint32_t row) const
+    {
+        const std::vector<std::atomic<uint64_t>> &removedRows = hRemovedRows[partition];
+        return !removedRows.empty() && ((removedRows[row / 64].load(std::memory_order_relaxed) >> (row % 64)) & 1);
+    }
+
+    uint32_t getNumRemovedRows(int partition) const
+    {
+        return hNumRemovedRows[partition].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Rewrites the partition without its removed rows, with room for the reserved number of rows
+     * (see reserve()) again. Rows keep their order but their row numbers change, so (partition, row)
+     * results and KeyViews of the partition from before are invalid afterwards. The new partition
+     * is built on the side; searches only wait for the swap.
+     */
+    void compact(int partition);
+
+    /**
+     * Incremented by every compact(); indexes built over the rows (e.g. KnnIvfCpu) are stale once it changes.
+     */
+    uint64_t getGeneration() const
+    {
+        return generation.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Shared lock on the host partitions, held by CPU searches. add() and remove() never take it,
+     * compact() only holds it exclusively while it swaps in the compacted partition.
+     */
+    class SearchGuard
+    {
+      public:
+        explicit SearchGuard(const KnnData *data) :
+            data(data)
+        {
+            pthread_rwlock_rdlock(&data->partitionsLock);
+        }
+
+        ~SearchGuard()
+        {
+            pthread_rwlock_unlock(&data->partitionsLock);
+        }
+
+      private:
+        const KnnData *data;
+    };
+
     ~KnnData();
+
+  private:
+    uint32_t reservedRows;
+    size_t reservedKeyBytes;
+    bool updatable;
+    std::atomic<uint64_t> generation;
+    std::mutex updateMutex; // serializes add, remove and compact
+    mutable pthread_rwlock_t partitionsLock; // see SearchGuard
+
+    void checkUpdatable(int partition) const;
 };
 
 Matrix allocateMatrixOnHost(uint32_t numRows, int numColumns, size_t elementSize);
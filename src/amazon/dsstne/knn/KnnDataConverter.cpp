@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+
+/**
+ * Converts a KNN text data file (key<TAB>v1 v2 ...) into the binary data file
+ * format read by BinaryFileDataReader.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <unistd.h>
+
+#include "DataReader.h"
+
+namespace
+{
+void printUsage()
+{
+  fprintf(stderr, "Usage: knnDataConverter -i input_text_file -o output_binary_file [-t data_type] [-k key_value_delimiter] [-v vector_delimiter]\n");
+  fprintf(stderr, "    -i input_text_file: one key<key_value_delimiter>vector per line\n");
+  fprintf(stderr, "    -o output_binary_file: binary data file to write\n");
+  fprintf(stderr, "    -t data_type: (default = fp32) fp32 or fp16 element type of the binary file\n");
+  fprintf(stderr, "    -k key_value_delimiter: (default = TAB)\n");
+  fprintf(stderr, "    -v vector_delimiter: (default = SPACE)\n");
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  std::string inputFile;
+  std::string outputFile;
+  BinaryDataType dataType = BinaryDataType::FP32;
+  char keyValueDelimiter = '\t';
+  char vectorDelimiter = ' ';
+
+  int opt;
+  while ((opt = getopt(argc, argv, "i:o:t:k:v:h")) != -1)
+  {
+    switch (opt) {
+      case 'i':
+        inputFile = optarg;
+        break;
+      case 'o':
+        outputFile = optarg;
+        break;
+      case 't':
+        if (std::string(optarg) == "fp16")
+        {
+          dataType = BinaryDataType::FP16;
+        } else if (std::string(optarg) != "fp32")
+        {
+          fprintf(stderr, "ERROR: unknown data_type %s\n", optarg);
+          printUsage();
+          return 1;
+        }
+        break;
+      case 'k':
+        keyValueDelimiter = optarg[0];
+        break;
+      case 'v':
+        vectorDelimiter = optarg[0];
+        break;
+      default:
+        printUsage();
+        return 1;
+    }
+  }
+
+  if (inputFile.empty() || outputFile.empty())
+  {
+    printUsage();
+    return 1;
+  }
+
+  try
+  {
+    TextFileDataReader reader(inputFile, keyValueDelimiter, vectorDelimiter);
+    fprintf(stderr, "INFO: read %u rows and %d columns from %s\n", reader.getRows(), reader.getColumns(),
+        inputFile.c_str());
+    writeBinaryDataFile(&reader, outputFile, dataType);
+    fprintf(stderr, "INFO: wrote %s\n", outputFile.c_str());
+  } catch (const std::exception &e)
+  {
+    fprintf(stderr, "ERROR: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <functional>
+#include <omp.h>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#include <cblas.h>
+}
+
+#include "KnnExactCpu.h"
+#include "KnnHeap.h"
+
+namespace
+{
+// queries per sgemm; bounds the per thread products buffer together with DATA_BLOCK_SIZE
+static const int QUERY_BLOCK_SIZE = 64;
+// data rows per sgemm; products block is DATA_BLOCK_SIZE x QUERY_BLOCK_SIZE floats (1 MB)
+static const uint32_t DATA_BLOCK_SIZE = 4096;
+}  // namespace
+
+namespace astdl
+{
+namespace knn
+{
+
+KnnExactCpu::KnnExactCpu(KnnData *data) :
+    Knn(data)
+{
+  if (data->backend != Backend::CPU)
+  {
+    throw std::invalid_argument("KnnExactCpu requires KnnData created with Backend::CPU");
+  }
+}
+
+void KnnExactCpu::search(int k, const float *inputs, int size, std::string *keys, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), keys, scores);
+}
+
+void KnnExactCpu::search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), partitions, rows, scores);
+}
+
+void KnnExactCpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    std::string *keys, float *scores)
+{
+  if (size > data->batchSize)
+  {
+    std::stringstream msg;
+    msg << "size = " << size << " is > batchSize = " << data->batchSize;
+    throw std::invalid_argument(msg.str());
+  }
+
+  // rows must not move (see KnnData::compact) before their keys are resolved
+  KnnData::SearchGuard guard(data);
+  size_t resultSize = (size_t) size * k;
+  std::vector<uint32_t> partitions(resultSize);
+  std::vector<uint32_t> rows(resultSize);
+  search(k, inputs, size, exclusions, partitions.data(), rows.data(), scores);
+  resolveKeys(resultSize, partitions.data(), rows.data(), keys);
+}
+
+void KnnExactCpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  int maxK = data->maxK;
+  int batchSize = data->batchSize;
+  int numPartitions = data->numGpus;
+  int columns = data->getFeatureSize();
+  DataType dataType = data->dataType;
+  Metric metric = data->metric;
+
+  if (k > maxK)
+  {
+    std::stringstream msg;
+    msg << "k = " << k << " is > maxK = " << maxK;
+    throw std::invalid_argument(msg.str());
+  }
+
+  if (size > batchSize)
+  {
+    std::stringstream msg;
+    msg << "size = " << size << " is > batchSize = " << batchSize;
+    throw std::invalid_argument(msg.str());
+  }
+
+  checkExclusions(exclusions, size);
+  KnnData::SearchGuard guard(data);
+
+  // small batches get smaller query blocks so that every thread has work
+  int numThreads = omp_get_max_threads();
+  int queryBlockSize = std::max(1, std::min(QUERY_BLOCK_SIZE, (size + numThreads - 1) / numThreads));
+
+#pragma omp parallel
+  {
+    std::vector<float> products((size_t) DATA_BLOCK_SIZE * queryBlockSize);
+    // INT8: dequantized data block, PQ: lookup tables of the query block
+    std::vector<float> decoded(dataType == DataType::INT8 ? (size_t) DATA_BLOCK_SIZE * columns : 0);
+    std::vector<float> tables;
+    std::vector<std::vector<Candidate>> heaps(queryBlockSize);
+    for (auto &heap : heaps)
+    {
+      heap.reserve(k);
+    }
+
+#pragma omp for schedule(dynamic)
+    for (int queryStart = 0; queryStart < size; queryStart += queryBlockSize)
+    {
+      int queryCount = std::min(queryBlockSize, size - queryStart);
+      const float *queryBlock = inputs + (size_t) queryStart * columns;
+
+      for (int q = 0; q < queryCount; ++q)
+      {
+        heaps[q].clear();
+      }
+
+      for (int partition = 0; partition < numPartitions; ++partition)
+      {
+        const Matrix &hCollection = data->hCollectionPartitions[partition];
+        // rows added after this point are not searched; ld is the capacity of the partition
+        uint32_t numRows = data->getNumRows(partition);
+        size_t ld = hCollection.numRows;
+
+        if (dataType == DataType::PQ)
+        {
+          // asymmetric distance tables of the query block against this partition's codebooks
+          const ProductQuantizer &quantizer = data->hProductQuantizers[partition];
+          size_t tableSize = (size_t) quantizer.getNumSubspaces() * quantizer.getNumCentroids();
+          tables.resize(tableSize * queryCount);
+          for (int q = 0; q < queryCount; ++q)
+          {
+            quantizer.computeLookupTable(queryBlock + (size_t) q * columns, tables.data() + q * tableSize);
+          }
+        }
+
+        for (uint32_t rowStart = 0; rowStart < numRows; rowStart += DATA_BLOCK_SIZE)
+        {
+          uint32_t rowCount = std::min(DATA_BLOCK_SIZE, numRows - rowStart);
+
+          if (dataType == DataType::PQ)
+          {
+            const ProductQuantizer &quantizer = data->hProductQuantizers[partition];
+            int codeSize = quantizer.getCodeSize();
+            size_t tableSize = (size_t) quantizer.getNumSubspaces() * quantizer.getNumCentroids();
+            const uint8_t *codes = (const uint8_t*) hCollection.data + (size_t) rowStart * codeSize;
+            for (int q = 0; q < queryCount; ++q)
+            {
+              const float *table = tables.data() + q * tableSize;
+              float *queryProducts = products.data() + (size_t) q * rowCount;
+              for (uint32_t i = 0; i < rowCount; ++i)
+              {
+                queryProducts[i] = quantizer.score(table, codes + (size_t) i * codeSize);
+              }
+            }
+          } else
+          {
+            const float *collectionBlock = (const float*) hCollection.data + rowStart;
+            int blockLd = ld;
+            if (dataType == DataType::INT8)
+            {
+              // dequantize the block (column major) and score it like fp32
+              const ScalarQuantizer &quantizer = data->hScalarQuantizers[partition];
+              const uint8_t *codes = (const uint8_t*) hCollection.data + rowStart;
+              for (int j = 0; j < columns; ++j)
+              {
+                const uint8_t *columnCodes = codes + (size_t) j * ld;
+                float *decodedColumn = decoded.data() + (size_t) j * rowCount;
+                for (uint32_t i = 0; i < rowCount; ++i)
+                {
+                  decodedColumn[i] = quantizer.decode(j, columnCodes[i]);
+                }
+              }
+              collectionBlock = decoded.data();
+              blockLd = rowCount;
+            }
+
+            // products (rowCount x queryCount, column major) = collection block (rowCount x columns, column major)
+            //   x queries^T (columns x queryCount, column major == queryCount x columns row major)
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, rowCount, queryCount, columns, 1.0f,
+                collectionBlock, blockLd, queryBlock, columns, 0.0f, products.data(), rowCount);
+          }
+
+          // fold the block (with the row norm correction of the metric) into the running
+          // top k of each query while it is still in cache
+          const float *rowNorms = metric == Metric::INNER_PRODUCT ? nullptr : data->hRowNorms[partition].data() + rowStart;
+          uint64_t idStart = ((uint64_t) partition << 32) | rowStart;
+          for (int q = 0; q < queryCount; ++q)
+          {
+            foldScores(metric, rowNorms, heaps[q], k, products.data() + (size_t) q * rowCount, rowCount,
+                [idStart](size_t i)
+                {
+                  return idStart + i;
+                }, RowFilter { data, getExclusions(exclusions, queryStart + q) });
+          }
+        }
+      }
+
+      for (int q = 0; q < queryCount; ++q)
+      {
+        // fewer than k rows in the data leave INVALID_INDEX slots
+        size_t offset = (size_t) (queryStart + q) * k;
+        float queryNorm = getQueryNorm(metric, queryBlock + (size_t) q * columns, columns);
+        writeResults(heaps[q], k, metric, queryNorm, scores + offset, partitions + offset, rows + offset);
+      }
+    }
+  }
+}
+
+} // namespace knn
+} // namespace astdl
@@ -0,0 +1,78 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KNN_EXACT_CPU_H_
+#define LIBKNN_KNN_EXACT_CPU_H_
+
+#include "Knn.h"
+#include "KnnData.h"
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * Exact (brute force) inner product search on the host. Requires KnnData
+ * created with Backend::CPU. Queries are processed in blocks; for each block
+ * the scores against a block of data rows are computed with a single sgemm
+ * and immediately folded into per query top k heaps, so the full
+ * query x data product matrix is never materialized. Query blocks are
+ * searched in parallel with OpenMP.
+ *
+ * With INT8 data each block is dequantized before the sgemm; with PQ data
+ * the scores come from per query lookup tables (asymmetric distance). The
+ * search is still exhaustive, but over the quantized vectors, so the results
+ * are approximate.
+ *
+ * Cosine and L2 (KnnData::metric) apply the row norms to the scores of each
+ * block as they are folded into the heaps, so they cost the same as inner
+ * products.
+ *
+ * Searches see the rows of KnnData::add and skip those of KnnData::remove as
+ * soon as the call returns, and only wait for KnnData::compact to swap in
+ * the compacted partition.
+ */
+class KnnExactCpu: public Knn
+{
+  public:
+    KnnExactCpu(KnnData *data);
+
+    void search(int k, const float *inputs, int size, std::string *keys, float *scores);
+
+    void search(int k, const float *inputs, std::string *keys, float *scores)
+    {
+        search(k, inputs, data->batchSize, keys, scores);
+    }
+
+    void search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores);
+
+    void search(int k, const float *inputs, uint32_t *partitions, uint32_t *rows, float *scores)
+    {
+        search(k, inputs, data->batchSize, partitions, rows, scores);
+    }
+
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        std::string *keys, float *scores);
+
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        uint32_t *partitions, uint32_t *rows, float *scores);
+};
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KNN_EXACT_CPU_H_ */
@@ -30,17 +30,14 @@ namespace astdl
 namespace knn
 {
 
-Knn::Knn(KnnData *data) :
-    data(data)
-{
-}
-
 KnnExactGpu::KnnExactGpu(KnnData *data) :
     Knn(data)
 {
 }
 
-void KnnExactGpu::search(int k, const float *inputs, int size, std::string *keys, float *scores)
+void KnnExactGpu::searchPartitions(int k, const float *inputs, int size,
+    const std::vector<const ExclusionSet*> &exclusions, std::vector<float*> &allScores,
+    std::vector<uint32_t*> &allIndexes)
 {
   int maxK = data->maxK;
   int batchSize = data->batchSize;
@@ -57,17 +54,19 @@ void KnnExactGpu::search(int k, const float *inputs, int size, std::string *keys
   {
       std::stringstream msg;
       msg << "size = " << size << " is > batchSize = " << batchSize;
+      throw std::invalid_argument(msg.str());
   }
 
+  checkExclusions(exclusions, size);
+
   // only process "size" (subset) of batch
   batchSize = size;
 
   // results from each GPU
-  std::vector<float*> allScores(numGpus);
-  std::vector<uint32_t*> allIndexes(numGpus);
+  allScores.resize(numGpus);
+  allIndexes.resize(numGpus);
 
-  omp_set_num_threads(numGpus);
-#pragma omp parallel
+#pragma omp parallel num_threads(numGpus)
   {
     int device = omp_get_thread_num();
     CHECK_ERR(cudaSetDevice(device));
@@ -141,7 +140,22 @@ void KnnExactGpu::search(int k, const float *inputs, int size, std::string *keys
     data->elapsedSgemm[device] = elapsed;
 
     CHECK_ERR(cudaEventRecord(start, 0));
-    kCalculateTopK((float*) dC, dScores, dIndexes, cRows, cColumns, paddedRows, maxK);
+    if (!exclusions.empty())
+    {
+      excludeRows(device, exclusions, size, (float*) dC, cColumns);
+    }
+    // the row side of cosine and l2 is applied while selecting, see KnnData::hRowNorms
+    float *dRowNorms = (float*) data->dRowNorms[device].data;
+    switch (data->metric) {
+      case Metric::COSINE:
+        kCalculateTopKCosine((float*) dC, dRowNorms, dScores, dIndexes, cRows, cColumns, paddedRows, maxK);
+        break;
+      case Metric::L2:
+        kCalculateTopKL2((float*) dC, dRowNorms, dScores, dIndexes, cRows, cColumns, paddedRows, maxK);
+        break;
+      default:
+        kCalculateTopK((float*) dC, dScores, dIndexes, cRows, cColumns, paddedRows, maxK);
+    }
     CHECK_ERR(cudaEventRecord(stop, 0));
     CHECK_ERR(cudaEventSynchronize(stop));
     CHECK_ERR(cudaEventElapsedTime(&elapsed, start, stop));
@@ -154,47 +168,92 @@ void KnnExactGpu::search(int k, const float *inputs, int size, std::string *keys
     allScores[device] = hScores;
     allIndexes[device] = hIndexes;
   }
-
-  mergeKnn(k, batchSize, maxK, numGpus, allScores, allIndexes, data->hKeys, scores, keys);
 }
 
-void mergeKnn(int k, int batchSize, int width, int numGpus, const std::vector<float*> &allScores,
-    const std::vector<uint32_t*> &allIndexes, const std::vector<std::vector<std::string>> &allKeys, float *scores,
-    std::string *keys)
+void KnnExactGpu::excludeRows(int device, const std::vector<const ExclusionSet*> &exclusions, int size,
+    float *dProducts, uint32_t width)
 {
+  uint32_t actualRows = data->dCollectionPartitions[device].numRows - data->collectionRowsPadded[device];
+  bool global = exclusions.size() == 1;
+  int numSets = global ? 1 : size;
 
-  for (int i = 0; i < batchSize; ++i)
+  // excluded rows of this partition, concatenated over the sets
+  std::vector<uint32_t> offsets(numSets + 1, 0);
+  std::vector<uint32_t> rows;
+  std::vector<uint32_t> setRows;
+  for (int i = 0; i < numSets; ++i)
   {
-    // keeps track of the index if each array as we perform a merge; initialize to rowStartIdx
-    int posIdxs[numGpus];
-    for (int n = 0; n < numGpus; n++)
+    if (exclusions[i] != nullptr)
     {
-      posIdxs[n] = i * width;
+      exclusions[i]->getRows(device, actualRows, &setRows);
+      rows.insert(rows.end(), setRows.begin(), setRows.end());
     }
-    for (int col = 0; col < k; col++)
+    offsets[i + 1] = rows.size();
+  }
+  if (rows.empty())
+  {
+    return;
+  }
+
+  Matrix dRows = allocateMatrixOnDevice(1, rows.size(), sizeof(uint32_t));
+  Matrix dOffsets = allocateMatrixOnDevice(1, offsets.size(), sizeof(uint32_t));
+  CHECK_ERR(cudaMemcpy(dRows.data, rows.data(), dRows.getSizeInBytes(), cudaMemcpyHostToDevice));
+  CHECK_ERR(cudaMemcpy(dOffsets.data, offsets.data(), dOffsets.getSizeInBytes(), cudaMemcpyHostToDevice));
+  kExcludeRows(dProducts, width, (uint32_t*) dRows.data, (uint32_t*) dOffsets.data, rows.size(), size, global);
+  freeMatrix(dRows);
+  freeMatrix(dOffsets);
+}
+
+void KnnExactGpu::search(int k, const float *inputs, int size, std::string *keys, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), keys, scores);
+}
+
+void KnnExactGpu::search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), partitions, rows, scores);
+}
+
+void KnnExactGpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    std::string *keys, float *scores)
+{
+  std::vector<float*> allScores;
+  std::vector<uint32_t*> allIndexes;
+  searchPartitions(k, inputs, size, exclusions, allScores, allIndexes);
+  mergeKnn(k, size, data->maxK, data->numGpus, allScores, allIndexes, data->hKeys, scores, keys);
+  applyQueryNorms(k, inputs, size, scores);
+}
+
+void KnnExactGpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  std::vector<float*> allScores;
+  std::vector<uint32_t*> allIndexes;
+  searchPartitions(k, inputs, size, exclusions, allScores, allIndexes);
+  mergeKnn(k, size, data->maxK, data->numGpus, allScores, allIndexes, scores, partitions, rows);
+  applyQueryNorms(k, inputs, size, scores);
+}
+
+void KnnExactGpu::applyQueryNorms(int k, const float *inputs, int size, float *scores)
+{
+  Metric metric = data->metric;
+  if (metric == Metric::INNER_PRODUCT)
+  {
+    return;
+  }
+
+  int columns = data->getFeatureSize();
+#pragma omp parallel for
+  for (int q = 0; q < size; ++q)
+  {
+    float queryNorm = getQueryNorm(metric, inputs + (size_t) q * columns, columns);
+    float *queryScores = scores + (size_t) q * k;
+    for (int i = 0; i < k; ++i)
     {
-      // initialize minValue and minIndex to the posIdx of GPU 0 results
-      int deviceId_0 = 0;
-      int posIdx_0 = posIdxs[deviceId_0];
-      float maxVal = allScores[deviceId_0][posIdx_0];
-      uint32_t maxIdx = allIndexes[deviceId_0][posIdx_0];
-      int maxDeviceId = deviceId_0;
-
-      for (int deviceId = 0; deviceId < numGpus; deviceId++)
-      {
-        int posIdx = posIdxs[deviceId];
-        if (maxVal < allScores[deviceId][posIdx])
-        {
-          maxVal = allScores[deviceId][posIdx];
-          maxIdx = allIndexes[deviceId][posIdx];
-          maxDeviceId = deviceId;
-        }
-      }
-      ++posIdxs[maxDeviceId];
-      scores[i * k + col] = maxVal;
-      keys[i * k + col] = allKeys[maxDeviceId][maxIdx];
+      queryScores[i] = getFinalScore(metric, queryScores[i], queryNorm);
     }
   }
 }
+
 } // namespace knn
 } // namespace astdl
@@ -18,55 +18,61 @@
 #ifndef LIBKNN_KNN_EXACT_GPU_H_
 #define LIBKNN_KNN_EXACT_GPU_H_
 
+#include "Knn.h"
 #include "KnnData.h"
+#include "KnnMerge.h"
 
 namespace astdl
 {
 namespace knn
 {
-class Knn
+class KnnExactGpu: public Knn
 {
   public:
+    KnnExactGpu(KnnData *data);
 
-    virtual void search(int k, const float *inputs, std::string *keys, float *scores) = 0;
+    void search(int k, const float *inputs, int size, std::string *keys, float *scores);
 
-    virtual ~Knn()
+    void search(int k, const float *inputs, std::string *keys, float *scores)
     {
+        search(k, inputs, data->batchSize, keys, scores);
+    }
+
+    void search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores);
 
+    void search(int k, const float *inputs, uint32_t *partitions, uint32_t *rows, float *scores)
+    {
+        search(k, inputs, data->batchSize, partitions, rows, scores);
     }
 
-  protected:
-    KnnData *data;
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        std::string *keys, float *scores);
 
-    Knn(KnnData *data);
-};
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        uint32_t *partitions, uint32_t *rows, float *scores);
 
-class KnnExactGpu: public Knn
-{
-  public:
-    KnnExactGpu(KnnData *data);
+  private:
+    /**
+     * runs the top maxK search on every GPU and copies the results (size x maxK) of
+     * each to allScores[device] and allIndexes[device] (host buffers owned by data).
+     */
+    void searchPartitions(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        std::vector<float*> &allScores, std::vector<uint32_t*> &allIndexes);
 
-    void search(int k, const float *inputs, int size, std::string *keys, float *scores);
+    /**
+     * sets the products (size x width on the device) of the rows of the device's partition that are
+     * excluded to -MAX_VALUE before the top k is selected.
+     */
+    void excludeRows(int device, const std::vector<const ExclusionSet*> &exclusions, int size, float *dProducts,
+        uint32_t width);
 
-    void search(int k, const float *inputs, std::string *keys, float *scores)
-    {
-        search(k, inputs, data->batchSize, keys, scores);
-    }
+    /**
+     * turns the merged, row corrected scores (size x k) into the scores of the metric.
+     */
+    void applyQueryNorms(int k, const float *inputs, int size, float *scores);
 
 };
 
-/**
- * merges the top k results from each of the GPUs.
- *   batchSize - number of rows in g_scores[i], and g_indexes[i]
- *    k - number of columns in g_scores[i] and g_indexes[i]
- *    g_scores - top k scores (k x batchSize) from each GPU
- *    g_indexes - top k indexes (k x batchSize) from each GPU
- *    scores - where to store the merged top k scores (must malloc k x batchSize x sizeof(float))
- *    indexes - where to store the merged top k indexes (must malloc k x batchSize x sizeof(float))
- */
-void mergeKnn(int k, int batchSize, int width, int numGpus, const std::vector<float*> &allScores,
-    const std::vector<uint32_t*> &allIndexes, const std::vector<std::vector<std::string>> &allKeys, float *scores,
-    std::string *keys);
 } // namespace knn
 } // namespace astdl
 
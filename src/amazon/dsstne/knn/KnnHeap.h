@@ -0,0 +1,170 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KNN_HEAP_H_
+#define LIBKNN_KNN_HEAP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "ExclusionSet.h"
+#include "Knn.h"
+#include "KnnData.h"
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * top k selection of the CPU searches: a min heap (on score) of the best k candidates of a query.
+ * candidates are (score, partition << 32 | row); std::greater makes the heap a min heap on score.
+ */
+typedef std::pair<float, uint64_t> Candidate;
+typedef std::greater<Candidate> MinHeapCompare;
+
+/**
+ * rows a search must not return: the exclusions of the query (may be nullptr) and the rows removed
+ * from the data (see KnnData::remove).
+ */
+struct RowFilter
+{
+    const KnnData *data;
+    const ExclusionSet *exclusions;
+
+    bool excludes(uint64_t id) const
+    {
+        return (exclusions != nullptr && exclusions->contains(id)) || data->isRemoved(id >> 32, id & 0xFFFFFFFF);
+    }
+};
+
+/**
+ * adds the candidate if it is one of the best k so far and not filtered out.
+ * the filter is only looked up for candidates that would enter the heap.
+ */
+inline void pushCandidate(std::vector<Candidate> &heap, size_t k, float score, uint64_t id, const RowFilter &filter)
+{
+    if (heap.size() < k)
+    {
+        if (!filter.excludes(id))
+        {
+            heap.emplace_back(score, id);
+            std::push_heap(heap.begin(), heap.end(), MinHeapCompare());
+        }
+    } else if (score > heap.front().first && !filter.excludes(id))
+    {
+        std::pop_heap(heap.begin(), heap.end(), MinHeapCompare());
+        heap.back() = Candidate(score, id);
+        std::push_heap(heap.begin(), heap.end(), MinHeapCompare());
+    }
+}
+
+/*
+ * row side of the metric applied to the inner product of the i-th row of a block, see KnnData::hRowNorms
+ */
+struct InnerProductScore
+{
+    float operator()(float product, size_t) const
+    {
+        return product;
+    }
+};
+
+struct CosineScore
+{
+    const float *rowNorms;
+
+    float operator()(float product, size_t i) const
+    {
+        return product * rowNorms[i];
+    }
+};
+
+struct L2Score
+{
+    const float *rowNorms;
+
+    float operator()(float product, size_t i) const
+    {
+        return 2.0f * product - rowNorms[i];
+    }
+};
+
+/**
+ * folds the inner products of a query with count rows into its heap, scoring row i as score(products[i], i)
+ * and identifying it as id(i). Rows excluded by the filter are skipped.
+ */
+template<typename Score, typename Id>
+void foldScores(std::vector<Candidate> &heap, size_t k, const float *products, size_t count, Score score, Id id,
+    const RowFilter &filter)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        pushCandidate(heap, k, score(products[i], i), id(i), filter);
+    }
+}
+
+/**
+ * as above for the given metric. rowNorms[i] is the KnnData::hRowNorms entry of row i (unused for INNER_PRODUCT).
+ */
+template<typename Id>
+void foldScores(Metric metric, const float *rowNorms, std::vector<Candidate> &heap, size_t k, const float *products,
+    size_t count, Id id, const RowFilter &filter)
+{
+    switch (metric) {
+        case Metric::COSINE:
+            foldScores(heap, k, products, count, CosineScore { rowNorms }, id, filter);
+            break;
+        case Metric::L2:
+            foldScores(heap, k, products, count, L2Score { rowNorms }, id, filter);
+            break;
+        default:
+            foldScores(heap, k, products, count, InnerProductScore(), id, filter);
+    }
+}
+
+/**
+ * sorts the heap (best first) into the k results of a query, applying the query side of the metric
+ * (see getQueryNorm). Slots without a candidate get INVALID_INDEX and a score of 0.
+ */
+inline void writeResults(std::vector<Candidate> &heap, int k, Metric metric, float queryNorm, float *scores,
+    uint32_t *partitions, uint32_t *rows)
+{
+    // ascending order under greater<> is descending by score
+    std::sort_heap(heap.begin(), heap.end(), MinHeapCompare());
+    for (int col = 0; col < k; ++col)
+    {
+        if (col < (int) heap.size())
+        {
+            scores[col] = getFinalScore(metric, heap[col].first, queryNorm);
+            partitions[col] = heap[col].second >> 32;
+            rows[col] = heap[col].second & 0xFFFFFFFF;
+        } else
+        {
+            scores[col] = 0.0f;
+            partitions[col] = Knn::INVALID_INDEX;
+            rows[col] = Knn::INVALID_INDEX;
+        }
+    }
+}
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KNN_HEAP_H_ */
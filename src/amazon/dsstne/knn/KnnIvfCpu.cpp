@@ -0,0 +1,349 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <numeric>
+#include <omp.h>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+extern "C"
+{
+#include <cblas.h>
+}
+
+#include "KMeans.h"
+#include "KnnHeap.h"
+#include "KnnIvfCpu.h"
+
+namespace
+{
+// rows gathered row major per kmeansAssign call when building the lists
+static const size_t ASSIGN_BLOCK_SIZE = 4096;
+}  // namespace
+
+namespace astdl
+{
+namespace knn
+{
+
+KnnIvfCpu::KnnIvfCpu(KnnData *data, int numLists, int nprobe, int trainIterations, int maxTrainingRowsPerList,
+    unsigned int seed) :
+    Knn(data),
+    numLists(numLists),
+    nprobe(1),
+    columns(data->getFeatureSize()),
+    maxListSize(0),
+    generation(data->getGeneration())
+{
+  if (data->backend != Backend::CPU)
+  {
+    throw std::invalid_argument("KnnIvfCpu requires KnnData created with Backend::CPU");
+  }
+
+  if (data->dataType != DataType::FP32 && data->dataType != DataType::FP16)
+  {
+    throw std::invalid_argument("KnnIvfCpu requires unquantized (fp32) KnnData");
+  }
+
+  // rows must not move (see KnnData::compact) while they are indexed
+  KnnData::SearchGuard guard(data);
+  size_t totalRows = 0;
+  for (int partition = 0; partition < data->numGpus; ++partition)
+  {
+    totalRows += data->getNumRows(partition);
+  }
+
+  if (numLists <= 0 || (size_t) numLists > totalRows)
+  {
+    std::stringstream msg;
+    msg << "numLists = " << numLists << " must be in [1, " << totalRows << "] (number of rows)";
+    throw std::invalid_argument(msg.str());
+  }
+
+  setNprobe(nprobe);
+
+  train(trainIterations, maxTrainingRowsPerList, seed);
+  buildLists();
+
+  fprintf(stderr, "INFO: built ivf index with %d lists over %zu rows. Largest list has %zu rows\n", numLists, totalRows,
+      maxListSize);
+}
+
+void KnnIvfCpu::setNprobe(int nprobe)
+{
+  if (nprobe <= 0 || nprobe > numLists)
+  {
+    std::stringstream msg;
+    msg << "nprobe = " << nprobe << " must be in [1, " << numLists << "] (numLists)";
+    throw std::invalid_argument(msg.str());
+  }
+  this->nprobe = nprobe;
+}
+
+void KnnIvfCpu::train(int trainIterations, int maxTrainingRowsPerList, unsigned int seed)
+{
+  int numPartitions = data->numGpus;
+
+  // uniform sample (without replacement) of the rows of all partitions
+  std::vector<uint64_t> ids;
+  for (int partition = 0; partition < numPartitions; ++partition)
+  {
+    uint32_t rows = data->getNumRows(partition);
+    for (uint32_t row = 0; row < rows; ++row)
+    {
+      ids.push_back(((uint64_t) partition << 32) | row);
+    }
+  }
+
+  std::mt19937 generator(seed);
+  size_t numSamples = std::min(ids.size(), (size_t) numLists * std::max(1, maxTrainingRowsPerList));
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    std::uniform_int_distribution<size_t> pick(i, ids.size() - 1);
+    std::swap(ids[i], ids[pick(generator)]);
+  }
+  ids.resize(numSamples);
+
+  // gather the sample row major
+  std::vector<float> samples(numSamples * columns);
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const Matrix &hCollection = data->hCollectionPartitions[ids[i] >> 32];
+    const float *collection = (const float*) hCollection.data;
+    uint32_t row = ids[i] & 0xFFFFFFFF;
+    for (int j = 0; j < columns; ++j)
+    {
+      samples[i * columns + j] = collection[(size_t) j * hCollection.numRows + row];
+    }
+  }
+
+  centroids.resize((size_t) numLists * columns);
+  centroidNorms.resize(numLists);
+  kmeansTrain(samples.data(), numSamples, columns, numLists, trainIterations, seed, centroids.data());
+  kmeansCentroidNorms(centroids.data(), numLists, columns, centroidNorms.data());
+}
+
+void KnnIvfCpu::buildLists()
+{
+  int numPartitions = data->numGpus;
+
+  // assign every row, one row major block of rows at a time
+  std::vector<std::vector<int>> assignments(numPartitions);
+  std::vector<float> block(ASSIGN_BLOCK_SIZE * columns);
+  std::vector<size_t> counts(numLists);
+  for (int partition = 0; partition < numPartitions; ++partition)
+  {
+    const Matrix &hCollection = data->hCollectionPartitions[partition];
+    const float *collection = (const float*) hCollection.data;
+    uint32_t rows = data->getNumRows(partition);
+    size_t ld = hCollection.numRows;
+    assignments[partition].resize(rows);
+
+    for (uint32_t rowStart = 0; rowStart < rows; rowStart += ASSIGN_BLOCK_SIZE)
+    {
+      uint32_t rowCount = std::min((uint32_t) ASSIGN_BLOCK_SIZE, rows - rowStart);
+      for (int j = 0; j < columns; ++j)
+      {
+        const float *column = collection + j * ld + rowStart;
+        for (uint32_t i = 0; i < rowCount; ++i)
+        {
+          block[(size_t) i * columns + j] = column[i];
+        }
+      }
+      kmeansAssign(block.data(), rowCount, columns, centroids.data(), centroidNorms.data(), numLists,
+          assignments[partition].data() + rowStart);
+    }
+
+    for (int l : assignments[partition])
+    {
+      ++counts[l];
+    }
+  }
+
+  listOffsets.assign(numLists + 1, 0);
+  std::partial_sum(counts.begin(), counts.end(), listOffsets.begin() + 1);
+  maxListSize = *std::max_element(counts.begin(), counts.end());
+
+  // scatter the rows into their lists
+  size_t totalRows = listOffsets[numLists];
+  listVectors.resize(totalRows * columns);
+  listIds.resize(totalRows);
+  if (data->metric != Metric::INNER_PRODUCT)
+  {
+    listNorms.resize(totalRows);
+  }
+  std::vector<size_t> next(listOffsets.begin(), listOffsets.end() - 1);
+  for (int partition = 0; partition < numPartitions; ++partition)
+  {
+    const Matrix &hCollection = data->hCollectionPartitions[partition];
+    const float *collection = (const float*) hCollection.data;
+    // the rows assigned above; rows added since are not indexed
+    uint32_t rows = assignments[partition].size();
+    size_t ld = hCollection.numRows;
+    for (uint32_t row = 0; row < rows; ++row)
+    {
+      size_t position = next[assignments[partition][row]]++;
+      listIds[position] = ((uint64_t) partition << 32) | row;
+      if (!listNorms.empty())
+      {
+        listNorms[position] = data->hRowNorms[partition][row];
+      }
+      for (int j = 0; j < columns; ++j)
+      {
+        listVectors[position * columns + j] = collection[j * ld + row];
+      }
+    }
+  }
+}
+
+void KnnIvfCpu::search(int k, const float *inputs, int size, std::string *keys, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), keys, scores);
+}
+
+void KnnIvfCpu::search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  search(k, inputs, size, std::vector<const ExclusionSet*>(), partitions, rows, scores);
+}
+
+void KnnIvfCpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    std::string *keys, float *scores)
+{
+  if (size > data->batchSize)
+  {
+    std::stringstream msg;
+    msg << "size = " << size << " is > batchSize = " << data->batchSize;
+    throw std::invalid_argument(msg.str());
+  }
+
+  // rows must not move (see KnnData::compact) before their keys are resolved
+  KnnData::SearchGuard guard(data);
+  size_t resultSize = (size_t) size * k;
+  std::vector<uint32_t> partitions(resultSize);
+  std::vector<uint32_t> rows(resultSize);
+  search(k, inputs, size, exclusions, partitions.data(), rows.data(), scores);
+  resolveKeys(resultSize, partitions.data(), rows.data(), keys);
+}
+
+void KnnIvfCpu::search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+    uint32_t *partitions, uint32_t *rows, float *scores)
+{
+  int maxK = data->maxK;
+  int batchSize = data->batchSize;
+
+  if (k > maxK)
+  {
+    std::stringstream msg;
+    msg << "k = " << k << " is > maxK = " << maxK;
+    throw std::invalid_argument(msg.str());
+  }
+
+  if (size > batchSize)
+  {
+    std::stringstream msg;
+    msg << "size = " << size << " is > batchSize = " << batchSize;
+    throw std::invalid_argument(msg.str());
+  }
+
+  checkExclusions(exclusions, size);
+  KnnData::SearchGuard guard(data);
+
+  if (data->getGeneration() != generation)
+  {
+    throw std::runtime_error("KnnData was compacted after the ivf index was built, rebuild the index");
+  }
+
+  Metric metric = data->metric;
+
+  // coarse scores of the whole batch: (size x numLists, row major) = inputs x centroids^T
+  std::vector<float> coarseScores((size_t) size * numLists);
+  cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, size, numLists, columns, 1.0f, inputs, columns,
+      centroids.data(), columns, 0.0f, coarseScores.data(), numLists);
+  if (metric != Metric::INNER_PRODUCT)
+  {
+    // rank the lists by the metric: q.c / |c| (cosine) or 2 q.c - |c|^2 (l2, the closest centroids)
+    for (size_t i = 0; i < coarseScores.size(); ++i)
+    {
+      float norm = centroidNorms[i % numLists];
+      if (metric == Metric::COSINE)
+      {
+        coarseScores[i] = norm > 0.0f ? coarseScores[i] / std::sqrt(norm) : 0.0f;
+      } else
+      {
+        coarseScores[i] = 2.0f * coarseScores[i] - norm;
+      }
+    }
+  }
+
+#pragma omp parallel
+  {
+    std::vector<int> lists(numLists);
+    std::vector<float> products(maxListSize);
+    std::vector<Candidate> heap;
+    heap.reserve(k);
+
+#pragma omp for schedule(dynamic)
+    for (int q = 0; q < size; ++q)
+    {
+      const float *query = inputs + (size_t) q * columns;
+      const float *queryCoarseScores = coarseScores.data() + (size_t) q * numLists;
+
+      // probe the lists whose centroids score highest against the query
+      std::iota(lists.begin(), lists.end(), 0);
+      std::partial_sort(lists.begin(), lists.begin() + nprobe, lists.end(), [queryCoarseScores](int a, int b)
+      {
+        return queryCoarseScores[a] > queryCoarseScores[b];
+      });
+
+      heap.clear();
+      for (int p = 0; p < nprobe; ++p)
+      {
+        int l = lists[p];
+        size_t listStart = listOffsets[l];
+        size_t listSize = listOffsets[l + 1] - listStart;
+        if (listSize == 0)
+        {
+          continue;
+        }
+
+        cblas_sgemv(CblasRowMajor, CblasNoTrans, listSize, columns, 1.0f, listVectors.data() + listStart * columns,
+            columns, query, 1, 0.0f, products.data(), 1);
+
+        const uint64_t *ids = listIds.data() + listStart;
+        foldScores(metric, listNorms.empty() ? nullptr : listNorms.data() + listStart, heap, k, products.data(),
+            listSize, [ids](size_t i)
+            {
+              return ids[i];
+            }, RowFilter { data, getExclusions(exclusions, q) });
+      }
+
+      // fewer than k rows in the probed lists leave INVALID_INDEX slots
+      size_t offset = (size_t) q * k;
+      writeResults(heap, k, metric, getQueryNorm(metric, query, columns), scores + offset, partitions + offset,
+          rows + offset);
+    }
+  }
+}
+
+} // namespace knn
+} // namespace astdl
@@ -0,0 +1,128 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KNN_IVF_CPU_H_
+#define LIBKNN_KNN_IVF_CPU_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Knn.h"
+#include "KnnData.h"
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * Approximate inner product search on the host using an inverted file index
+ * (IVF). Requires KnnData created with Backend::CPU.
+ *
+ * At construction the rows of all partitions are clustered into numLists
+ * lists with k-means (trained on a random sample of at most
+ * maxTrainingRowsPerList * numLists rows) and copied into contiguous,
+ * row major per list storage. A search scores the query against the
+ * centroids and then only scans the nprobe lists whose centroids have the
+ * highest inner product with the query (for cosine and L2, the highest
+ * cosine and the smallest distance). nprobe trades recall for latency;
+ * nprobe == numLists is an exact search.
+ *
+ * The index holds its own copy of the data, so the KnnData may be released
+ * once the index is built (hKeys are still needed to resolve results).
+ * Rows removed from the data (KnnData::remove) are skipped, rows added
+ * after the index was built are not indexed, and compacting the data
+ * invalidates the index (searches throw std::runtime_error).
+ */
+class KnnIvfCpu: public Knn
+{
+  public:
+    static const int DEFAULT_TRAIN_ITERATIONS = 10;
+    static const int DEFAULT_MAX_TRAINING_ROWS_PER_LIST = 256;
+
+    KnnIvfCpu(KnnData *data, int numLists, int nprobe = 1, int trainIterations = DEFAULT_TRAIN_ITERATIONS,
+        int maxTrainingRowsPerList = DEFAULT_MAX_TRAINING_ROWS_PER_LIST, unsigned int seed = 1);
+
+    void search(int k, const float *inputs, int size, std::string *keys, float *scores);
+
+    void search(int k, const float *inputs, std::string *keys, float *scores)
+    {
+        search(k, inputs, data->batchSize, keys, scores);
+    }
+
+    void search(int k, const float *inputs, int size, uint32_t *partitions, uint32_t *rows, float *scores);
+
+    void search(int k, const float *inputs, uint32_t *partitions, uint32_t *rows, float *scores)
+    {
+        search(k, inputs, data->batchSize, partitions, rows, scores);
+    }
+
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        std::string *keys, float *scores);
+
+    void search(int k, const float *inputs, int size, const std::vector<const ExclusionSet*> &exclusions,
+        uint32_t *partitions, uint32_t *rows, float *scores);
+
+    void setNprobe(int nprobe);
+
+    int getNprobe() const
+    {
+        return nprobe;
+    }
+
+    int getNumLists() const
+    {
+        return numLists;
+    }
+
+    /**
+     * Number of rows in list l.
+     */
+    size_t getListSize(int l) const
+    {
+        return listOffsets[l + 1] - listOffsets[l];
+    }
+
+  private:
+    const int numLists;
+    int nprobe;
+    int columns;
+
+    /*
+     * numLists x columns, row major
+     */
+    std::vector<float> centroids;
+    std::vector<float> centroidNorms; // squared l2 norm of each centroid
+
+    /*
+     * rows of list l are [listOffsets[l], listOffsets[l + 1])
+     */
+    std::vector<size_t> listOffsets;
+    std::vector<float> listVectors; // row major
+    std::vector<uint64_t> listIds; // partition << 32 | row
+    std::vector<float> listNorms; // KnnData::hRowNorms of each row, empty for Metric::INNER_PRODUCT
+    size_t maxListSize;
+    uint64_t generation; // KnnData::getGeneration() the index was built at
+
+    void train(int trainIterations, int maxTrainingRowsPerList, unsigned int seed);
+
+    void buildLists();
+};
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KNN_IVF_CPU_H_ */
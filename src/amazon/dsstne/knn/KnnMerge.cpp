@@ -0,0 +1,146 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+
+#include "KnnMerge.h"
+
+namespace
+{
+/**
+ * Head of one partition's result list. Orders the max heap by score, then by lower partition.
+ */
+struct Head
+{
+    float score;
+    uint32_t partition;
+
+    bool operator<(const Head &other) const
+    {
+      return score < other.score || (score == other.score && partition > other.partition);
+    }
+};
+}  // namespace
+
+namespace astdl
+{
+namespace knn
+{
+
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, float *scores, uint32_t *partitions, uint32_t *rows)
+{
+  if (numPartitions == 1)
+  {
+    // nothing to merge
+#pragma omp parallel for
+    for (int i = 0; i < batchSize; ++i)
+    {
+      std::copy_n(allScores[0] + (size_t) i * width, k, scores + (size_t) i * k);
+      std::copy_n(allIndexes[0] + (size_t) i * width, k, rows + (size_t) i * k);
+      std::fill_n(partitions + (size_t) i * k, k, 0);
+    }
+    return;
+  }
+
+#pragma omp parallel
+  {
+    std::vector<Head> heap;
+    heap.reserve(numPartitions);
+    std::vector<int> positions(numPartitions);
+
+#pragma omp for
+    for (int i = 0; i < batchSize; ++i)
+    {
+      size_t rowStart = (size_t) i * width;
+      heap.clear();
+      for (int n = 0; n < numPartitions; ++n)
+      {
+        positions[n] = 0;
+        heap.push_back( { allScores[n][rowStart], (uint32_t) n });
+      }
+      std::make_heap(heap.begin(), heap.end());
+
+      for (int col = 0; col < k; ++col)
+      {
+        std::pop_heap(heap.begin(), heap.end());
+        Head &head = heap.back();
+        uint32_t n = head.partition;
+        int position = positions[n]++;
+
+        size_t out = (size_t) i * k + col;
+        scores[out] = head.score;
+        partitions[out] = n;
+        rows[out] = allIndexes[n][rowStart + position];
+
+        if (position + 1 < width)
+        {
+          head.score = allScores[n][rowStart + position + 1];
+          std::push_heap(heap.begin(), heap.end());
+        } else
+        {
+          // partition exhausted
+          heap.pop_back();
+        }
+      }
+    }
+  }
+}
+
+namespace
+{
+void assignKey(const KeyArena &arena, uint32_t row, std::string *key)
+{
+  arena.copyKey(row, key);
+}
+
+void assignKey(const KeyArena &arena, uint32_t row, KeyView *key)
+{
+  *key = arena[row];
+}
+
+template<typename Key>
+void mergeKnnKeys(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, const std::vector<KeyArena> &allKeys, float *scores, Key *keys)
+{
+  size_t size = (size_t) batchSize * k;
+  std::vector<uint32_t> partitions(size);
+  std::vector<uint32_t> rows(size);
+  mergeKnn(k, batchSize, width, numPartitions, allScores, allIndexes, scores, partitions.data(), rows.data());
+
+#pragma omp parallel for
+  for (size_t i = 0; i < size; ++i)
+  {
+    assignKey(allKeys[partitions[i]], rows[i], &keys[i]);
+  }
+}
+}  // namespace
+
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, const std::vector<KeyArena> &allKeys, float *scores, std::string *keys)
+{
+  mergeKnnKeys(k, batchSize, width, numPartitions, allScores, allIndexes, allKeys, scores, keys);
+}
+
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, const std::vector<KeyArena> &allKeys, float *scores, KeyView *keys)
+{
+  mergeKnnKeys(k, batchSize, width, numPartitions, allScores, allIndexes, allKeys, scores, keys);
+}
+
+} // namespace knn
+} // namespace astdl
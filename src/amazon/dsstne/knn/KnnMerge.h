@@ -0,0 +1,62 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_KNN_MERGE_H_
+#define LIBKNN_KNN_MERGE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "KeyArena.h"
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * merges the per partition top k results into the overall top k with a k-way heap merge
+ * over (score, partition, row). Queries are merged in parallel.
+ *   k - number of results per query to produce (<= width)
+ *   batchSize - number of queries
+ *   width - number of columns (results per query, sorted by descending score) in allScores[i] and allIndexes[i]
+ *   allScores - top width scores (batchSize x width, row major) of each partition
+ *   allIndexes - rows (within the partition) of allScores
+ *   scores - where to store the merged top k scores (batchSize x k)
+ *   partitions, rows - where to store the partition and row of each merged result (batchSize x k)
+ * Ties are broken towards the lower partition.
+ */
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, float *scores, uint32_t *partitions, uint32_t *rows);
+
+/**
+ * as above, but stores the keys (allKeys[partition][row]) of the merged results. Keys are
+ * only looked up for the final k results of each query.
+ */
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, const std::vector<KeyArena> &allKeys, float *scores, std::string *keys);
+
+/**
+ * as above, but returns views of the keys in allKeys instead of copies.
+ */
+void mergeKnn(int k, int batchSize, int width, int numPartitions, const std::vector<float*> &allScores,
+    const std::vector<uint32_t*> &allIndexes, const std::vector<KeyArena> &allKeys, float *scores, KeyView *keys);
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_KNN_MERGE_H_ */
@@ -0,0 +1,167 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+extern "C"
+{
+#include <cblas.h>
+}
+
+#include "KMeans.h"
+#include "Quantizer.h"
+
+namespace
+{
+// vectors gathered per subspace when encoding
+static const size_t ENCODE_BLOCK_SIZE = 16384;
+}  // namespace
+
+namespace astdl
+{
+namespace knn
+{
+
+ScalarQuantizer::ScalarQuantizer() :
+    columns(0)
+{
+}
+
+void ScalarQuantizer::train(const float *vectors, size_t n, int columns)
+{
+  this->columns = columns;
+  min.assign(columns, std::numeric_limits<float>::max());
+  std::vector<float> max(columns, std::numeric_limits<float>::lowest());
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < columns; ++j)
+    {
+      float value = vectors[i * columns + j];
+      min[j] = std::min(min[j], value);
+      max[j] = std::max(max[j], value);
+    }
+  }
+
+  scale.resize(columns);
+  inverseScale.resize(columns);
+  for (int j = 0; j < columns; ++j)
+  {
+    if (n == 0)
+    {
+      min[j] = 0.0f;
+      max[j] = 0.0f;
+    }
+    scale[j] = (max[j] - min[j]) / 255.0f;
+    // constant dimension: every value encodes to 0 and decodes to min
+    inverseScale[j] = scale[j] > 0.0f ? 1.0f / scale[j] : 0.0f;
+  }
+}
+
+ProductQuantizer::ProductQuantizer() :
+    columns(0),
+    subspaceColumns(0),
+    numSubspaces(0),
+    numCentroids(0)
+{
+}
+
+void ProductQuantizer::train(const float *vectors, size_t n, int columns, int subspaceColumns, int iterations,
+    unsigned int seed)
+{
+  if (subspaceColumns <= 0 || subspaceColumns > columns)
+  {
+    std::stringstream msg;
+    msg << "subspaceColumns = " << subspaceColumns << " must be in [1, " << columns << "] (columns)";
+    throw std::invalid_argument(msg.str());
+  }
+  if (n == 0)
+  {
+    throw std::invalid_argument("ProductQuantizer needs at least one training vector");
+  }
+
+  this->columns = columns;
+  this->subspaceColumns = subspaceColumns;
+  numSubspaces = (columns + subspaceColumns - 1) / subspaceColumns;
+  numCentroids = (int) std::min((size_t) MAX_CENTROIDS, n);
+  codebooks.assign((size_t) numSubspaces * numCentroids * subspaceColumns, 0.0f);
+
+  std::vector<float> subvectors(n * subspaceColumns);
+  for (int m = 0; m < numSubspaces; ++m)
+  {
+    int width = getSubspaceWidth(m);
+    for (size_t i = 0; i < n; ++i)
+    {
+      std::copy_n(vectors + i * columns + m * subspaceColumns, width, subvectors.data() + i * width);
+    }
+    kmeansTrain(subvectors.data(), n, width, numCentroids, iterations, seed + m,
+        codebooks.data() + (size_t) m * numCentroids * subspaceColumns);
+  }
+}
+
+void ProductQuantizer::encode(const float *vectors, size_t n, uint8_t *codes) const
+{
+  std::vector<float> subvectors(std::min(n, ENCODE_BLOCK_SIZE) * subspaceColumns);
+  std::vector<int> assignments(std::min(n, ENCODE_BLOCK_SIZE));
+  std::vector<float> norms(numCentroids);
+
+  for (int m = 0; m < numSubspaces; ++m)
+  {
+    int width = getSubspaceWidth(m);
+    const float *codebook = getCodebook(m);
+    kmeansCentroidNorms(codebook, numCentroids, width, norms.data());
+
+    for (size_t start = 0; start < n; start += ENCODE_BLOCK_SIZE)
+    {
+      size_t count = std::min(ENCODE_BLOCK_SIZE, n - start);
+      for (size_t i = 0; i < count; ++i)
+      {
+        std::copy_n(vectors + (start + i) * columns + m * subspaceColumns, width, subvectors.data() + i * width);
+      }
+      kmeansAssign(subvectors.data(), count, width, codebook, norms.data(), numCentroids, assignments.data());
+      for (size_t i = 0; i < count; ++i)
+      {
+        codes[(start + i) * numSubspaces + m] = (uint8_t) assignments[i];
+      }
+    }
+  }
+}
+
+void ProductQuantizer::decode(const uint8_t *code, float *vector) const
+{
+  for (int m = 0; m < numSubspaces; ++m)
+  {
+    int width = getSubspaceWidth(m);
+    std::copy_n(getCodebook(m) + (size_t) code[m] * width, width, vector + m * subspaceColumns);
+  }
+}
+
+void ProductQuantizer::computeLookupTable(const float *query, float *table) const
+{
+  for (int m = 0; m < numSubspaces; ++m)
+  {
+    int width = getSubspaceWidth(m);
+    // table row m = codebook (numCentroids x width) x query sub vector
+    cblas_sgemv(CblasRowMajor, CblasNoTrans, numCentroids, width, 1.0f, getCodebook(m), width,
+        query + m * subspaceColumns, 1, 0.0f, table + m * numCentroids, 1);
+  }
+}
+
+} // namespace knn
+} // namespace astdl
@@ -0,0 +1,177 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef LIBKNN_QUANTIZER_H_
+#define LIBKNN_QUANTIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace astdl
+{
+namespace knn
+{
+/**
+ * Per dimension 8-bit scalar quantization. Each dimension j is mapped
+ * linearly from [min_j, max_j] (observed on the training sample) onto the
+ * codes 0..255; values outside the range are clamped. 4x smaller than fp32
+ * with a reconstruction error of at most scale_j / 2 inside the range.
+ */
+class ScalarQuantizer
+{
+  public:
+    ScalarQuantizer();
+
+    /**
+     * Learns the per dimension ranges from n row major vectors.
+     */
+    void train(const float *vectors, size_t n, int columns);
+
+    uint8_t encode(int column, float value) const
+    {
+        float code = (value - min[column]) * inverseScale[column] + 0.5f;
+        return code <= 0.0f ? 0 : (code >= 255.0f ? 255 : (uint8_t) code);
+    }
+
+    float decode(int column, uint8_t code) const
+    {
+        return min[column] + scale[column] * code;
+    }
+
+    int getColumns() const
+    {
+        return columns;
+    }
+
+  private:
+    int columns;
+    std::vector<float> min;
+    std::vector<float> scale;
+    std::vector<float> inverseScale;
+};
+
+/**
+ * Product quantization. The columns are split into numSubspaces consecutive
+ * subspaces of subspaceColumns dimensions (the last one may be narrower)
+ * and each subspace gets a codebook of up to 256 centroids learned with
+ * k-means, so a vector is stored as one byte per subspace.
+ *
+ * Inner products are computed asymmetrically (ADC): the query stays in fp32
+ * and computeLookupTable precomputes its inner product with every centroid,
+ * after which the score of a code is the sum of numSubspaces table lookups.
+ */
+class ProductQuantizer
+{
+  public:
+    static const int MAX_CENTROIDS = 256;
+
+    ProductQuantizer();
+
+    /**
+     * Learns the codebooks from n row major vectors. Uses min(256, n) centroids per subspace.
+     */
+    void train(const float *vectors, size_t n, int columns, int subspaceColumns, int iterations, unsigned int seed);
+
+    /**
+     * Encodes n row major vectors into n x getCodeSize() bytes (row major).
+     */
+    void encode(const float *vectors, size_t n, uint8_t *codes) const;
+
+    /**
+     * Reconstructs the vector of a code.
+     */
+    void decode(const uint8_t *code, float *vector) const;
+
+    /**
+     * Fills table (getNumSubspaces() x getNumCentroids(), row major) with the
+     * inner products of the query sub vectors with the centroids.
+     */
+    void computeLookupTable(const float *query, float *table) const;
+
+    /**
+     * Approximate inner product of the query whose table is given with the code.
+     */
+    float score(const float *table, const uint8_t *code) const
+    {
+        float sum = 0.0f;
+        for (int m = 0; m < numSubspaces; ++m)
+        {
+            sum += table[m * numCentroids + code[m]];
+        }
+        return sum;
+    }
+
+    int getColumns() const
+    {
+        return columns;
+    }
+
+    int getNumSubspaces() const
+    {
+        return numSubspaces;
+    }
+
+    int getNumCentroids() const
+    {
+        return numCentroids;
+    }
+
+    /**
+     * Bytes per encoded vector.
+     */
+    int getCodeSize() const
+    {
+        return numSubspaces;
+    }
+
+    /**
+     * Bytes used by the codebooks.
+     */
+    size_t getCodebookSizeInBytes() const
+    {
+        return codebooks.size() * sizeof(float);
+    }
+
+  private:
+    int columns;
+    int subspaceColumns;
+    int numSubspaces;
+    int numCentroids;
+
+    /*
+     * the codebook of subspace m is numCentroids x getSubspaceWidth(m) (row major)
+     * starting at m * numCentroids * subspaceColumns
+     */
+    std::vector<float> codebooks;
+
+    int getSubspaceWidth(int m) const
+    {
+        int remaining = columns - m * subspaceColumns;
+        return remaining < subspaceColumns ? remaining : subspaceColumns;
+    }
+
+    const float *getCodebook(int m) const
+    {
+        return codebooks.data() + (size_t) m * numCentroids * subspaceColumns;
+    }
+};
+
+} // namespace knn
+} // namespace astdl
+
+#endif /* LIBKNN_QUANTIZER_H_ */
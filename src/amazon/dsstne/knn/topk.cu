@@ -26,10 +26,43 @@
  * to enable cublas to run the fp16 sgemm kernels on tensorcores.
  */
 
+/*
+ * Score corrections applied to each product as it is read by kCalculateTopK_kernel.
+ * Excluded products (-MAX_VALUE, see kExcludeRows) must stay <= -MAX_VALUE.
+ */
+struct InnerProduct
+{
+    __device__ __forceinline__ NNFloat operator()(NNFloat product, uint32_t) const
+    {
+        return product;
+    }
+};
+
+struct Cosine
+{
+    const NNFloat* pNorm;
+
+    __device__ __forceinline__ NNFloat operator()(NNFloat product, uint32_t pos) const
+    {
+        return (product <= -MAX_VALUE) ? product : product * pNorm[pos];
+    }
+};
+
+struct L2
+{
+    const NNFloat* pNorm;
+
+    __device__ __forceinline__ NNFloat operator()(NNFloat product, uint32_t pos) const
+    {
+        return (NNFloat)2.0 * product - pNorm[pos];
+    }
+};
+
+template<typename Correction>
 static __global__ void
 LAUNCH_BOUNDS()
 kCalculateTopK_kernel(NNFloat* pOutputBuffer, NNFloat* pKeyBuffer, uint32_t* pValueBuffer, uint32_t batch,
-    uint32_t width, uint32_t widthPadding, uint32_t k)
+    uint32_t width, uint32_t widthPadding, uint32_t k, Correction correction)
 {
 __shared__ volatile NNFloat sKey[160 * 4];
 __shared__ volatile uint32_t sValue[160 * 4];
@@ -68,25 +101,25 @@ __shared__ volatile uint32_t sValue[160 * 4];
         uint32_t wpos               = tgx;
         if (wpos < dataWidth)
         {
-            k0                      = pOutput[wpos];
+            k0                      = correction(pOutput[wpos], wpos);
             v0                      = wpos;
         }
         wpos                       += 32;
         if (wpos < dataWidth)
         {
-            k1                      = pOutput[wpos];
+            k1                      = correction(pOutput[wpos], wpos);
             v1                      = wpos;
         }
         wpos                       += 32;
         if (wpos < dataWidth)
         {
-            k2                      = pOutput[wpos];
+            k2                      = correction(pOutput[wpos], wpos);
             v2                      = wpos;
         }
         wpos                       += 32;
         if (wpos < dataWidth)
         {
-            k3                      = pOutput[wpos];
+            k3                      = correction(pOutput[wpos], wpos);
             v3                      = wpos;
         }
 
@@ -106,7 +139,7 @@ __shared__ volatile uint32_t sValue[160 * 4];
             uint32_t value          = wpos;
             if (wpos < dataWidth)
             {
-                key                 = pOutput[wpos];
+                key                 = correction(pOutput[wpos], wpos);
             }
 
             // Add values > minValue to shared memory buffer
@@ -221,9 +254,70 @@ __shared__ volatile uint32_t sValue[160 * 4];
     }
 }
 
+static __global__ void
+LAUNCH_BOUNDS()
+kExcludeRows_kernel(NNFloat* pOutput, uint32_t width, const uint32_t* pRows, const uint32_t* pOffsets, uint32_t batch, bool global)
+{
+    uint32_t pos                    = blockIdx.x * blockDim.x + threadIdx.x;
+    if (global)
+    {
+        // one thread per excluded row, for all queries
+        if (pos < pOffsets[1])
+        {
+            uint32_t row            = pRows[pos];
+            for (uint32_t q = 0; q < batch; q++)
+            {
+                pOutput[(size_t)q * width + row]    = -MAX_VALUE;
+            }
+        }
+    }
+    else if (pos < pOffsets[batch])
+    {
+        // one thread per excluded (query, row), find the query of the entry
+        uint32_t lo                 = 0;
+        uint32_t hi                 = batch;
+        while (hi - lo > 1)
+        {
+            uint32_t mid            = (lo + hi) / 2;
+            if (pOffsets[mid] <= pos)
+                lo                  = mid;
+            else
+                hi                  = mid;
+        }
+        pOutput[(size_t)lo * width + pRows[pos]]    = -MAX_VALUE;
+    }
+}
+
+void kExcludeRows(NNFloat* pOutput, uint32_t width, const uint32_t* pRows, const uint32_t* pOffsets, uint32_t entries, uint32_t batch, bool global)
+{
+    if (entries == 0)
+    {
+        return;
+    }
+    uint32_t blocks                 = (entries + 127) / 128;
+    kExcludeRows_kernel<<<blocks, 128>>>(pOutput, width, pRows, pOffsets, batch, global);
+    LAUNCHERROR("kExcludeRows_kernel");
+}
+
 void kCalculateTopK(NNFloat* pOutput, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k)
 {
     uint32_t blocks                 = (batch + 3) / 4;
-    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, widthPadding, k);
+    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, widthPadding, k, InnerProduct());
     LAUNCHERROR("kCalculateTopK_kernel");
 }
+
+void kCalculateTopKCosine(NNFloat* pOutput, NNFloat* pNorm, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k)
+{
+    uint32_t blocks                 = (batch + 3) / 4;
+    Cosine correction               = { pNorm };
+    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, widthPadding, k, correction);
+    LAUNCHERROR("kCalculateTopKCosine_kernel");
+}
+
+void kCalculateTopKL2(NNFloat* pOutput, NNFloat* pNorm, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k)
+{
+    uint32_t blocks                 = (batch + 3) / 4;
+    L2 correction                   = { pNorm };
+    kCalculateTopK_kernel<<<blocks, 128>>>(pOutput, pKey, pValue, batch, width, widthPadding, k, correction);
+    LAUNCHERROR("kCalculateTopKL2_kernel");
+}
@@ -72,4 +72,21 @@ static const int SM_6X_THREADS_PER_BLOCK                        = 128;
  */
 void kCalculateTopK(NNFloat* pOutput, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k);
 
+/*
+ * Same as kCalculateTopK, but each product is corrected with the norm of its column (data row)
+ * as it is read, so cosine and l2 cost the same as an inner product search:
+ *   kCalculateTopKCosine: pOutput[i] * pNorm[i]           (pNorm = 1 / |x|)
+ *   kCalculateTopKL2:     2 * pOutput[i] - pNorm[i]       (pNorm = |x|^2)
+ */
+void kCalculateTopKCosine(NNFloat* pOutput, NNFloat* pNorm, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k);
+
+void kCalculateTopKL2(NNFloat* pOutput, NNFloat* pNorm, NNFloat *pKey, uint32_t* pValue, uint32_t batch, uint32_t width, uint32_t widthPadding, uint32_t k);
+
+/*
+ * Sets the products of excluded rows to -MAX_VALUE so that the kCalculateTopK variants never select them
+ * (unless fewer than k rows are left). pRows[pOffsets[q], pOffsets[q + 1]) are the excluded rows of query q,
+ * or, with global set, pRows[0, pOffsets[1]) are excluded for all batch queries. entries is the length of pRows.
+ */
+void kExcludeRows(NNFloat* pOutput, uint32_t width, const uint32_t* pRows, const uint32_t* pOffsets, uint32_t entries, uint32_t batch, bool global);
+
 #endif /* LIBKNN_TOPK_H_ */
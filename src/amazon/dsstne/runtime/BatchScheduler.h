@@ -0,0 +1,246 @@
+/*
+ *  Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License").
+ *  You may not use this file except in compliance with the License.
+ *  A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0/
+ *
+ *  or in the "license" file accompanying this file.
+ *  This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ *  either express or implied.
+ *
+ *  See the License for the specific language governing permissions and limitations under the License.
+ *
+ */
+
+#ifndef BATCHSCHEDULER_H_
+#define BATCHSCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Coalesces individually submitted requests into batches for a batch oriented backend
+ * (e.g. astdl::knn::Knn::search or NNNetwork::PredictBatch), the native counterpart of
+ * the java TimedBatchExecutor.
+ *
+ * A batch is dispatched as soon as maxBatchSize requests are queued or the oldest queued
+ * request has waited maxLatency, whichever comes first. numWorkers threads each form and
+ * process their own batches, so one batch can be collected while others are processed.
+ * Each submit returns a future that receives the response, or the exception thrown while
+ * processing its batch.
+ *
+ * The batch function is called concurrently from different workers; worker (in [0, numWorkers))
+ * lets it use per worker resources, e.g. one KnnData per GPU:
+ *
+ *   BatchScheduler<std::vector<float>, std::vector<std::string>> scheduler(
+ *       [&](int worker, std::vector<std::vector<float>> &queries, std::vector<std::vector<std::string>> &keys) {
+ *           // copy queries into one batch, knns[worker]->search(k, batch, queries.size(), ...), split into keys
+ *       }, batchSize, std::chrono::microseconds(2000), numGpus);
+ *   std::future<std::vector<std::string>> result = scheduler.submit(query);
+ *
+ * Backends that only support one instance per process (DsstneContext) use a single worker.
+ */
+template<typename Request, typename Response>
+class BatchScheduler
+{
+  public:
+    /**
+     * Fills responses[i] (already sized to requests.size()) with the response to requests[i].
+     */
+    typedef std::function<void(int worker, std::vector<Request> &requests, std::vector<Response> &responses)> BatchFunction;
+
+    BatchScheduler(BatchFunction batchFunction, size_t maxBatchSize, std::chrono::microseconds maxLatency,
+                   int numWorkers = 1) :
+        batchFunction(batchFunction),
+        maxBatchSize(maxBatchSize),
+        maxLatency(maxLatency),
+        stopping(false),
+        numBatches(0),
+        numRequests(0)
+    {
+        if (maxBatchSize == 0)
+        {
+            throw std::invalid_argument("BatchScheduler: maxBatchSize must be > 0");
+        }
+        if (numWorkers <= 0)
+        {
+            throw std::invalid_argument("BatchScheduler: numWorkers must be > 0");
+        }
+        for (int worker = 0; worker < numWorkers; ++worker)
+        {
+            workers.emplace_back(&BatchScheduler::work, this, worker);
+        }
+    }
+
+    BatchScheduler(const BatchScheduler&) = delete;
+
+    BatchScheduler &operator=(const BatchScheduler&) = delete;
+
+    /**
+     * Processes the requests still queued, then stops the workers.
+     */
+    ~BatchScheduler()
+    {
+        shutdown();
+    }
+
+    /**
+     * Queues the request. Throws std::runtime_error once the scheduler is shut down.
+     */
+    std::future<Response> submit(Request request)
+    {
+        Pending pending;
+        pending.request = std::move(request);
+        pending.deadline = std::chrono::steady_clock::now() + maxLatency;
+        std::future<Response> future = pending.promise.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+            {
+                throw std::runtime_error("BatchScheduler: submit after shutdown");
+            }
+            queue.push_back(std::move(pending));
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    /**
+     * Stops accepting requests, processes the queued ones and joins the workers. Idempotent.
+     */
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (std::thread &worker : workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+    }
+
+    size_t getNumBatches() const
+    {
+        return numBatches;
+    }
+
+    size_t getNumRequests() const
+    {
+        return numRequests;
+    }
+
+  private:
+    struct Pending
+    {
+        Request request;
+        std::promise<Response> promise;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    const BatchFunction batchFunction;
+    const size_t maxBatchSize;
+    const std::chrono::microseconds maxLatency;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Pending> queue;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> numBatches;
+    std::atomic<size_t> numRequests;
+
+    void work(int worker)
+    {
+        std::vector<Request> requests;
+        std::vector<Response> responses;
+        std::vector<std::promise<Response>> promises;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                {
+                    // stopping and drained
+                    return;
+                }
+
+                // wait for a full batch, but not past the deadline of the oldest request
+                // (on shutdown the queue is drained without waiting)
+                while (!stopping && !queue.empty() && queue.size() < maxBatchSize
+                    && std::chrono::steady_clock::now() < queue.front().deadline)
+                {
+                    condition.wait_until(lock, queue.front().deadline);
+                }
+                if (queue.empty())
+                {
+                    // taken by another worker
+                    continue;
+                }
+
+                size_t batchSize = std::min(queue.size(), maxBatchSize);
+                requests.clear();
+                promises.clear();
+                for (size_t i = 0; i < batchSize; ++i)
+                {
+                    requests.push_back(std::move(queue.front().request));
+                    promises.push_back(std::move(queue.front().promise));
+                    queue.pop_front();
+                }
+                if (!queue.empty())
+                {
+                    // the rest is for another worker
+                    condition.notify_one();
+                }
+            }
+
+            responses.clear();
+            responses.resize(requests.size());
+            std::exception_ptr error;
+            try
+            {
+                batchFunction(worker, requests, responses);
+            } catch (...)
+            {
+                error = std::current_exception();
+            }
+            // counted before the futures become ready
+            ++numBatches;
+            numRequests += requests.size();
+            for (size_t i = 0; i < promises.size(); ++i)
+            {
+                if (error)
+                {
+                    promises[i].set_exception(error);
+                } else
+                {
+                    promises[i].set_value(std::move(responses[i]));
+                }
+            }
+        }
+    }
+};
+
+#endif /* BATCHSCHEDULER_H_ */
@@ -33,7 +33,7 @@ DsstneContext::DsstneContext(const string &networkFilename, uint32_t batchSize,
 {
     getGpu().Startup(ARGC, &ARGV);
     getGpu().SetRandomSeed(SEED);
-    NNNetwork *network = LoadNeuralNetworkNetCDF(networkFilename, batchSize);
+    NNNetwork *network = LoadNeuralNetworkNetCDF(networkFilename, batchSize, true);
     getGpu().SetNeuralNetwork(network);
 
     vector<const NNLayer*> outputLayers;
@@ -0,0 +1,168 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <inttypes.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+using namespace std;
+
+void printUsageEstimateMemory() {
+    cout << "EstimateMemory: Estimates the GPU memory of a network from its config and data set dimensions, and the largest batch that fits a budget. No GPU is required." << endl;
+    cout << "Usage: estimateMemory -c <config_file> [-i <input_netcdf>] [-o <output_netcdf>] [-s <data_set_spec>] [-b <batch_size>] [-m <budget_mb>] [-t <optimizer>] [-p]" << endl;
+    cout << "    -c config_file: (required) the JSON config file of the network." << endl;
+    cout << "    -i input_netcdf: netcdf files with the input data sets, comma separated. Only the headers are read." << endl;
+    cout << "    -o output_netcdf: netcdf files with the output data sets, comma separated. Only the headers are read." << endl;
+    cout << "    -s data_set_spec: data sets that have not been generated yet, comma separated, each name:width[xheight[xlength]]:examples[:density]." << endl;
+    cout << "                      A density below 1 makes the data set sparse and boolean." << endl;
+    cout << "    -b batch_size: (default = 1024) the batch size of the per layer and per weight estimate." << endl;
+    cout << "    -m budget_mb: GPU memory budget in MiB, recommends the largest batch size that fits into it." << endl;
+    cout << "    -t optimizer: (default = sgd) one of sgd, momentum, adagrad, nesterov, rmsprop, adadelta or adam." << endl;
+    cout << "    -p: estimate prediction with a network loaded for inference only instead of training." << endl;
+    cout << endl;
+}
+
+static bool parseDataSetSpec(const string& spec, NNDataSetDescriptor& d)
+{
+    vector<string> vField = split(spec, ':');
+    if ((vField.size() < 3) || (vField.size() > 4))
+        return false;
+
+    vector<string> vDim = split(vField[1], 'x');
+    if ((vDim.size() < 1) || (vDim.size() > 3))
+        return false;
+    d._name                 = vField[0];
+    d._dim                  = NNDataSetDimensions(stoul(vDim[0]), (vDim.size() > 1) ? stoul(vDim[1]) : 1, (vDim.size() > 2) ? stoul(vDim[2]) : 1);
+    d._dim._dimensions      = vDim.size();
+    d._examples             = stoul(vField[2]);
+    d._sparseDensity        = (vField.size() > 3) ? stof(vField[3]) : 1.0f;
+    d._dataType             = NNDataSetEnums::Float;
+    d._attributes           = (d._sparseDensity < 1.0f) ? (NNDataSetEnums::Sparse | NNDataSetEnums::Boolean) : 0;
+    return true;
+}
+
+static void printFootprint(const NNMemoryFootprint& f)
+{
+    printf("%-32s %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+           f._name.c_str(), f._units, f._deltas, f._weights, f._gradients, f._velocities, f._sparseTransposed, f._data, f._other, f.GetTotal());
+}
+
+int main(int argc, char** argv)
+{
+    if (isArgSet(argc, argv, "-h")) {
+        printUsageEstimateMemory();
+        exit(1);
+    }
+
+    string configFileName = getRequiredArgValue(argc, argv, "-c", "config file was not specified.", &printUsageEstimateMemory);
+    if (! fileExists(configFileName)) {
+        cout << "Error: Cannot read config file: " << configFileName << endl;
+        return 1;
+    }
+
+    // Data set dimensions from netcdf headers and specs
+    vector<NNDataSetDescriptor> vDataSetDescriptor;
+    vector<string> vDataFile;
+    split(getOptionalArgValue(argc, argv, "-i", ""), ',', vDataFile);
+    split(getOptionalArgValue(argc, argv, "-o", ""), ',', vDataFile);
+    for (auto& f : vDataFile) {
+        if (f.empty())
+            continue;
+        if (! fileExists(f)) {
+            cout << "Error: Cannot read data file: " << f << endl;
+            return 1;
+        }
+        if (!LoadNNDataSetDescriptorsNetCDF(f, vDataSetDescriptor))
+            return 1;
+    }
+    for (auto& s : split(getOptionalArgValue(argc, argv, "-s", ""), ',')) {
+        if (s.empty())
+            continue;
+        NNDataSetDescriptor d;
+        if (!parseDataSetSpec(s, d)) {
+            cout << "Error: Invalid data set spec: " << s << endl;
+            printUsageEstimateMemory();
+            return 1;
+        }
+        vDataSetDescriptor.push_back(d);
+    }
+
+    unsigned int batchSize = stoi(getOptionalArgValue(argc, argv, "-b", "1024"));
+    bool bInference = isArgSet(argc, argv, "-p");
+    string optimizer = getOptionalArgValue(argc, argv, "-t", "sgd");
+    transform(optimizer.begin(), optimizer.end(), optimizer.begin(), ::tolower);
+    map<string, TrainingMode> mOptimizer = {
+        {"sgd", SGD}, {"momentum", Momentum}, {"adagrad", AdaGrad}, {"nesterov", Nesterov},
+        {"rmsprop", RMSProp}, {"adadelta", AdaDelta}, {"adam", Adam},
+    };
+    if (mOptimizer.find(optimizer) == mOptimizer.end()) {
+        cout << "Error: Unknown optimizer: " << optimizer << endl;
+        printUsageEstimateMemory();
+        return 1;
+    }
+    TrainingMode mode = mOptimizer[optimizer];
+
+    // Parse the network exactly as LoadNeuralNetworkJSON does, sizing input and output layers from the data sets
+    NNNetworkDescriptor nd;
+    if (!LoadNNNetworkDescriptorJSON(configFileName, vDataSetDescriptor, nd))
+        return 1;
+    for (auto& l : nd._vLayerDescriptor) {
+        bool bFound = false;
+        for (auto& d : vDataSetDescriptor)
+            bFound |= (d._name == l._dataSet);
+        if ((l._kind != NNLayer::Kind::Hidden) && !bFound)
+            cout << "Warning: No data set " << l._dataSet << " for layer " << l._name << ", its data is not included." << endl;
+    }
+
+    NNMemoryEstimate estimate;
+    if (!EstimateNetworkMemory(nd, vDataSetDescriptor, batchSize, mode, bInference, estimate))
+        return 1;
+
+    cout << "EstimateMemory: " << (bInference ? "Prediction" : "Training with optimizer ") << (bInference ? "" : optimizer) << " at batch size " << batchSize << ", in bytes:" << endl;
+    printf("%-32s %14s %14s %14s %14s %14s %14s %14s %14s %14s\n", "Layer", "Units", "Deltas", "Weights", "Gradients", "Velocities", "SparseT", "Data", "Other", "Total");
+    for (auto& f : estimate._vLayer)
+        printFootprint(f);
+    printf("\n%-32s\n", "Weight");
+    for (auto& f : estimate._vWeight)
+        printFootprint(f);
+    printf("\n%-32s\n", "Data set");
+    for (auto& f : estimate._vDataSet)
+        printFootprint(f);
+    if (bInference) {
+        uint64_t units = 0;
+        for (auto& f : estimate._vLayer)
+            units += f._units;
+        printf("\nUnit data shared between layers: %" PRIu64 " bytes instead of %" PRIu64 "\n", estimate._unitArenas, units);
+    }
+    printf("\nTotal: %" PRIu64 " bytes (%.1f MiB), excluding the cuDNN workspace and the CUDA context\n", estimate.GetTotal(), estimate.GetTotal() / (1024.0 * 1024.0));
+
+    // Recommend the largest batch that fits the budget
+    if (isArgSet(argc, argv, "-m")) {
+        uint64_t budget = (uint64_t)(stod(getOptionalArgValue(argc, argv, "-m", "0")) * 1024.0 * 1024.0);
+        uint32_t batch = FindLargestBatch(nd, vDataSetDescriptor, mode, bInference, budget);
+        if (batch == 0) {
+            cout << "EstimateMemory: Not even a batch of 1 fits into " << budget << " bytes." << endl;
+            return 1;
+        }
+        EstimateNetworkMemory(nd, vDataSetDescriptor, batch, mode, bInference, estimate);
+        printf("EstimateMemory: Largest batch size within %" PRIu64 " bytes: %u (%" PRIu64 " bytes)\n", budget, batch, estimate.GetTotal());
+    }
+    return 0;
+}
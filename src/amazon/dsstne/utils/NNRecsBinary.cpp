@@ -0,0 +1,281 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "NNRecsBinary.h"
+
+using namespace std;
+
+namespace
+{
+// Records are decoded from a buffer refilled in chunks of this size
+const size_t READ_BUFFER_SIZE = 4 * 1024 * 1024;
+
+void writeUInt32(FILE *fp, uint32_t value)
+{
+    fwrite(&value, sizeof(uint32_t), 1, fp);
+}
+
+void writeString(FILE *fp, const string &value)
+{
+    writeUInt32(fp, (uint32_t)value.size());
+    fwrite(value.data(), 1, value.size(), fp);
+}
+
+uint32_t readUInt32(FILE *fp, const string &fileName)
+{
+    uint32_t value;
+    if (fread(&value, sizeof(uint32_t), 1, fp) != 1)
+    {
+        throw runtime_error("NNRecsBinaryReader: truncated header in " + fileName);
+    }
+    return value;
+}
+
+string readString(FILE *fp, const string &fileName)
+{
+    uint32_t length = readUInt32(fp, fileName);
+    string value(length, '\0');
+    if (length > 0 && fread(&value[0], 1, length, fp) != length)
+    {
+        throw runtime_error("NNRecsBinaryReader: truncated header in " + fileName);
+    }
+    return value;
+}
+}
+
+size_t NNRecsBinaryHeader::getRecordSize() const
+{
+    size_t scoreSize = (scoreType == RecsScoreFP16) ? sizeof(uint16_t) : sizeof(float);
+    return sizeof(uint32_t) + k * (sizeof(uint32_t) + scoreSize);
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign       = (bits >> 16) & 0x8000;
+    uint32_t exponent   = (bits >> 23) & 0xFF;
+    uint32_t mantissa   = bits & 0x7FFFFF;
+
+    // Inf and NaN
+    if (exponent == 0xFF)
+    {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+
+    int32_t halfExponent = (int32_t)exponent - 127 + 15;
+    if (halfExponent >= 0x1F)
+    {
+        return sign | 0x7C00;
+    }
+
+    // Subnormal half or underflow to zero
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+        {
+            return sign;
+        }
+        mantissa                |= 0x800000;
+        uint32_t shift          = 14 - halfExponent;
+        uint32_t half           = mantissa >> shift;
+        uint32_t remainder      = mantissa & ((1u << shift) - 1);
+        uint32_t halfway        = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return sign | half;
+    }
+
+    // Rounding may carry into the exponent, which correctly rounds up to the next binade or Inf
+    uint32_t half               = (halfExponent << 10) | (mantissa >> 13);
+    uint32_t remainder          = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return sign | half;
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign               = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent           = (value >> 10) & 0x1F;
+    uint32_t mantissa           = value & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Normalize the subnormal half
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x3FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void writeRecsBinaryHeader(FILE *fp, const NNRecsBinaryHeader &header)
+{
+    fwrite(RECS_BINARY_MAGIC, 1, sizeof(RECS_BINARY_MAGIC), fp);
+    writeUInt32(fp, RECS_BINARY_VERSION);
+    writeUInt32(fp, header.k);
+    writeUInt32(fp, header.scoreType);
+    writeString(fp, header.featureIndexFileName);
+    writeString(fp, header.sampleIndexFileName);
+}
+
+void appendRecsBinaryRecord(string &out, const NNRecsBinaryHeader &header, uint32_t sampleId,
+                            const uint32_t *indexes, const float *scores)
+{
+    size_t pos = out.size();
+    out.resize(pos + header.getRecordSize());
+    char *pRecord = &out[pos];
+
+    memcpy(pRecord, &sampleId, sizeof(uint32_t));
+    pRecord += sizeof(uint32_t);
+    memcpy(pRecord, indexes, header.k * sizeof(uint32_t));
+    pRecord += header.k * sizeof(uint32_t);
+
+    if (header.scoreType == RecsScoreFP16)
+    {
+        for (uint32_t i = 0; i < header.k; i++)
+        {
+            uint16_t half = floatToHalf(scores[i]);
+            memcpy(pRecord + i * sizeof(uint16_t), &half, sizeof(uint16_t));
+        }
+    }
+    else
+    {
+        memcpy(pRecord, scores, header.k * sizeof(float));
+    }
+}
+
+NNRecsBinaryReader::NNRecsBinaryReader(const string &fileName) :
+    fp(fopen(fileName.c_str(), "rb")),
+    bufferPos(0),
+    bufferEnd(0)
+{
+    if (fp == NULL)
+    {
+        throw runtime_error("NNRecsBinaryReader: unable to open " + fileName);
+    }
+
+    try
+    {
+        char magic[sizeof(RECS_BINARY_MAGIC)];
+        if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, RECS_BINARY_MAGIC, sizeof(magic)) != 0)
+        {
+            throw runtime_error("NNRecsBinaryReader: " + fileName + " is not a binary recs file");
+        }
+
+        uint32_t version = readUInt32(fp, fileName);
+        if (version != RECS_BINARY_VERSION)
+        {
+            throw runtime_error("NNRecsBinaryReader: unsupported version " + to_string(version) + " in " + fileName);
+        }
+
+        header.k                    = readUInt32(fp, fileName);
+        uint32_t scoreType          = readUInt32(fp, fileName);
+        if (scoreType != RecsScoreFP32 && scoreType != RecsScoreFP16)
+        {
+            throw runtime_error("NNRecsBinaryReader: unknown score type " + to_string(scoreType) + " in " + fileName);
+        }
+        header.scoreType            = (NNRecsScoreType)scoreType;
+        header.featureIndexFileName = readString(fp, fileName);
+        header.sampleIndexFileName  = readString(fp, fileName);
+    }
+    catch (...)
+    {
+        fclose(fp);
+        throw;
+    }
+
+    recordSize = header.getRecordSize();
+    // Whole records per buffer so a record never straddles two reads
+    buffer.resize(max(READ_BUFFER_SIZE / recordSize, (size_t)1) * recordSize);
+}
+
+NNRecsBinaryReader::~NNRecsBinaryReader()
+{
+    fclose(fp);
+}
+
+bool NNRecsBinaryReader::fill()
+{
+    size_t remaining = bufferEnd - bufferPos;
+    memmove(buffer.data(), buffer.data() + bufferPos, remaining);
+    bufferPos = 0;
+    bufferEnd = remaining + fread(buffer.data() + remaining, 1, buffer.size() - remaining, fp);
+    return bufferEnd >= recordSize;
+}
+
+bool NNRecsBinaryReader::readRecord(uint32_t *sampleId, uint32_t *indexes, float *scores)
+{
+    if (bufferEnd - bufferPos < recordSize && !fill())
+    {
+        if (bufferEnd != 0)
+        {
+            throw runtime_error("NNRecsBinaryReader: truncated record at end of file");
+        }
+        return false;
+    }
+
+    const char *pRecord = buffer.data() + bufferPos;
+    bufferPos += recordSize;
+
+    memcpy(sampleId, pRecord, sizeof(uint32_t));
+    pRecord += sizeof(uint32_t);
+    memcpy(indexes, pRecord, header.k * sizeof(uint32_t));
+    pRecord += header.k * sizeof(uint32_t);
+
+    if (header.scoreType == RecsScoreFP16)
+    {
+        for (uint32_t i = 0; i < header.k; i++)
+        {
+            uint16_t half;
+            memcpy(&half, pRecord + i * sizeof(uint16_t), sizeof(uint16_t));
+            scores[i] = halfToFloat(half);
+        }
+    }
+    else
+    {
+        memcpy(scores, pRecord, header.k * sizeof(float));
+    }
+    return true;
+}
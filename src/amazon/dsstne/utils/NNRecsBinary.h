@@ -0,0 +1,114 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Compact binary recs format, an alternative to the "label,score:" text output of predict.
+ *
+ * All values are little endian.
+ *
+ *   header:
+ *     char[8]   magic            "DSSTRECS"
+ *     uint32_t  version          RECS_BINARY_VERSION
+ *     uint32_t  k                number of recs per sample
+ *     uint32_t  scoreType        NNRecsScoreType
+ *     uint32_t  length, char[]   output feature index file (index -> label)
+ *     uint32_t  length, char[]   samples index file (sample id -> label)
+ *
+ *   one record per sample:
+ *     uint32_t  sampleId         index into the samples index file
+ *     uint32_t  index[k]         indexes into the output feature index file
+ *     fp32|fp16 score[k]
+ *
+ * Slots without a valid rec (e.g. fewer than k outputs) hold RECS_BINARY_INVALID_INDEX.
+ */
+enum NNRecsScoreType
+{
+    RecsScoreFP32 = 0,
+    RecsScoreFP16 = 1,
+};
+
+static const char RECS_BINARY_MAGIC[8]                = { 'D', 'S', 'S', 'T', 'R', 'E', 'C', 'S' };
+static const uint32_t RECS_BINARY_VERSION             = 1;
+static const uint32_t RECS_BINARY_INVALID_INDEX       = 0xFFFFFFFF;
+
+struct NNRecsBinaryHeader
+{
+    uint32_t k;
+    NNRecsScoreType scoreType;
+    std::string featureIndexFileName;
+    std::string sampleIndexFileName;
+
+    /**
+     * Size in bytes of one sample record.
+     */
+    size_t getRecordSize() const;
+};
+
+/**
+ * Converts between fp32 and IEEE 754 half precision (round to nearest even).
+ */
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+/**
+ * Writes the header to the start of a recs file.
+ */
+void writeRecsBinaryHeader(FILE *fp, const NNRecsBinaryHeader &header);
+
+/**
+ * Appends one sample record to the out buffer. indexes and scores hold header.k entries.
+ */
+void appendRecsBinaryRecord(std::string &out, const NNRecsBinaryHeader &header, uint32_t sampleId,
+                            const uint32_t *indexes, const float *scores);
+
+/**
+ * Sequential reader of binary recs files.
+ *
+ *   NNRecsBinaryReader reader("recs");
+ *   std::vector<uint32_t> indexes(reader.getHeader().k);
+ *   std::vector<float> scores(reader.getHeader().k);
+ *   uint32_t sampleId;
+ *   while (reader.readRecord(&sampleId, indexes.data(), scores.data())) { ... }
+ */
+class NNRecsBinaryReader
+{
+    FILE *fp;
+    NNRecsBinaryHeader header;
+    std::vector<char> buffer;
+    size_t bufferPos;
+    size_t bufferEnd;
+    size_t recordSize;
+
+    bool fill();
+
+public:
+    explicit NNRecsBinaryReader(const std::string &fileName);
+
+    ~NNRecsBinaryReader();
+
+    const NNRecsBinaryHeader &getHeader() const
+    {
+        return header;
+    }
+
+    /**
+     * Decodes the next record; scores are always returned as fp32.
+     * Returns false once all records have been read.
+     */
+    bool readRecord(uint32_t *sampleId, uint32_t *indexes, float *scores);
+};
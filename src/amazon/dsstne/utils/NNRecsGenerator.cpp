@@ -17,6 +17,11 @@
 #include <string>
 #include <cstdio>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
 #include "NNRecsGenerator.h"
 #include "GpuTypes.h"
@@ -27,6 +32,8 @@ using namespace std;
 
 const string NNRecsGenerator::DEFAULT_LAYER_RECS_GEN_LABEL = "Output";
 const string NNRecsGenerator::DEFAULT_SCORE_PRECISION = "4.3f";
+const string NNRecsGenerator::SHARD_BY_RANGE = "range";
+const string NNRecsGenerator::SHARD_BY_HASH = "hash";
 
 // Multiplicative of xK. 
 // We sorting TOPK_SCALAR times of xK mainly in concern with multi GPU sorting
@@ -34,6 +41,185 @@ const string NNRecsGenerator::DEFAULT_SCORE_PRECISION = "4.3f";
 // sorting the topK from xK* #GPUs * TOPK_SCALAR is OK though 
 const unsigned int NNRecsGenerator::TOPK_SCALAR = 5;
 
+/**
+ * Formats and writes the recs of one output shard on its own thread. Batches of
+ * already selected top K (index, score) pairs are queued by generateRecs so that
+ * formatting and disk I/O overlap with the prediction of the next batch.
+ */
+class NNRecsShardWriter
+{
+public:
+    struct Batch
+    {
+        unsigned int k;
+        const vector<string> *pCustomerIndex;
+        const vector<string> *pFeatureIndex;
+        vector<unsigned int> vSample;   // sample index of each row
+        vector<unsigned int> vIndex;    // k global feature indexes per row
+        vector<NNFloat> vScore;         // k scores per row
+    };
+
+    /**
+     * Writes text recs using format, or binary recs when pBinaryHeader is not NULL.
+     */
+    NNRecsShardWriter(const string &fileName, const string &format, const NNRecsBinaryHeader *pBinaryHeader)
+      : fileName(fileName),
+        strFormat(format),
+        bBinary(pBinaryHeader != NULL),
+        rows(0),
+        bClosed(false)
+    {
+        fp = fopen(fileName.c_str(), bBinary ? "wb" : "w");
+        if (fp == NULL)
+        {
+            throw runtime_error("NNRecsShardWriter: unable to open " + fileName);
+        }
+        if (bBinary)
+        {
+            binaryHeader = *pBinaryHeader;
+            writeRecsBinaryHeader(fp, binaryHeader);
+        }
+        writer = thread(&NNRecsShardWriter::run, this);
+    }
+
+    ~NNRecsShardWriter()
+    {
+        close();
+    }
+
+    void enqueue(unique_ptr<Batch> pBatch)
+    {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            queue.push_back(move(pBatch));
+        }
+        queueCondition.notify_one();
+    }
+
+    /**
+     * Blocks until all queued batches are written and closes the shard.
+     */
+    void close()
+    {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            if (bClosed)
+            {
+                return;
+            }
+            bClosed = true;
+        }
+        queueCondition.notify_one();
+        writer.join();
+        fclose(fp);
+    }
+
+    const string &getFileName() const
+    {
+        return fileName;
+    }
+
+    uint64_t getRows() const
+    {
+        return rows;
+    }
+
+private:
+    string fileName;
+    string strFormat;
+    bool bBinary;
+    NNRecsBinaryHeader binaryHeader;
+    FILE *fp;
+    uint64_t rows;
+    bool bClosed;
+    deque<unique_ptr<Batch>> queue;
+    mutex queueMutex;
+    condition_variable queueCondition;
+    thread writer;
+
+    void run()
+    {
+        while (true)
+        {
+            unique_ptr<Batch> pBatch;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return bClosed || !queue.empty(); });
+                if (queue.empty())
+                {
+                    return;
+                }
+                pBatch = move(queue.front());
+                queue.pop_front();
+            }
+            if (bBinary)
+            {
+                writeBinary(*pBatch);
+            }
+            else
+            {
+                write(*pBatch);
+            }
+        }
+    }
+
+    void writeBinary(const Batch &batch)
+    {
+        string out;
+        out.reserve(batch.vSample.size() * binaryHeader.getRecordSize());
+        vector<uint32_t> vIndex(batch.k);
+        const size_t features = batch.pFeatureIndex->size();
+        for (size_t j = 0; j < batch.vSample.size(); j++)
+        {
+            for (unsigned int x = 0; x < batch.k; x++)
+            {
+                unsigned int index = batch.vIndex[j * batch.k + x];
+                vIndex[x] = (index < features) ? index : RECS_BINARY_INVALID_INDEX;
+            }
+            appendRecsBinaryRecord(out, binaryHeader, batch.vSample[j], vIndex.data(), &batch.vScore[j * batch.k]);
+        }
+        fwrite(out.data(), 1, out.size(), fp);
+        rows += batch.vSample.size();
+    }
+
+    void write(const Batch &batch)
+    {
+        // Format the whole batch into one buffer so that each batch costs a single fwrite
+        string out;
+        char buffer[1024];
+        const vector<string> &vCustomer = *batch.pCustomerIndex;
+        const vector<string> &vFeature  = *batch.pFeatureIndex;
+        for (size_t j = 0; j < batch.vSample.size(); j++)
+        {
+            out.append(vCustomer[batch.vSample[j]]);
+            out.push_back('\t');
+            for (unsigned int x = 0; x < batch.k; x++)
+            {
+                const size_t pos = j * batch.k + x;
+                unsigned int index = batch.vIndex[pos];
+                if (index < vFeature.size())
+                {
+                    int length = snprintf(buffer, sizeof(buffer), strFormat.c_str(), vFeature[index].c_str(), batch.vScore[pos]);
+                    if (length >= (int)sizeof(buffer))
+                    {
+                        // Label longer than the scratch buffer, fall back to a heap allocated one
+                        vector<char> large(length + 1);
+                        snprintf(large.data(), large.size(), strFormat.c_str(), vFeature[index].c_str(), batch.vScore[pos]);
+                        out.append(large.data(), length);
+                    }
+                    else if (length > 0)
+                    {
+                        out.append(buffer, length);
+                    }
+                }
+            }
+            out.push_back('\n');
+        }
+        fwrite(out.data(), 1, out.size(), fp);
+        rows += batch.vSample.size();
+    }
+};
+
 /**
 We should allocate and deallocate the GPU memory once to save time on allocating and deallocating the
 GPU Memory
@@ -46,13 +232,133 @@ NNRecsGenerator::NNRecsGenerator(unsigned int xBatchSize,
                                  unsigned int xK,
                                  unsigned int xOutputBufferSize,
                                  const string &layer,
-                                 const string &precision)
+                                 const string &precision,
+                                 unsigned int xOutputShards,
+                                 const string &xShardBy)
   : pbKey(new GpuBuffer<NNFloat>(xBatchSize * xK * TOPK_SCALAR, true)),
     pbUIValue(new GpuBuffer<unsigned int>(xBatchSize * xK * TOPK_SCALAR, true)),
     pFilteredOutput(new GpuBuffer<NNFloat>(xOutputBufferSize, true)),
     recsGenLayerLabel(layer),
-    scorePrecision(precision)
+    scorePrecision(precision),
+    outputShards(xOutputShards),
+    shardBy(xShardBy),
+    bBinaryOutput(false)
+{
+    if (outputShards == 0)
+    {
+        throw invalid_argument("NNRecsGenerator: number of output shards must be at least 1");
+    }
+    if (shardBy != SHARD_BY_RANGE && shardBy != SHARD_BY_HASH)
+    {
+        throw invalid_argument("NNRecsGenerator: unknown shard assignment " + shardBy + ", must be " + SHARD_BY_RANGE + " or " + SHARD_BY_HASH);
+    }
+}
+
+NNRecsGenerator::~NNRecsGenerator()
+{
+    try
+    {
+        finish();
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error finishing recs shards: " << e.what() << endl;
+    }
+}
+
+void NNRecsGenerator::setBinaryOutput(NNRecsScoreType scoreType,
+                                      const string &featureIndexFileName,
+                                      const string &sampleIndexFileName)
 {
+    bBinaryOutput                       = true;
+    binaryHeader.scoreType              = scoreType;
+    binaryHeader.featureIndexFileName   = featureIndexFileName;
+    binaryHeader.sampleIndexFileName    = sampleIndexFileName;
+}
+
+void NNRecsGenerator::openShardWriters(const string &fileName, unsigned int k)
+{
+    outputFileName = fileName;
+    binaryHeader.k = k;
+    string strFormat = "%s,%" + scorePrecision + ":";
+    const NNRecsBinaryHeader *pBinaryHeader = bBinaryOutput ? &binaryHeader : NULL;
+
+    // A single binary output keeps the plain output file name and needs no manifest
+    if (outputShards == 1)
+    {
+        vShardWriters.emplace_back(new NNRecsShardWriter(fileName, strFormat, pBinaryHeader));
+        cout << "Writing binary recs to " << fileName << endl;
+        return;
+    }
+
+    char suffix[32];
+    for (unsigned int shard = 0; shard < outputShards; shard++)
+    {
+        snprintf(suffix, sizeof(suffix), ".part-%05u", shard);
+        vShardWriters.emplace_back(new NNRecsShardWriter(fileName + suffix, strFormat, pBinaryHeader));
+    }
+    cout << "Writing " << (bBinaryOutput ? "binary " : "") << "recs to " << outputShards << " shards " << fileName << ".part-*" << endl;
+}
+
+unsigned int NNRecsGenerator::getShard(unsigned int sampleIndex, unsigned int examples, const vector<string> &customerIndex) const
+{
+    if (shardBy == SHARD_BY_HASH)
+    {
+        // FNV-1a, stable across runs and platforms unlike std::hash
+        const string &label = customerIndex[sampleIndex];
+        uint32_t hash = 2166136261u;
+        for (char c : label)
+        {
+            hash ^= (unsigned char)c;
+            hash *= 16777619u;
+        }
+        return hash % outputShards;
+    }
+    return (unsigned int)(((uint64_t)sampleIndex * outputShards) / examples);
+}
+
+void NNRecsGenerator::finish()
+{
+    if (vShardWriters.empty())
+    {
+        return;
+    }
+
+    for (auto &pWriter : vShardWriters)
+    {
+        pWriter->close();
+    }
+
+    if (outputShards == 1)
+    {
+        cout << "Wrote " << vShardWriters[0]->getRows() << " recs to " << vShardWriters[0]->getFileName() << endl;
+        vShardWriters.clear();
+        return;
+    }
+
+    string manifestFileName = outputFileName + ".manifest";
+    FILE *fp = fopen(manifestFileName.c_str(), "w");
+    if (fp == NULL)
+    {
+        vShardWriters.clear();
+        throw runtime_error("NNRecsGenerator: unable to open " + manifestFileName);
+    }
+    uint64_t totalRows = 0;
+    for (auto &pWriter : vShardWriters)
+    {
+        // Shards are listed by file name only so the output directory can be relocated
+        string shardFileName = pWriter->getFileName();
+        size_t separator = shardFileName.find_last_of('/');
+        if (separator != string::npos)
+        {
+            shardFileName = shardFileName.substr(separator + 1);
+        }
+        fprintf(fp, "%s\t%llu\n", shardFileName.c_str(), (unsigned long long)pWriter->getRows());
+        totalRows += pWriter->getRows();
+    }
+    fclose(fp);
+    cout << "Wrote " << totalRows << " recs to " << vShardWriters.size() << " shards, manifest " << manifestFileName << endl;
+    vShardWriters.clear();
 }
 
 void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
@@ -177,11 +483,6 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
 
     if (getGpu()._id == 0)
     {
-        const char *fileName = xFilterSet->getOutputFileName().c_str();
-        auto const now = std::chrono::steady_clock::now();
-        cout << "Time Elapsed for Filtering and selecting Top " << xK << " recs: " << elapsed_seconds(start, now) << endl;
-        cout << "Writing to " << fileName << endl;
-        FILE *fp = fopen(fileName, "a");
         pbKey->Download();
         pbUIValue->Download();
         NNFloat* pKey                   = pbKey->_pSysData;
@@ -193,41 +494,91 @@ void NNRecsGenerator::generateRecs(NNNetwork *xNetwork,
             pUIValueCache               = pbUIValueCache->_pSysData;
         }
 
-        string strFormat = "%s,%" + scorePrecision + ":";
-        for (int j = 0; j < lBatch; j++)
+        // Returns the global FEATURE index of the recommendation at bufferPos
+        auto getGlobalIndex = [&](size_t bufferPos) -> unsigned int
+        {
+            // Single GPU case, FEATURE index is global
+            unsigned int finalIndex = pIndex[bufferPos];
+            if (bMultiGPU)
+            {
+                // Multi GPU case. Need to do two level look up
+                // which GPU this index comes from
+                unsigned int gpuId = finalIndex / (xK * TOPK_SCALAR);
+                // Local index within one GPU
+                unsigned int localIndex = pUIValueCache[bufferPos];
+                finalIndex = gpuId * lLocalOutputStride + localIndex;
+            }
+            return finalIndex;
+        };
+
+        if (outputShards > 1 || bBinaryOutput)
         {
-            fprintf(fp, "%s%c", xCustomerIndex[lPosition + j].c_str(), '\t');
-            for (int x = 0; x < xK; ++x)
+            if (vShardWriters.empty())
             {
-                const size_t bufferPos = j * xK * TOPK_SCALAR + x;
+                openShardWriters(xFilterSet->getOutputFileName(), xK);
+            }
 
-                // Single GPU case, FEATURE index is global
-                int finalIndex = pIndex[bufferPos];
-                float value = pKey[bufferPos];
-                if (bMultiGPU)
+            // Split the batch by shard and hand each part to its writer thread
+            vector<unique_ptr<NNRecsShardWriter::Batch>> vBatches(outputShards);
+            for (int j = 0; j < lBatch; j++)
+            {
+                unsigned int sampleIndex = lPosition + j;
+                unsigned int shard = getShard(sampleIndex, lExamples, xCustomerIndex);
+                unique_ptr<NNRecsShardWriter::Batch> &pBatch = vBatches[shard];
+                if (!pBatch)
                 {
-                    // Multi GPU case. Need to do two level look up
-                    // which GPU this index comes from
-                    int gpuId = finalIndex / (xK * TOPK_SCALAR);
-                    // Local index within one GPU
-                    int localIndex = pUIValueCache[bufferPos];
-                    int globalIndex = gpuId * lLocalOutputStride + localIndex; 
-                    if (globalIndex < xFeatureIndex.size())
-                    {
-                        fprintf(fp, strFormat.c_str(), xFeatureIndex[globalIndex].c_str(), value);
-                    } 
+                    pBatch.reset(new NNRecsShardWriter::Batch());
+                    pBatch->k              = xK;
+                    pBatch->pCustomerIndex = &xCustomerIndex;
+                    pBatch->pFeatureIndex  = &xFeatureIndex;
                 }
-                else if (finalIndex < xFeatureIndex.size())
+                pBatch->vSample.push_back(sampleIndex);
+                for (int x = 0; x < xK; ++x)
                 {
-                    fprintf(fp, strFormat.c_str(), xFeatureIndex[finalIndex].c_str(), value);
+                    const size_t bufferPos = j * xK * TOPK_SCALAR + x;
+                    pBatch->vIndex.push_back(getGlobalIndex(bufferPos));
+                    pBatch->vScore.push_back(pKey[bufferPos]);
                 }
             }
+            for (unsigned int shard = 0; shard < outputShards; shard++)
+            {
+                if (vBatches[shard])
+                {
+                    vShardWriters[shard]->enqueue(move(vBatches[shard]));
+                }
+            }
+            auto const end = std::chrono::steady_clock::now();
+            cout << "Time Elapsed for queueing recs to shard writers: " << elapsed_seconds(start, end) << endl;
+        }
+        else
+        {
+            const string fileName = xFilterSet->getOutputFileName();
+            auto const now = std::chrono::steady_clock::now();
+            cout << "Time Elapsed for Filtering and selecting Top " << xK << " recs: " << elapsed_seconds(start, now) << endl;
+            cout << "Writing to " << fileName << endl;
+            FILE *fp = fopen(fileName.c_str(), "a");
 
-            fprintf(fp, "\n");
+            string strFormat = "%s,%" + scorePrecision + ":";
+            for (int j = 0; j < lBatch; j++)
+            {
+                fprintf(fp, "%s%c", xCustomerIndex[lPosition + j].c_str(), '\t');
+                for (int x = 0; x < xK; ++x)
+                {
+                    const size_t bufferPos = j * xK * TOPK_SCALAR + x;
+                    unsigned int globalIndex = getGlobalIndex(bufferPos);
+                    float value = pKey[bufferPos];
+                    if (globalIndex < xFeatureIndex.size())
+                    {
+                        fprintf(fp, strFormat.c_str(), xFeatureIndex[globalIndex].c_str(), value);
+                    }
+                }
+
+                fprintf(fp, "\n");
+            }
+            fclose(fp);
+            auto const end = std::chrono::steady_clock::now();
+            cout << "Time Elapsed for Writing to file: " << elapsed_seconds(start, end) << endl;
         }
-        fclose(fp);
-        auto const end = std::chrono::steady_clock::now();
-        cout << "Time Elapsed for Writing to file: " << elapsed_seconds(start, end) << endl;
     }
 
     // Delete multi-GPU data and P2P handles if multi-GPU
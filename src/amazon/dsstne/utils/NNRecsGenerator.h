@@ -18,9 +18,11 @@
 
 #include "GpuTypes.h"
 #include "NNTypes.h"
+#include "NNRecsBinary.h"
 
 class FilterConfig;
 class NNNetwork;
+class NNRecsShardWriter;
 
 class NNRecsGenerator
 {
@@ -30,23 +32,61 @@ class NNRecsGenerator
     std::vector<GpuBuffer<NNFloat>*> *vNodeFilters;
     std::string recsGenLayerLabel;
     std::string scorePrecision;
-    
+    unsigned int outputShards;
+    std::string shardBy;
+    std::string outputFileName;
+    std::vector<std::unique_ptr<NNRecsShardWriter>> vShardWriters;
+    bool bBinaryOutput;
+    NNRecsBinaryHeader binaryHeader;
+
+    void openShardWriters(const std::string &fileName, unsigned int k);
+    unsigned int getShard(unsigned int sampleIndex, unsigned int examples, const std::vector<std::string> &customerIndex) const;
+
 public:
     static const std::string DEFAULT_LAYER_RECS_GEN_LABEL;
     static const unsigned int TOPK_SCALAR;
     static const std::string DEFAULT_SCORE_PRECISION;
+    static const std::string SHARD_BY_RANGE;
+    static const std::string SHARD_BY_HASH;
 
+    /**
+     * When xOutputShards > 1, recs are written to xOutputShards files named
+     * <outputFile>.part-00000, <outputFile>.part-00001, ... each formatted and
+     * appended by its own writer thread. Samples are assigned to shards either by
+     * contiguous sample index range (SHARD_BY_RANGE) or by a hash of the sample
+     * label (SHARD_BY_HASH). A <outputFile>.manifest listing every shard and its
+     * row count is written by finish().
+     */
     NNRecsGenerator(unsigned int xBatchSize,
                     unsigned int xK, 
                     unsigned int xOutputBufferSize,
                     const std::string &layer = DEFAULT_LAYER_RECS_GEN_LABEL,
-                    const std::string &precision = DEFAULT_SCORE_PRECISION);
+                    const std::string &precision = DEFAULT_SCORE_PRECISION,
+                    unsigned int xOutputShards = 1,
+                    const std::string &xShardBy = SHARD_BY_RANGE);
+
+    ~NNRecsGenerator();
+
+    /**
+     * Writes recs in the compact binary format described in NNRecsBinary.h instead of text.
+     * The header of each output file references the feature and sample index files used to
+     * decode the output indexes and sample ids.
+     */
+    void setBinaryOutput(NNRecsScoreType scoreType,
+                         const std::string &featureIndexFileName,
+                         const std::string &sampleIndexFileName);
 
     void generateRecs(NNNetwork *network,
                       unsigned int topK,
                       const FilterConfig *filters,
                       const std::vector<std::string> &customerIndex,
                       const std::vector<std::string> &featureIndex);
+
+    /**
+     * Waits for the shard writers to drain, closes the shards and writes the manifest.
+     * No-op when writing to a single output file.
+     */
+    void finish();
 };
 
 #endif
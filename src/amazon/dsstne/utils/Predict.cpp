@@ -92,18 +92,21 @@ void convertTextToNetCDF(string inputTextFile,
 
 void printUsagePredict() {
     cout << "Predict: Generates predictions from a trained neural network given a signals/input dataset." << endl;
-    cout << "Usage: predict -d <dataset_name> -n <network_file> -r <input_text_file> -i <input_feature_index> -o <output_feature_index> -f <filters_json> [-b <batch_size>] [-k <num_recs>] [-l layer] [-s input_signals_index] [-p score_precision]" << endl;
+    cout << "Usage: predict -d <dataset_name> -n <network_file> -r <input_text_file> -i <input_feature_index> -o <output_feature_index> -f <filters_json> [-b <batch_size>] [-k <num_recs>] [-l layer] [-s input_signals_index] [-p score_precision] [-w num_output_shards] [-m shard_by] [-t output_format]" << endl;
     cout << "    -b batch_size: (default = 1024) the number records/input rows to process in a batch." << endl;
     cout << "    -d dataset_name: (required) name for the dataset within the netcdf file." << endl;
     cout << "    -f samples filterFileName ." << endl;
     cout << "    -i input_feature_index: (required) path to the feature index file, used to tranform input signals to correct input feature vector." << endl;
     cout << "    -k num_recs: (default = 100) The number of predictions (sorted by score to generate). Ignored if -l flag is used." << endl;
     cout << "    -l layer: (default = Output) the network layer to use for predictions. If specified, the raw scores for each node in the layer is output in order." << endl;
+    cout << "    -m shard_by: (default = range) how samples are assigned to output shards when -w > 1, either range (contiguous sample ranges) or hash (hash of the sample label)." << endl;
     cout << "    -n network_file: (required) the trained neural network in NetCDF file." << endl;
     cout << "    -o output_feature_index: (required) path to the feature index file, used to tranform the network output feature vector to appropriate features." << endl;
     cout << "    -p score_precision: (default = 4.3f) precision of the scores in output" << endl;
     cout << "    -r input_text_file: (required) path to the file with input signal to use to generate predictions (i.e. recommendations)." << endl;
     cout << "    -s filename (required) . to put the output recs to." << endl;
+    cout << "    -t output_format: (default = text) text writes label,score: lists. binary writes the compact format of NNRecsBinary.h with fp32 scores, binary_fp16 with fp16 scores." << endl;
+    cout << "    -w num_output_shards: (default = 1) number of output files <filename>.part-NNNNN, each written by its own thread. A <filename>.manifest lists the shards and their row counts." << endl;
     cout << endl;
 }
 
@@ -164,6 +167,24 @@ int main(int argc, char** argv)
 
     string scoreFormat = getOptionalArgValue(argc, argv, "-p", NNRecsGenerator::DEFAULT_SCORE_PRECISION);
 
+    int outputShards = stoi(getOptionalArgValue(argc, argv, "-w", "1"));
+    if (outputShards < 1) {
+        cout << "Error: num_output_shards must be at least 1, got " << outputShards << endl;
+        return 1;
+    }
+
+    string shardBy = getOptionalArgValue(argc, argv, "-m", NNRecsGenerator::SHARD_BY_RANGE);
+    if (shardBy != NNRecsGenerator::SHARD_BY_RANGE && shardBy != NNRecsGenerator::SHARD_BY_HASH) {
+        cout << "Error: shard_by must be " << NNRecsGenerator::SHARD_BY_RANGE << " or " << NNRecsGenerator::SHARD_BY_HASH << ", got " << shardBy << endl;
+        return 1;
+    }
+
+    string outputFormat = getOptionalArgValue(argc, argv, "-t", "text");
+    if (outputFormat != "text" && outputFormat != "binary" && outputFormat != "binary_fp16") {
+        cout << "Error: output_format must be text, binary or binary_fp16, got " << outputFormat << endl;
+        return 1;
+    }
+
 
     // Initialize GPU network
     getGpu().Startup(argc, argv);
@@ -207,9 +228,18 @@ int main(int argc, char** argv)
     }
 
     vector <NNDataSetBase*> vDataSetInput = LoadNetCDF(inputNetCDFFileName);
-    NNNetwork* pNetwork = LoadNeuralNetworkNetCDF(networkFileName, batchSize);
+    NNNetwork* pNetwork = LoadNeuralNetworkNetCDF(networkFileName, batchSize, true);
     pNetwork->LoadDataSets(vDataSetInput);
 
+    // The network is loaded for inference only, without training buffers
+    int totalGPUMemory;
+    int totalCPUMemory;
+    getGpu().GetMemoryUsage(&totalGPUMemory, &totalCPUMemory);
+    if (getGpu()._id == 0) {
+        cout << "GPU Memory Usage: " << totalGPUMemory << " KB" << endl;
+        cout << "CPU Memory Usage: " << totalCPUMemory << " KB" << endl;
+    }
+
     // Generate an ordered vector of the signals/samples index, so that output are correctly labeled.
     vector<string> vSignals(mSignals.size());
     extractNNMapsToVectors(vSignals, mSignals);
@@ -241,7 +271,12 @@ int main(int argc, char** argv)
     unsigned int lBatch            = pNetwork->GetBatch();
     unsigned int outputBufferSize  = pNetwork->GetBufferSize(recsGenLayerLabel);
 
-    NNRecsGenerator *nnRecsGenerator = new NNRecsGenerator(lBatch, topK, outputBufferSize, recsGenLayerLabel, scoreFormat);
+    NNRecsGenerator *nnRecsGenerator = new NNRecsGenerator(lBatch, topK, outputBufferSize, recsGenLayerLabel, scoreFormat, outputShards, shardBy);
+
+    if (outputFormat != "text") {
+        NNRecsScoreType scoreType = (outputFormat == "binary_fp16") ? RecsScoreFP16 : RecsScoreFP32;
+        nnRecsGenerator->setBinaryOutput(scoreType, outputIndexFileName, sampleIndexFile);
+    }
 
     auto const recsGenerationStart = std::chrono::steady_clock::now();
 
@@ -263,6 +298,7 @@ int main(int argc, char** argv)
         }
 
     }
+    nnRecsGenerator->finish();
     auto const recsGenerationEnd = std::chrono::steady_clock::now();
     auto const recsGenerationDuration = elapsed_seconds(recsGenerationStart, recsGenerationEnd);
     if (getGpu()._id == 0) {
@@ -0,0 +1,128 @@
+/*
+
+
+   Copyright 2016  Amazon.com, Inc. or its affiliates. All Rights Reserved.
+
+   Licensed under the Apache License, Version 2.0 (the "License"). You may not use this file except in compliance with the License. A copy of the License is located at
+
+   http://aws.amazon.com/apache2.0/
+
+   or in the "license" file accompanying this file. This file is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the License for the specific language governing permissions and limitations under the License.
+ */
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "Utils.h"
+
+using namespace std;
+
+void printUsageQuantizePredict() {
+    cout << "QuantizePredict: Quantizes a trained network to int8 on the CPU and compares its predictions with fp32. No GPU is required." << endl;
+    cout << "Usage: quantizePredict -n <network_file> -d <input_netcdf> [-l <output_layer>] [-k <top_k>] [-b <batch_size>] [-c <calibration_examples>] [-e <examples>]" << endl;
+    cout << "    -n network_file: (required) the trained network in netcdf format." << endl;
+    cout << "    -d input_netcdf: (required) netcdf file with the data sets of the input layers." << endl;
+    cout << "    -l output_layer: (default = Output) the layer whose top K units are compared." << endl;
+    cout << "    -k top_k: (default = 10) the number of top units compared per example." << endl;
+    cout << "    -b batch_size: (default = 1024) the prediction batch size." << endl;
+    cout << "    -c calibration_examples: (default = 1024) the first examples, used to calibrate the unit scales." << endl;
+    cout << "    -e examples: (default = all) the examples after the calibration ones that are predicted and compared." << endl;
+    cout << endl;
+}
+
+// Predicts examples [position, position + examples) and returns the seconds spent in PredictBatch and the top K
+// unit indices of every example
+static double predictTopK(NNCpuNetwork* pNetwork, const string& layer, uint32_t k, uint32_t position, uint32_t examples, vector<uint32_t>& vTopK)
+{
+    uint32_t batch = pNetwork->GetBatch();
+    double seconds = 0.0;
+    vTopK.resize((uint64_t)examples * k);
+    vector<NNFloat> vKey;
+    vector<uint32_t> vValue;
+    for (uint32_t i = 0; i < examples; i += batch) {
+        pNetwork->SetPosition(position + i);
+        auto const start = std::chrono::steady_clock::now();
+        pNetwork->PredictBatch();
+        seconds += elapsed_seconds(start, std::chrono::steady_clock::now());
+        pNetwork->CalculateTopK(layer, k, vKey, vValue);
+        uint32_t count = min(batch, examples - i);
+        copy(vValue.begin(), vValue.begin() + (uint64_t)count * k, vTopK.begin() + (uint64_t)i * k);
+    }
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    if (isArgSet(argc, argv, "-h")) {
+        printUsageQuantizePredict();
+        exit(1);
+    }
+
+    string networkFileName = getRequiredArgValue(argc, argv, "-n", "network file was not specified.", &printUsageQuantizePredict);
+    string dataFileName = getRequiredArgValue(argc, argv, "-d", "input data file was not specified.", &printUsageQuantizePredict);
+    for (auto& f : { networkFileName, dataFileName }) {
+        if (! fileExists(f)) {
+            cout << "Error: Cannot read file: " << f << endl;
+            return 1;
+        }
+    }
+    string layer = getOptionalArgValue(argc, argv, "-l", "Output");
+    unsigned int k = stoi(getOptionalArgValue(argc, argv, "-k", "10"));
+    unsigned int batchSize = stoi(getOptionalArgValue(argc, argv, "-b", "1024"));
+    unsigned int calibration = stoi(getOptionalArgValue(argc, argv, "-c", "1024"));
+
+    vector<NNDataSetBase*> vDataSet = LoadNetCDF(dataFileName);
+    NNCpuNetwork* pNetwork = LoadCpuNeuralNetworkNetCDF(networkFileName, batchSize);
+    if ((pNetwork == NULL) || !pNetwork->LoadDataSets(vDataSet)) {
+        cout << "Error: Cannot predict " << networkFileName << " on the CPU" << endl;
+        return 1;
+    }
+    uint32_t available = pNetwork->GetExamples();
+    if (calibration >= available) {
+        cout << "Error: No examples left after the " << calibration << " calibration examples, the data set has " << available << endl;
+        return 1;
+    }
+    unsigned int examples = stoi(getOptionalArgValue(argc, argv, "-e", to_string(available - calibration)));
+    examples = min(examples, available - calibration);
+
+    // fp32 reference on examples the scales were not calibrated on
+    vector<uint32_t> vTopK, vQuantizedTopK;
+    double seconds = predictTopK(pNetwork, layer, k, calibration, examples, vTopK);
+
+    auto const start = std::chrono::steady_clock::now();
+    if (!pNetwork->Quantize(calibration)) {
+        cout << "Error: Cannot quantize " << networkFileName << endl;
+        return 1;
+    }
+    double quantizeSeconds = elapsed_seconds(start, std::chrono::steady_clock::now());
+    double quantizedSeconds = predictTopK(pNetwork, layer, k, calibration, examples, vQuantizedTopK);
+
+    // Fraction of the fp32 top K units that are also in the int8 top K, regardless of their order
+    uint64_t matches = 0;
+    for (uint64_t i = 0; i < (uint64_t)examples * k; i += k) {
+        for (uint32_t j = 0; j < k; j++)
+            matches += count(vQuantizedTopK.begin() + i, vQuantizedTopK.begin() + i + k, vTopK[i + j]);
+    }
+
+    uint64_t bytes = pNetwork->GetWeightBytes(false);
+    uint64_t quantizedBytes = pNetwork->GetWeightBytes(true);
+    printf("QuantizePredict: Calibrated on %u examples in %.3f s, compared %u examples of layer %s with the %s kernel\n",
+           calibration, quantizeSeconds, examples, layer.c_str(), hGetQuantizedKernelName());
+    printf("%-16s %12s %16s %16s\n", "", "Seconds", "Examples/s", "Weight bytes");
+    printf("%-16s %12.4f %16.1f %16" PRIu64 "\n", "fp32", seconds, examples / seconds, bytes);
+    printf("%-16s %12.4f %16.1f %16" PRIu64 "\n", "int8", quantizedSeconds, examples / quantizedSeconds, quantizedBytes);
+    printf("Speedup %.2fx, weights %.2fx smaller, top %u overlap %.4f\n",
+           seconds / quantizedSeconds, (double)bytes / quantizedBytes, k, (double)matches / ((uint64_t)examples * k));
+
+    delete pNetwork;
+    for (auto p : vDataSet) {
+        delete p;
+    }
+    return 0;
+}
@@ -34,13 +34,15 @@ using namespace netCDF::exceptions;
 
 void printUsageTrain() {
     cout << "Train: Trains a neural networks given a config and dataset." << endl;
-    cout << "Usage: train -d <dataset_name> -c <config_file> -n <network_file> -i <input_netcdf> -o <output_netcdf> [-b <batch_size>] [-e <num_epochs>]" << endl;
+    cout << "Usage: train -d <dataset_name> -c <config_file> -n <network_file> -i <input_netcdf> -o <output_netcdf> [-b <batch_size>] [-e <num_epochs>] [-cpu <threads>]" << endl;
     cout << "    -c config_file: (required) the JSON config files with network training parameters." << endl;
     cout << "    -i input_netcdf: (required) path to the netcdf with dataset for the input of the network." << endl;
     cout << "    -o output_netcdf: (required) path to the netcdf with dataset for expected output of the network." << endl;
     cout << "    -n network_file: (required) the output trained neural network in NetCDF file." << endl;
     cout << "    -b batch_size: (default = 1024) the number records/input rows to process in a batch." << endl;
     cout << "    -e num_epochs: (default = 40) the number passes on the full dataset." << endl;
+    cout << "    -cpu threads: train on the CPU with this many Hogwild threads (0 = all OpenMP threads) instead of the GPU," << endl;
+    cout << "                  starting from the same initial network." << endl;
     cout << endl;
 }
 
@@ -111,6 +113,12 @@ int main(int argc, char** argv)
 
     unsigned int epoch =  stoi(getOptionalArgValue(argc, argv, "-e", "40"));
     cout << "Train will use number of epochs: " << epoch << endl;
+
+    bool bCpu = isArgSet(argc, argv, "-cpu");
+    unsigned int cpuThreads = stoi(getOptionalArgValue(argc, argv, "-cpu", "0"));
+    if (bCpu) {
+        cout << "Train will train on the CPU with threads: " << cpuThreads << endl;
+    }
     cout << "Train alpha " << alpha << ", lambda " << lambda <<", mu "<< mu <<".Please check CDL.txt for meanings" << endl;
     cout << "Train alpha " << alpha << ", lambda " << lambda << ", lambda1 " << lambda1 << ", mu " << mu << ", mu1 " << mu1 << ".Please check CDL.txt for meanings" << endl;    
 	
@@ -141,17 +149,51 @@ int main(int argc, char** argv)
     // Set to default training mode SGD.
     TrainingMode mode=SGD;
     pNetwork->SetTrainingMode(mode);
+
+    // The CPU network starts from the saved initial network and gets its own copies of the data sets,
+    // the GPU network has sharded the ones loaded above
+    NNCpuNetwork* pCpuNetwork = NULL;
+    vector <NNDataSetBase*> vCpuDataSet;
+    if (bCpu) {
+        vCpuDataSet = LoadNetCDF(inputDataFile);
+        vector <NNDataSetBase*> vCpuDataSetOutput = LoadNetCDF(outputDataFile);
+        vCpuDataSet.insert(vCpuDataSet.end(), vCpuDataSetOutput.begin(), vCpuDataSetOutput.end());
+        pCpuNetwork = LoadCpuNeuralNetworkNetCDF("initial_network.nc", batchSize);
+        if ((pCpuNetwork == NULL) || !pCpuNetwork->LoadDataSets(vCpuDataSet)) {
+            cout << "Error: Cannot train initial_network.nc on the CPU" << endl;
+            return 1;
+        }
+        pCpuNetwork->SetTrainingMode(mode);
+        pCpuNetwork->SetThreads(cpuThreads);
+    }
 	
     auto const start = std::chrono::steady_clock::now();
     // Start Training
+    float error = 0.0f;
     for(unsigned int x = 0 ; x < epoch; ++x) {
-        float error = pNetwork->Train(1, alpha, lambda, lambda1, mu, mu1);
+        error = bCpu ? pCpuNetwork->Train(1, alpha, lambda, lambda1, mu, mu1) : pNetwork->Train(1, alpha, lambda, lambda1, mu, mu1);
         CWMetric::updateMetrics("Average_Error",error);
         CWMetric::updateMetrics("Epochs",x+1);
     }
     auto const end = std::chrono::steady_clock::now();
     CWMetric::updateMetrics("Training_Time", elapsed_seconds(start, end));
-    cout << "Total Training Time " << elapsed_seconds(start, end);
+    cout << "Total Training Time " << elapsed_seconds(start, end) << endl;
+    cout << "Final average error " << error << ", " << (double)pNetwork->GetExamples() * epoch / elapsed_seconds(start, end) << " examples/s" << endl;
+
+    // Copy the CPU trained weights into the GPU network to save them
+    if (bCpu) {
+        for (const auto& layers : pCpuNetwork->GetWeightLayers()) {
+            vector<NNFloat> vWeight, vBias;
+            NNWeight* pWeight = pNetwork->GetWeight(get<0>(layers), get<1>(layers));
+            pCpuNetwork->GetWeights(get<0>(layers), get<1>(layers), vWeight, vBias);
+            pWeight->SetWeights(vWeight);
+            pWeight->SetBiases(vBias);
+        }
+        delete pCpuNetwork;
+        for (auto p : vCpuDataSet) {
+            delete p;
+        }
+    }
 
     int totalGPUMemory;
     int totalCPUMemory;
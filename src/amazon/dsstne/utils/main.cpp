@@ -71,7 +71,7 @@ int main(int argc, char** argv)
 #endif    
     // Create neural network
     if (cdl._mode == Prediction)
-        pNetwork = LoadNeuralNetworkNetCDF(cdl._networkFileName, cdl._batch);
+        pNetwork = LoadNeuralNetworkNetCDF(cdl._networkFileName, cdl._batch, true);
     else
         pNetwork = LoadNeuralNetworkJSON(cdl._networkFileName, cdl._batch, vDataSet);
  
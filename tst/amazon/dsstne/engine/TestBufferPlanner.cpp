@@ -0,0 +1,112 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <random>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks that PlanBufferArenas never places buffers that are live during the same step in the
+ * same arena, that every arena fits its buffers and that chains of layers need only two arenas.
+ */
+class TestBufferPlanner : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestBufferPlanner);
+
+    CPPUNIT_TEST(testChain);
+    CPPUNIT_TEST(testSkip);
+    CPPUNIT_TEST(testRandom);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static NNBufferLifetime Lifetime(uint64_t size, uint32_t first, uint32_t last)
+    {
+        NNBufferLifetime l;
+        l._size = size;
+        l._first = first;
+        l._last = last;
+        return l;
+    }
+
+    void checkPlan(const std::vector<NNBufferLifetime>& vLifetime, const std::vector<uint32_t>& vArena,
+                   const std::vector<uint64_t>& vArenaSize, uint64_t total)
+    {
+        CPPUNIT_ASSERT_EQUAL(vLifetime.size(), vArena.size());
+        uint64_t sum = 0;
+        for (auto size : vArenaSize)
+            sum += size;
+        CPPUNIT_ASSERT_EQUAL(sum, total);
+
+        for (size_t i = 0; i < vLifetime.size(); i++)
+        {
+            CPPUNIT_ASSERT(vArena[i] < vArenaSize.size());
+            CPPUNIT_ASSERT(vLifetime[i]._size <= vArenaSize[vArena[i]]);
+            for (size_t j = i + 1; j < vLifetime.size(); j++)
+            {
+                bool bOverlap = (vLifetime[i]._first <= vLifetime[j]._last) && (vLifetime[j]._first <= vLifetime[i]._last);
+                CPPUNIT_ASSERT(!bOverlap || (vArena[i] != vArena[j]));
+            }
+        }
+    }
+
+ public:
+    void testChain()
+    {
+        // Input, 6 hidden layers of varying width and an output read after the last step
+        std::vector<NNBufferLifetime> vLifetime;
+        std::vector<uint64_t> vSize = {4096, 1024, 2048, 512, 2048, 1024, 256, 128};
+        uint32_t steps = vSize.size();
+        for (uint32_t i = 0; i < steps; i++)
+            vLifetime.push_back(Lifetime(vSize[i], (i == 0) ? 0 : i, (i == steps - 1) ? steps : i + 1));
+
+        std::vector<uint32_t> vArena;
+        std::vector<uint64_t> vArenaSize;
+        uint64_t total = PlanBufferArenas(vLifetime, vArena, vArenaSize);
+        checkPlan(vLifetime, vArena, vArenaSize, total);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, vArenaSize.size());
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(4096 + 1024), total);
+    }
+
+    void testSkip()
+    {
+        // 0 -> 1 -> 2 -> 3 with a skip connection from 1 to 3 keeps 1 live across 2
+        std::vector<NNBufferLifetime> vLifetime = {
+            Lifetime(100, 0, 1),
+            Lifetime(100, 1, 3),
+            Lifetime(100, 2, 3),
+            Lifetime(100, 3, 4),
+        };
+
+        std::vector<uint32_t> vArena;
+        std::vector<uint64_t> vArenaSize;
+        uint64_t total = PlanBufferArenas(vLifetime, vArena, vArenaSize);
+        checkPlan(vLifetime, vArena, vArenaSize, total);
+        CPPUNIT_ASSERT_EQUAL((size_t)3, vArenaSize.size());
+        CPPUNIT_ASSERT_EQUAL(vArena[0], vArena[2]);
+    }
+
+    void testRandom()
+    {
+        std::mt19937 rng(12345);
+        for (uint32_t trial = 0; trial < 50; trial++)
+        {
+            std::vector<NNBufferLifetime> vLifetime;
+            uint32_t buffers = 1 + rng() % 40;
+            for (uint32_t i = 0; i < buffers; i++)
+            {
+                uint32_t first = rng() % 20;
+                vLifetime.push_back(Lifetime(1 + rng() % 10000, first, first + rng() % 5));
+            }
+
+            std::vector<uint32_t> vArena;
+            std::vector<uint64_t> vArenaSize;
+            uint64_t total = PlanBufferArenas(vLifetime, vArena, vArenaSize);
+            checkPlan(vLifetime, vArena, vArenaSize, total);
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestBufferPlanner);
@@ -0,0 +1,239 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks the host activation functions and their derivatives against double precision
+ * references over [-40, 40], on every instruction set the CPU supports, with the error
+ * bounds documented in hostkernels.h.
+ */
+class TestHostActivation : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestHostActivation);
+
+    CPPUNIT_TEST(testActivation);
+    CPPUNIT_TEST(testSoftMax);
+    CPPUNIT_TEST(testHadamardProduct);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    const NNFloat slope = 0.1f;
+    const NNFloat alpha = 1.6732632f;
+    const NNFloat lambda = 1.0507010f;
+
+    // Dense grid over [-40, 40] with extra points near 0, where the polynomials switch ranges, and an odd
+    // size so that every vectorized kernel also has a scalar tail
+    std::vector<NNFloat> generateInputs()
+    {
+        std::vector<NNFloat> vX;
+        for (int i = -400000; i <= 400000; i++)
+            vX.push_back(i * 1.0e-4f);
+        for (int i = -10000; i <= 10000; i++)
+            vX.push_back(i * 1.0e-7f);
+        vX.push_back(-1.0e-30f);
+        vX.push_back(1.0e-30f);
+        return vX;
+    }
+
+    double reference(Activation activation, double x)
+    {
+        switch (activation)
+        {
+            case Sigmoid:
+                return 1.0 / (1.0 + exp(-x));
+            case Tanh:
+                return tanh(x);
+            case RectifiedLinear:
+            case RELUMax:
+                return std::max(x, 0.0);
+            case LeakyRectifiedLinear:
+            case ParametricRectifiedLinear:
+                return std::max((NNFloat)x, (NNFloat)x * slope);
+            case ExponentialLinear:
+                return (x > 0.0) ? x : alpha * expm1(x);
+            case ScaledExponentialLinear:
+                return (x > 0.0) ? lambda * x : lambda * alpha * expm1(x);
+            case SoftPlus:
+                return std::max(x, 0.0) + log1p(exp(-fabs(x)));
+            case SoftSign:
+                return x / (1.0 + fabs(x));
+            default:
+                return x;
+        }
+    }
+
+    // Derivative as a function of the activation's output y, as kCalculateHadamardProduct computes it
+    double referenceDerivative(Activation activation, double y)
+    {
+        switch (activation)
+        {
+            case Sigmoid:
+                return y * (1.0 - y);
+            case Tanh:
+                return 1.0 - y * y;
+            case RectifiedLinear:
+            case RELUMax:
+                return (y > 0.0) ? 1.0 : 0.0;
+            case LeakyRectifiedLinear:
+            case ParametricRectifiedLinear:
+                return (y > 0.0) ? 1.0 : slope;
+            case ExponentialLinear:
+                return (y > 0.0) ? 1.0 : y + alpha;
+            case ScaledExponentialLinear:
+                return (y > 0.0) ? lambda : y + lambda * alpha;
+            case SoftPlus:
+                return -expm1(-y);
+            case SoftSign:
+                return (1.0 - fabs(y)) * (1.0 - fabs(y));
+            default:
+                return 1.0;
+        }
+    }
+
+    // Error measure of each activation: absolute for the bounded ones, relative for the others
+    // (relative to the negative branch's scale for ELU and SELU)
+    double error(Activation activation, double expected, double actual)
+    {
+        switch (activation)
+        {
+            case Sigmoid:
+            case Tanh:
+            case SoftSign:
+                return fabs(actual - expected);
+            default:
+                return fabs(actual - expected) / std::max(fabs(expected), 1.0e-30);
+        }
+    }
+
+    double bound(Activation activation)
+    {
+        switch (activation)
+        {
+            case Sigmoid:
+            case Tanh:
+            case SoftSign:
+                return 2.0e-7;
+            case ExponentialLinear:
+            case ScaledExponentialLinear:
+            case SoftPlus:
+                return 4.0e-7;
+            default:
+                return 0.0;
+        }
+    }
+
+    std::vector<HostSimd> supportedSimd()
+    {
+        std::vector<HostSimd> vSimd;
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+        {
+            if (simd <= best)
+                vSimd.push_back(simd);
+        }
+        return vSimd;
+    }
+
+    std::vector<Activation> elementwiseActivations()
+    {
+        return { Sigmoid, Tanh, RectifiedLinear, Linear, ParametricRectifiedLinear, SoftPlus, SoftSign,
+                 RELUMax, LinearMax, ExponentialLinear, LeakyRectifiedLinear, ScaledExponentialLinear };
+    }
+
+ public:
+    void testActivation()
+    {
+        std::vector<NNFloat> vX = generateInputs();
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            for (Activation activation : elementwiseActivations())
+            {
+                std::vector<NNFloat> vY(vX);
+                hCalculateActivation(activation, vY.data(), 1, vY.size(), slope, alpha, lambda);
+                double maxError = 0.0;
+                for (size_t i = 0; i < vX.size(); i++)
+                    maxError = std::max(maxError, error(activation, reference(activation, vX[i]), vY[i]));
+                std::stringstream message;
+                message << hGetSimdName(simd) << " " << activation << " error " << maxError;
+                CPPUNIT_ASSERT_MESSAGE(message.str(), maxError <= bound(activation));
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testSoftMax()
+    {
+        const uint32_t batch = 17;
+        std::vector<NNFloat> vX = generateInputs();
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            // Widths around the vector sizes and a wide one
+            for (uint32_t stride : { 1u, 7u, 16u, 37u, 1000u })
+            {
+                std::vector<NNFloat> vY(batch * stride);
+                for (size_t i = 0; i < vY.size(); i++)
+                    vY[i] = vX[(i * 7919) % vX.size()] * 0.5f;
+                std::vector<NNFloat> vInput(vY);
+                hCalculateSoftMaxActivation(vY.data(), batch, stride);
+
+                double maxError = 0.0;
+                for (uint32_t b = 0; b < batch; b++)
+                {
+                    const NNFloat* pX = vInput.data() + b * stride;
+                    double maxValue = *std::max_element(pX, pX + stride);
+                    double sum = 0.0;
+                    for (uint32_t j = 0; j < stride; j++)
+                        sum += exp(pX[j] - maxValue);
+                    for (uint32_t j = 0; j < stride; j++)
+                        maxError = std::max(maxError, fabs(exp(pX[j] - maxValue) / sum - vY[b * stride + j]));
+                }
+                std::stringstream message;
+                message << hGetSimdName(simd) << " stride " << stride << " error " << maxError;
+                CPPUNIT_ASSERT_MESSAGE(message.str(), maxError <= 2.0e-7);
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testHadamardProduct()
+    {
+        std::vector<NNFloat> vX = generateInputs();
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            for (Activation activation : elementwiseActivations())
+            {
+                // Deltas of 1 give the derivative itself
+                std::vector<NNFloat> vUnit(vX.size());
+                for (size_t i = 0; i < vX.size(); i++)
+                    vUnit[i] = (NNFloat)reference(activation, vX[i]);
+                std::vector<NNFloat> vDelta(vX.size(), 1.0f);
+                hCalculateHadamardProduct(activation, vX.size(), 1.0f, vUnit.data(), vDelta.data(), slope, alpha, lambda);
+
+                double maxError = 0.0;
+                for (size_t i = 0; i < vX.size(); i++)
+                    maxError = std::max(maxError, error(activation, referenceDerivative(activation, vUnit[i]), vDelta[i]));
+                std::stringstream message;
+                message << hGetSimdName(simd) << " " << activation << " error " << maxError;
+                CPPUNIT_ASSERT_MESSAGE(message.str(), maxError <= bound(activation));
+            }
+        }
+        hSetSimd(best);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHostActivation);
@@ -0,0 +1,401 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <random>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks the host kernels of hostkernels.h against naive single threaded
+ * implementations, on every instruction set the CPU supports.
+ */
+class TestHostKernels : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestHostKernels);
+
+    CPPUNIT_TEST(testSparseZ);
+    CPPUNIT_TEST(testIndexedSparseAnalogZ);
+    CPPUNIT_TEST(testSparseDenoisedZ);
+    CPPUNIT_TEST(testSparseTransposedMatrix);
+    CPPUNIT_TEST(testSparseTransposedWeightGradient);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    // Random sparse data set of examples with 0 to maxNonzeros nonzeros out of inputs features
+    struct SparseData
+    {
+        std::vector<uint64_t> vSparseStart;
+        std::vector<uint64_t> vSparseEnd;
+        std::vector<uint32_t> vSparseIndex;
+        std::vector<unsigned char> vSparseData;
+        std::vector<NNFloat> vDataWeight;
+        std::vector<NNFloat> vRandom;
+        std::vector<uint32_t> vIndex;
+        std::vector<uint32_t> vShuffleIndex;
+    };
+
+    std::mt19937 generator;
+
+    SparseData generateSparseData(uint32_t examples, uint32_t inputs, uint32_t maxNonzeros)
+    {
+        SparseData data;
+        std::uniform_int_distribution<uint32_t> nonzeros(0, maxNonzeros);
+        std::uniform_int_distribution<uint32_t> index(0, inputs - 1);
+        std::uniform_int_distribution<uint32_t> value(0, 255);
+        std::uniform_real_distribution<NNFloat> uniform(0.0f, 1.0f);
+        for (uint32_t i = 0; i < examples; i++)
+        {
+            data.vSparseStart.push_back(data.vSparseIndex.size());
+            uint32_t count = nonzeros(generator);
+            for (uint32_t j = 0; j < count; j++)
+            {
+                data.vSparseIndex.push_back(index(generator));
+                data.vSparseData.push_back(value(generator));
+                data.vRandom.push_back(uniform(generator));
+            }
+            data.vSparseEnd.push_back(data.vSparseIndex.size());
+            data.vDataWeight.push_back(0.5f + uniform(generator));
+            data.vIndex.push_back(examples - 1 - i);
+            data.vShuffleIndex.push_back(i);
+        }
+        std::shuffle(data.vShuffleIndex.begin(), data.vShuffleIndex.end(), generator);
+        return data;
+    }
+
+    std::vector<NNFloat> generateVector(size_t size)
+    {
+        std::uniform_real_distribution<NNFloat> uniform(-1.0f, 1.0f);
+        std::vector<NNFloat> v(size);
+        for (auto& x : v)
+        {
+            x = uniform(generator);
+        }
+        return v;
+    }
+
+    // kCalculateSparseZ semantics with every option: pIndex, pSparseData, pRandom and pShuffleIndex may be NULL
+    void referenceSparseZ(uint32_t position, uint32_t batch, uint32_t stride, const NNFloat* pWeight, const uint32_t* pIndex,
+                          const SparseData& data, bool bAnalog, bool bWeighted, const NNFloat* pRandom, NNFloat p,
+                          NNFloat* pUnit, NNFloat beta, const uint32_t* pShuffleIndex)
+    {
+        NNFloat q = (pRandom != NULL) ? 1.0f / (1.0f - p) : 1.0f;
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example = (pShuffleIndex != NULL) ? pShuffleIndex[position + i] : position + i;
+            if (pIndex != NULL)
+                example = pIndex[example];
+            uint64_t start = data.vSparseStart[example];
+            uint64_t end = data.vSparseEnd[example];
+            if (start == end)
+                continue;
+            NNFloat w = q * (bWeighted ? data.vDataWeight[example] : 1.0f);
+            for (uint32_t o = 0; o < stride; o++)
+            {
+                NNFloat unit = (beta == 0.0f) ? 0.0f : beta * pUnit[(uint64_t)i * stride + o];
+                for (uint64_t j = start; j < end; j++)
+                {
+                    if ((pRandom != NULL) && (pRandom[j] < p))
+                        continue;
+                    NNFloat value = bAnalog ? data.vSparseData[j] / 256.0f : 1.0f;
+                    unit += w * value * pWeight[(uint64_t)data.vSparseIndex[j] * stride + o];
+                }
+                pUnit[(uint64_t)i * stride + o] = unit;
+            }
+        }
+    }
+
+    // Per feature lists of (batch row, value) in batch order, the order of the host transposed matrix kernels
+    std::vector<std::vector<std::pair<uint32_t, NNFloat>>> referenceSparseTransposedMatrix(uint32_t position, uint32_t batch, uint32_t inputs, const uint32_t* pIndex,
+                                                                                         const SparseData& data, bool bAnalog, bool bWeighted, const NNFloat* pRandom, NNFloat p,
+                                                                                         const uint32_t* pShuffleIndex)
+    {
+        NNFloat q = (pRandom != NULL) ? 1.0f / (1.0f - p) : 1.0f;
+        std::vector<std::vector<std::pair<uint32_t, NNFloat>>> vFeature(inputs);
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example = (pShuffleIndex != NULL) ? pShuffleIndex[position + i] : position + i;
+            if (pIndex != NULL)
+                example = pIndex[example];
+            NNFloat w = q * (bWeighted ? data.vDataWeight[example] : 1.0f);
+            for (uint64_t j = data.vSparseStart[example]; j < data.vSparseEnd[example]; j++)
+            {
+                if ((pRandom != NULL) && (pRandom[j] < p))
+                    continue;
+                NNFloat value = bAnalog ? data.vSparseData[j] / 256.0f : 1.0f;
+                vFeature[data.vSparseIndex[j]].push_back(std::make_pair(i, w * value));
+            }
+        }
+        return vFeature;
+    }
+
+    // Capacity of each feature's list for every example of the data set, like NNDataSet::GenerateSparseTransposedMatrix
+    std::vector<uint32_t> generateSparseTransposedStart(const SparseData& data, uint32_t inputs)
+    {
+        std::vector<uint32_t> vCount(inputs, 0);
+        for (uint32_t index : data.vSparseIndex)
+            vCount[index]++;
+        std::vector<uint32_t> vStart(inputs);
+        uint32_t start = 0;
+        for (uint32_t i = 0; i < inputs; i++)
+        {
+            vStart[i] = start;
+            start += vCount[i];
+        }
+        return vStart;
+    }
+
+    void assertNear(const std::vector<NNFloat>& vExpected, const std::vector<NNFloat>& vActual, const std::string& message)
+    {
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(message, vExpected.size(), vActual.size());
+        for (size_t i = 0; i < vExpected.size(); i++)
+        {
+            NNFloat tolerance = 1.0e-5f * std::max(1.0f, std::fabs(vExpected[i]));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE(message, vExpected[i], vActual[i], tolerance);
+        }
+    }
+
+    std::vector<HostSimd> supportedSimd()
+    {
+        std::vector<HostSimd> vSimd;
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+        {
+            if (simd <= best)
+                vSimd.push_back(simd);
+        }
+        return vSimd;
+    }
+
+ public:
+    void setUp()
+    {
+        generator.seed(12345);
+    }
+
+    void testSparseZ()
+    {
+        const uint32_t examples = 64;
+        const uint32_t inputs = 300;
+        const uint32_t batch = 24;
+        const uint32_t position = 17;
+        SparseData data = generateSparseData(examples, inputs, 40);
+        HostSimd best = hGetSimd();
+
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            // widths around the vector and tile sizes of each instruction set
+            for (uint32_t stride : { 1u, 7u, 8u, 16u, 31u, 33u, 64u, 100u, 257u })
+            {
+                std::vector<NNFloat> vWeight = generateVector((size_t)inputs * stride);
+                std::vector<NNFloat> vInitial = generateVector((size_t)batch * stride);
+                for (NNFloat beta : { 0.0f, 1.0f, 0.5f })
+                {
+                    for (uint32_t prefetch : { 0u, 4u })
+                    {
+                        for (bool bShuffle : { false, true })
+                        {
+                            hSetWeightPrefetch(prefetch);
+                            uint32_t* pShuffleIndex = bShuffle ? data.vShuffleIndex.data() : NULL;
+                            std::vector<NNFloat> vExpected(vInitial);
+                            std::vector<NNFloat> vActual(vInitial);
+                            referenceSparseZ(position, batch, stride, vWeight.data(), NULL, data, false, true, NULL, 0.0f, vExpected.data(), beta, pShuffleIndex);
+                            hCalculateSparseZ(position, batch, stride, vWeight.data(), data.vSparseStart.data(), data.vSparseEnd.data(),
+                                              data.vSparseIndex.data(), data.vDataWeight.data(), vActual.data(), beta, pShuffleIndex);
+                            assertNear(vExpected, vActual, std::string(hGetSimdName(simd)) + " stride " + std::to_string(stride));
+                        }
+                    }
+                }
+            }
+        }
+        hSetWeightPrefetch(0);
+        hSetSimd(best);
+    }
+
+    void testIndexedSparseAnalogZ()
+    {
+        const uint32_t examples = 50;
+        const uint32_t inputs = 1000;
+        const uint32_t batch = examples;
+        const uint32_t stride = 130;
+        SparseData data = generateSparseData(examples, inputs, 100);
+        std::vector<NNFloat> vWeight = generateVector((size_t)inputs * stride);
+        std::vector<NNFloat> vInitial = generateVector((size_t)batch * stride);
+        HostSimd best = hGetSimd();
+
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            std::vector<NNFloat> vExpected(vInitial);
+            std::vector<NNFloat> vActual(vInitial);
+            referenceSparseZ(0, batch, stride, vWeight.data(), data.vIndex.data(), data, true, false, NULL, 0.0f, vExpected.data(), 1.0f, NULL);
+            hCalculateIndexedSparseAnalogZ(0, batch, stride, vWeight.data(), data.vIndex.data(), data.vSparseStart.data(), data.vSparseEnd.data(),
+                                           data.vSparseIndex.data(), (NNFloat*)NULL, data.vSparseData.data(), vActual.data(), 1.0f);
+            assertNear(vExpected, vActual, hGetSimdName(simd));
+        }
+        hSetSimd(best);
+    }
+
+    void testSparseDenoisedZ()
+    {
+        const uint32_t examples = 40;
+        const uint32_t inputs = 200;
+        const uint32_t batch = examples;
+        const uint32_t stride = 72;
+        const NNFloat p = 0.3f;
+        SparseData data = generateSparseData(examples, inputs, 30);
+        std::vector<NNFloat> vWeight = generateVector((size_t)inputs * stride);
+        std::vector<NNFloat> vInitial = generateVector((size_t)batch * stride);
+
+        std::vector<NNFloat> vExpected(vInitial);
+        std::vector<NNFloat> vActual(vInitial);
+        referenceSparseZ(0, batch, stride, vWeight.data(), NULL, data, false, true, data.vRandom.data(), p, vExpected.data(), 1.0f, NULL);
+        hCalculateSparseDenoisedZ(0, batch, stride, vWeight.data(), data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(),
+                                  data.vDataWeight.data(), data.vRandom.data(), vActual.data(), 1.0f, p);
+        assertNear(vExpected, vActual, "boolean");
+
+        vExpected = vInitial;
+        vActual = vInitial;
+        referenceSparseZ(0, batch, stride, vWeight.data(), data.vIndex.data(), data, true, false, data.vRandom.data(), p, vExpected.data(), 0.0f, NULL);
+        hCalculateIndexedSparseAnalogDenoisedZ(0, batch, stride, vWeight.data(), data.vIndex.data(), data.vSparseStart.data(), data.vSparseEnd.data(),
+                                               data.vSparseIndex.data(), (NNFloat*)NULL, data.vSparseData.data(), data.vRandom.data(), vActual.data(), 0.0f, p);
+        assertNear(vExpected, vActual, "indexed analog");
+    }
+
+    void testSparseTransposedMatrix()
+    {
+        const uint32_t examples = 80;
+        const uint32_t inputs = 150;
+        const uint32_t batch = 32;
+        const uint32_t position = 20;
+        const NNFloat p = 0.25f;
+        SparseData data = generateSparseData(examples, inputs, 30);
+        std::vector<uint32_t> vStart = generateSparseTransposedStart(data, inputs);
+        int threads = omp_get_max_threads();
+
+        // Lists must not depend on the thread count
+        for (int t : { 1, 3, 8 })
+        {
+            omp_set_num_threads(t);
+            for (int variant = 0; variant < 4; variant++)
+            {
+                bool bIndexed = (variant & 1);
+                bool bDenoised = (variant & 2);
+                uint32_t* pIndex = bIndexed ? data.vIndex.data() : NULL;
+                NNFloat* pRandom = bDenoised ? data.vRandom.data() : NULL;
+                for (bool bAnalog : { false, true })
+                {
+                    std::vector<uint32_t> vEnd(vStart);
+                    std::vector<uint32_t> vTransposedIndex(data.vSparseIndex.size());
+                    std::vector<NNFloat> vTransposedData(data.vSparseIndex.size());
+                    NNFloat* pDataWeight = data.vDataWeight.data();
+                    uint32_t* pShuffleIndex = data.vShuffleIndex.data();
+                    if (bAnalog && bIndexed && bDenoised)
+                        hCalculateIndexedSparseTransposedAnalogDenoisedMatrix(position, batch, pIndex, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight, data.vSparseData.data(),
+                                                                              pRandom, vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), p, pShuffleIndex);
+                    else if (bAnalog && bDenoised)
+                        hCalculateSparseTransposedAnalogDenoisedMatrix(position, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight, data.vSparseData.data(),
+                                                                       pRandom, vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), p, pShuffleIndex);
+                    else if (bAnalog && bIndexed)
+                        hCalculateIndexedSparseTransposedAnalogMatrix(position, batch, pIndex, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight, data.vSparseData.data(),
+                                                                      vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), pShuffleIndex);
+                    else if (bAnalog)
+                        hCalculateSparseTransposedAnalogMatrix(position, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight, data.vSparseData.data(),
+                                                               vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), pShuffleIndex);
+                    else if (bIndexed && bDenoised)
+                        hCalculateIndexedSparseTransposedDenoisedMatrix(position, batch, pIndex, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight,
+                                                                        pRandom, vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), p, pShuffleIndex);
+                    else if (bDenoised)
+                        hCalculateSparseTransposedDenoisedMatrix(position, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight,
+                                                                 pRandom, vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), p, pShuffleIndex);
+                    else if (bIndexed)
+                        hCalculateIndexedSparseTransposedMatrix(position, batch, pIndex, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight,
+                                                                vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), pShuffleIndex);
+                    else
+                        hCalculateSparseTransposedMatrix(position, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), pDataWeight,
+                                                         vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), pShuffleIndex);
+
+                    auto vExpected = referenceSparseTransposedMatrix(position, batch, inputs, pIndex, data, bAnalog, true, pRandom, p, pShuffleIndex);
+                    std::string message = "threads " + std::to_string(t) + " variant " + std::to_string(variant) + (bAnalog ? " analog" : "");
+                    for (uint32_t f = 0; f < inputs; f++)
+                    {
+                        CPPUNIT_ASSERT_EQUAL_MESSAGE(message, (uint32_t)vExpected[f].size(), vEnd[f] - vStart[f]);
+                        for (uint32_t j = 0; j < vExpected[f].size(); j++)
+                        {
+                            CPPUNIT_ASSERT_EQUAL_MESSAGE(message, vExpected[f][j].first, vTransposedIndex[vStart[f] + j]);
+                            CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE(message, vExpected[f][j].second, vTransposedData[vStart[f] + j], 1.0e-6f);
+                        }
+                    }
+                }
+            }
+        }
+        omp_set_num_threads(threads);
+    }
+
+    void testSparseTransposedWeightGradient()
+    {
+        const uint32_t examples = 48;
+        const uint32_t inputs = 400;
+        const uint32_t batch = examples;
+        SparseData data = generateSparseData(examples, inputs, 60);
+        std::vector<uint32_t> vStart = generateSparseTransposedStart(data, inputs);
+        HostSimd best = hGetSimd();
+
+        for (bool bAnalog : { false, true })
+        {
+            // Transposed matrix of an unweighted boolean or analog batch
+            std::vector<uint32_t> vEnd(vStart);
+            std::vector<uint32_t> vTransposedIndex(data.vSparseIndex.size());
+            std::vector<NNFloat> vTransposedData(data.vSparseIndex.size());
+            if (bAnalog)
+                hCalculateSparseTransposedAnalogMatrix(0, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), (NNFloat*)NULL, data.vSparseData.data(),
+                                                       vEnd.data(), vTransposedIndex.data(), vTransposedData.data());
+            else
+                hCalculateSparseTransposedMatrix(0, batch, data.vSparseStart.data(), data.vSparseEnd.data(), data.vSparseIndex.data(), NULL,
+                                                 vEnd.data(), vTransposedIndex.data(), NULL);
+
+            for (uint32_t n : { 1u, 9u, 64u, 100u })
+            {
+                std::vector<NNFloat> vDelta = generateVector((size_t)batch * n);
+                std::vector<NNFloat> vInitial = generateVector((size_t)inputs * n);
+                for (NNFloat beta : { 0.0f, 1.0f, 0.9f })
+                {
+                    // Dense reference: beta * G + alpha * X^T * delta
+                    const NNFloat alpha = -0.5f;
+                    std::vector<NNFloat> vExpected(vInitial);
+                    for (auto& g : vExpected)
+                        g = (beta == 0.0f) ? 0.0f : beta * g;
+                    for (uint32_t i = 0; i < batch; i++)
+                    {
+                        for (uint64_t j = data.vSparseStart[i]; j < data.vSparseEnd[i]; j++)
+                        {
+                            NNFloat value = bAnalog ? data.vSparseData[j] / 256.0f : 1.0f;
+                            for (uint32_t o = 0; o < n; o++)
+                                vExpected[(size_t)data.vSparseIndex[j] * n + o] += alpha * value * vDelta[(size_t)i * n + o];
+                        }
+                    }
+
+                    for (HostSimd simd : supportedSimd())
+                    {
+                        CPPUNIT_ASSERT(hSetSimd(simd));
+                        std::vector<NNFloat> vActual(vInitial);
+                        if (bAnalog)
+                            hCalculateSparseTransposedAnalogWeightGradient(alpha, beta, inputs, n, vStart.data(), vEnd.data(), vTransposedIndex.data(), vTransposedData.data(), vDelta.data(), vActual.data());
+                        else
+                            hCalculateSparseTransposedWeightGradient(alpha, beta, inputs, n, vStart.data(), vEnd.data(), vTransposedIndex.data(), vDelta.data(), vActual.data());
+                        assertNear(vExpected, vActual, std::string(hGetSimdName(simd)) + (bAnalog ? " analog" : " boolean") + " n " + std::to_string(n));
+                    }
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHostKernels);
@@ -0,0 +1,481 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks the host sparse output deltas and errors of hostloss.cpp against naive double
+ * precision implementations that visit every unit, on every instruction set the CPU supports.
+ */
+class TestHostLoss : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestHostLoss);
+
+    CPPUNIT_TEST(testOutputDelta);
+    CPPUNIT_TEST(testCrossEntropyOutputDelta);
+    CPPUNIT_TEST(testError);
+    CPPUNIT_TEST(testMultinomialError);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    const NNFloat slope = 0.1f;
+    const NNFloat alpha = 1.6732632f;
+    const NNFloat lambda = 1.0507010f;
+    const NNFloat deltaBoostOne = 1.5f;
+    const NNFloat deltaBoostZero = 0.75f;
+    const NNFloat oneTarget = 0.8f;
+    const NNFloat zeroTarget = 0.2f;
+    const NNFloat oneScale = 2.0f;
+    const NNFloat zeroScale = 0.5f;
+    const uint32_t batch = 29;
+
+    // Boolean targets without duplicate indices, with the data weights, index and shuffle of a data set
+    struct SparseData
+    {
+        std::vector<uint64_t> vSparseStart;
+        std::vector<uint64_t> vSparseEnd;
+        std::vector<uint32_t> vSparseIndex;
+        std::vector<NNFloat> vDataWeight;
+        std::vector<uint32_t> vIndex;
+        std::vector<uint32_t> vShuffleIndex;
+    };
+
+    // The data set option combinations each test runs through
+    struct Options
+    {
+        bool bWeighted;
+        bool bIndexed;
+        bool bShuffled;
+    };
+
+    std::mt19937 generator;
+
+    SparseData generateSparseData(uint32_t examples, uint32_t outputs)
+    {
+        SparseData data;
+        std::uniform_int_distribution<uint32_t> nonzeros(1, std::min(outputs, 12u));
+        std::uniform_int_distribution<uint32_t> index(0, outputs - 1);
+        std::uniform_real_distribution<NNFloat> uniform(0.0f, 1.0f);
+        for (uint32_t i = 0; i < examples; i++)
+        {
+            data.vSparseStart.push_back(data.vSparseIndex.size());
+            std::set<uint32_t> targets;
+            uint32_t count = nonzeros(generator);
+            while (targets.size() < count)
+                targets.insert(index(generator));
+            data.vSparseIndex.insert(data.vSparseIndex.end(), targets.begin(), targets.end());
+            data.vSparseEnd.push_back(data.vSparseIndex.size());
+            data.vDataWeight.push_back(0.5f + uniform(generator));
+            data.vIndex.push_back(examples - 1 - i);
+            data.vShuffleIndex.push_back(i);
+        }
+        std::shuffle(data.vShuffleIndex.begin(), data.vShuffleIndex.end(), generator);
+        return data;
+    }
+
+    // Outputs of an activation for random inputs, in (0, 1) for the cross entropy activations
+    std::vector<NNFloat> generateUnits(Activation activation, size_t size)
+    {
+        std::uniform_real_distribution<double> uniform(-3.0, 3.0);
+        std::vector<NNFloat> vUnit(size);
+        for (auto& u : vUnit)
+        {
+            double x = uniform(generator);
+            switch (activation)
+            {
+                case Sigmoid:
+                case SoftMax:
+                    u = (NNFloat)(1.0 / (1.0 + exp(-x)));
+                    break;
+                case Tanh:
+                    u = (NNFloat)tanh(x);
+                    break;
+                case RectifiedLinear:
+                    u = (NNFloat)std::max(x, 0.0);
+                    break;
+                case LeakyRectifiedLinear:
+                    u = (NNFloat)std::max(x, x * slope);
+                    break;
+                case ExponentialLinear:
+                    u = (NNFloat)((x > 0.0) ? x : alpha * expm1(x));
+                    break;
+                case ScaledExponentialLinear:
+                    u = (NNFloat)((x > 0.0) ? lambda * x : lambda * alpha * expm1(x));
+                    break;
+                case SoftPlus:
+                    u = (NNFloat)(std::max(x, 0.0) + log1p(exp(-fabs(x))));
+                    break;
+                case SoftSign:
+                    u = (NNFloat)(x / (1.0 + fabs(x)));
+                    break;
+                default:
+                    u = (NNFloat)x;
+                    break;
+            }
+        }
+        return vUnit;
+    }
+
+    // Derivative as a function of the activation's output y, as kCalculateHadamardProduct computes it
+    double derivative(Activation activation, double y)
+    {
+        switch (activation)
+        {
+            case Sigmoid:
+                return y * (1.0 - y);
+            case Tanh:
+                return 1.0 - y * y;
+            case RectifiedLinear:
+                return (y > 0.0) ? 1.0 : 0.0;
+            case LeakyRectifiedLinear:
+                return (y > 0.0) ? 1.0 : slope;
+            case ExponentialLinear:
+                return (y > 0.0) ? 1.0 : y + alpha;
+            case ScaledExponentialLinear:
+                return (y > 0.0) ? lambda : y + lambda * alpha;
+            case SoftPlus:
+                return -expm1(-y);
+            case SoftSign:
+                return (1.0 - fabs(y)) * (1.0 - fabs(y));
+            default:
+                return 1.0;
+        }
+    }
+
+    static double sign(double x)
+    {
+        return (x > 0.0) ? 1.0 : ((x < 0.0) ? -1.0 : 0.0);
+    }
+
+    std::vector<Options> allOptions()
+    {
+        return { { false, false, false }, { true, false, false }, { false, true, true }, { true, true, true } };
+    }
+
+    std::vector<HostSimd> supportedSimd()
+    {
+        std::vector<HostSimd> vSimd;
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+        {
+            if (simd <= best)
+                vSimd.push_back(simd);
+        }
+        return vSimd;
+    }
+
+    // Per unit targets of every batch row, 0 or 1
+    std::vector<std::vector<bool>> targets(uint32_t position, uint32_t stride, const SparseData& data, const Options& options, uint32_t* pExample)
+    {
+        std::vector<std::vector<bool>> vTarget(batch, std::vector<bool>(stride, false));
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example = options.bShuffled ? data.vShuffleIndex[position + i] : position + i;
+            if (options.bIndexed)
+                example = data.vIndex[example];
+            pExample[i] = example;
+            for (uint64_t pos = data.vSparseStart[example]; pos < data.vSparseEnd[example]; pos++)
+                vTarget[i][data.vSparseIndex[pos]] = true;
+        }
+        return vTarget;
+    }
+
+    // Output delta of every unit following kDelta.cu, with the delta boost applied to every activation
+    std::vector<double> referenceOutputDelta(ErrorFunction ef, Activation activation, uint32_t position, uint32_t stride, const std::vector<NNFloat>& vUnit,
+                                             const SparseData& data, const Options& options, bool bSparseIgnoreZero)
+    {
+        std::vector<uint32_t> vExample(batch);
+        std::vector<std::vector<bool>> vTarget = targets(position, stride, data, options, vExample.data());
+        std::vector<double> vDelta((size_t)batch * stride);
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example = vExample[i];
+            double dw = options.bWeighted ? data.vDataWeight[example] : 1.0;
+            double count = (double)(data.vSparseEnd[example] - data.vSparseStart[example]);
+            for (uint32_t j = 0; j < stride; j++)
+            {
+                double a = vUnit[(size_t)i * stride + j];
+                bool bOne = vTarget[i][j];
+                double delta = 0.0;
+                if (!bOne && bSparseIgnoreZero)
+                    delta = 0.0;
+                else if (activation == SoftMax)
+                {
+                    double t = options.bWeighted ? dw : 1.0 / count;
+                    if (ef == ScaledMarginalCrossEntropy)
+                        delta = bOne ? ((a < oneTarget) ? oneScale * (a - t) : 0.0) : ((a > zeroTarget) ? dw * zeroScale * a : 0.0);
+                    else
+                        delta = bOne ? a - t : dw * deltaBoostZero * a;
+                }
+                else if (ef == CrossEntropy)
+                    delta = bOne ? dw * deltaBoostOne * (a - 1.0) : dw * deltaBoostZero * a;
+                else if (ef == ScaledMarginalCrossEntropy)
+                    delta = bOne ? ((a < oneTarget) ? dw * oneScale * (a - 1.0) : 0.0) : ((a > zeroTarget) ? dw * zeroScale * a : 0.0);
+                else
+                {
+                    double d;
+                    if (ef == L1)
+                        d = bOne ? sign(a - 1.0) : sign(a);
+                    else if (ef == L2Hinge)
+                        d = bOne ? std::min(a - 1.0, 0.0) : std::max(a, 0.0);
+                    else
+                        d = bOne ? a - 1.0 : a;
+                    delta = dw * (bOne ? deltaBoostOne : deltaBoostZero) * d * derivative(activation, a);
+                }
+                vDelta[(size_t)i * stride + j] = delta;
+            }
+        }
+        return vDelta;
+    }
+
+    // Error of every unit following kLoss.cu
+    double referenceError(ErrorFunction ef, bool bMultinomial, uint32_t position, uint32_t stride, const std::vector<NNFloat>& vUnit,
+                          const SparseData& data, const Options& options, bool bSparseIgnoreZero)
+    {
+        std::vector<uint32_t> vExample(batch);
+        std::vector<std::vector<bool>> vTarget = targets(position, stride, data, options, vExample.data());
+        double error = 0.0;
+        for (uint32_t i = 0; i < batch; i++)
+        {
+            uint32_t example = vExample[i];
+            double dw = options.bWeighted ? data.vDataWeight[example] : 1.0;
+            if (bMultinomial)
+                dw = options.bWeighted ? dw : 1.0 / (double)(data.vSparseEnd[example] - data.vSparseStart[example]);
+            for (uint32_t j = 0; j < stride; j++)
+            {
+                double a = vUnit[(size_t)i * stride + j];
+                bool bOne = vTarget[i][j];
+                if (!bOne && (bSparseIgnoreZero || bMultinomial))
+                    continue;
+                double e;
+                switch (ef)
+                {
+                    case L1:
+                        e = bOne ? fabs(a - 1.0) : fabs(a);
+                        break;
+                    case L2Hinge:
+                        e = bOne ? std::min(a - 1.0, 0.0) : std::max(a, 0.0);
+                        e = 0.5 * e * e;
+                        break;
+                    case CrossEntropy:
+                        e = bOne ? -log(std::max((double)MIN_ERROR, a)) : -log(std::max((double)MIN_ERROR, 1.0 - a));
+                        break;
+                    case ScaledMarginalCrossEntropy:
+                        if (bOne)
+                            e = (a < oneTarget) ? -oneScale * log(std::max((double)MIN_ERROR, a)) : 0.0;
+                        else
+                            e = (a > zeroTarget) ? -zeroScale * log(std::max((double)MIN_ERROR, 1.0 - a)) : 0.0;
+                        break;
+                    default:
+                        e = bOne ? 0.5 * (a - 1.0) * (a - 1.0) : 0.5 * a * a;
+                        break;
+                }
+                error += dw * e;
+            }
+        }
+        return error;
+    }
+
+    void outputDelta(ErrorFunction ef, Activation activation, uint32_t position, uint32_t stride, NNFloat* pUnit, NNFloat* pDelta,
+                     SparseData& data, const Options& options, bool bSparseIgnoreZero)
+    {
+        NNFloat* pDataWeight = options.bWeighted ? data.vDataWeight.data() : NULL;
+        uint32_t* pIndex = options.bIndexed ? data.vIndex.data() : NULL;
+        uint32_t* pShuffleIndex = options.bShuffled ? data.vShuffleIndex.data() : NULL;
+        uint64_t* pStart = data.vSparseStart.data();
+        uint64_t* pEnd = data.vSparseEnd.data();
+        uint32_t* pSparseIndex = data.vSparseIndex.data();
+        switch (ef)
+        {
+            case L1:
+                if (pIndex)
+                    hCalculateIndexedSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                else
+                    hCalculateSparseL1OutputDelta(activation, position, batch, stride, pUnit, pDelta, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                break;
+            case L2Hinge:
+                if (pIndex)
+                    hCalculateIndexedSparseL2HingeOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                else
+                    hCalculateSparseL2HingeOutputDelta(activation, position, batch, stride, pUnit, pDelta, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                break;
+            case CrossEntropy:
+                if (pIndex)
+                    hCalculateIndexedSparseCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+                else
+                    hCalculateSparseCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+                break;
+            case ScaledMarginalCrossEntropy:
+                if (pIndex)
+                    hCalculateIndexedSparseScaledMarginalCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+                else
+                    hCalculateSparseScaledMarginalCrossEntropyOutputDelta(activation, position, batch, stride, pUnit, pDelta, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+                break;
+            default:
+                if (pIndex)
+                    hCalculateIndexedSparseOutputDelta(activation, position, batch, stride, pUnit, pDelta, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                else
+                    hCalculateSparseOutputDelta(activation, position, batch, stride, pUnit, pDelta, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, slope, alpha, lambda, pShuffleIndex);
+                break;
+        }
+    }
+
+    NNFloat error(ErrorFunction ef, bool bMultinomial, uint32_t position, uint32_t stride, NNFloat* pUnit, SparseData& data, const Options& options, bool bSparseIgnoreZero)
+    {
+        NNFloat* pDataWeight = options.bWeighted ? data.vDataWeight.data() : NULL;
+        uint32_t* pIndex = options.bIndexed ? data.vIndex.data() : NULL;
+        uint32_t* pShuffleIndex = options.bShuffled ? data.vShuffleIndex.data() : NULL;
+        uint64_t* pStart = data.vSparseStart.data();
+        uint64_t* pEnd = data.vSparseEnd.data();
+        uint32_t* pSparseIndex = data.vSparseIndex.data();
+        if (bMultinomial)
+        {
+            if (ef == CrossEntropy)
+                return pIndex ? hCalculateIndexedSparseMultinomialCrossEntropyError(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, pShuffleIndex)
+                              : hCalculateSparseMultinomialCrossEntropyError(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+            return pIndex ? hCalculateIndexedSparseMultinomialScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, pShuffleIndex)
+                          : hCalculateSparseMultinomialScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, pShuffleIndex);
+        }
+
+        switch (ef)
+        {
+            case L1:
+                return pIndex ? hCalculateIndexedSparseL1Error(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                              : hCalculateSparseL1Error(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            case L2Hinge:
+                return pIndex ? hCalculateIndexedSparseL2HingeError(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                              : hCalculateSparseL2HingeError(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            case CrossEntropy:
+                return pIndex ? hCalculateIndexedSparseCrossEntropyError(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                              : hCalculateSparseCrossEntropyError(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            case ScaledMarginalCrossEntropy:
+                return pIndex ? hCalculateIndexedSparseScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                              : hCalculateSparseScaledMarginalCrossEntropyError(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+            default:
+                return pIndex ? hCalculateIndexedSparseL2Error(position, batch, stride, pUnit, pIndex, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex)
+                              : hCalculateSparseL2Error(position, batch, stride, pUnit, pStart, pEnd, pSparseIndex, pDataWeight, bSparseIgnoreZero, pShuffleIndex);
+        }
+    }
+
+    // Runs the delta of ef for each activation over every instruction set, option and width
+    void checkOutputDelta(ErrorFunction ef, const std::vector<Activation>& vActivation)
+    {
+        const uint32_t examples = 3 * batch;
+        const uint32_t position = batch / 2;
+        HostSimd best = hGetSimd();
+        hSetDeltaBoost(deltaBoostOne, deltaBoostZero);
+        hSetSMCE(oneTarget, zeroTarget, oneScale, zeroScale);
+        for (uint32_t stride : { 5u, 37u, 1000u })
+        {
+            SparseData data = generateSparseData(examples, stride);
+            for (Activation activation : vActivation)
+            {
+                std::vector<NNFloat> vUnit = generateUnits(activation, (size_t)batch * stride);
+                for (HostSimd simd : supportedSimd())
+                {
+                    CPPUNIT_ASSERT(hSetSimd(simd));
+                    for (const Options& options : allOptions())
+                    {
+                        for (bool bSparseIgnoreZero : { false, true })
+                        {
+                            std::vector<double> vExpected = referenceOutputDelta(ef, activation, position, stride, vUnit, data, options, bSparseIgnoreZero);
+                            std::vector<NNFloat> vDelta(vUnit.size(), -123.0f);
+                            outputDelta(ef, activation, position, stride, vUnit.data(), vDelta.data(), data, options, bSparseIgnoreZero);
+                            double maxError = 0.0;
+                            for (size_t i = 0; i < vDelta.size(); i++)
+                                maxError = std::max(maxError, fabs(vDelta[i] - vExpected[i]) / std::max(fabs(vExpected[i]), 1.0));
+                            std::stringstream message;
+                            message << hGetSimdName(simd) << " " << ef << " " << activation << " stride " << stride << " weighted " << options.bWeighted
+                                    << " indexed " << options.bIndexed << " ignore zero " << bSparseIgnoreZero << " error " << maxError;
+                            CPPUNIT_ASSERT_MESSAGE(message.str(), maxError <= 1.0e-6);
+                        }
+                    }
+                }
+            }
+        }
+        hSetSimd(best);
+        hSetDeltaBoost(1.0f, 1.0f);
+    }
+
+ public:
+    void testOutputDelta()
+    {
+        std::vector<Activation> vActivation = { Sigmoid, Tanh, Linear, RectifiedLinear, LeakyRectifiedLinear, ExponentialLinear,
+                                                ScaledExponentialLinear, SoftPlus, SoftSign };
+        checkOutputDelta(L2, vActivation);
+        checkOutputDelta(L2Hinge, vActivation);
+        checkOutputDelta(L1, vActivation);
+        checkOutputDelta(L2, { SoftMax });
+    }
+
+    void testCrossEntropyOutputDelta()
+    {
+        checkOutputDelta(CrossEntropy, { Sigmoid, SoftMax });
+        checkOutputDelta(ScaledMarginalCrossEntropy, { Sigmoid, SoftMax });
+    }
+
+    void testError()
+    {
+        const uint32_t examples = 3 * batch;
+        const uint32_t position = batch / 2;
+        HostSimd best = hGetSimd();
+        hSetSMCE(oneTarget, zeroTarget, oneScale, zeroScale);
+        for (uint32_t stride : { 5u, 37u, 10000u })
+        {
+            SparseData data = generateSparseData(examples, stride);
+            std::vector<NNFloat> vUnit = generateUnits(Sigmoid, (size_t)batch * stride);
+            for (ErrorFunction ef : { L1, L2, L2Hinge, CrossEntropy, ScaledMarginalCrossEntropy })
+            {
+                for (HostSimd simd : supportedSimd())
+                {
+                    CPPUNIT_ASSERT(hSetSimd(simd));
+                    for (const Options& options : allOptions())
+                    {
+                        for (bool bSparseIgnoreZero : { false, true })
+                        {
+                            double expected = referenceError(ef, false, position, stride, vUnit, data, options, bSparseIgnoreZero);
+                            NNFloat actual = error(ef, false, position, stride, vUnit.data(), data, options, bSparseIgnoreZero);
+                            std::stringstream message;
+                            message << hGetSimdName(simd) << " " << ef << " stride " << stride << " weighted " << options.bWeighted
+                                    << " indexed " << options.bIndexed << " ignore zero " << bSparseIgnoreZero << " expected " << expected << " actual " << actual;
+                            CPPUNIT_ASSERT_MESSAGE(message.str(), fabs(actual - expected) <= 1.0e-5 * std::max(fabs(expected), 1.0));
+                        }
+                    }
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testMultinomialError()
+    {
+        const uint32_t examples = 3 * batch;
+        const uint32_t position = batch / 2;
+        const uint32_t stride = 1000;
+        hSetSMCE(oneTarget, zeroTarget, oneScale, zeroScale);
+        SparseData data = generateSparseData(examples, stride);
+        std::vector<NNFloat> vUnit = generateUnits(SoftMax, (size_t)batch * stride);
+        for (ErrorFunction ef : { CrossEntropy, ScaledMarginalCrossEntropy })
+        {
+            for (const Options& options : allOptions())
+            {
+                double expected = referenceError(ef, true, position, stride, vUnit, data, options, false);
+                NNFloat actual = error(ef, true, position, stride, vUnit.data(), data, options, false);
+                std::stringstream message;
+                message << ef << " weighted " << options.bWeighted << " indexed " << options.bIndexed << " expected " << expected << " actual " << actual;
+                CPPUNIT_ASSERT_MESSAGE(message.str(), fabs(actual - expected) <= 1.0e-5 * std::max(fabs(expected), 1.0));
+            }
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHostLoss);
@@ -0,0 +1,336 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks the host weight and bias updates of hostoptimizer.cpp against element by element
+ * transcriptions of the update kernels of kernels.cu, over several steps, on every
+ * instruction set the CPU supports.
+ */
+class TestHostOptimizer : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestHostOptimizer);
+
+    CPPUNIT_TEST(testUpdateWeights);
+    CPPUNIT_TEST(testUpdateBiases);
+    CPPUNIT_TEST(testNesterovShift);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    const NNFloat alpha = 0.01f;
+    const NNFloat lambda = 0.001f;
+    const NNFloat lambda1 = 0.0001f;
+    const NNFloat mu = 0.9f;
+    const NNFloat mu1 = 0.999f;
+    const uint32_t steps = 3;
+
+    // Weights (or biases) with their two velocities
+    struct State
+    {
+        std::vector<NNFloat> vWeight;
+        std::vector<NNFloat> vVelocity;
+        std::vector<NNFloat> vGradientVelocity;
+    };
+
+    std::mt19937 generator;
+
+    std::vector<NNFloat> generateVector(size_t size, NNFloat low, NNFloat high)
+    {
+        std::uniform_real_distribution<NNFloat> uniform(low, high);
+        std::vector<NNFloat> v(size);
+        for (auto& x : v)
+            x = uniform(generator);
+        return v;
+    }
+
+    State generateState(size_t size)
+    {
+        State state;
+        state.vWeight = generateVector(size, -1.0f, 1.0f);
+        state.vVelocity = generateVector(size, 0.0f, 0.01f);
+        state.vGradientVelocity = generateVector(size, 0.0f, 0.01f);
+        // Exact zeros exercise sgn(0)
+        for (size_t i = 0; i < size; i += 7)
+            state.vWeight[i] = 0.0f;
+        return state;
+    }
+
+    static NNFloat sgn(NNFloat x)
+    {
+        return (NNFloat)((x > 0.0f) - (x < 0.0f));
+    }
+
+    // One element of each kernel of kernels.cu, with 1 / sqrt for rsqrt
+    void referenceUpdate(TrainingMode mode, NNFloat g, NNFloat lambda, NNFloat lambda1, NNFloat t, NNFloat& w, NNFloat& v, NNFloat& vg)
+    {
+        switch (mode)
+        {
+            case SGD:
+                w = w + alpha * (g - lambda * w - lambda1 * sgn(w));
+                break;
+            case Momentum:
+                v = mu * v + alpha * (g - lambda * w - lambda1 * sgn(w));
+                w = w + v;
+                break;
+            case AdaGrad:
+                g -= lambda * w + lambda1 * sgn(w);
+                v += g * g;
+                w = w + alpha * g / sqrtf(std::max(0.000000001f, v));
+                break;
+            case Nesterov:
+            {
+                NNFloat vOld = v;
+                v = mu * vOld + alpha * (g - lambda * w - lambda1 * sgn(w));
+                w = w + v + mu * (v - vOld);
+                break;
+            }
+            case RMSProp:
+                g -= lambda * w + lambda1 * sgn(w);
+                v = mu * v + (1.0f - mu) * g * g;
+                w = w + alpha * g / sqrtf(std::max(0.000000001f, v));
+                break;
+            case AdaDelta:
+            {
+                g -= lambda * w + lambda1 * sgn(w);
+                vg = mu * vg + (1.0f - mu) * g * g;
+                NNFloat dw = sqrtf(std::max(0.000000001f, v) / std::max(0.000000001f, vg)) * g;
+                v = mu * v + (1.0f - mu) * dw * dw;
+                w = w + dw;
+                break;
+            }
+            case Adam:
+            {
+                g -= lambda * w + lambda1 * sgn(w);
+                v = mu * v + (1.0f - mu) * g;
+                vg = mu1 * vg + (1.0f - mu1) * g * g;
+                NNFloat vHat = v / (1.0f - powf(mu, t + 1.0f));
+                NNFloat vgHat = vg / (1.0f - powf(mu1, t + 1.0f));
+                w = w + alpha * vHat / (sqrtf(vgHat) + 1.0e-8f);
+                break;
+            }
+        }
+    }
+
+    // The bias kernels: the mean of the delta over the batch, used like a negated gradient
+    void referenceBiasUpdate(TrainingMode mode, NNFloat sum, NNFloat t, NNFloat& b, NNFloat& v, NNFloat& vg)
+    {
+        switch (mode)
+        {
+            case SGD:
+                b = b - alpha * sum;
+                break;
+            case Momentum:
+                v = mu * v - alpha * sum;
+                b += v;
+                break;
+            case AdaGrad:
+                v += sum * sum;
+                b -= alpha * sum / sqrtf(std::max(0.000000001f, v));
+                break;
+            case Nesterov:
+            {
+                NNFloat vOld = v;
+                v = mu * vOld - alpha * sum;
+                b += v + mu * (v - vOld);
+                break;
+            }
+            case RMSProp:
+                v = mu * v + (1.0f - mu) * sum * sum;
+                b -= alpha * sum / sqrtf(std::max(0.000000001f, v));
+                break;
+            case AdaDelta:
+            {
+                vg = mu * vg + (1.0f - mu) * sum * sum;
+                NNFloat dw = sqrtf(std::max(0.000000001f, v) / std::max(0.000000001f, vg)) * sum;
+                v = mu * v + (1.0f - mu) * dw * dw;
+                b -= dw;
+                break;
+            }
+            case Adam:
+            {
+                v = mu * v + (1.0f - mu) * sum;
+                vg = mu1 * vg + (1.0f - mu1) * sum * sum;
+                NNFloat vHat = v / (1.0f - powf(mu, t + 1.0f));
+                NNFloat vgHat = vg / (1.0f - powf(mu1, t + 1.0f));
+                b -= alpha * vHat / (sqrtf(vgHat) + 1.0e-8f);
+                break;
+            }
+        }
+    }
+
+    void updateWeights(TrainingMode mode, NNFloat t, uint64_t size, NNFloat* pGradient, State& state)
+    {
+        NNFloat* pV = state.vVelocity.data();
+        NNFloat* pVG = state.vGradientVelocity.data();
+        NNFloat* pW = state.vWeight.data();
+        switch (mode)
+        {
+            case SGD:       hSGDUpdateWeights(alpha, lambda, lambda1, size, pGradient, pW); break;
+            case Momentum:  hMomentumUpdateWeights(alpha, lambda, lambda1, mu, size, pV, pGradient, pW); break;
+            case AdaGrad:   hAdaGradUpdateWeights(alpha, lambda, lambda1, size, pV, pGradient, pW); break;
+            case Nesterov:  hNesterovUpdateWeights(alpha, lambda, lambda1, mu, size, pV, pGradient, pW); break;
+            case RMSProp:   hRMSPropUpdateWeights(alpha, lambda, lambda1, mu, size, pV, pGradient, pW); break;
+            case AdaDelta:  hAdaDeltaUpdateWeights(lambda, lambda1, mu, size, pV, pGradient, pVG, pW); break;
+            case Adam:      hAdamUpdateWeights(alpha, lambda, lambda1, mu, mu1, t, size, pV, pGradient, pVG, pW); break;
+        }
+    }
+
+    void updateBiases(TrainingMode mode, NNFloat t, uint32_t batch, uint32_t width, NNFloat* pDelta, State& state)
+    {
+        NNFloat* pV = state.vVelocity.data();
+        NNFloat* pVG = state.vGradientVelocity.data();
+        NNFloat* pB = state.vWeight.data();
+        switch (mode)
+        {
+            case SGD:       hSGDUpdateBiases(alpha, batch, width, pDelta, pB); break;
+            case Momentum:  hMomentumUpdateBiases(alpha, mu, batch, width, pDelta, pV, pB); break;
+            case AdaGrad:   hAdaGradUpdateBiases(alpha, batch, width, pDelta, pV, pB); break;
+            case Nesterov:  hNesterovUpdateBiases(alpha, mu, batch, width, pDelta, pV, pB); break;
+            case RMSProp:   hRMSPropUpdateBiases(alpha, mu, batch, width, pDelta, pV, pB); break;
+            case AdaDelta:  hAdaDeltaUpdateBiases(mu, batch, width, pDelta, pV, pVG, pB); break;
+            case Adam:      hAdamUpdateBiases(alpha, mu, mu1, t, batch, width, pDelta, pV, pVG, pB); break;
+        }
+    }
+
+    static double maxError(const std::vector<NNFloat>& vExpected, const std::vector<NNFloat>& vActual)
+    {
+        double error = 0.0;
+        for (size_t i = 0; i < vExpected.size(); i++)
+            error = std::max(error, fabs((double)vActual[i] - vExpected[i]) / std::max(fabs((double)vExpected[i]), 1.0e-3));
+        return error;
+    }
+
+    void checkState(const std::string& name, const State& expected, const State& actual)
+    {
+        double error = std::max(maxError(expected.vWeight, actual.vWeight),
+                                std::max(maxError(expected.vVelocity, actual.vVelocity), maxError(expected.vGradientVelocity, actual.vGradientVelocity)));
+        std::stringstream message;
+        message << name << " error " << error;
+        CPPUNIT_ASSERT_MESSAGE(message.str(), error <= 1.0e-4);
+    }
+
+    std::vector<HostSimd> supportedSimd()
+    {
+        std::vector<HostSimd> vSimd;
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+        {
+            if (simd <= best)
+                vSimd.push_back(simd);
+        }
+        return vSimd;
+    }
+
+    std::vector<TrainingMode> allModes()
+    {
+        return { SGD, Momentum, AdaGrad, Nesterov, RMSProp, AdaDelta, Adam };
+    }
+
+ public:
+    void testUpdateWeights()
+    {
+        HostSimd best = hGetSimd();
+        // Sizes below one vector, with a tail, and across several parallel blocks
+        for (uint64_t size : { 1ull, 37ull, 100003ull })
+        {
+            State initial = generateState(size);
+            std::vector<std::vector<NNFloat>> vGradient;
+            for (uint32_t step = 0; step < steps; step++)
+                vGradient.push_back(generateVector(size, -0.1f, 0.1f));
+
+            for (TrainingMode mode : allModes())
+            {
+                State expected = initial;
+                for (uint32_t step = 0; step < steps; step++)
+                    for (uint64_t i = 0; i < size; i++)
+                        referenceUpdate(mode, vGradient[step][i], lambda, lambda1, (NNFloat)step, expected.vWeight[i], expected.vVelocity[i], expected.vGradientVelocity[i]);
+
+                for (HostSimd simd : supportedSimd())
+                {
+                    CPPUNIT_ASSERT(hSetSimd(simd));
+                    State actual = initial;
+                    for (uint32_t step = 0; step < steps; step++)
+                        updateWeights(mode, (NNFloat)step, size, vGradient[step].data(), actual);
+                    std::stringstream name;
+                    name << hGetSimdName(simd) << " " << mode << " size " << size;
+                    checkState(name.str(), expected, actual);
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testUpdateBiases()
+    {
+        const uint32_t batch = 13;
+        HostSimd best = hGetSimd();
+        // Widths below one vector, with a tail, and across several bias blocks
+        for (uint32_t width : { 5u, 37u, 2500u })
+        {
+            State initial = generateState(width);
+            std::vector<std::vector<NNFloat>> vDelta;
+            for (uint32_t step = 0; step < steps; step++)
+                vDelta.push_back(generateVector((size_t)batch * width, -0.1f, 0.1f));
+
+            for (TrainingMode mode : allModes())
+            {
+                State expected = initial;
+                for (uint32_t step = 0; step < steps; step++)
+                {
+                    for (uint32_t j = 0; j < width; j++)
+                    {
+                        NNFloat sum = 0.0f;
+                        for (uint32_t i = 0; i < batch; i++)
+                            sum += vDelta[step][(size_t)i * width + j];
+                        sum /= (NNFloat)batch;
+                        referenceBiasUpdate(mode, sum, (NNFloat)step, expected.vWeight[j], expected.vVelocity[j], expected.vGradientVelocity[j]);
+                    }
+                }
+
+                for (HostSimd simd : supportedSimd())
+                {
+                    CPPUNIT_ASSERT(hSetSimd(simd));
+                    State actual = initial;
+                    for (uint32_t step = 0; step < steps; step++)
+                        updateBiases(mode, (NNFloat)step, batch, width, vDelta[step].data(), actual);
+                    std::stringstream name;
+                    name << hGetSimdName(simd) << " " << mode << " width " << width;
+                    checkState(name.str(), expected, actual);
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testNesterovShift()
+    {
+        const uint64_t size = 100003;
+        HostSimd best = hGetSimd();
+        State initial = generateState(size);
+        std::vector<NNFloat> vExpected = initial.vWeight;
+        for (uint64_t i = 0; i < size; i++)
+            vExpected[i] += mu * initial.vVelocity[i];
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            std::vector<NNFloat> vWeight = initial.vWeight;
+            hNesterovShiftWeights(mu, size, initial.vVelocity.data(), vWeight.data());
+            CPPUNIT_ASSERT(maxError(vExpected, vWeight) <= 1.0e-6);
+            std::vector<NNFloat> vBias(initial.vWeight.begin(), initial.vWeight.begin() + 37);
+            hNesterovShiftBiases(mu, 37, initial.vVelocity.data(), vBias.data());
+            CPPUNIT_ASSERT(maxError(std::vector<NNFloat>(vExpected.begin(), vExpected.begin() + 37), vBias) <= 1.0e-6);
+        }
+        hSetSimd(best);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHostOptimizer);
@@ -0,0 +1,287 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks the int8 quantization kernels of hostkernels.h: the quantization error of
+ * weights and units, the integer GEMM against exact integer dot products and single
+ * precision, and the quantized sparse Z kernels against dequantized weights, on
+ * every instruction set the CPU supports.
+ */
+class TestHostQuantize : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestHostQuantize);
+
+    CPPUNIT_TEST(testQuantizeWeights);
+    CPPUNIT_TEST(testQuantizeUnits);
+    CPPUNIT_TEST(testQuantizedZ);
+    CPPUNIT_TEST(testQuantizedSparseZ);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    std::mt19937 generator;
+
+    std::vector<NNFloat> generateVector(size_t size, NNFloat range)
+    {
+        std::uniform_real_distribution<NNFloat> uniform(-range, range);
+        std::vector<NNFloat> v(size);
+        for (auto& x : v)
+        {
+            x = uniform(generator);
+        }
+        return v;
+    }
+
+    std::vector<HostSimd> supportedSimd()
+    {
+        std::vector<HostSimd> vSimd;
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : { HostSimdScalar, HostSimdAVX2, HostSimdAVX512 })
+        {
+            if (simd <= best)
+                vSimd.push_back(simd);
+        }
+        return vSimd;
+    }
+
+ public:
+    void setUp()
+    {
+        generator.seed(12345);
+    }
+
+    void testQuantizeWeights()
+    {
+        for (bool bTransposed : { false, true })
+        {
+            for (uint32_t k : { 1u, 63u, 64u, 65u, 300u })
+            {
+                const uint32_t n = 37;
+                uint32_t kp = hQuantizedStride(k);
+                CPPUNIT_ASSERT(kp >= k && kp % 64 == 0 && kp < k + 64);
+
+                // the last output has no nonzero weights
+                std::vector<NNFloat> vWeight = generateVector((size_t)k * n, 2.0f);
+                for (uint32_t l = 0; l < k; l++)
+                    vWeight[bTransposed ? (size_t)(n - 1) * k + l : (size_t)l * n + n - 1] = 0.0f;
+
+                std::vector<NNFloat> vScale(n), vInputScale(n);
+                std::vector<int8_t> vQByOutput((size_t)n * kp, 1), vQByInput((size_t)k * n);
+                std::vector<int32_t> vSum(n);
+                hQuantizeWeightsByOutput(k, n, vWeight.data(), bTransposed, vScale.data(), vQByOutput.data(), vSum.data());
+                hQuantizeWeightsByInput(k, n, vWeight.data(), bTransposed, vInputScale.data(), vQByInput.data());
+
+                for (uint32_t j = 0; j < n; j++)
+                {
+                    NNFloat max = 0.0f;
+                    int32_t sum = 0;
+                    for (uint32_t l = 0; l < k; l++)
+                        max = std::max(max, std::fabs(vWeight[bTransposed ? (size_t)j * k + l : (size_t)l * n + j]));
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL((max > 0.0f) ? max / 127.0f : 1.0f, vScale[j], 1.0e-7f);
+                    CPPUNIT_ASSERT_EQUAL(vScale[j], vInputScale[j]);
+                    for (uint32_t l = 0; l < k; l++)
+                    {
+                        NNFloat w = vWeight[bTransposed ? (size_t)j * k + l : (size_t)l * n + j];
+                        int8_t q = vQByOutput[(size_t)j * kp + l];
+                        CPPUNIT_ASSERT(q >= -127);
+                        CPPUNIT_ASSERT(std::fabs(q * vScale[j] - w) <= 0.5001f * vScale[j]);
+                        CPPUNIT_ASSERT_EQUAL(q, vQByInput[(size_t)l * n + j]);
+                        sum += q;
+                    }
+                    for (uint32_t l = k; l < kp; l++)
+                        CPPUNIT_ASSERT_EQUAL((int8_t)0, vQByOutput[(size_t)j * kp + l]);
+                    CPPUNIT_ASSERT_EQUAL(sum, vSum[j]);
+                }
+            }
+        }
+    }
+
+    void testQuantizeUnits()
+    {
+        HostSimd best = hGetSimd();
+        const uint32_t batch = 5;
+        const NNFloat scale = 1.0f / 64.0f;
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            for (uint32_t k : { 1u, 31u, 32u, 33u, 100u })
+            {
+                // half of the units are out of range and saturate
+                uint32_t kp = hQuantizedStride(k);
+                std::vector<NNFloat> vUnit = generateVector((size_t)batch * k, 4.0f);
+                vUnit[0] = 0.5f * scale;
+                std::vector<int8_t> vQUnit((size_t)batch * kp, 1);
+                hQuantizeUnits(vUnit.data(), batch, k, scale, vQUnit.data());
+                for (uint32_t i = 0; i < batch; i++)
+                {
+                    for (uint32_t l = 0; l < k; l++)
+                    {
+                        NNFloat expected = std::min(std::max(nearbyintf(vUnit[(size_t)i * k + l] / scale), -127.0f), 127.0f);
+                        CPPUNIT_ASSERT_EQUAL((int)expected, (int)vQUnit[(size_t)i * kp + l]);
+                    }
+                    for (uint32_t l = k; l < kp; l++)
+                        CPPUNIT_ASSERT_EQUAL((int8_t)0, vQUnit[(size_t)i * kp + l]);
+                }
+                CPPUNIT_ASSERT_EQUAL((int8_t)0, vQUnit[0]);
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testQuantizedZ()
+    {
+        HostSimd best = hGetSimd();
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            // batches and widths around the tile and block sizes of each instruction set
+            for (uint32_t batch : { 1u, 3u, 66u })
+            {
+                for (uint32_t k : { 1u, 17u, 64u, 300u })
+                {
+                    for (uint32_t n : { 1u, 5u, 16u, 35u })
+                    {
+                        std::vector<NNFloat> vUnit = generateVector((size_t)batch * k, 1.0f);
+                        std::vector<NNFloat> vWeight = generateVector((size_t)k * n, 0.1f);
+                        std::vector<NNFloat> vInitial = generateVector((size_t)batch * n, 1.0f);
+                        uint32_t kp = hQuantizedStride(k);
+                        const NNFloat unitScale = 1.0f / 127.0f;
+                        std::vector<int8_t> vQUnit((size_t)batch * kp), vQWeight((size_t)n * kp);
+                        std::vector<NNFloat> vScale(n);
+                        std::vector<int32_t> vSum(n);
+                        hQuantizeUnits(vUnit.data(), batch, k, unitScale, vQUnit.data());
+                        hQuantizeWeightsByOutput(k, n, vWeight.data(), false, vScale.data(), vQWeight.data(), vSum.data());
+
+                        for (NNFloat beta : { 0.0f, 1.0f })
+                        {
+                            std::vector<NNFloat> vZ = vInitial;
+                            hCalculateQuantizedZ(batch, k, n, vQUnit.data(), unitScale, vQWeight.data(), vScale.data(), vSum.data(), vZ.data(), beta);
+                            for (uint32_t i = 0; i < batch; i++)
+                            {
+                                for (uint32_t j = 0; j < n; j++)
+                                {
+                                    // exact integer dot product, then within the quantization error of single precision
+                                    int32_t dot = 0;
+                                    double exact = 0.0;
+                                    double bound = 1.0e-5;
+                                    for (uint32_t l = 0; l < k; l++)
+                                    {
+                                        NNFloat a = vUnit[(size_t)i * k + l];
+                                        NNFloat w = vWeight[(size_t)l * n + j];
+                                        dot += (int32_t)vQUnit[(size_t)i * kp + l] * (int32_t)vQWeight[(size_t)j * kp + l];
+                                        exact += (double)a * w;
+                                        bound += 0.5 * unitScale * std::fabs(w) + (std::fabs(a) + 0.5 * unitScale) * 0.5 * vScale[j];
+                                    }
+                                    NNFloat initial = (beta == 0.0f) ? 0.0f : beta * vInitial[(size_t)i * n + j];
+                                    NNFloat expected = initial + unitScale * vScale[j] * (NNFloat)dot;
+                                    NNFloat actual = vZ[(size_t)i * n + j];
+                                    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, actual, 1.0e-6f * std::max(1.0f, std::fabs(expected)));
+                                    CPPUNIT_ASSERT_DOUBLES_EQUAL(initial + exact, actual, bound);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+
+    void testQuantizedSparseZ()
+    {
+        const uint32_t examples = 64;
+        const uint32_t inputs = 300;
+        const uint32_t batch = 24;
+        const uint32_t position = 17;
+        HostSimd best = hGetSimd();
+
+        // random nonzeros with analog values, data weights, an index and a shuffle
+        std::vector<uint64_t> vSparseStart, vSparseEnd;
+        std::vector<uint32_t> vSparseIndex, vIndex, vShuffleIndex;
+        std::vector<unsigned char> vSparseData;
+        std::vector<NNFloat> vDataWeight;
+        std::uniform_int_distribution<uint32_t> nonzeros(0, 40);
+        std::uniform_int_distribution<uint32_t> index(0, inputs - 1);
+        std::uniform_int_distribution<uint32_t> value(0, 255);
+        for (uint32_t i = 0; i < examples; i++)
+        {
+            vSparseStart.push_back(vSparseIndex.size());
+            uint32_t count = nonzeros(generator);
+            for (uint32_t j = 0; j < count; j++)
+            {
+                vSparseIndex.push_back(index(generator));
+                vSparseData.push_back(value(generator));
+            }
+            vSparseEnd.push_back(vSparseIndex.size());
+            vDataWeight.push_back(0.5f + (i % 7) * 0.25f);
+            vIndex.push_back(examples - 1 - i);
+            vShuffleIndex.push_back((i * 37) % examples);
+        }
+
+        for (HostSimd simd : supportedSimd())
+        {
+            CPPUNIT_ASSERT(hSetSimd(simd));
+            // widths around the vector and tile sizes of each instruction set
+            for (uint32_t stride : { 1u, 7u, 8u, 16u, 33u, 64u, 100u, 257u })
+            {
+                std::vector<NNFloat> vWeight = generateVector((size_t)inputs * stride, 1.0f);
+                std::vector<NNFloat> vInitial = generateVector((size_t)batch * stride, 1.0f);
+                std::vector<int8_t> vQWeight((size_t)inputs * stride);
+                std::vector<NNFloat> vScale(stride);
+                hQuantizeWeightsByInput(inputs, stride, vWeight.data(), false, vScale.data(), vQWeight.data());
+
+                for (bool bAnalog : { false, true })
+                {
+                    for (NNFloat beta : { 0.0f, 1.0f })
+                    {
+                        std::vector<NNFloat> vZ = vInitial;
+                        if (bAnalog)
+                            hCalculateIndexedQuantizedSparseAnalogZ(position, batch, stride, vQWeight.data(), vScale.data(), vIndex.data(), vSparseStart.data(), vSparseEnd.data(),
+                                                                    vSparseIndex.data(), vDataWeight.data(), vSparseData.data(), vZ.data(), beta, vShuffleIndex.data());
+                        else
+                            hCalculateQuantizedSparseZ(position, batch, stride, vQWeight.data(), vScale.data(), vSparseStart.data(), vSparseEnd.data(),
+                                                       vSparseIndex.data(), NULL, vZ.data(), beta, vShuffleIndex.data());
+
+                        // kCalculateSparseZ on the dequantized weights; rows without nonzeros are untouched
+                        for (uint32_t i = 0; i < batch; i++)
+                        {
+                            uint32_t example = vShuffleIndex[position + i];
+                            if (bAnalog)
+                                example = vIndex[example];
+                            NNFloat w = bAnalog ? vDataWeight[example] : 1.0f;
+                            for (uint32_t o = 0; o < stride; o++)
+                            {
+                                NNFloat initial = vInitial[(size_t)i * stride + o];
+                                double expected = initial;
+                                double magnitude = 1.0;
+                                if (vSparseStart[example] != vSparseEnd[example])
+                                {
+                                    expected = (beta == 0.0f) ? 0.0 : beta * initial;
+                                    for (uint64_t j = vSparseStart[example]; j < vSparseEnd[example]; j++)
+                                    {
+                                        NNFloat v = bAnalog ? vSparseData[j] / 256.0f : 1.0f;
+                                        double term = (double)w * v * vScale[o] * vQWeight[(size_t)vSparseIndex[j] * stride + o];
+                                        expected += term;
+                                        magnitude += std::fabs(term);
+                                    }
+                                }
+                                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, vZ[(size_t)i * stride + o], 1.0e-6 * magnitude);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        hSetSimd(best);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHostQuantize);
@@ -0,0 +1,155 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/engine/GpuTypes.h"
+#include "amazon/dsstne/engine/NNTypes.h"
+
+/**
+ * Checks EstimateNetworkMemory against the allocations of NNLayer, NNWeight and NNDataSet for a small
+ * fully connected network, and FindLargestBatch against the estimate it inverts.
+ */
+class TestMemoryEstimator : public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestMemoryEstimator);
+
+    CPPUNIT_TEST(testTraining);
+    CPPUNIT_TEST(testOptimizerVelocities);
+    CPPUNIT_TEST(testInference);
+    CPPUNIT_TEST(testLargestBatch);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    NNNetworkDescriptor nd;
+    std::vector<NNDataSetDescriptor> vDataSet;
+
+    static NNLayerDescriptor Layer(const std::string& name, NNLayer::Kind kind, uint32_t Nx, const std::string& source)
+    {
+        NNLayerDescriptor l;
+        l._name = name;
+        l._kind = kind;
+        l._Nx = Nx;
+        if (kind != NNLayer::Kind::Hidden)
+            l._dataSet = name;
+        if (!source.empty())
+            l._vSource.push_back(source);
+        return l;
+    }
+
+    static NNWeightDescriptor Weight(const std::string& input, const std::string& output)
+    {
+        NNWeightDescriptor w;
+        w._inputLayer = input;
+        w._outputLayer = output;
+        return w;
+    }
+
+    static NNDataSetDescriptor DataSet(const std::string& name, uint32_t width, NNFloat density)
+    {
+        NNDataSetDescriptor d;
+        d._name = name;
+        d._dataType = NNDataSetEnums::Float;
+        d._dim = NNDataSetDimensions(width);
+        d._examples = 60000;
+        d._sparseDensity = density;
+        d._attributes = (density < 1.0f) ? (NNDataSetEnums::Sparse | NNDataSetEnums::Boolean) : 0;
+        return d;
+    }
+
+    // input (784) -> hidden1 (256) -> hidden2 (128) -> output (10)
+    void build(NNFloat inputDensity)
+    {
+        nd._vLayerDescriptor.clear();
+        nd._vWeightDescriptor.clear();
+        nd._vLayerDescriptor.push_back(Layer("input", NNLayer::Kind::Input, 784, ""));
+        nd._vLayerDescriptor.push_back(Layer("hidden1", NNLayer::Kind::Hidden, 256, "input"));
+        nd._vLayerDescriptor.push_back(Layer("hidden2", NNLayer::Kind::Hidden, 128, "hidden1"));
+        nd._vLayerDescriptor.push_back(Layer("output", NNLayer::Kind::Output, 10, "hidden2"));
+        if (inputDensity < 1.0f)
+            nd._vLayerDescriptor[0]._attributes = NNLayer::Attributes::Sparse;
+        nd._vWeightDescriptor.push_back(Weight("input", "hidden1"));
+        nd._vWeightDescriptor.push_back(Weight("hidden1", "hidden2"));
+        nd._vWeightDescriptor.push_back(Weight("hidden2", "output"));
+        vDataSet.clear();
+        vDataSet.push_back(DataSet("input", 784, inputDensity));
+        vDataSet.push_back(DataSet("output", 10, 1.0f));
+    }
+
+ public:
+    void testTraining()
+    {
+        build(0.01f);
+        NNMemoryEstimate e;
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 32, SGD, false, e));
+        CPPUNIT_ASSERT_EQUAL((size_t)4, e._vLayer.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)3, e._vWeight.size());
+
+        // Fast sparse input: no units, transposed indices bounded by the batch plus per feature padding
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, e._vLayer[0]._units);
+        uint64_t indices = 784 * 32 + 31 * 784;
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(2 * 784 * 4 + indices * 4), e._vLayer[0]._sparseTransposed);
+
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(256 * 32 * 4), e._vLayer[1]._units);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(256 * 32 * 4), e._vLayer[1]._deltas);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(10 * 32 * 4), e._vLayer[3]._deltas);
+
+        CPPUNIT_ASSERT_EQUAL((uint64_t)((784 * 256 + 256) * 4), e._vWeight[0]._weights);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(784 * 256 * 4), e._vWeight[0]._gradients);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, e._vWeight[0]._velocities);
+
+        // 1% of 60000 x 784 boolean datapoints plus 64-bit starts and ends
+        uint64_t datapoints = (uint64_t)(60000.0 * 784.0 * 0.01f);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(2 * 60000 * 8) + datapoints * 4, e._vDataSet[0]._data);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(60000 * 10 * 4), e._vDataSet[1]._data);
+        CPPUNIT_ASSERT_EQUAL((uint64_t)0, e._unitArenas);
+    }
+
+    void testOptimizerVelocities()
+    {
+        build(0.01f);
+        NNMemoryEstimate e;
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 32, Momentum, false, e));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)((128 * 10 + 10) * 4), e._vWeight[2]._velocities);
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 32, Adam, false, e));
+        CPPUNIT_ASSERT_EQUAL((uint64_t)(2 * (128 * 10 + 10) * 4), e._vWeight[2]._velocities);
+    }
+
+    void testInference()
+    {
+        build(1.0f);
+        NNMemoryEstimate e;
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 32, Adam, true, e));
+        for (auto& f : e._vLayer)
+            CPPUNIT_ASSERT_EQUAL((uint64_t)0, f._deltas);
+        for (auto& f : e._vWeight)
+        {
+            CPPUNIT_ASSERT_EQUAL((uint64_t)0, f._gradients);
+            CPPUNIT_ASSERT_EQUAL((uint64_t)0, f._velocities);
+        }
+
+        // input and hidden2 share one arena, hidden1 and output the other
+        CPPUNIT_ASSERT_EQUAL((uint64_t)((784 + 256) * 32 * 4), e._unitArenas);
+        uint64_t total = e._unitArenas;
+        for (auto& f : e._vWeight)
+            total += f._weights;
+        for (auto& f : e._vDataSet)
+            total += f._data;
+        CPPUNIT_ASSERT_EQUAL(total, e.GetTotal());
+    }
+
+    void testLargestBatch()
+    {
+        build(0.01f);
+        NNMemoryEstimate e;
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 1000, Adam, false, e));
+        CPPUNIT_ASSERT_EQUAL(1000u, FindLargestBatch(nd, vDataSet, Adam, false, e.GetTotal()));
+        CPPUNIT_ASSERT_EQUAL(999u, FindLargestBatch(nd, vDataSet, Adam, false, e.GetTotal() - 1));
+        CPPUNIT_ASSERT(EstimateNetworkMemory(nd, vDataSet, 1, Adam, false, e));
+        CPPUNIT_ASSERT_EQUAL(0u, FindLargestBatch(nd, vDataSet, Adam, false, e.GetTotal() - 1));
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestMemoryEstimator);
@@ -0,0 +1,208 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "amazon/dsstne/knn/DataReader.h"
+
+#include "VectorDataReader.h"
+
+class TestBinaryFileDataReader: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestBinaryFileDataReader);
+
+    CPPUNIT_TEST(testRoundTripFp32);
+    CPPUNIT_TEST(testRoundTripFp16);
+    CPPUNIT_TEST(testAppendRows);
+    CPPUNIT_TEST(testConvertTextFile);
+    CPPUNIT_TEST(testEmpty);
+    CPPUNIT_TEST_EXCEPTION(testNotABinaryFile, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testTruncatedFile, std::invalid_argument);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static const int rows = 1000;
+    static const int columns = 12;
+
+    std::string fileName;
+    std::vector<std::string> keys;
+    std::vector<float> vectors;
+
+    std::string createTempFile()
+    {
+        char name[] = "/tmp/TestBinaryFileDataReader.XXXXXX";
+        int fd = mkstemp(name);
+        close(fd);
+        return name;
+    }
+
+ public:
+    void setUp()
+    {
+        fileName = createTempFile();
+
+        std::mt19937 generator(5);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        keys.clear();
+        vectors.clear();
+        for (int row = 0; row < rows; ++row)
+        {
+            // keys of varying length, including empty
+            keys.push_back(std::string(row % 7, 'k') + std::to_string(row % 3 == 0 ? row : -row).substr(0, row % 5));
+            for (int j = 0; j < columns; ++j)
+            {
+                vectors.push_back(normal(generator));
+            }
+        }
+    }
+
+    void tearDown()
+    {
+        remove(fileName.c_str());
+    }
+
+    void testRoundTripFp32()
+    {
+        VectorDataReader source(keys, vectors, columns);
+        writeBinaryDataFile(&source, fileName);
+
+        BinaryFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) rows, reader.getRows());
+        CPPUNIT_ASSERT_EQUAL(columns, reader.getColumns());
+        CPPUNIT_ASSERT(reader.getDataType() == BinaryDataType::FP32);
+
+        // in place access
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT_EQUAL(keys[row], std::string(reader.getKeyData(row), reader.getKeyLength(row)));
+            CPPUNIT_ASSERT(memcmp(&vectors[row * columns], reader.getRowData(row), columns * sizeof(float)) == 0);
+        }
+
+        std::string key;
+        float vector[columns];
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT(reader.readRow(&key, vector));
+            CPPUNIT_ASSERT_EQUAL(keys[row], key);
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_EQUAL(vectors[row * columns + j], vector[j]);
+            }
+        }
+        CPPUNIT_ASSERT(!reader.readRow(&key, vector));
+    }
+
+    void testRoundTripFp16()
+    {
+        VectorDataReader source(keys, vectors, columns);
+        writeBinaryDataFile(&source, fileName, BinaryDataType::FP16);
+
+        BinaryFileDataReader reader(fileName);
+        CPPUNIT_ASSERT(reader.getDataType() == BinaryDataType::FP16);
+
+        std::string key;
+        float vector[columns];
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT(reader.readRow(&key, vector));
+            CPPUNIT_ASSERT_EQUAL(keys[row], key);
+            for (int j = 0; j < columns; ++j)
+            {
+                // half has an 11 bit significand
+                float expected = vectors[row * columns + j];
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, vector[j], std::abs(expected) / 1024 + 1e-7);
+            }
+        }
+    }
+
+    void testAppendRows()
+    {
+        VectorDataReader source(keys, vectors, columns);
+        writeBinaryDataFile(&source, fileName);
+
+        BinaryFileDataReader reader(fileName);
+        size_t keySize = 0;
+        for (const std::string &key : keys)
+        {
+            keySize += key.size();
+        }
+        CPPUNIT_ASSERT_EQUAL(keySize, reader.getKeySizeInBytes());
+
+        astdl::knn::KeyArena arena;
+        arena.reserve(reader.getRows(), reader.getKeySizeInBytes());
+        std::vector<float> vector(columns);
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT(reader.appendRow(&arena, vector.data()));
+            CPPUNIT_ASSERT_EQUAL(vectors[row * columns + columns - 1], vector[columns - 1]);
+        }
+        CPPUNIT_ASSERT(!reader.appendRow(&arena, vector.data()));
+
+        CPPUNIT_ASSERT_EQUAL((size_t) rows, arena.size());
+        CPPUNIT_ASSERT_EQUAL(keySize, arena.getNumChars());
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT_EQUAL(keys[row], arena[row].str());
+        }
+    }
+
+    void testConvertTextFile()
+    {
+        std::string textFileName = createTempFile();
+        {
+            std::ofstream out(textFileName);
+            out << "a\t1 2 3\nb\t4 5 6\n";
+        }
+        TextFileDataReader text(textFileName);
+        writeBinaryDataFile(&text, fileName);
+        remove(textFileName.c_str());
+
+        BinaryFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 2, reader.getRows());
+        CPPUNIT_ASSERT_EQUAL(3, reader.getColumns());
+        std::string key;
+        float vector[3];
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT_EQUAL(std::string("b"), key);
+        CPPUNIT_ASSERT_EQUAL(6.0f, vector[2]);
+    }
+
+    void testEmpty()
+    {
+        VectorDataReader source(std::vector<std::string>(), std::vector<float>(), columns);
+        writeBinaryDataFile(&source, fileName);
+
+        BinaryFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, reader.getRows());
+        std::string key;
+        float vector[columns];
+        CPPUNIT_ASSERT(!reader.readRow(&key, vector));
+    }
+
+    void testNotABinaryFile()
+    {
+        std::ofstream out(fileName);
+        out << std::string(256, 'x');
+        out.close();
+        BinaryFileDataReader reader(fileName);
+    }
+
+    void testTruncatedFile()
+    {
+        VectorDataReader source(keys, vectors, columns);
+        writeBinaryDataFile(&source, fileName);
+        CPPUNIT_ASSERT_EQUAL(0, truncate(fileName.c_str(), 4096));
+        BinaryFileDataReader reader(fileName);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestBinaryFileDataReader);
@@ -0,0 +1,86 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "amazon/dsstne/knn/ExclusionSet.h"
+
+using astdl::knn::ExclusionSet;
+
+class TestExclusionSet: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestExclusionSet);
+
+    CPPUNIT_TEST(testEmpty);
+    CPPUNIT_TEST(testSortedIds);
+    CPPUNIT_TEST(testBitmasks);
+    CPPUNIT_TEST(testGetRows);
+    CPPUNIT_TEST_EXCEPTION(testFromSortedIds_Unsorted, std::invalid_argument);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ public:
+
+    void testEmpty()
+    {
+        ExclusionSet exclusions;
+        CPPUNIT_ASSERT(!exclusions.contains(0, 0));
+        std::vector<uint32_t> rows;
+        exclusions.getRows(0, 100, &rows);
+        CPPUNIT_ASSERT(rows.empty());
+    }
+
+    void testSortedIds()
+    {
+        ExclusionSet exclusions = ExclusionSet::fromSortedIds({ ExclusionSet::getId(0, 3), ExclusionSet::getId(0, 70),
+            ExclusionSet::getId(2, 0) });
+        CPPUNIT_ASSERT(exclusions.contains(0, 3));
+        CPPUNIT_ASSERT(exclusions.contains(0, 70));
+        CPPUNIT_ASSERT(exclusions.contains(2, 0));
+        CPPUNIT_ASSERT(!exclusions.contains(0, 4));
+        CPPUNIT_ASSERT(!exclusions.contains(1, 3));
+        CPPUNIT_ASSERT(!exclusions.contains(2, 1));
+    }
+
+    void testBitmasks()
+    {
+        std::vector<std::vector<uint64_t>> bitmasks(2);
+        bitmasks[1] = { 1ull << 5, 1ull << 63 };
+        ExclusionSet exclusions = ExclusionSet::fromBitmasks(bitmasks);
+        CPPUNIT_ASSERT(exclusions.contains(1, 5));
+        CPPUNIT_ASSERT(exclusions.contains(1, 127));
+        CPPUNIT_ASSERT(!exclusions.contains(1, 6));
+        CPPUNIT_ASSERT(!exclusions.contains(0, 5));
+        // past the end of the bitmasks
+        CPPUNIT_ASSERT(!exclusions.contains(1, 128));
+        CPPUNIT_ASSERT(!exclusions.contains(3, 5));
+    }
+
+    void testGetRows()
+    {
+        ExclusionSet ids = ExclusionSet::fromSortedIds({ ExclusionSet::getId(0, 1), ExclusionSet::getId(1, 2),
+            ExclusionSet::getId(1, 64), ExclusionSet::getId(1, 100), ExclusionSet::getId(2, 0) });
+        std::vector<std::vector<uint64_t>> bitmasks(2);
+        bitmasks[1] = { 1ull << 2, 1ull, 1ull << 36 };
+        ExclusionSet bits = ExclusionSet::fromBitmasks(bitmasks);
+
+        for (const ExclusionSet *exclusions : { &ids, &bits })
+        {
+            // rows >= numRows are left out
+            std::vector<uint32_t> rows;
+            exclusions->getRows(1, 100, &rows);
+            CPPUNIT_ASSERT_EQUAL((size_t) 2, rows.size());
+            CPPUNIT_ASSERT_EQUAL(2u, rows[0]);
+            CPPUNIT_ASSERT_EQUAL(64u, rows[1]);
+        }
+    }
+
+    void testFromSortedIds_Unsorted()
+    {
+        ExclusionSet::fromSortedIds({ 5, 3 });
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestExclusionSet);
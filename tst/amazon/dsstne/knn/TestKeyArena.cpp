@@ -0,0 +1,85 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/knn/KeyArena.h"
+
+class TestKeyArena: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestKeyArena);
+
+    CPPUNIT_TEST(testAppend);
+    CPPUNIT_TEST(testAppendArena);
+    CPPUNIT_TEST(testKeyViewCompare);
+    CPPUNIT_TEST(testClear);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ public:
+
+    void testAppend()
+    {
+        astdl::knn::KeyArena arena;
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, arena.size());
+
+        arena.reserve(3, 8);
+        arena.append("abc");
+        arena.append("", 0);
+        arena.append(std::string("de\0f", 4));
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, arena.size());
+        CPPUNIT_ASSERT_EQUAL((size_t) 7, arena.getNumChars());
+        CPPUNIT_ASSERT_EQUAL(std::string("abc"), arena[0].str());
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, arena[1].size());
+        CPPUNIT_ASSERT_EQUAL(std::string("de\0f", 4), arena[2].str());
+
+        std::string key = "previous";
+        arena.copyKey(0, &key);
+        CPPUNIT_ASSERT_EQUAL(std::string("abc"), key);
+    }
+
+    void testAppendArena()
+    {
+        // offsets need not start at 0: append keys 1..2 of a larger arena
+        const char chars[] = "xxhelloworld";
+        const uint64_t offsets[] = { 0, 2, 7, 12 };
+
+        astdl::knn::KeyArena arena;
+        arena.append("first");
+        arena.append(chars, offsets + 1, 2);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, arena.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("first"), arena[0].str());
+        CPPUNIT_ASSERT_EQUAL(std::string("hello"), arena[1].str());
+        CPPUNIT_ASSERT_EQUAL(std::string("world"), arena[2].str());
+        CPPUNIT_ASSERT_EQUAL((uint64_t) 15, arena.getOffsets()[3]);
+    }
+
+    void testKeyViewCompare()
+    {
+        astdl::knn::KeyArena arena;
+        arena.append("key");
+        arena.append("key");
+        arena.append("kez");
+
+        CPPUNIT_ASSERT(arena[0] == arena[1]);
+        CPPUNIT_ASSERT(arena[0] != arena[2]);
+        CPPUNIT_ASSERT(arena[0] == std::string("key"));
+        CPPUNIT_ASSERT(arena[0] != std::string("ke"));
+        CPPUNIT_ASSERT(astdl::knn::KeyView() == std::string());
+    }
+
+    void testClear()
+    {
+        astdl::knn::KeyArena arena;
+        arena.append("abc");
+        arena.clear();
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, arena.size());
+        arena.append("d");
+        CPPUNIT_ASSERT_EQUAL(std::string("d"), arena[0].str());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestKeyArena);
@@ -0,0 +1,231 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/knn/DataReader.h"
+#include "amazon/dsstne/knn/KnnData.h"
+
+#include "VectorDataReader.h"
+
+class TestKnnData: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestKnnData);
+
+    CPPUNIT_TEST(testLoadOnHostIsColumnMajor);
+    CPPUNIT_TEST(testLoadOnHostInt8);
+    CPPUNIT_TEST(testMatrixSizeDoesNotOverflow);
+    CPPUNIT_TEST(testAddRemoveCompact);
+    CPPUNIT_TEST_EXCEPTION(testAdd_Full, std::runtime_error);
+    CPPUNIT_TEST_EXCEPTION(testAdd_NotReserved, std::runtime_error);
+    CPPUNIT_TEST_EXCEPTION(testReserve_Int8, std::invalid_argument);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    // more rows than one load block and columns that are not a multiple of the transpose tile
+    static const int rows = 20001;
+    static const int columns = 37;
+
+    std::vector<std::string> keys;
+    std::vector<float> vectors;
+
+    /**
+     * asserts that the rows of the partition are the given rows of vectors (row major), in order.
+     */
+    void checkRows(astdl::knn::KnnData &data, const std::vector<int> &expectedRows)
+    {
+        const astdl::knn::Matrix &matrix = data.hCollectionPartitions[0];
+        const float *values = (const float*) matrix.data;
+        CPPUNIT_ASSERT_EQUAL((uint32_t) expectedRows.size(), data.getNumRows(0));
+        CPPUNIT_ASSERT_EQUAL(expectedRows.size(), data.hKeys[0].size());
+        for (size_t row = 0; row < expectedRows.size(); ++row)
+        {
+            CPPUNIT_ASSERT_EQUAL(keys[expectedRows[row]], data.hKeys[0][row].str());
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_EQUAL(vectors[expectedRows[row] * columns + j], values[(size_t) j * matrix.numRows + row]);
+            }
+        }
+    }
+
+    void load(astdl::knn::KnnData &data)
+    {
+        std::map<int, DataReader*> readers;
+        readers[0] = new VectorDataReader(keys, vectors, columns);
+        data.load(readers);
+        delete readers[0];
+    }
+
+ public:
+    void setUp()
+    {
+        std::mt19937 generator(35);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        keys.clear();
+        vectors.clear();
+        for (int row = 0; row < rows; ++row)
+        {
+            keys.push_back("key" + std::to_string(row));
+            for (int j = 0; j < columns; ++j)
+            {
+                vectors.push_back(distribution(generator));
+            }
+        }
+    }
+
+    void testLoadOnHostIsColumnMajor()
+    {
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+
+        astdl::knn::Matrix &matrix = data.hCollectionPartitions[0];
+        CPPUNIT_ASSERT_EQUAL((uint32_t) rows, matrix.numRows);
+        CPPUNIT_ASSERT_EQUAL(columns, matrix.numColumns);
+        const float *values = (const float*) matrix.data;
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_EQUAL(vectors[row * columns + j], values[(size_t) j * rows + row]);
+            }
+        }
+
+        CPPUNIT_ASSERT_EQUAL((size_t) rows, data.hKeys[0].size());
+        CPPUNIT_ASSERT_EQUAL(keys[0], data.hKeys[0][0].str());
+        CPPUNIT_ASSERT_EQUAL(keys[rows - 1], data.hKeys[0][rows - 1].str());
+    }
+
+    void testLoadOnHostInt8()
+    {
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::INT8, astdl::knn::Backend::CPU);
+        load(data);
+
+        const astdl::knn::ScalarQuantizer &quantizer = data.hScalarQuantizers[0];
+        const uint8_t *codes = (const uint8_t*) data.hCollectionPartitions[0].data;
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_EQUAL(quantizer.encode(j, vectors[row * columns + j]), codes[(size_t) j * rows + row]);
+            }
+        }
+    }
+
+    void testMatrixSizeDoesNotOverflow()
+    {
+        // 100M x 128 fp32 is 51.2 GB, well past 32 bits
+        astdl::knn::Matrix matrix(nullptr, 100000000, 128, sizeof(float), cudaMemoryTypeHost);
+        CPPUNIT_ASSERT_EQUAL((size_t) 12800000000ULL, matrix.getLength());
+        CPPUNIT_ASSERT_EQUAL((size_t) 51200000000ULL, matrix.getSizeInBytes());
+    }
+
+    void testAddRemoveCompact()
+    {
+        // load the first half of the rows, add the second half in two batches
+        const int loaded = rows / 2;
+        const int reserved = rows - loaded;
+        std::vector<std::string> loadedKeys(keys.begin(), keys.begin() + loaded);
+        std::vector<float> loadedVectors(vectors.begin(), vectors.begin() + (size_t) loaded * columns);
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU,
+            astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, astdl::knn::Metric::L2);
+        data.reserve(reserved, reserved * 16);
+        std::map<int, DataReader*> readers;
+        readers[0] = new VectorDataReader(loadedKeys, loadedVectors, columns);
+        data.load(readers);
+        delete readers[0];
+
+        CPPUNIT_ASSERT_EQUAL((uint32_t) rows, data.hCollectionPartitions[0].numRows);
+        std::vector<int> expectedRows;
+        for (int row = 0; row < loaded; ++row)
+        {
+            expectedRows.push_back(row);
+        }
+        checkRows(data, expectedRows);
+
+        int start = loaded;
+        for (int count : { 100, reserved - 100 })
+        {
+            std::vector<std::string> addedKeys(keys.begin() + start, keys.begin() + start + count);
+            data.add(0, addedKeys, vectors.data() + (size_t) start * columns);
+            for (int row = start; row < start + count; ++row)
+            {
+                expectedRows.push_back(row);
+            }
+            start += count;
+        }
+        checkRows(data, expectedRows);
+        float norm = 0.0f;
+        for (int j = 0; j < columns; ++j)
+        {
+            norm += vectors[(rows - 1) * columns + j] * vectors[(rows - 1) * columns + j];
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(norm, data.hRowNorms[0][rows - 1], 1e-4);
+
+        // remove every third row, one of them twice, and a key that does not exist
+        std::vector<std::string> removedKeys = { "missing", keys[0] };
+        for (int row = 0; row < rows; row += 3)
+        {
+            removedKeys.push_back(keys[row]);
+        }
+        size_t removed = (rows + 2) / 3;
+        CPPUNIT_ASSERT_EQUAL(removed, data.remove(removedKeys));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) removed, data.getNumRemovedRows(0));
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT_EQUAL(row % 3 == 0, data.isRemoved(0, row));
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, data.remove({ keys[0] }));
+
+        uint64_t generation = data.getGeneration();
+        data.compact(0);
+        CPPUNIT_ASSERT(data.getGeneration() != generation);
+        CPPUNIT_ASSERT_EQUAL(0u, data.getNumRemovedRows(0));
+        expectedRows.clear();
+        for (int row = 0; row < rows; ++row)
+        {
+            if (row % 3 != 0)
+            {
+                expectedRows.push_back(row);
+                CPPUNIT_ASSERT(!data.isRemoved(0, expectedRows.size() - 1));
+            }
+        }
+        checkRows(data, expectedRows);
+        // room for the reserved rows again
+        CPPUNIT_ASSERT_EQUAL((uint32_t) (expectedRows.size() + reserved), data.hCollectionPartitions[0].numRows);
+        std::vector<std::string> readdedKeys = { keys[0] };
+        data.add(0, readdedKeys, vectors.data());
+        CPPUNIT_ASSERT_EQUAL(keys[0], data.hKeys[0][expectedRows.size()].str());
+    }
+
+    void testAdd_Full()
+    {
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        data.reserve(1, 64);
+        load(data);
+
+        std::vector<std::string> addedKeys = { "added0", "added1" };
+        data.add(0, addedKeys, vectors.data());
+    }
+
+    void testAdd_NotReserved()
+    {
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+
+        std::vector<std::string> addedKeys = { "added0" };
+        data.add(0, addedKeys, vectors.data());
+    }
+
+    void testReserve_Int8()
+    {
+        astdl::knn::KnnData data(1, 16, 10, astdl::knn::DataType::INT8, astdl::knn::Backend::CPU);
+        data.reserve(1, 64);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestKnnData);
@@ -0,0 +1,523 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "amazon/dsstne/knn/cudautil.h"
+#include "amazon/dsstne/knn/DataReader.h"
+#include "amazon/dsstne/knn/ExclusionSet.h"
+#include "amazon/dsstne/knn/KnnData.h"
+#include "amazon/dsstne/knn/KnnExactCpu.h"
+#include "amazon/dsstne/knn/KnnExactGpu.h"
+
+#include "VectorDataReader.h"
+
+class TestKnnExactCpu: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestKnnExactCpu);
+
+    CPPUNIT_TEST(testSearchMatchesBruteForce);
+    CPPUNIT_TEST(testSearchPartialBatch);
+    CPPUNIT_TEST(testSearchIndexes);
+    CPPUNIT_TEST(testSearchCosine);
+    CPPUNIT_TEST(testSearchL2);
+    CPPUNIT_TEST(testSearchGlobalExclusions);
+    CPPUNIT_TEST(testSearchPerQueryExclusions);
+    CPPUNIT_TEST_EXCEPTION(testSearch_WrongNumberOfExclusions, std::invalid_argument);
+    CPPUNIT_TEST(testSearchAfterAddRemoveCompact);
+    CPPUNIT_TEST(testSearchDuringUpdates);
+    CPPUNIT_TEST(testSearchMatchesGpu);
+    CPPUNIT_TEST_EXCEPTION(testSearch_KGreaterThanMaxK, std::invalid_argument);
+    CPPUNIT_TEST(testCreate_OnGpuData);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static const int numPartitions = 3;
+    static const int rowsPerPartition = 5000;
+    static const int columns = 24;
+    static const int batchSize = 40;
+    static const int maxK = 32;
+
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<float>> vectors;
+    std::vector<float> queries;
+
+    void load(astdl::knn::KnnData &data)
+    {
+        std::map<int, DataReader*> readers;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            readers[p] = new VectorDataReader(keys[p], vectors[p], columns);
+        }
+        data.load(readers);
+        for (auto &entry : readers)
+        {
+            delete entry.second;
+        }
+    }
+
+    /**
+     * Returns the top k (score, key) of query q under the metric, best first
+     * (highest score, or smallest distance for L2).
+     */
+    std::vector<std::pair<float, std::string>> bruteForce(int q, int k,
+        astdl::knn::Metric metric = astdl::knn::Metric::INNER_PRODUCT, const astdl::knn::ExclusionSet *exclusions =
+            nullptr)
+    {
+        std::vector<std::pair<float, std::string>> results;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (size_t row = 0; row < keys[p].size(); ++row)
+            {
+                if (exclusions != nullptr && exclusions->contains(p, row))
+                {
+                    continue;
+                }
+                double product = 0.0;
+                double queryNorm = 0.0;
+                double rowNorm = 0.0;
+                for (int j = 0; j < columns; ++j)
+                {
+                    float x = queries[q * columns + j];
+                    float y = vectors[p][row * columns + j];
+                    product += x * y;
+                    queryNorm += x * x;
+                    rowNorm += y * y;
+                }
+                double score = product;
+                if (metric == astdl::knn::Metric::COSINE)
+                {
+                    score = product / std::sqrt(queryNorm * rowNorm);
+                } else if (metric == astdl::knn::Metric::L2)
+                {
+                    // negated so that the best result is the highest
+                    score = -(queryNorm + rowNorm - 2.0 * product);
+                }
+                results.push_back(std::make_pair((float) score, keys[p][row]));
+            }
+        }
+        std::partial_sort(results.begin(), results.begin() + k, results.end(),
+            std::greater<std::pair<float, std::string>>());
+        results.resize(k);
+        if (metric == astdl::knn::Metric::L2)
+        {
+            for (auto &result : results)
+            {
+                result.first = -result.first;
+            }
+        }
+        return results;
+    }
+
+    void checkResults(const std::vector<std::string> &resultKeys, const std::vector<float> &resultScores, int size, int k,
+        astdl::knn::Metric metric = astdl::knn::Metric::INNER_PRODUCT)
+    {
+        for (int q = 0; q < size; ++q)
+        {
+            std::vector<std::pair<float, std::string>> expected = bruteForce(q, k, metric);
+            for (int i = 0; i < k; ++i)
+            {
+                CPPUNIT_ASSERT_EQUAL(expected[i].second, resultKeys[q * k + i]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i].first, resultScores[q * k + i], 1e-4);
+            }
+        }
+    }
+
+    void checkMetric(astdl::knn::Metric metric)
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU,
+            astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, metric);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        const int k = 10;
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), resultKeys.data(), resultScores.data());
+
+        checkResults(resultKeys, resultScores, batchSize, k, metric);
+    }
+
+ public:
+
+    void setUp()
+    {
+        srand(31);
+        keys.assign(numPartitions, std::vector<std::string>());
+        vectors.assign(numPartitions, std::vector<float>());
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (int row = 0; row < rowsPerPartition; ++row)
+            {
+                keys[p].push_back("key_" + std::to_string(p) + "_" + std::to_string(row));
+                for (int j = 0; j < columns; ++j)
+                {
+                    vectors[p].push_back((float) rand() / RAND_MAX - 0.5f);
+                }
+            }
+        }
+        queries.clear();
+        for (int i = 0; i < batchSize * columns; ++i)
+        {
+            queries.push_back((float) rand() / RAND_MAX - 0.5f);
+        }
+    }
+
+    void testSearchMatchesBruteForce()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        const int k = 10;
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), resultKeys.data(), resultScores.data());
+
+        checkResults(resultKeys, resultScores, batchSize, k);
+    }
+
+    void testSearchPartialBatch()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        const int size = 3;
+        std::vector<std::string> resultKeys(size * maxK);
+        std::vector<float> resultScores(size * maxK);
+        knn.search(maxK, queries.data(), size, resultKeys.data(), resultScores.data());
+
+        checkResults(resultKeys, resultScores, size, maxK);
+    }
+
+    void testSearchIndexes()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        const int k = 10;
+        std::vector<uint32_t> partitions(batchSize * k);
+        std::vector<uint32_t> rows(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), partitions.data(), rows.data(), resultScores.data());
+
+        std::vector<std::string> resultKeys;
+        for (int i = 0; i < batchSize * k; ++i)
+        {
+            resultKeys.push_back(keys[partitions[i]][rows[i]]);
+        }
+        checkResults(resultKeys, resultScores, batchSize, k);
+    }
+
+    void testSearchCosine()
+    {
+        checkMetric(astdl::knn::Metric::COSINE);
+    }
+
+    void testSearchL2()
+    {
+        checkMetric(astdl::knn::Metric::L2);
+    }
+
+    void testSearchGlobalExclusions()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        // exclude the unfiltered top 5 of query 0 and every third row of partition 1
+        const int k = 10;
+        std::vector<uint64_t> ids;
+        std::vector<uint32_t> partitions(batchSize * k);
+        std::vector<uint32_t> rows(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), partitions.data(), rows.data(), resultScores.data());
+        for (int i = 0; i < 5; ++i)
+        {
+            ids.push_back(astdl::knn::ExclusionSet::getId(partitions[i], rows[i]));
+        }
+        for (int row = 0; row < rowsPerPartition; row += 3)
+        {
+            ids.push_back(astdl::knn::ExclusionSet::getId(1, row));
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        astdl::knn::ExclusionSet exclusions = astdl::knn::ExclusionSet::fromSortedIds(ids);
+
+        std::vector<std::string> resultKeys(batchSize * k);
+        knn.search(k, queries.data(), batchSize, { &exclusions }, resultKeys.data(), resultScores.data());
+
+        for (int q = 0; q < batchSize; ++q)
+        {
+            std::vector<std::pair<float, std::string>> expected = bruteForce(q, k, astdl::knn::Metric::INNER_PRODUCT,
+                &exclusions);
+            for (int i = 0; i < k; ++i)
+            {
+                CPPUNIT_ASSERT_EQUAL(expected[i].second, resultKeys[q * k + i]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i].first, resultScores[q * k + i], 1e-4);
+            }
+        }
+    }
+
+    void testSearchPerQueryExclusions()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        // query q excludes the rows of partition q % numPartitions whose index is a multiple of q + 2
+        // (bitmasks), except the last query which is not filtered
+        const int k = 10;
+        const int size = 8;
+        std::vector<astdl::knn::ExclusionSet> sets;
+        for (int q = 0; q < size; ++q)
+        {
+            std::vector<std::vector<uint64_t>> bitmasks(numPartitions);
+            bitmasks[q % numPartitions].resize((rowsPerPartition + 63) / 64);
+            for (int row = 0; row < rowsPerPartition; row += q + 2)
+            {
+                bitmasks[q % numPartitions][row / 64] |= 1ull << (row % 64);
+            }
+            sets.push_back(astdl::knn::ExclusionSet::fromBitmasks(bitmasks));
+        }
+        std::vector<const astdl::knn::ExclusionSet*> exclusions;
+        for (int q = 0; q < size - 1; ++q)
+        {
+            exclusions.push_back(&sets[q]);
+        }
+        exclusions.push_back(nullptr);
+
+        std::vector<uint32_t> partitions(size * k);
+        std::vector<uint32_t> rows(size * k);
+        std::vector<float> resultScores(size * k);
+        knn.search(k, queries.data(), size, exclusions, partitions.data(), rows.data(), resultScores.data());
+
+        for (int q = 0; q < size; ++q)
+        {
+            std::vector<std::pair<float, std::string>> expected = bruteForce(q, k, astdl::knn::Metric::INNER_PRODUCT,
+                exclusions[q]);
+            for (int i = 0; i < k; ++i)
+            {
+                CPPUNIT_ASSERT_EQUAL(expected[i].second, keys[partitions[q * k + i]][rows[q * k + i]]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i].first, resultScores[q * k + i], 1e-4);
+            }
+        }
+    }
+
+    void testSearch_WrongNumberOfExclusions()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        astdl::knn::ExclusionSet exclusions;
+        const int k = 10;
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), batchSize, { &exclusions, &exclusions }, resultKeys.data(), resultScores.data());
+    }
+
+    void testSearchAfterAddRemoveCompact()
+    {
+        // load all but the last 1000 rows of each partition, add those afterwards
+        const int added = 1000;
+        std::vector<std::vector<std::string>> addedKeys(numPartitions);
+        std::vector<std::vector<float>> addedVectors(numPartitions);
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            addedKeys[p].assign(keys[p].end() - added, keys[p].end());
+            addedVectors[p].assign(vectors[p].end() - added * columns, vectors[p].end());
+            keys[p].resize(rowsPerPartition - added);
+            vectors[p].resize((rowsPerPartition - added) * columns);
+        }
+
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU,
+            astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, astdl::knn::Metric::COSINE);
+        data.reserve(added, added * 16);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            data.add(p, addedKeys[p], addedVectors[p].data());
+            keys[p].insert(keys[p].end(), addedKeys[p].begin(), addedKeys[p].end());
+            vectors[p].insert(vectors[p].end(), addedVectors[p].begin(), addedVectors[p].end());
+        }
+
+        const int k = 10;
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        knn.search(k, queries.data(), resultKeys.data(), resultScores.data());
+        checkResults(resultKeys, resultScores, batchSize, k, astdl::knn::Metric::COSINE);
+
+        // remove the top 5 of every query
+        std::set<std::string> removedKeys;
+        for (int q = 0; q < batchSize; ++q)
+        {
+            removedKeys.insert(resultKeys.begin() + q * k, resultKeys.begin() + q * k + 5);
+        }
+        CPPUNIT_ASSERT_EQUAL(removedKeys.size(),
+            data.remove(std::vector<std::string>(removedKeys.begin(), removedKeys.end())));
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (size_t row = keys[p].size(); row-- > 0;)
+            {
+                if (removedKeys.count(keys[p][row]) != 0)
+                {
+                    keys[p].erase(keys[p].begin() + row);
+                    vectors[p].erase(vectors[p].begin() + row * columns, vectors[p].begin() + (row + 1) * columns);
+                }
+            }
+        }
+
+        knn.search(k, queries.data(), resultKeys.data(), resultScores.data());
+        checkResults(resultKeys, resultScores, batchSize, k, astdl::knn::Metric::COSINE);
+
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            data.compact(p);
+        }
+        std::vector<uint32_t> partitions(batchSize * k);
+        std::vector<uint32_t> rows(batchSize * k);
+        knn.search(k, queries.data(), partitions.data(), rows.data(), resultScores.data());
+        for (int i = 0; i < batchSize * k; ++i)
+        {
+            resultKeys[i] = keys[partitions[i]][rows[i]];
+        }
+        checkResults(resultKeys, resultScores, batchSize, k, astdl::knn::Metric::COSINE);
+    }
+
+    void testSearchDuringUpdates()
+    {
+        // partition 0 is loaded, partition 1 is added to, removed from and compacted while another thread searches
+        const int added = 2000;
+        std::vector<std::string> addedKeys(keys[1].end() - added, keys[1].end());
+        std::vector<float> addedVectors(vectors[1].end() - added * columns, vectors[1].end());
+        keys[1].resize(rowsPerPartition - added);
+        vectors[1].resize((rowsPerPartition - added) * columns);
+
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        data.reserve(added, added * 16);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        std::set<std::string> allKeys;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            allKeys.insert(keys[p].begin(), keys[p].end());
+        }
+        allKeys.insert(addedKeys.begin(), addedKeys.end());
+
+        const int k = 10;
+        bool done = false;
+        std::atomic<bool> updated(false);
+        std::thread updater([&]()
+        {
+            for (int start = 0; start < added; start += 100)
+            {
+                std::vector<std::string> batchKeys(addedKeys.begin() + start, addedKeys.begin() + start + 100);
+                data.add(1, batchKeys, addedVectors.data() + start * columns);
+                data.remove({ batchKeys[0] });
+                if (start % 500 == 0)
+                {
+                    data.compact(1);
+                }
+            }
+            updated = true;
+        });
+
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> resultScores(batchSize * k);
+        while (!done)
+        {
+            done = updated;
+            knn.search(k, queries.data(), resultKeys.data(), resultScores.data());
+            for (int i = 0; i < batchSize * k; ++i)
+            {
+                CPPUNIT_ASSERT(allKeys.count(resultKeys[i]) != 0);
+            }
+            for (int q = 0; q < batchSize; ++q)
+            {
+                for (int i = 1; i < k; ++i)
+                {
+                    CPPUNIT_ASSERT(resultScores[q * k + i - 1] >= resultScores[q * k + i]);
+                }
+            }
+        }
+        updater.join();
+
+        // the last search started after the updates, so it sees all of them
+        for (int start = 0; start < added; start += 100)
+        {
+            CPPUNIT_ASSERT(std::find(resultKeys.begin(), resultKeys.end(), addedKeys[start]) == resultKeys.end());
+        }
+        // one row of each batch removed
+        CPPUNIT_ASSERT_EQUAL((uint32_t) (rowsPerPartition - added / 100),
+            data.getNumRows(1) - data.getNumRemovedRows(1));
+    }
+
+    void testSearchMatchesGpu()
+    {
+        REQUIRE_GPUS(numPartitions);
+
+        for (astdl::knn::Metric metric : { astdl::knn::Metric::INNER_PRODUCT, astdl::knn::Metric::COSINE,
+            astdl::knn::Metric::L2 })
+        {
+            astdl::knn::KnnData cpuData(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32,
+                astdl::knn::Backend::CPU, astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, metric);
+            astdl::knn::KnnData gpuData(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32,
+                astdl::knn::Backend::GPU, astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, metric);
+            load(cpuData);
+            load(gpuData);
+            astdl::knn::KnnExactCpu cpuKnn(&cpuData);
+            astdl::knn::KnnExactGpu gpuKnn(&gpuData);
+
+            const int k = 16;
+            std::vector<std::string> cpuKeys(batchSize * k);
+            std::vector<float> cpuScores(batchSize * k);
+            std::vector<std::string> gpuKeys(batchSize * k);
+            std::vector<float> gpuScores(batchSize * k);
+            cpuKnn.search(k, queries.data(), cpuKeys.data(), cpuScores.data());
+            gpuKnn.search(k, queries.data(), gpuKeys.data(), gpuScores.data());
+
+            for (int i = 0; i < batchSize * k; ++i)
+            {
+                CPPUNIT_ASSERT_EQUAL(gpuKeys[i], cpuKeys[i]);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(gpuScores[i], cpuScores[i], 1e-4);
+            }
+        }
+    }
+
+    void testSearch_KGreaterThanMaxK()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu knn(&data);
+
+        std::vector<std::string> resultKeys(batchSize * (maxK + 1));
+        std::vector<float> resultScores(batchSize * (maxK + 1));
+        knn.search(maxK + 1, queries.data(), resultKeys.data(), resultScores.data());
+    }
+
+    void testCreate_OnGpuData()
+    {
+        REQUIRE_GPU
+        astdl::knn::KnnData data(1, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::GPU);
+        CPPUNIT_ASSERT_THROW(astdl::knn::KnnExactCpu knn(&data), std::invalid_argument);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestKnnExactCpu);
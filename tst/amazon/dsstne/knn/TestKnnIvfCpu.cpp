@@ -0,0 +1,227 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/knn/ExclusionSet.h"
+#include "amazon/dsstne/knn/KnnData.h"
+#include "amazon/dsstne/knn/KnnExactCpu.h"
+#include "amazon/dsstne/knn/KnnIvfCpu.h"
+
+#include "VectorDataReader.h"
+
+class TestKnnIvfCpu: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestKnnIvfCpu);
+
+    CPPUNIT_TEST(testListsCoverAllRows);
+    CPPUNIT_TEST(testFullProbeMatchesExact);
+    CPPUNIT_TEST(testFullProbeWithExclusionsMatchesExact);
+    CPPUNIT_TEST(testRecallIncreasesWithNprobe);
+    CPPUNIT_TEST_EXCEPTION(testSetNprobe_GreaterThanNumLists, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testCreate_MoreListsThanRows, std::invalid_argument);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static const int numPartitions = 2;
+    static const int rowsPerPartition = 4000;
+    static const int columns = 16;
+    static const int clusters = 32;
+    static const int numLists = 32;
+    static const int batchSize = 50;
+    static const int maxK = 20;
+
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<float>> vectors;
+    std::vector<float> queries;
+
+    void load(astdl::knn::KnnData &data)
+    {
+        std::map<int, DataReader*> readers;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            readers[p] = new VectorDataReader(keys[p], vectors[p], columns);
+        }
+        data.load(readers);
+        for (auto &entry : readers)
+        {
+            delete entry.second;
+        }
+    }
+
+    /**
+     * Fraction of the exact top k keys that the approximate search returned.
+     */
+    double recall(const std::vector<std::string> &exactKeys, const std::vector<std::string> &approximateKeys, int k)
+    {
+        size_t hits = 0;
+        for (int q = 0; q < batchSize; ++q)
+        {
+            std::set<std::string> expected(exactKeys.begin() + q * k, exactKeys.begin() + (q + 1) * k);
+            for (int i = 0; i < k; ++i)
+            {
+                hits += expected.count(approximateKeys[q * k + i]);
+            }
+        }
+        return (double) hits / (batchSize * k);
+    }
+
+ public:
+    void setUp()
+    {
+        // gaussian clusters around random centers so that the coarse quantizer has structure to find
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, 0.1f);
+        std::uniform_int_distribution<int> pickCluster(0, clusters - 1);
+
+        std::vector<float> centers(clusters * columns);
+        for (float &center : centers)
+        {
+            center = uniform(generator);
+        }
+
+        keys.assign(numPartitions, std::vector<std::string>());
+        vectors.assign(numPartitions, std::vector<float>());
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (int row = 0; row < rowsPerPartition; ++row)
+            {
+                keys[p].push_back("key_" + std::to_string(p) + "_" + std::to_string(row));
+                int c = pickCluster(generator);
+                for (int j = 0; j < columns; ++j)
+                {
+                    vectors[p].push_back(centers[c * columns + j] + noise(generator));
+                }
+            }
+        }
+
+        queries.clear();
+        for (int q = 0; q < batchSize; ++q)
+        {
+            int c = pickCluster(generator);
+            for (int j = 0; j < columns; ++j)
+            {
+                queries.push_back(centers[c * columns + j] + noise(generator));
+            }
+        }
+    }
+
+    void testListsCoverAllRows()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnIvfCpu knn(&data, numLists);
+
+        size_t rows = 0;
+        for (int l = 0; l < knn.getNumLists(); ++l)
+        {
+            rows += knn.getListSize(l);
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t) numPartitions * rowsPerPartition, rows);
+    }
+
+    void testFullProbeMatchesExact()
+    {
+        for (astdl::knn::Metric metric : { astdl::knn::Metric::INNER_PRODUCT, astdl::knn::Metric::COSINE,
+            astdl::knn::Metric::L2 })
+        {
+            astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32,
+                astdl::knn::Backend::CPU, astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS, metric);
+            load(data);
+            astdl::knn::KnnExactCpu exact(&data);
+            astdl::knn::KnnIvfCpu ivf(&data, numLists, numLists);
+
+            std::vector<std::string> exactKeys(batchSize * maxK);
+            std::vector<float> exactScores(batchSize * maxK);
+            std::vector<std::string> ivfKeys(batchSize * maxK);
+            std::vector<float> ivfScores(batchSize * maxK);
+            exact.search(maxK, queries.data(), exactKeys.data(), exactScores.data());
+            ivf.search(maxK, queries.data(), ivfKeys.data(), ivfScores.data());
+
+            for (int i = 0; i < batchSize * maxK; ++i)
+            {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(exactScores[i], ivfScores[i], 1e-4);
+            }
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, recall(exactKeys, ivfKeys, maxK), 1e-2);
+        }
+    }
+
+    void testFullProbeWithExclusionsMatchesExact()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu exact(&data);
+        astdl::knn::KnnIvfCpu ivf(&data, numLists, numLists);
+
+        // every other row of partition 0
+        std::vector<std::vector<uint64_t>> bitmasks(1, std::vector<uint64_t>((rowsPerPartition + 63) / 64,
+            0x5555555555555555ull));
+        astdl::knn::ExclusionSet exclusions = astdl::knn::ExclusionSet::fromBitmasks(bitmasks);
+
+        std::vector<uint32_t> exactPartitions(batchSize * maxK);
+        std::vector<uint32_t> exactRows(batchSize * maxK);
+        std::vector<float> exactScores(batchSize * maxK);
+        std::vector<uint32_t> ivfPartitions(batchSize * maxK);
+        std::vector<uint32_t> ivfRows(batchSize * maxK);
+        std::vector<float> ivfScores(batchSize * maxK);
+        exact.search(maxK, queries.data(), batchSize, { &exclusions }, exactPartitions.data(), exactRows.data(),
+            exactScores.data());
+        ivf.search(maxK, queries.data(), batchSize, { &exclusions }, ivfPartitions.data(), ivfRows.data(),
+            ivfScores.data());
+
+        for (int i = 0; i < batchSize * maxK; ++i)
+        {
+            CPPUNIT_ASSERT(!exclusions.contains(ivfPartitions[i], ivfRows[i]));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(exactScores[i], ivfScores[i], 1e-4);
+        }
+    }
+
+    void testRecallIncreasesWithNprobe()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnExactCpu exact(&data);
+        astdl::knn::KnnIvfCpu ivf(&data, numLists);
+
+        const int k = 10;
+        std::vector<std::string> exactKeys(batchSize * k);
+        std::vector<float> exactScores(batchSize * k);
+        exact.search(k, queries.data(), exactKeys.data(), exactScores.data());
+
+        std::vector<std::string> ivfKeys(batchSize * k);
+        std::vector<float> ivfScores(batchSize * k);
+        double previousRecall = 0.0;
+        for (int nprobe : { 1, 4, 16 })
+        {
+            ivf.setNprobe(nprobe);
+            ivf.search(k, queries.data(), ivfKeys.data(), ivfScores.data());
+            double r = recall(exactKeys, ivfKeys, k);
+            CPPUNIT_ASSERT(r >= previousRecall);
+            previousRecall = r;
+        }
+        CPPUNIT_ASSERT(previousRecall > 0.9);
+    }
+
+    void testSetNprobe_GreaterThanNumLists()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnIvfCpu knn(&data, numLists);
+        knn.setNprobe(numLists + 1);
+    }
+
+    void testCreate_MoreListsThanRows()
+    {
+        astdl::knn::KnnData data(numPartitions, batchSize, maxK, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        load(data);
+        astdl::knn::KnnIvfCpu knn(&data, numPartitions * rowsPerPartition + 1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestKnnIvfCpu);
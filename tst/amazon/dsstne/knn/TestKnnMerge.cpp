@@ -0,0 +1,178 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "amazon/dsstne/knn/KnnMerge.h"
+
+class TestKnnMerge: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestKnnMerge);
+
+    CPPUNIT_TEST(testMergeMatchesSort);
+    CPPUNIT_TEST(testMergeSinglePartition);
+    CPPUNIT_TEST(testMergeTiesPreferLowerPartition);
+    CPPUNIT_TEST(testMergeKeys);
+    CPPUNIT_TEST(testMergeKeyViews);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static const int batchSize = 17;
+    static const int width = 50;
+
+    std::vector<std::vector<float>> scores;
+    std::vector<std::vector<uint32_t>> indexes;
+    std::vector<float*> allScores;
+    std::vector<uint32_t*> allIndexes;
+
+    /**
+     * Fills numPartitions result lists (batchSize x width, sorted by descending score) whose scores
+     * are drawn from numValues distinct values, so small numValues produce ties.
+     */
+    void generate(int numPartitions, int numValues)
+    {
+        scores.assign(numPartitions, std::vector<float>(batchSize * width));
+        indexes.assign(numPartitions, std::vector<uint32_t>(batchSize * width));
+        allScores.clear();
+        allIndexes.clear();
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                float *row = scores[p].data() + i * width;
+                for (int j = 0; j < width; ++j)
+                {
+                    row[j] = (float) (rand() % numValues) / numValues;
+                    indexes[p][i * width + j] = rand() % 1000;
+                }
+                std::sort(row, row + width, std::greater<float>());
+            }
+            allScores.push_back(scores[p].data());
+            allIndexes.push_back(indexes[p].data());
+        }
+    }
+
+    /**
+     * (-score, partition, position) of the top k of query i by sorting all results; ties go to the
+     * lower partition, then the earlier position.
+     */
+    std::vector<std::tuple<float, int, int>> expected(int i, int k)
+    {
+        std::vector<std::tuple<float, int, int>> all;
+        for (int p = 0; p < (int) scores.size(); ++p)
+        {
+            for (int j = 0; j < width; ++j)
+            {
+                all.push_back(std::make_tuple(-scores[p][i * width + j], p, j));
+            }
+        }
+        std::sort(all.begin(), all.end());
+        all.resize(k);
+        return all;
+    }
+
+    void checkMerge(int numPartitions, int numValues, int k)
+    {
+        generate(numPartitions, numValues);
+        std::vector<float> mergedScores(batchSize * k);
+        std::vector<uint32_t> partitions(batchSize * k);
+        std::vector<uint32_t> rows(batchSize * k);
+        astdl::knn::mergeKnn(k, batchSize, width, numPartitions, allScores, allIndexes, mergedScores.data(),
+            partitions.data(), rows.data());
+
+        for (int i = 0; i < batchSize; ++i)
+        {
+            std::vector<std::tuple<float, int, int>> top = expected(i, k);
+            for (int col = 0; col < k; ++col)
+            {
+                int p = std::get<1>(top[col]);
+                int j = std::get<2>(top[col]);
+                CPPUNIT_ASSERT_EQUAL(-std::get<0>(top[col]), mergedScores[i * k + col]);
+                CPPUNIT_ASSERT_EQUAL((uint32_t) p, partitions[i * k + col]);
+                CPPUNIT_ASSERT_EQUAL(indexes[p][i * width + j], rows[i * k + col]);
+            }
+        }
+    }
+
+ public:
+
+    void setUp()
+    {
+        srand(33);
+    }
+
+    void testMergeMatchesSort()
+    {
+        for (int numPartitions = 2; numPartitions <= 8; ++numPartitions)
+        {
+            checkMerge(numPartitions, 1000000, 10);
+            checkMerge(numPartitions, 1000000, width);
+        }
+    }
+
+    void testMergeSinglePartition()
+    {
+        checkMerge(1, 1000000, 10);
+        checkMerge(1, 1000000, width);
+    }
+
+    void testMergeTiesPreferLowerPartition()
+    {
+        checkMerge(4, 3, width);
+    }
+
+    /**
+     * merges 3 partitions with keys and checks the keys with getKey(partition, row)
+     */
+    template<typename Key, typename GetKey>
+    void checkMergeKeys(GetKey getKey)
+    {
+        const int numPartitions = 3;
+        const int k = 20;
+        generate(numPartitions, 1000000);
+        std::vector<astdl::knn::KeyArena> allKeys(numPartitions);
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (int row = 0; row < 1000; ++row)
+            {
+                allKeys[p].append(std::to_string(p) + "_" + std::to_string(row));
+            }
+        }
+
+        std::vector<float> mergedScores(batchSize * k);
+        std::vector<Key> keys(batchSize * k);
+        astdl::knn::mergeKnn(k, batchSize, width, numPartitions, allScores, allIndexes, allKeys, mergedScores.data(),
+            keys.data());
+
+        for (int i = 0; i < batchSize; ++i)
+        {
+            std::vector<std::tuple<float, int, int>> top = expected(i, k);
+            for (int col = 0; col < k; ++col)
+            {
+                int p = std::get<1>(top[col]);
+                int j = std::get<2>(top[col]);
+                CPPUNIT_ASSERT_EQUAL(-std::get<0>(top[col]), mergedScores[i * k + col]);
+                CPPUNIT_ASSERT_EQUAL(std::to_string(p) + "_" + std::to_string(indexes[p][i * width + j]),
+                    getKey(keys[i * k + col]));
+            }
+        }
+    }
+
+    void testMergeKeys()
+    {
+        checkMergeKeys<std::string>([](const std::string &key) { return key; });
+    }
+
+    void testMergeKeyViews()
+    {
+        checkMergeKeys<astdl::knn::KeyView>([](const astdl::knn::KeyView &key) { return key.str(); });
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestKnnMerge);
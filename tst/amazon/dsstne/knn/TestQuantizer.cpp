@@ -0,0 +1,229 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/knn/KnnData.h"
+#include "amazon/dsstne/knn/KnnExactCpu.h"
+#include "amazon/dsstne/knn/Quantizer.h"
+
+#include "VectorDataReader.h"
+
+class TestQuantizer: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestQuantizer);
+
+    CPPUNIT_TEST(testScalarQuantizerReconstructionError);
+    CPPUNIT_TEST(testProductQuantizerLookupTableMatchesDecode);
+    CPPUNIT_TEST(testProductQuantizerExactOnCentroids);
+    CPPUNIT_TEST(testSearchInt8);
+    CPPUNIT_TEST(testSearchPq);
+    CPPUNIT_TEST(testCreate_Int8OnGpu);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    static const int numPartitions = 2;
+    static const int rowsPerPartition = 3000;
+    static const int columns = 32;
+    static const int batchSize = 40;
+    static const int k = 10;
+
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<float>> vectors;
+    std::vector<float> queries;
+
+    void load(astdl::knn::KnnData &data)
+    {
+        std::map<int, DataReader*> readers;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            readers[p] = new VectorDataReader(keys[p], vectors[p], columns);
+        }
+        data.load(readers);
+        for (auto &entry : readers)
+        {
+            delete entry.second;
+        }
+    }
+
+    /**
+     * recall@k of a search over data stored as dataType against the fp32 search.
+     */
+    double recall(astdl::knn::DataType dataType, size_t *sizeInBytes,
+                  int pqSubspaceColumns = astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS)
+    {
+        astdl::knn::KnnData exactData(numPartitions, batchSize, k, astdl::knn::DataType::FP32, astdl::knn::Backend::CPU);
+        astdl::knn::KnnData data(numPartitions, batchSize, k, dataType, astdl::knn::Backend::CPU, pqSubspaceColumns);
+        load(exactData);
+        load(data);
+        *sizeInBytes = data.getHostDataSizeInBytes();
+
+        std::vector<std::string> exactKeys(batchSize * k);
+        std::vector<std::string> resultKeys(batchSize * k);
+        std::vector<float> scores(batchSize * k);
+        astdl::knn::KnnExactCpu(&exactData).search(k, queries.data(), exactKeys.data(), scores.data());
+        astdl::knn::KnnExactCpu(&data).search(k, queries.data(), resultKeys.data(), scores.data());
+
+        size_t hits = 0;
+        for (int q = 0; q < batchSize; ++q)
+        {
+            std::set<std::string> expected(exactKeys.begin() + q * k, exactKeys.begin() + (q + 1) * k);
+            for (int i = 0; i < k; ++i)
+            {
+                hits += expected.count(resultKeys[q * k + i]);
+            }
+        }
+        return (double) hits / (batchSize * k);
+    }
+
+ public:
+    void setUp()
+    {
+        // a few dominant directions so that the top k is well separated from the rest
+        std::mt19937 generator(11);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        const int clusters = 64;
+        std::vector<float> centers(clusters * columns);
+        for (float &center : centers)
+        {
+            center = normal(generator);
+        }
+
+        keys.assign(numPartitions, std::vector<std::string>());
+        vectors.assign(numPartitions, std::vector<float>());
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            for (int row = 0; row < rowsPerPartition; ++row)
+            {
+                keys[p].push_back("key_" + std::to_string(p) + "_" + std::to_string(row));
+                int c = generator() % clusters;
+                for (int j = 0; j < columns; ++j)
+                {
+                    vectors[p].push_back(centers[c * columns + j] + 0.3f * normal(generator));
+                }
+            }
+        }
+
+        queries.clear();
+        for (int i = 0; i < batchSize * columns; ++i)
+        {
+            queries.push_back(normal(generator));
+        }
+    }
+
+    void testScalarQuantizerReconstructionError()
+    {
+        const std::vector<float> &rows = vectors[0];
+        astdl::knn::ScalarQuantizer quantizer;
+        quantizer.train(rows.data(), rowsPerPartition, columns);
+
+        for (int j = 0; j < columns; ++j)
+        {
+            float min = rows[j];
+            float max = rows[j];
+            for (int row = 0; row < rowsPerPartition; ++row)
+            {
+                min = std::min(min, rows[row * columns + j]);
+                max = std::max(max, rows[row * columns + j]);
+            }
+            float halfStep = (max - min) / 255.0f / 2.0f;
+
+            for (int row = 0; row < rowsPerPartition; ++row)
+            {
+                float value = rows[row * columns + j];
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(value, quantizer.decode(j, quantizer.encode(j, value)), halfStep * 1.001);
+            }
+            // out of range values are clamped
+            CPPUNIT_ASSERT_EQUAL((int) 0, (int) quantizer.encode(j, min - 1.0f));
+            CPPUNIT_ASSERT_EQUAL((int) 255, (int) quantizer.encode(j, max + 1.0f));
+        }
+    }
+
+    void testProductQuantizerLookupTableMatchesDecode()
+    {
+        // 32 columns in subspaces of 5 leaves a narrower last subspace
+        astdl::knn::ProductQuantizer quantizer;
+        quantizer.train(vectors[0].data(), rowsPerPartition, columns, 5, 5, 1);
+        CPPUNIT_ASSERT_EQUAL(7, quantizer.getNumSubspaces());
+        CPPUNIT_ASSERT_EQUAL(256, quantizer.getNumCentroids());
+
+        std::vector<uint8_t> codes(rowsPerPartition * quantizer.getCodeSize());
+        quantizer.encode(vectors[0].data(), rowsPerPartition, codes.data());
+
+        std::vector<float> table(quantizer.getNumSubspaces() * quantizer.getNumCentroids());
+        quantizer.computeLookupTable(queries.data(), table.data());
+
+        std::vector<float> decoded(columns);
+        for (int row = 0; row < 100; ++row)
+        {
+            const uint8_t *code = codes.data() + row * quantizer.getCodeSize();
+            quantizer.decode(code, decoded.data());
+            float expected = 0.0f;
+            for (int j = 0; j < columns; ++j)
+            {
+                expected += queries[j] * decoded[j];
+            }
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, quantizer.score(table.data(), code), 1e-3);
+        }
+    }
+
+    void testProductQuantizerExactOnCentroids()
+    {
+        // fewer distinct training vectors than centroids: every vector is its own centroid
+        const int n = 100;
+        astdl::knn::ProductQuantizer quantizer;
+        quantizer.train(vectors[0].data(), n, columns, 8, 5, 1);
+        CPPUNIT_ASSERT_EQUAL(n, quantizer.getNumCentroids());
+
+        std::vector<uint8_t> codes(n * quantizer.getCodeSize());
+        quantizer.encode(vectors[0].data(), n, codes.data());
+        std::vector<float> decoded(columns);
+        for (int row = 0; row < n; ++row)
+        {
+            quantizer.decode(codes.data() + row * quantizer.getCodeSize(), decoded.data());
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(vectors[0][row * columns + j], decoded[j], 1e-5);
+            }
+        }
+    }
+
+    void testSearchInt8()
+    {
+        size_t sizeInBytes;
+        double r = recall(astdl::knn::DataType::INT8, &sizeInBytes);
+        CPPUNIT_ASSERT_EQUAL((size_t) numPartitions * rowsPerPartition * columns, sizeInBytes);
+        CPPUNIT_ASSERT(r > 0.9);
+    }
+
+    void testSearchPq()
+    {
+        size_t sizeInBytes;
+        double r = recall(astdl::knn::DataType::PQ, &sizeInBytes);
+        size_t codesInBytes = (size_t) numPartitions * rowsPerPartition * columns
+            / astdl::knn::KnnData::DEFAULT_PQ_SUBSPACE_COLUMNS;
+        size_t codebooksInBytes = (size_t) numPartitions * 256 * columns * sizeof(float);
+        CPPUNIT_ASSERT_EQUAL(codesInBytes + codebooksInBytes, sizeInBytes);
+        // no reranking, 16x smaller than fp32: well above chance (k / rows) but far from exact
+        CPPUNIT_ASSERT(r > 0.3);
+
+        // one column per subspace is 8-bit non-uniform scalar quantization
+        r = recall(astdl::knn::DataType::PQ, &sizeInBytes, 1);
+        CPPUNIT_ASSERT(r > 0.9);
+    }
+
+    void testCreate_Int8OnGpu()
+    {
+        CPPUNIT_ASSERT_THROW(
+            astdl::knn::KnnData data(1, batchSize, k, astdl::knn::DataType::INT8, astdl::knn::Backend::GPU),
+            std::invalid_argument);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestQuantizer);
@@ -0,0 +1,204 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "amazon/dsstne/knn/DataReader.h"
+
+class TestTextFileDataReader: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestTextFileDataReader);
+
+    CPPUNIT_TEST(testReadRows);
+    CPPUNIT_TEST(testAppendRows);
+    CPPUNIT_TEST(testFloatFormats);
+    CPPUNIT_TEST(testLargeFileKeepsRowOrder);
+    CPPUNIT_TEST(testEmptyFile);
+    CPPUNIT_TEST_EXCEPTION(testMissingKeyValueDelimiter, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testInconsistentColumns, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testMalformedFloat, std::invalid_argument);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    std::string fileName;
+
+    void write(const std::string &content)
+    {
+        std::ofstream out(fileName, std::ios_base::out | std::ios_base::trunc);
+        out << content;
+    }
+
+ public:
+    void setUp()
+    {
+        char name[] = "/tmp/TestTextFileDataReader.XXXXXX";
+        int fd = mkstemp(name);
+        close(fd);
+        fileName = name;
+    }
+
+    void tearDown()
+    {
+        remove(fileName.c_str());
+    }
+
+    void testReadRows()
+    {
+        // empty lines are skipped, windows line endings and a trailing delimiter are accepted
+        write("a\t1 2 3\n\nbb\t-4 5.5 6e1\r\nccc\t7 8 9 \n");
+        TextFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 3, reader.getRows());
+        CPPUNIT_ASSERT_EQUAL(3, reader.getColumns());
+
+        std::string key;
+        float vector[3];
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT_EQUAL(std::string("a"), key);
+        CPPUNIT_ASSERT_EQUAL(1.0f, vector[0]);
+        CPPUNIT_ASSERT_EQUAL(3.0f, vector[2]);
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT_EQUAL(std::string("bb"), key);
+        CPPUNIT_ASSERT_EQUAL(-4.0f, vector[0]);
+        CPPUNIT_ASSERT_EQUAL(5.5f, vector[1]);
+        CPPUNIT_ASSERT_EQUAL(60.0f, vector[2]);
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT_EQUAL(std::string("ccc"), key);
+        CPPUNIT_ASSERT_EQUAL(9.0f, vector[2]);
+        CPPUNIT_ASSERT(!reader.readRow(&key, vector));
+    }
+
+    void testAppendRows()
+    {
+        write("a\t1 2\nbb\t3 4\n\t5 6\nccc\t7 8\n");
+        TextFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((size_t) 6, reader.getKeySizeInBytes());
+
+        astdl::knn::KeyArena keys;
+        std::string key;
+        float vector[2];
+        CPPUNIT_ASSERT(reader.appendRow(&keys, vector));
+        CPPUNIT_ASSERT_EQUAL(2.0f, vector[1]);
+        // both read paths can be mixed
+        CPPUNIT_ASSERT(reader.readRow(&key, vector));
+        CPPUNIT_ASSERT_EQUAL(std::string("bb"), key);
+        CPPUNIT_ASSERT(reader.appendRow(&keys, vector));
+        CPPUNIT_ASSERT(reader.appendRow(&keys, vector));
+        CPPUNIT_ASSERT_EQUAL(8.0f, vector[1]);
+        CPPUNIT_ASSERT(!reader.appendRow(&keys, vector));
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, keys.size());
+        CPPUNIT_ASSERT_EQUAL(std::string("a"), keys[0].str());
+        CPPUNIT_ASSERT_EQUAL(std::string(""), keys[1].str());
+        CPPUNIT_ASSERT_EQUAL(std::string("ccc"), keys[2].str());
+    }
+
+    void testFloatFormats()
+    {
+        std::vector<std::string> literals = { "0", "-0", "+1.5", ".25", "3.", "1e-3", "-2.5E+2", "0.000001234",
+            "123456789012345678901234", "3.4028234e38", "1e-40", "inf", "-nan", "0x1p-2" };
+        std::string line = "key\t";
+        for (size_t i = 0; i < literals.size(); ++i)
+        {
+            line += literals[i] + (i + 1 < literals.size() ? "," : "\n");
+        }
+        write(line);
+
+        TextFileDataReader reader(fileName, '\t', ',');
+        CPPUNIT_ASSERT_EQUAL((int) literals.size(), reader.getColumns());
+        std::string key;
+        std::vector<float> vector(literals.size());
+        CPPUNIT_ASSERT(reader.readRow(&key, vector.data()));
+        for (size_t i = 0; i < literals.size(); ++i)
+        {
+            float expected = strtof(literals[i].c_str(), nullptr);
+            if (std::isnan(expected))
+            {
+                CPPUNIT_ASSERT(std::isnan(vector[i]));
+            } else
+            {
+                CPPUNIT_ASSERT_EQUAL(expected, vector[i]);
+            }
+        }
+    }
+
+    void testLargeFileKeepsRowOrder()
+    {
+        // large enough to be split into several chunks
+        const int rows = 100000;
+        const int columns = 8;
+        std::mt19937 generator(3);
+        std::normal_distribution<float> normal(0.0f, 10.0f);
+        std::vector<float> expected;
+        {
+            std::ofstream out(fileName);
+            char buffer[32];
+            for (int row = 0; row < rows; ++row)
+            {
+                out << "key" << row << '\t';
+                for (int j = 0; j < columns; ++j)
+                {
+                    float value = normal(generator);
+                    snprintf(buffer, sizeof(buffer), "%.9g", value);
+                    expected.push_back(strtof(buffer, nullptr));
+                    out << buffer << (j + 1 < columns ? ' ' : '\n');
+                }
+            }
+        }
+
+        TextFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) rows, reader.getRows());
+        CPPUNIT_ASSERT_EQUAL(columns, reader.getColumns());
+
+        std::string key;
+        float vector[columns];
+        for (int row = 0; row < rows; ++row)
+        {
+            CPPUNIT_ASSERT(reader.readRow(&key, vector));
+            CPPUNIT_ASSERT_EQUAL("key" + std::to_string(row), key);
+            for (int j = 0; j < columns; ++j)
+            {
+                CPPUNIT_ASSERT_EQUAL(expected[row * columns + j], vector[j]);
+            }
+        }
+        CPPUNIT_ASSERT(!reader.readRow(&key, vector));
+    }
+
+    void testEmptyFile()
+    {
+        write("");
+        TextFileDataReader reader(fileName);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, reader.getRows());
+        std::string key;
+        float vector[1];
+        CPPUNIT_ASSERT(!reader.readRow(&key, vector));
+    }
+
+    void testMissingKeyValueDelimiter()
+    {
+        write("a\t1 2\nb 3 4\n");
+        TextFileDataReader reader(fileName);
+    }
+
+    void testInconsistentColumns()
+    {
+        write("a\t1 2\nb\t3 4 5\n");
+        TextFileDataReader reader(fileName);
+    }
+
+    void testMalformedFloat()
+    {
+        write("a\t1 2x\n");
+        TextFileDataReader reader(fileName);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestTextFileDataReader);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "amazon/dsstne/knn/DataReader.h"
+
+/**
+ * DataReader over rows held in memory.
+ */
+class VectorDataReader: public DataReader
+{
+  public:
+    VectorDataReader(const std::vector<std::string> &keys, const std::vector<float> &vectors, int columns) :
+        keys(keys),
+        vectors(vectors),
+        position(0)
+    {
+        this->rows = keys.size();
+        this->columns = columns;
+    }
+
+    bool readRow(std::string *key, float *vector)
+    {
+        if (position >= rows)
+        {
+            return false;
+        }
+        *key = keys[position];
+        std::copy(vectors.begin() + position * columns, vectors.begin() + (position + 1) * columns, vector);
+        ++position;
+        return true;
+    }
+
+  private:
+    std::vector<std::string> keys;
+    std::vector<float> vectors;
+    uint32_t position;
+};
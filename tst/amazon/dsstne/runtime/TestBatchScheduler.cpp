@@ -0,0 +1,168 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "amazon/dsstne/runtime/BatchScheduler.h"
+
+class TestBatchScheduler: public CppUnit::TestFixture
+{
+
+CPPUNIT_TEST_SUITE(TestBatchScheduler);
+
+    CPPUNIT_TEST(testResponsesMatchRequests);
+    CPPUNIT_TEST(testFullBatchIsDispatchedBeforeDeadline);
+    CPPUNIT_TEST(testPartialBatchIsDispatchedAtDeadline);
+    CPPUNIT_TEST(testMultipleWorkers);
+    CPPUNIT_TEST(testExceptionIsPropagated);
+    CPPUNIT_TEST(testShutdownDrainsQueue);
+    CPPUNIT_TEST_EXCEPTION(testSubmitAfterShutdown, std::runtime_error);
+
+    CPPUNIT_TEST_SUITE_END();
+
+ private:
+    typedef BatchScheduler<int, int> Scheduler;
+
+    std::mutex mutex;
+    std::vector<size_t> batchSizes;
+
+    Scheduler::BatchFunction square()
+    {
+        return [this](int, std::vector<int> &requests, std::vector<int> &responses)
+        {
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                responses[i] = requests[i] * requests[i];
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            batchSizes.push_back(requests.size());
+        };
+    }
+
+ public:
+    void setUp()
+    {
+        batchSizes.clear();
+    }
+
+    void testResponsesMatchRequests()
+    {
+        Scheduler scheduler(square(), 8, std::chrono::microseconds(1000));
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 100; ++i)
+        {
+            futures.push_back(scheduler.submit(i));
+        }
+        for (int i = 0; i < 100; ++i)
+        {
+            CPPUNIT_ASSERT_EQUAL(i * i, futures[i].get());
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t) 100, scheduler.getNumRequests());
+        for (size_t batchSize : batchSizes)
+        {
+            CPPUNIT_ASSERT(batchSize <= 8);
+        }
+    }
+
+    void testFullBatchIsDispatchedBeforeDeadline()
+    {
+        // a deadline that is never reached within the test: only full batches are dispatched
+        Scheduler scheduler(square(), 4, std::chrono::microseconds(60000000));
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 4; ++i)
+        {
+            futures.push_back(scheduler.submit(i));
+        }
+        CPPUNIT_ASSERT(futures[3].wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        CPPUNIT_ASSERT_EQUAL(9, futures[3].get());
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, scheduler.getNumBatches());
+    }
+
+    void testPartialBatchIsDispatchedAtDeadline()
+    {
+        Scheduler scheduler(square(), 1000, std::chrono::microseconds(20000));
+        auto start = std::chrono::steady_clock::now();
+        std::future<int> a = scheduler.submit(2);
+        std::future<int> b = scheduler.submit(3);
+        CPPUNIT_ASSERT_EQUAL(4, a.get());
+        CPPUNIT_ASSERT_EQUAL(9, b.get());
+        CPPUNIT_ASSERT(std::chrono::steady_clock::now() - start >= std::chrono::microseconds(20000));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, batchSizes.size());
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, batchSizes[0]);
+    }
+
+    void testMultipleWorkers()
+    {
+        // slow batches, so a single worker could not finish them all in time
+        std::atomic<int> active(0);
+        std::atomic<int> maxActive(0);
+        Scheduler scheduler([&](int worker, std::vector<int> &requests, std::vector<int> &responses)
+        {
+            int now = ++active;
+            int seen = maxActive;
+            while (now > seen && !maxActive.compare_exchange_weak(seen, now))
+            {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                responses[i] = worker;
+            }
+            --active;
+        }, 2, std::chrono::microseconds(100), 4);
+
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 8; ++i)
+        {
+            futures.push_back(scheduler.submit(i));
+        }
+        for (std::future<int> &future : futures)
+        {
+            int worker = future.get();
+            CPPUNIT_ASSERT(worker >= 0 && worker < 4);
+        }
+        CPPUNIT_ASSERT(maxActive > 1);
+    }
+
+    void testExceptionIsPropagated()
+    {
+        Scheduler scheduler([](int, std::vector<int>&, std::vector<int>&)
+        {
+            throw std::invalid_argument("bad batch");
+        }, 2, std::chrono::microseconds(100));
+        std::future<int> a = scheduler.submit(1);
+        std::future<int> b = scheduler.submit(2);
+        CPPUNIT_ASSERT_THROW(a.get(), std::invalid_argument);
+        CPPUNIT_ASSERT_THROW(b.get(), std::invalid_argument);
+    }
+
+    void testShutdownDrainsQueue()
+    {
+        std::vector<std::future<int>> futures;
+        {
+            Scheduler scheduler(square(), 1000, std::chrono::microseconds(60000000));
+            for (int i = 0; i < 10; ++i)
+            {
+                futures.push_back(scheduler.submit(i));
+            }
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            CPPUNIT_ASSERT_EQUAL(i * i, futures[i].get());
+        }
+    }
+
+    void testSubmitAfterShutdown()
+    {
+        Scheduler scheduler(square(), 8, std::chrono::microseconds(1000));
+        scheduler.shutdown();
+        scheduler.submit(1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestBatchScheduler);
@@ -0,0 +1,185 @@
+// CppUnit
+#include "cppunit/extensions/HelperMacros.h"
+#include "cppunit/ui/text/TestRunner.h"
+#include "cppunit/TestAssert.h"
+// STL
+#include <cmath>
+#include <string>
+
+#include "Utils.h"
+#include "GpuTypes.h"
+#include "NNTypes.h"
+#include "TestUtils.h"
+
+/**
+ * Runs a network on the GPU, saves it and checks that NNCpuNetwork loaded from
+ * the saved NetCDF file predicts the same output units for every batch.
+ */
+inline bool compareCpuNetwork(const uint32_t batch, const std::string& modelPath, const TestDataType testDataType, const DataParameters& dataParameters, std::ostream& out) {
+    out << "start CPU comparison of " << modelPath << std::endl;
+
+    const std::string dataPath(TEST_DATA_PATH);
+    const std::string networkPath = dataPath + "cpu_network.nc";
+    const NNFloat tolerance = 1.0e-4f;
+    generateTestData(dataPath, testDataType, dataParameters, out);
+    std::vector<NNDataSetBase*> vDataSet = LoadNetCDF(dataPath + "test.nc");
+    NNNetwork* pNetwork = LoadNeuralNetworkJSON(modelPath, batch, vDataSet);
+    pNetwork->LoadDataSets(vDataSet);
+    pNetwork->SaveNetCDF(networkPath);
+
+    // Host copies of the data sets stay intact after loading them into the GPU network
+    NNCpuNetwork* pCpuNetwork = LoadCpuNeuralNetworkNetCDF(networkPath, batch);
+    bool valid = (pCpuNetwork != NULL) && pCpuNetwork->LoadDataSets(vDataSet);
+
+    NNLayer* pOutputLayer = pNetwork->GetLayer("Output");
+    uint32_t Nx, Ny, Nz, Nw;
+    std::tie(Nx, Ny, Nz, Nw) = pOutputLayer->GetDimensions();
+    const uint32_t stride = Nx * Ny * Nz * Nw;
+    std::vector<NNFloat> vGpuUnit(batch * stride);
+    std::vector<NNFloat> vCpuUnit;
+    NNFloat maxError = 0.0f;
+    for (uint32_t pos = 0; valid && (pos < pNetwork->GetExamples()); pos += batch) {
+        pNetwork->SetPosition(pos);
+        pNetwork->PredictBatch();
+        pOutputLayer->GetUnits(vGpuUnit);
+
+        pCpuNetwork->SetPosition(pos);
+        valid = pCpuNetwork->PredictBatch() && pCpuNetwork->GetUnits("Output", vCpuUnit);
+        const uint32_t examples = std::min(batch, pNetwork->GetExamples() - pos);
+        for (uint32_t i = 0; valid && (i < examples * stride); i++) {
+            // relative error, the regression inputs go up to the number of samples
+            maxError = std::max(maxError, std::fabs(vGpuUnit[i] - vCpuUnit[i]) / std::max(1.0f, std::fabs(vGpuUnit[i])));
+        }
+    }
+    valid = valid && (maxError <= tolerance);
+    out << (valid ? "SUCCESFUL" : "FAILED") << " CPU comparison, maximum error " << maxError << std::endl;
+
+    delete pCpuNetwork;
+    delete pNetwork;
+    for (auto p : vDataSet) {
+        delete p;
+    }
+    return valid;
+}
+
+/**
+ * Trains a network on the GPU and NNCpuNetwork from the same initial network
+ * and data, and checks that single threaded CPU training ends with the same
+ * error and Hogwild training with several threads with a similar one.
+ */
+inline bool compareCpuTraining(const uint32_t batch, const uint32_t epochs, const std::string& modelPath, const TestDataType testDataType, const DataParameters& dataParameters, std::ostream& out) {
+    out << "start CPU training comparison of " << modelPath << std::endl;
+
+    const std::string dataPath(TEST_DATA_PATH);
+    const std::string networkPath = dataPath + "cpu_initial_network.nc";
+    const NNFloat alpha = 0.01f, lambda = 0.0001f, mu = 0.5f;
+    generateTestData(dataPath, testDataType, dataParameters, out);
+    std::vector<NNDataSetBase*> vDataSet = LoadNetCDF(dataPath + "test.nc");
+    NNNetwork* pNetwork = LoadNeuralNetworkJSON(modelPath, batch, vDataSet);
+    pNetwork->LoadDataSets(vDataSet);
+    pNetwork->SaveNetCDF(networkPath);
+    pNetwork->SetTrainingMode(SGD);
+    NNFloat gpuError = pNetwork->Train(epochs, alpha, lambda, 0.0f, mu, 0.0f);
+
+    // The GPU network shards its data sets, so each CPU network gets fresh copies
+    bool valid = true;
+    NNFloat cpuError[2] = { 0.0f, 0.0f };
+    const uint32_t threads[2] = { 1, 4 };
+    for (int i = 0; valid && (i < 2); i++) {
+        std::vector<NNDataSetBase*> vCpuDataSet = LoadNetCDF(dataPath + "test.nc");
+        NNCpuNetwork* pCpuNetwork = LoadCpuNeuralNetworkNetCDF(networkPath, batch);
+        valid = (pCpuNetwork != NULL) && pCpuNetwork->LoadDataSets(vCpuDataSet);
+        if (valid) {
+            pCpuNetwork->SetTrainingMode(SGD);
+            pCpuNetwork->SetThreads(threads[i]);
+            cpuError[i] = pCpuNetwork->Train(epochs, alpha, lambda, 0.0f, mu, 0.0f);
+        }
+        delete pCpuNetwork;
+        for (auto p : vCpuDataSet) {
+            delete p;
+        }
+    }
+
+    // Hogwild updates read weights other threads are changing, so only expect a similar error
+    const NNFloat syncError = std::fabs(cpuError[0] - gpuError) / gpuError;
+    const NNFloat hogwildError = std::fabs(cpuError[1] - gpuError) / gpuError;
+    valid = valid && (syncError <= 1.0e-3f) && (hogwildError <= 0.1f);
+    out << (valid ? "SUCCESFUL" : "FAILED") << " CPU training comparison, GPU error " << gpuError << ", CPU error " << cpuError[0]
+        << ", Hogwild CPU error " << cpuError[1] << std::endl;
+
+    delete pNetwork;
+    for (auto p : vDataSet) {
+        delete p;
+    }
+    return valid;
+}
+
+class TestCpuNetwork: public CppUnit::TestFixture {
+public:
+    // Interface
+    void testCpuNetwork() {
+        // Initialize GPU
+        getGpu().SetRandomSeed(12345);
+        getGpu().CopyConstants();
+
+        // dense input (sparse data set above the fast sparse density), sigmoid and linear
+        {
+            const uint32_t batch = 4;
+            const string modelPath = std::string(TEST_DATA_PATH) + "validate_L2_02.json";
+            DataParameters dataParameters;
+            dataParameters.numberOfSamples = 1024;
+            dataParameters.inpFeatureDimensionality = 1;
+            dataParameters.outFeatureDimensionality = 1;
+            bool result = compareCpuNetwork(batch, modelPath, Regression, dataParameters, std::cout);
+            CPPUNIT_ASSERT_MESSAGE("failed on validate_L2_02", result);
+        }
+
+        // leaky RELU
+        {
+            const uint32_t batch = 4;
+            const string modelPath = std::string(TEST_DATA_PATH) + "validate_L2_LRelu_02.json";
+            DataParameters dataParameters;
+            dataParameters.numberOfSamples = 1024;
+            dataParameters.inpFeatureDimensionality = 2;
+            dataParameters.outFeatureDimensionality = 2;
+            bool result = compareCpuNetwork(batch, modelPath, Regression, dataParameters, std::cout);
+            CPPUNIT_ASSERT_MESSAGE("failed on validate_L2_LRelu_02", result);
+        }
+
+        // fast sparse input, RELU, tanh and softmax, with a partial last batch
+        {
+            const uint32_t batch = 100;
+            const string modelPath = std::string(TEST_DATA_PATH) + "validate_CpuNetwork_01.json";
+            DataParameters dataParameters;
+            dataParameters.numberOfSamples = 1024;
+            dataParameters.inpFeatureDimensionality = 32;
+            dataParameters.outFeatureDimensionality = 8;
+            bool result = compareCpuNetwork(batch, modelPath, Classification, dataParameters, std::cout);
+            CPPUNIT_ASSERT_MESSAGE("failed on validate_CpuNetwork_01", result);
+        }
+    }
+
+    void testCpuTraining() {
+        // Initialize GPU
+        getGpu().SetRandomSeed(12345);
+        getGpu().CopyConstants();
+
+        // fast sparse input, RELU, tanh and softmax
+        {
+            const uint32_t batch = 32;
+            const string modelPath = std::string(TEST_DATA_PATH) + "validate_CpuNetwork_01.json";
+            DataParameters dataParameters;
+            dataParameters.numberOfSamples = 1024;
+            dataParameters.inpFeatureDimensionality = 32;
+            dataParameters.outFeatureDimensionality = 8;
+            bool result = compareCpuTraining(batch, 4, modelPath, Classification, dataParameters, std::cout);
+            CPPUNIT_ASSERT_MESSAGE("failed training validate_CpuNetwork_01", result);
+        }
+    }
+
+public:
+    CPPUNIT_TEST_SUITE(TestCpuNetwork);
+    CPPUNIT_TEST(testCpuNetwork);
+    CPPUNIT_TEST(testCpuTraining);
+    CPPUNIT_TEST_SUITE_END();
+};
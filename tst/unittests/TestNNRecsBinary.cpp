@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/TestAssert.h>
+
+#include "NNRecsBinary.h"
+
+class TestNNRecsBinary : public CppUnit::TestFixture
+{
+    void writeRecs(const std::string &fileName, const NNRecsBinaryHeader &header,
+                   const std::vector<uint32_t> &indexes, const std::vector<float> &scores, uint32_t samples)
+    {
+        FILE *fp = fopen(fileName.c_str(), "wb");
+        writeRecsBinaryHeader(fp, header);
+        std::string out;
+        for (uint32_t sample = 0; sample < samples; sample++)
+        {
+            appendRecsBinaryRecord(out, header, sample * 7, &indexes[sample * header.k], &scores[sample * header.k]);
+        }
+        fwrite(out.data(), 1, out.size(), fp);
+        fclose(fp);
+    }
+
+public:
+    void TestHalfConversion()
+    {
+        const float values[] = { 0.0f, 1.0f, -2.5f, 0.333251953125f, 65504.0f, 6.103515625e-05f, 5.9604644775390625e-08f };
+        for (float value : values)
+        {
+            CPPUNIT_ASSERT_EQUAL(value, halfToFloat(floatToHalf(value)));
+        }
+        CPPUNIT_ASSERT(std::isinf(halfToFloat(floatToHalf(1.0e6f))));
+        // 1 + 2^-11 is halfway between two halfs and rounds to even
+        CPPUNIT_ASSERT_EQUAL(1.0f, halfToFloat(floatToHalf(1.00048828125f)));
+    }
+
+    void TestRoundTrip()
+    {
+        const uint32_t samples = 3;
+        NNRecsBinaryHeader header;
+        header.k = 4;
+        header.featureIndexFileName = "features_output";
+        header.sampleIndexFileName = "gl_predict.samplesIndex";
+
+        std::vector<uint32_t> indexes;
+        std::vector<float> scores;
+        for (uint32_t i = 0; i < samples * header.k; i++)
+        {
+            indexes.push_back(i * 3);
+            scores.push_back(1.0f / (i + 1));
+        }
+        indexes[5] = RECS_BINARY_INVALID_INDEX;
+
+        const NNRecsScoreType scoreTypes[] = { RecsScoreFP32, RecsScoreFP16 };
+        for (NNRecsScoreType scoreType : scoreTypes)
+        {
+            header.scoreType = scoreType;
+            const std::string fileName = "TestNNRecsBinary.recs";
+            writeRecs(fileName, header, indexes, scores, samples);
+
+            NNRecsBinaryReader reader(fileName);
+            CPPUNIT_ASSERT_EQUAL(header.k, reader.getHeader().k);
+            CPPUNIT_ASSERT_EQUAL(scoreType, reader.getHeader().scoreType);
+            CPPUNIT_ASSERT_EQUAL(header.featureIndexFileName, reader.getHeader().featureIndexFileName);
+            CPPUNIT_ASSERT_EQUAL(header.sampleIndexFileName, reader.getHeader().sampleIndexFileName);
+
+            uint32_t sampleId;
+            std::vector<uint32_t> readIndexes(header.k);
+            std::vector<float> readScores(header.k);
+            for (uint32_t sample = 0; sample < samples; sample++)
+            {
+                CPPUNIT_ASSERT(reader.readRecord(&sampleId, readIndexes.data(), readScores.data()));
+                CPPUNIT_ASSERT_EQUAL(sample * 7, sampleId);
+                for (uint32_t x = 0; x < header.k; x++)
+                {
+                    CPPUNIT_ASSERT_EQUAL(indexes[sample * header.k + x], readIndexes[x]);
+                    float tolerance = (scoreType == RecsScoreFP16) ? 1.0e-3f : 0.0f;
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(scores[sample * header.k + x], readScores[x], tolerance);
+                }
+            }
+            CPPUNIT_ASSERT(!reader.readRecord(&sampleId, readIndexes.data(), readScores.data()));
+            remove(fileName.c_str());
+        }
+    }
+
+    CPPUNIT_TEST_SUITE(TestNNRecsBinary);
+    CPPUNIT_TEST(TestHalfConversion);
+    CPPUNIT_TEST(TestRoundTrip);
+    CPPUNIT_TEST_SUITE_END();
+};